@@ -647,7 +647,8 @@ struct Response
   // already specified.
   //
   // PATH: Attempts to perform a 'sendfile' operation on the file
-  // found at 'path'.
+  // found at 'path'. Only the bytes of the file within 'range' are
+  // sent, if set.
   //
   // PIPE: Splices data from the Pipe 'reader' using a "chunked"
   // 'Transfer-Encoding'. The writer uses a Pipe::Writer to
@@ -671,6 +672,17 @@ struct Response
   std::string path;
   Option<Pipe::Reader> reader;
 
+  // A range of bytes of the file of a PATH response, which is capped
+  // at the size of the file when it is sent. Note that the caller is
+  // expected to set the status and the 'Content-Range' header.
+  struct Range
+  {
+    size_t offset;
+    size_t length;
+  };
+
+  Option<Range> range;
+
   uint16_t code;
 };
 
@@ -233,14 +233,19 @@ public:
 class FileEncoder : public Encoder
 {
 public:
-  FileEncoder(int_fd _fd, size_t _size)
-    : fd(_fd), size(static_cast<off_t>(_size)), index(0)
+  // Encodes `_size` bytes of the file starting at `offset`.
+  FileEncoder(int_fd _fd, size_t _size, size_t offset = 0)
+    : fd(_fd),
+      size(static_cast<off_t>(offset + _size)),
+      index(static_cast<off_t>(offset))
   {
     // NOTE: For files, we expect the size to be derived from `stat`-ing
     // the file.  The `struct stat` returns the size in `off_t` form,
     // meaning that it is a programmer error to construct the `FileEncoder`
     // with a size greater the max value of `off_t`.
-    CHECK_LE(_size, static_cast<size_t>(std::numeric_limits<off_t>::max()));
+    CHECK_LE(
+        offset + _size,
+        static_cast<size_t>(std::numeric_limits<off_t>::max()));
   }
 
   ~FileEncoder() override
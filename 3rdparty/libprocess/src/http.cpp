@@ -1738,9 +1738,17 @@ Future<Nothing> sendfile(
     return send(socket, InternalServerError(body), request);
   }
 
+  size_t offset = 0;
+  size_t length = size->bytes();
+
+  if (response.range.isSome()) {
+    offset = std::min(response.range->offset, length);
+    length = std::min(response.range->length, length - offset);
+  }
+
   // While the user is expected to properly set a 'Content-Type'
   // header, we'll fill in (or overwrite) 'Content-Length' header.
-  response.headers["Content-Length"] = stringify(size->bytes());
+  response.headers["Content-Length"] = stringify(length);
 
   // TODO(benh): If this is a TCP socket consider turning on TCP_CORK
   // for both sends and then turning it off.
@@ -1757,7 +1765,7 @@ Future<Nothing> sendfile(
     })
     .then([=]() mutable -> Future<Nothing> {
       // NOTE: the file descriptor gets closed by FileEncoder.
-      Encoder* encoder = new FileEncoder(fd.get(), size->bytes());
+      Encoder* encoder = new FileEncoder(fd.get(), length, offset);
       return send(socket, encoder)
         .onAny([=]() {
           delete encoder;
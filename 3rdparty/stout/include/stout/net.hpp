@@ -43,6 +43,7 @@
 
 #include <curl/curl.h>
 
+#include <atomic>
 #include <iostream>
 #include <set>
 #include <string>
@@ -139,10 +140,13 @@ inline Try<Bytes> contentLength(const std::string& url)
 // download the specified HTTP or FTP URL into a file at the specified
 // path. The `stall_timeout` parameter controls how long the download
 // waits before aborting when the download speed keeps below 1 byte/sec.
+// The download is also aborted once `cancelled` is set, if given, which
+// lets another thread cancel a download that blocks the calling one.
 inline Try<int> download(
     const std::string& url,
     const std::string& path,
-    const Option<Duration>& stall_timeout = None())
+    const Option<Duration>& stall_timeout = None(),
+    const std::atomic_bool* cancelled = nullptr)
 {
   initialize();
 
@@ -205,6 +209,22 @@ inline Try<int> download(
         curl, CURLOPT_LOW_SPEED_TIME, static_cast<long>(stall_timeout->secs()));
   }
 
+  if (cancelled != nullptr) {
+    // libcurl calls the progress function about once per second even
+    // if no data arrives, and aborts the download once it returns a
+    // non-zero value. See:
+    // https://curl.haxx.se/libcurl/c/CURLOPT_XFERINFOFUNCTION.html
+    curl_xferinfo_callback progress =
+      [](void* data, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+        return static_cast<const std::atomic_bool*>(data)->load() ? 1 : 0;
+      };
+
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, progress);
+    curl_easy_setopt(
+        curl, CURLOPT_XFERINFODATA, const_cast<std::atomic_bool*>(cancelled));
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+  }
+
   CURLcode curlErrorCode = curl_easy_perform(curl);
   if (curlErrorCode != 0) {
     curl_easy_cleanup(curl);
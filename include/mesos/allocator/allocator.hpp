@@ -158,6 +158,22 @@ struct FrameworkOptions
 };
 
 
+/**
+ * An agent to be added to the allocator as part of a batch, see
+ * `Allocator::addSlaves()`. The fields have the same meaning as the
+ * corresponding arguments of `Allocator::addSlave()`.
+ */
+struct SlaveAddition
+{
+  SlaveID slaveId;
+  SlaveInfo slaveInfo;
+  std::vector<SlaveInfo::Capability> capabilities;
+  Option<Unavailability> unavailability;
+  Resources total;
+  hashmap<FrameworkID, Resources> used;
+};
+
+
 /**
  * Basic model of an allocator: resources are allocated to a framework
  * in the form of offers. A framework can refuse some resources in
@@ -316,6 +332,28 @@ public:
       const Resources& total,
       const hashmap<FrameworkID, Resources>& used) = 0;
 
+  /**
+   * Adds a batch of agents, in order, as if `addSlave()` was called for
+   * each of them. This is used when many agents (re-)register at once,
+   * e.g., after a master failover, so that an allocator can amortize
+   * the per-agent work (e.g., perform a single allocation for the whole
+   * batch instead of one per agent).
+   *
+   * The default implementation simply calls `addSlave()` for each agent.
+   */
+  virtual void addSlaves(const std::vector<SlaveAddition>& slaves)
+  {
+    for (const SlaveAddition& slave : slaves) {
+      addSlave(
+          slave.slaveId,
+          slave.slaveInfo,
+          slave.capabilities,
+          slave.unavailability,
+          slave.total,
+          slave.used);
+    }
+  }
+
   /**
    * Removes an agent from the Mesos cluster. All resources belonging to this
    * agent should be released by the allocator.
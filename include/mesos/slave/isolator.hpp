@@ -54,6 +54,16 @@ public:
     return false;
   }
 
+  // Returns true if the cleanup of this isolator does not depend on
+  // the cleanup of any other isolator. Such isolators are cleaned up
+  // concurrently with the other isolators when a container is
+  // destroyed, rather than one after another in the reverse order
+  // they were prepared.
+  virtual bool supportsConcurrentCleanup()
+  {
+    return false;
+  }
+
   // Recover containers from the run states and the orphan containers
   // (known to the launcher but not known to the slave) detected by
   // the launcher.
@@ -43,12 +43,13 @@ namespace command {
 
 static Future<string> launch(
     const string& path,
-    const vector<string>& argv)
+    const vector<string>& argv,
+    const Subprocess::IO& in = Subprocess::PATH(os::DEV_NULL))
 {
   Try<Subprocess> s = subprocess(
       path,
       argv,
-      Subprocess::PATH(os::DEV_NULL),
+      in,
       Subprocess::PIPE(),
       Subprocess::PIPE());
 
@@ -169,6 +170,73 @@ Future<Nothing> untar(
 }
 
 
+Future<Nothing> untar(
+    int_fd input,
+    const Option<Path>& directory,
+    const Option<Compression>& compression)
+{
+  vector<string> argv = {
+    "tar",
+    "-x",  // Extract/unarchive.
+    "-f",  // Input file to extract/unarchive.
+    "-"    // Read the archive from stdin.
+  };
+
+  // Add additional flags.
+  if (directory.isSome()) {
+    argv.emplace_back("-C");
+    argv.emplace_back(directory.get());
+  }
+
+  if (compression.isSome()) {
+    switch (compression.get()) {
+      case Compression::GZIP:
+        argv.emplace_back("-z");
+        break;
+      case Compression::BZIP2:
+        argv.emplace_back("-j");
+        break;
+      case Compression::XZ:
+        argv.emplace_back("-J");
+        break;
+      default:
+        UNREACHABLE();
+    }
+  }
+
+  return launch("tar", argv, Subprocess::FD(input))
+    .then([]() { return Nothing(); });
+}
+
+
+Future<string> sha256(int_fd input)
+{
+#ifdef __linux__
+  const string cmd = "sha256sum";
+  vector<string> argv = {
+    cmd
+  };
+#else
+  const string cmd = "shasum";
+  vector<string> argv = {
+    cmd,
+    "-a", "256"       // Shasum type.
+  };
+#endif // __linux__
+
+  return launch(cmd, argv, Subprocess::FD(input))
+    .then([cmd](const string& output) -> Future<string> {
+      vector<string> tokens = strings::tokenize(output, " ");
+      if (tokens.size() < 2) {
+        return Failure(
+            "Failed to parse '" + output + "' from '" + cmd + "' command");
+      }
+
+      return tokens[0];
+    });
+}
+
+
 Future<string> sha512(const Path& input)
 {
 #ifdef __linux__
@@ -22,6 +22,8 @@
 #include <stout/option.hpp>
 #include <stout/path.hpp>
 
+#include <stout/os/int_fd.hpp>
+
 namespace mesos {
 namespace internal {
 namespace command {
@@ -59,9 +61,32 @@ process::Future<Nothing> untar(
     const Path& input,
     const Option<Path>& directory = None());
 
+
+/**
+ * Untar(unarchive) the archive read from the given file descriptor.
+ * Unlike for files, tar cannot detect the compression of a stream,
+ * so it has to be given.
+ *
+ * @param input file descriptor the archive is read from until EOF.
+ * @param directory change to this directory before unarchiving.
+ * @param compression compression type if the archive is compressed.
+ */
+process::Future<Nothing> untar(
+    int_fd input,
+    const Option<Path>& directory = None(),
+    const Option<Compression>& compression = None());
+
 // TODO(Jojy): Add more overloads/options for untar (eg., keep existing files)
 
 
+/**
+ * Computes SHA 256 checksum of the data read from a file descriptor.
+ *
+ * @param input file descriptor the data is read from until EOF.
+ */
+process::Future<std::string> sha256(int_fd input);
+
+
 /**
  * Computes SHA 512 checksum of a file.
  *
@@ -200,6 +200,10 @@ protected:
         case Event::UPDATE_OPERATION_STATUS:
           break;
 
+        // This framework does not request batched reconciliation.
+        case Event::UPDATES:
+          break;
+
         case Event::FAILURE: {
           const Event::Failure& failure = event.failure();
 
@@ -156,6 +156,10 @@ public:
         case Event::UPDATE_OPERATION_STATUS:
           break;
 
+        // This framework does not request batched reconciliation.
+        case Event::UPDATES:
+          break;
+
         case Event::MESSAGE: {
           cout << endl << "Received a MESSAGE event" << endl;
           break;
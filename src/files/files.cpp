@@ -21,6 +21,7 @@
 #include <sys/stat.h>
 
 #include <algorithm>
+#include <limits>
 #include <map>
 #include <string>
 #include <vector>
@@ -35,8 +36,11 @@
 #include <process/http.hpp>
 #include <process/io.hpp>
 #include <process/mime.hpp>
+#include <process/owned.hpp>
 #include <process/process.hpp>
 
+#include <stout/bytes.hpp>
+#include <stout/duration.hpp>
 #include <stout/error.hpp>
 #include <stout/hashmap.hpp>
 #include <stout/json.hpp>
@@ -80,7 +84,9 @@ using process::DESCRIPTION;
 using process::Failure;
 using process::Future;
 using process::HELP;
+using process::Owned;
 using process::Process;
+using process::Promise;
 using process::TLDR;
 using process::wait; // Necessary on some OS's to disambiguate.
 
@@ -95,6 +101,73 @@ using std::vector;
 namespace mesos {
 namespace internal {
 
+// The maximum duration a read waits for data to be appended to a file.
+constexpr Duration MAX_READ_WAIT = Minutes(1);
+
+
+// A single range of bytes requested with the `Range` header (see RFC
+// 7233), where either bound may be omitted: `bytes=500-` requests the
+// bytes from offset 500 on, and `bytes=-500` the last 500 bytes.
+struct ByteRange
+{
+  Option<size_t> first;
+  Option<size_t> last;
+};
+
+
+// Parses the `Range` header. Returns None if the header is to be
+// ignored, i.e., if it is malformed or requests multiple ranges,
+// which are not supported, in which case the whole file is sent.
+static Option<ByteRange> parseRange(const string& header)
+{
+  if (!strings::startsWith(header, "bytes=")) {
+    return None();
+  }
+
+  const string spec = strings::trim(header.substr(strlen("bytes=")));
+
+  const size_t dash = spec.find('-');
+  if (dash == string::npos || strings::contains(spec, ",")) {
+    return None();
+  }
+
+  const string first = strings::trim(spec.substr(0, dash));
+  const string last = strings::trim(spec.substr(dash + 1));
+
+  ByteRange range;
+
+  if (!first.empty()) {
+    Try<size_t> result = numify<size_t>(first);
+    if (result.isError()) {
+      return None();
+    }
+
+    range.first = result.get();
+  }
+
+  if (!last.empty()) {
+    Try<size_t> result = numify<size_t>(last);
+    if (result.isError()) {
+      return None();
+    }
+
+    range.last = result.get();
+  }
+
+  if (range.first.isNone() && range.last.isNone()) {
+    return None();
+  }
+
+  if (range.first.isSome() &&
+      range.last.isSome() &&
+      range.first.get() > range.last.get()) {
+    return None();
+  }
+
+  return range;
+}
+
+
 class FilesProcess : public Process<FilesProcess>
 {
 public:
@@ -158,6 +231,20 @@ private:
       const http::Request& request,
       const Option<Principal>& principal);
 
+  // Waits up to `wait` for the file to grow past `offset`, i.e., for
+  // data to be appended to it. Returns right away if it has already,
+  // or if it cannot be watched, in which case the read reports any
+  // error.
+  Future<Nothing> append(
+      const string& path,
+      size_t offset,
+      const Duration& wait);
+
+#ifdef __linux__
+  void watch();
+  void _watch(const Future<io::Watcher::Event>& event);
+#endif // __linux__
+
   // Returns the raw file contents for a given path.
   // Requests have the following parameters:
   //   path: The directory to browse. Required.
@@ -165,7 +252,11 @@ private:
       const http::Request& request,
       const Option<Principal>& principal);
 
-  Future<http::Response> _download(const string& path);
+  // Sends the file or the requested range of it with `sendfile`, see
+  // `http::Response::PATH`.
+  Future<http::Response> _download(
+      const string& path,
+      const Option<ByteRange>& range = None());
 
   // Returns the internal virtual path mapping.
   Future<http::Response> debug(
@@ -209,6 +300,20 @@ private:
   // FilesProcess needs an authorizer object to add authorization in
   // `/files/debug` endpoint.
   Option<Authorizer*> authorizer;
+
+#ifdef __linux__
+  // The reads waiting for data to be appended to a file.
+  struct Append
+  {
+    Promise<Nothing> promise;
+    size_t waiters = 0;
+  };
+
+  // A single watcher is shared by all the files being waited on, since
+  // the number of inotify instances per user is limited.
+  Option<io::Watcher> watcher;
+  hashmap<string, Owned<Append>> appends;
+#endif // __linux__
 };
 
 
@@ -486,7 +591,14 @@ const string FilesProcess::READ_HELP = HELP(
         ">        path=VALUE          The path of directory to browse.",
         ">        offset=VALUE        Value added to base address to obtain "
         "a second address",
-        ">        length=VALUE        Length of file to read."),
+        ">        length=VALUE        Length of file to read.",
+        ">        raw=true|false      Whether to return the raw bytes of the "
+        "file with `sendfile` instead of JSON, in which case the length is not "
+        "capped and a `Range` header takes precedence over `offset` and "
+        "`length`. Defaults to false.",
+        ">        wait=VALUE          Duration (e.g., 30secs) to wait for data "
+        "to be appended to the file if `offset` is at its end, before "
+        "returning. At most 1mins. Only supported on Linux."),
     AUTHENTICATION(true),
     AUTHORIZATION(
         "Reading files requires that the request principal is",
@@ -551,19 +663,125 @@ Future<http::Response> FilesProcess::__read(
     }
   }
 
+  bool raw = false;
+
+  if (request.url.query.contains("raw")) {
+    const string& value = request.url.query.at("raw");
+
+    if (value != "true" && value != "false") {
+      return BadRequest(
+          "Failed to parse raw: Expecting 'true' or 'false'.\n");
+    }
+
+    raw = value == "true";
+  }
+
+  Option<Duration> wait;
+
+  if (request.url.query.contains("wait")) {
+    Try<Duration> result = Duration::parse(request.url.query.at("wait"));
+
+    if (result.isError()) {
+      return BadRequest("Failed to parse wait: " + result.error() + ".\n");
+    }
+
+    if (result.get() < Duration::zero()) {
+      return BadRequest("Negative wait provided.\n");
+    }
+
+    wait = std::min(result.get(), MAX_READ_WAIT);
+  }
+
   size_t offset_ = offset;
 
   // The pailer in the webui sends `offset=-1` initially to determine the length
   // of the file. This is equivalent to making a call to `read()` with an
   // `offset`/`length` of 0.
   if (offset == -1) {
+    if (raw) {
+      return BadRequest("Negative offset is not supported with raw=true.\n");
+    }
+
     offset_ = 0;
     length = 0;
+    wait = None();
+  }
+
+  Option<ByteRange> range;
+
+  if (raw) {
+    if (length == 0u) {
+      return BadRequest("Zero length is not supported with raw=true.\n");
+    }
+
+    range = ByteRange{offset_, None()};
+
+    // The last byte saturates instead of overflowing, it is capped at
+    // the end of the file anyway.
+    if (length.isSome()) {
+      range->last =
+        length.get() > std::numeric_limits<size_t>::max() - offset_
+          ? std::numeric_limits<size_t>::max()
+          : offset_ + length.get() - 1;
+    }
+
+    Option<string> header = request.headers.get("Range");
+    if (header.isSome()) {
+      Option<ByteRange> requested = parseRange(header.get());
+      if (requested.isSome()) {
+        range = requested;
+        offset_ = requested->first.getOrElse(0);
+
+        // The suffix ranges are at the end of the file already.
+        if (requested->first.isNone()) {
+          wait = None();
+        }
+      }
+    }
+  }
+
+  const string requestedPath = path::from_uri(path.get());
+
+  // Once authorized, the read waits for data to be appended to the file
+  // if requested, and then the data is read.
+  Future<bool> authorized = authorize(requestedPath, principal);
+
+  if (raw) {
+    return authorized
+      .then(defer(self(), [=](bool authorized) -> Future<http::Response> {
+        if (!authorized) {
+          return Forbidden();
+        }
+
+        Future<Nothing> appended = wait.isSome()
+          ? append(requestedPath, offset_, wait.get())
+          : Nothing();
+
+        return appended
+          .then(defer(self(), [=]() {
+            return _download(requestedPath, range);
+          }));
+      }));
   }
 
   Option<string> jsonp = request.url.query.get("jsonp");
 
-  return read(offset_, length, path.get(), principal)
+  return authorized
+    .then(defer(self(), [=](bool authorized)
+        -> Future<Try<tuple<size_t, string>, FilesError>> {
+      if (!authorized) {
+        return FilesError(FilesError::Type::UNAUTHORIZED);
+      }
+
+      Future<Nothing> appended = wait.isSome()
+        ? append(requestedPath, offset_, wait.get())
+        : Nothing();
+
+      return appended
+        .then(defer(self(), [=]() {
+          return _read(offset_, length, requestedPath);
+        }));
+    }))
     .then([offset, jsonp](const Try<tuple<size_t, string>, FilesError>& result)
         -> Future<http::Response> {
       if (result.isError()) {
@@ -713,12 +931,133 @@ Future<Try<tuple<size_t, string>, FilesError>> FilesProcess::_read(
 }
 
 
+Future<Nothing> FilesProcess::append(
+    const string& path,
+    size_t offset,
+    const Duration& wait)
+{
+#ifdef __linux__
+  Result<string> resolvedPath = resolve(path);
+
+  if (!resolvedPath.isSome() || os::stat::isdir(resolvedPath.get())) {
+    return Nothing();
+  }
+
+  const string file = resolvedPath.get();
+
+  if (watcher.isNone()) {
+    Try<io::Watcher> created = io::create_watcher();
+    if (created.isError()) {
+      LOG(WARNING) << "Failed to create a watcher for '" << file << "': "
+                   << created.error();
+      return Nothing();
+    }
+
+    watcher = created.get();
+    watch();
+  }
+
+  // NOTE: The watch is added before the size of the file is checked
+  // so that an append in between is not missed.
+  if (!appends.contains(file)) {
+    Try<Nothing> add = watcher->add(file);
+    if (add.isError()) {
+      LOG(WARNING) << "Failed to watch '" << file << "': " << add.error();
+      return Nothing();
+    }
+
+    appends.put(file, Owned<Append>(new Append()));
+  }
+
+  Owned<Append> append = appends.at(file);
+
+  Try<Bytes> size = os::stat::size(file);
+  if (size.isError() || size->bytes() > offset) {
+    if (append->waiters == 0) {
+      appends.erase(file);
+      watcher->remove(file);
+    }
+
+    return Nothing();
+  }
+
+  append->waiters++;
+
+  return append->promise.future()
+    .after(wait, [](const Future<Nothing>&) -> Future<Nothing> {
+      return Nothing();
+    })
+    .onAny(defer(self(), [this, file, append](const Future<Nothing>&) {
+      // Stop watching the file once nobody waits on it anymore.
+      if (--append->waiters == 0 &&
+          appends.contains(file) &&
+          appends.at(file) == append) {
+        appends.erase(file);
+
+        if (watcher.isSome()) {
+          watcher->remove(file);
+        }
+      }
+    }));
+#else
+  return Nothing();
+#endif // __linux__
+}
+
+
+#ifdef __linux__
+void FilesProcess::watch()
+{
+  CHECK_SOME(watcher);
+
+  watcher->events().get()
+    .onAny(defer(self(), &Self::_watch, lambda::_1));
+}
+
+
+void FilesProcess::_watch(const Future<io::Watcher::Event>& event)
+{
+  if (!event.isReady() || event->type == io::Watcher::Event::Failure) {
+    LOG(WARNING) << "Failed to watch the files being read: "
+                 << (event.isReady() ? event->path
+                     : event.isFailed() ? event.failure() : "discarded");
+
+    // Complete all the reads, the watcher is created again on the
+    // next read which waits.
+    foreachvalue (const Owned<Append>& append, appends) {
+      append->promise.set(Nothing());
+    }
+
+    appends.clear();
+    watcher = None();
+    return;
+  }
+
+  // Any change to the file completes the reads waiting on it, which
+  // then read whatever was appended, if anything.
+  if (appends.contains(event->path)) {
+    appends.at(event->path)->promise.set(Nothing());
+    appends.erase(event->path);
+
+    // NOTE: The watch is gone already if the file was removed or
+    // renamed, in which case this is a no-op.
+    watcher->remove(event->path);
+  }
+
+  watch();
+}
+#endif // __linux__
+
+
 const string FilesProcess::DOWNLOAD_HELP = HELP(
     TLDR(
         "Returns the raw file contents for a given path."),
     DESCRIPTION(
         "This endpoint will return the raw file contents for the",
-        "given path.",
+        "given path. A single range of bytes of the file can be",
+        "requested with the `Range` header (e.g., `Range: bytes=0-499`),",
+        "in which case `206 Partial Content` is returned along with",
+        "the `Content-Range` header.",
         "",
         "Query parameters:",
         "",
@@ -747,11 +1086,19 @@ Future<http::Response> FilesProcess::download(
 
   const string requestedPath = path::from_uri(path.get());
 
+  Option<ByteRange> range;
+
+  Option<string> header = request.headers.get("Range");
+  if (header.isSome()) {
+    range = parseRange(header.get());
+  }
+
   return authorize(requestedPath, principal)
     .then(defer(self(),
-        [this, requestedPath](bool authorized) -> Future<http::Response> {
+        [this, requestedPath, range](bool authorized)
+          -> Future<http::Response> {
       if (authorized) {
-        return _download(requestedPath);
+        return _download(requestedPath, range);
       }
 
       return Forbidden();
@@ -759,7 +1106,9 @@ Future<http::Response> FilesProcess::download(
 }
 
 
-Future<http::Response> FilesProcess::_download(const string& path)
+Future<http::Response> FilesProcess::_download(
+    const string& path,
+    const Option<ByteRange>& range)
 {
   Result<string> resolvedPath = resolve(path);
 
@@ -790,6 +1139,54 @@ Future<http::Response> FilesProcess::_download(const string& path)
     response.headers["Content-Type"] = mime::types[extension.get()];
   }
 
+  response.headers["Accept-Ranges"] = "bytes";
+
+  if (range.isNone()) {
+    return response;
+  }
+
+  Try<Bytes> bytes = os::stat::size(resolvedPath.get());
+  if (bytes.isError()) {
+    return InternalServerError(
+        "Failed to get the size of '" + resolvedPath.get() + "': " +
+        bytes.error() + ".\n");
+  }
+
+  const size_t size = bytes->bytes();
+
+  // The last byte is capped at the end of the file, and a suffix range
+  // longer than the file requests the whole file.
+  const bool satisfiable = range->first.isSome()
+    ? range->first.get() < size
+    : size > 0 && range->last.get() > 0;
+
+  if (!satisfiable) {
+    http::Response unsatisfiable(
+        "Requested range not satisfiable.\n",
+        http::Status::REQUESTED_RANGE_NOT_SATISFIABLE);
+
+    unsatisfiable.headers["Content-Range"] = "bytes */" + stringify(size);
+    return unsatisfiable;
+  }
+
+  size_t first = 0;
+  size_t last = size - 1;
+
+  if (range->first.isSome()) {
+    first = range->first.get();
+    last = std::min(range->last.getOrElse(last), last);
+  } else if (range->last.get() < size) {
+    first = size - range->last.get();
+  }
+
+  response.status = http::Status::string(http::Status::PARTIAL_CONTENT);
+  response.code = http::Status::PARTIAL_CONTENT;
+  response.headers["Content-Range"] =
+    "bytes " + stringify(first) + "-" + stringify(last) + "/" +
+    stringify(size);
+
+  response.range = http::Response::Range{first, last - first + 1};
+
   return response;
 }
 
@@ -16,6 +16,8 @@
 
 #include <fts.h>
 
+#include <sys/epoll.h>
+
 #include "linux/cgroups2.hpp"
 
 #include <iterator>
@@ -26,12 +28,15 @@
 #include <utility>
 
 #include <process/after.hpp>
+#include <process/defer.hpp>
+#include <process/dispatch.hpp>
 #include <process/loop.hpp>
 #include <process/pid.hpp>
 #include <process/io.hpp>
 #include <process/owned.hpp>
 
 #include <stout/adaptor.hpp>
+#include <stout/hashmap.hpp>
 #include <stout/linkedhashmap.hpp>
 #include <stout/none.hpp>
 #include <stout/numify.hpp>
@@ -390,6 +395,187 @@ Try<Nothing> kill(const std::string& cgroup)
 }
 
 
+// Returns whether any process lives in the cgroup or its descendants,
+// as reported by the 'populated' field of 'cgroup.events'.
+static Try<bool> populated(const string& cgroup)
+{
+  Try<string> content = cgroups2::read<string>(cgroup, control::EVENTS);
+  if (content.isError()) {
+    return Error("Failed to read '" + control::EVENTS + "': "
+                 + content.error());
+  }
+
+  foreach (const string& line, strings::split(*content, "\n")) {
+    vector<string> tokens = strings::split(line, " ");
+    if (tokens.size() == 2 && tokens[0] == "populated") {
+      return tokens[1] != "0";
+    }
+  }
+
+  return Error("Missing 'populated' in '" + control::EVENTS + "'");
+}
+
+
+// Waits for cgroups to have no processes left in them or their
+// descendants. The kernel generates a file modified event on
+// 'cgroup.events' when its 'populated' field changes, so we watch it
+// instead of polling the cgroups.
+//
+// NOTE: A single watcher is shared by all the cgroups being destroyed,
+// since the inotify instances are limited per user and are also used
+// by the OOM listener and by other programs, e.g., systemd.
+class UnpopulatedListenerProcess
+  : public process::Process<UnpopulatedListenerProcess>
+{
+public:
+  UnpopulatedListenerProcess()
+    : ProcessBase(process::ID::generate("cgroups2-unpopulated-listener")) {}
+
+  Future<Nothing> listen(const string& cgroup)
+  {
+    if (watcher.isNone()) {
+      Try<Watcher> created = process::io::create_watcher();
+      if (created.isError()) {
+        // Without a watcher, the removal of the cgroups in `destroy`
+        // is retried until the processes have exited.
+        LOG_IF(WARNING, !fallback)
+          << "Failed to create a watcher, falling back to retrying the"
+          << " removal of the cgroups being destroyed: " << created.error();
+
+        fallback = true;
+        return Nothing();
+      }
+
+      fallback = false;
+      watcher = created.get();
+      watch(watcher.get());
+    }
+
+    const string events = path::join(cgroups2::path(cgroup), control::EVENTS);
+
+    if (listeners.contains(events)) {
+      return listeners.at(events).promise->future();
+    }
+
+    // NOTE: The watch is added before 'populated' is first read so
+    // that a change in between is not missed.
+    Try<Nothing> add = watcher->add(events);
+    if (add.isError()) {
+      return Failure("Failed to watch '" + events + "': " + add.error());
+    }
+
+    Owned<Promise<Nothing>> promise(new Promise<Nothing>());
+    listeners.put(events, Listener{cgroup, promise});
+
+    promise->future()
+      .onDiscard(defer(self(), [this, events, promise]() {
+        if (listeners.contains(events) &&
+            listeners.at(events).promise.get() == promise.get()) {
+          remove(events);
+          promise->discard();
+        }
+      }));
+
+    check(events);
+
+    return promise->future();
+  }
+
+private:
+  void watch(Watcher watcher)
+  {
+    loop(
+        self(),
+        [watcher]() mutable {
+          return watcher.events().get();
+        },
+        [this](const Watcher::Event& event) -> Future<ControlFlow<Nothing>> {
+          if (event.type == Watcher::Event::Failure) {
+            // Like without a watcher, the removal of the cgroups is
+            // retried until their processes have exited. A new watcher
+            // is created for the next cgroups.
+            //
+            // NOTE: `event.path` contains the error message.
+            LOG(WARNING) << "Watcher failed: " << event.path;
+
+            foreachvalue (const Listener& listener, listeners) {
+              listener.promise->set(Nothing());
+            }
+
+            listeners.clear();
+            this->watcher = None();
+
+            return Break();
+          }
+
+          check(event.path);
+          return Continue();
+        });
+  }
+
+  // Completes the listener of the 'cgroup.events' file once its
+  // cgroup is no longer populated.
+  void check(const string& events)
+  {
+    if (!listeners.contains(events)) {
+      return;
+    }
+
+    const Listener listener = listeners.at(events);
+
+    Try<bool> populated = cgroups2::populated(listener.cgroup);
+    if (populated.isError()) {
+      remove(events);
+      listener.promise->fail(populated.error());
+    } else if (!*populated) {
+      remove(events);
+      listener.promise->set(Nothing());
+    }
+  }
+
+  void remove(const string& events)
+  {
+    listeners.erase(events);
+
+    if (watcher.isSome()) {
+      // The watch might already have been removed along with the
+      // cgroup, in which case this is a no-op.
+      watcher->remove(events);
+    }
+  }
+
+  Option<Watcher> watcher;
+
+  // Whether the watcher failed to be created, so that it is only
+  // logged once until a watcher is created again.
+  bool fallback = false;
+
+  struct Listener
+  {
+    string cgroup;
+    Owned<Promise<Nothing>> promise;
+  };
+
+  // The listeners keyed by the path of their 'cgroup.events' files.
+  hashmap<string, Listener> listeners;
+};
+
+
+// Waits for all processes in the cgroup and its descendants to exit.
+static Future<Nothing> unpopulated(const string& cgroup)
+{
+  // The listener is shared by the whole agent and lives as long as it.
+  static UnpopulatedListenerProcess* listener = []() {
+    UnpopulatedListenerProcess* listener = new UnpopulatedListenerProcess();
+    process::spawn(listener);
+    return listener;
+  }();
+
+  return process::dispatch(
+      listener, &UnpopulatedListenerProcess::listen, cgroup);
+}
+
+
 Future<Nothing> destroy(const string& cgroup)
 {
   if (!cgroups2::exists(cgroup)) {
@@ -397,14 +583,22 @@ Future<Nothing> destroy(const string& cgroup)
   }
 
   // To destroy a subtree of cgroups we first kill all of the processes inside
-  // of the cgroup and then remove all of the cgroup directories, removing
-  // the most deeply nested directories first.
+  // of the cgroup, wait for them to exit, and then remove all of the cgroup
+  // directories, removing the most deeply nested directories first.
 
   Try<Nothing> kill = cgroups2::kill(cgroup);
   if (kill.isError()) {
     return Failure("Failed to kill processes in cgroup: " + kill.error());
   }
 
+  // The processes exit asynchronously after being killed. We give them
+  // as long as we give the removal of the cgroups below.
+  Future<Nothing> exited = unpopulated(cgroup)
+    .after(Seconds(5), [](Future<Nothing> future) -> Future<Nothing> {
+      future.discard();
+      return Failure("Timed out waiting for the killed processes to exit");
+    });
+
   // In order to reliably destroy a cgroup, one has to retry on EBUSY
   // *even if* all the processes are no longer found in cgroup.procs.
   // We retry for up to ~5 seconds, based on how crun destroys its
@@ -412,41 +606,43 @@ Future<Nothing> destroy(const string& cgroup)
   //
   // https://github.com/containers/crun/blob/10b3038c1398b7db20b1826f
   // 94e9d4cb444e9568/src/libcrun/cgroup-utils.c#L471
-  int retries = 5000;
-  Future<Nothing> removal = loop(
-    []() { return process::after(Milliseconds(1)); },
-    [=](const Nothing&) mutable -> Future<ControlFlow<Nothing>> {
-      Try<set<string>> cgroups = cgroups2::get(cgroup);
-      if (cgroups.isError()) {
-        return Failure("Failed to get nested cgroups: " + cgroups.error());
-      }
-      cgroups->insert(cgroup);
-
-      // Remove the cgroups in bottom-up order.
-      foreach (const string& cgroup, adaptor::reverse(*cgroups)) {
-        const string path = cgroups2::path(cgroup);
-
-        // Remove the cgroup's directory. If the directory does not exist,
-        // ignore the error to protect against races.
-        if (::rmdir(path.c_str()) < 0) {
-          ErrnoError error = ErrnoError();
-          if (error.code == EBUSY) {
-            --retries;
-            if (retries == 0) {
-              return Failure("Failed to remove cgroup after 5000 attempts");
+  return exited.then([=]() {
+    int retries = 5000;
+    return loop(
+      []() { return Nothing(); },
+      [=](const Nothing&) mutable -> Future<ControlFlow<Nothing>> {
+        Try<set<string>> cgroups = cgroups2::get(cgroup);
+        if (cgroups.isError()) {
+          return Failure("Failed to get nested cgroups: " + cgroups.error());
+        }
+        cgroups->insert(cgroup);
+
+        // Remove the cgroups in bottom-up order.
+        foreach (const string& cgroup, adaptor::reverse(*cgroups)) {
+          const string path = cgroups2::path(cgroup);
+
+          // Remove the cgroup's directory. If the directory does not exist,
+          // ignore the error to protect against races.
+          if (::rmdir(path.c_str()) < 0) {
+            ErrnoError error = ErrnoError();
+            if (error.code == EBUSY) {
+              --retries;
+              if (retries == 0) {
+                return Failure("Failed to remove cgroup after 5000 attempts");
+              }
+              return process::after(Milliseconds(1))
+                .then([]() -> ControlFlow<Nothing> { return Continue(); });
+            } else if (error.code != ENOENT) {
+              return Failure(
+                  "Failed to remove directory '" + path + "': "
+                  + error.message);
             }
-            return Continue();
-          } else if (error.code != ENOENT) {
-            return Failure(
-                "Failed to remove directory '" + path + "': " + error.message);
           }
         }
-      }
-
-      return Break();
-    });
 
-  return removal;
+        return Break();
+      });
+  });
 }
 
 
@@ -1229,6 +1425,183 @@ Try<Stats> stats(const string& cgroup)
 
 } // namespace memory {
 
+namespace pressure {
+
+namespace control {
+
+const string CPU = "cpu.pressure";
+const string IO = "io.pressure";
+const string MEMORY = "memory.pressure";
+
+} // namespace control {
+
+
+static const string& control_file(Resource resource)
+{
+  switch (resource) {
+    case Resource::CPU:    return control::CPU;
+    case Resource::MEMORY: return control::MEMORY;
+    case Resource::IO:     return control::IO;
+  }
+
+  UNREACHABLE();
+}
+
+
+Try<Stats> parse(const string& content)
+{
+  // Format
+  // -----------------------------
+  // some avg10=$AVG10 avg60=$AVG60 avg300=$AVG300 total=$TOTAL
+  // full avg10=$AVG10 avg60=$AVG60 avg300=$AVG300 total=$TOTAL
+  // -----------------------------
+  // $AVGn       Percentage of time stalled over the last n seconds.
+  //
+  // $TOTAL      Total time stalled, in microseconds.
+  Stats stats;
+
+  foreach (const string& line, strings::split(content, "\n")) {
+    if (line.empty()) {
+      continue;
+    }
+
+    vector<string> tokens = strings::tokenize(line, " ");
+    if (tokens.size() != 5 || (tokens[0] != "some" && tokens[0] != "full")) {
+      return Error("Invalid line format in pressure file expected"
+                   " '<some|full> avg10=$AVG10 avg60=$AVG60 avg300=$AVG300"
+                   " total=$TOTAL' received: '" + line + "'");
+    }
+
+    Stats::Stall& stall = tokens[0] == "some" ? stats.some : stats.full;
+
+    for (size_t i = 1; i < tokens.size(); ++i) {
+      vector<string> pair = strings::split(tokens[i], "=");
+      if (pair.size() != 2) {
+        return Error("Invalid field format in pressure file expected"
+                     " <key>=<value> received: '" + tokens[i] + "'");
+      }
+
+      const string& field = pair[0];
+      const string& value = pair[1];
+
+      if (field == "total") {
+        Try<uint64_t> total = numify<uint64_t>(value);
+        if (total.isError()) {
+          return Error("Failed to parse '" + field + "': " + total.error());
+        }
+
+        stall.total = Microseconds(static_cast<int64_t>(*total));
+        continue;
+      }
+
+      Try<double> average = numify<double>(value);
+      if (average.isError()) {
+        return Error("Failed to parse '" + field + "': " + average.error());
+      }
+
+      if      (field == "avg10")  { stall.avg10 = *average; }
+      else if (field == "avg60")  { stall.avg60 = *average; }
+      else if (field == "avg300") { stall.avg300 = *average; }
+    }
+  }
+
+  return stats;
+}
+
+
+bool supported()
+{
+  return os::exists("/proc/pressure");
+}
+
+
+Try<Stats> stats(const string& cgroup, Resource resource)
+{
+  const string& control = control_file(resource);
+
+  Try<string> content = cgroups2::read<string>(cgroup, control);
+  if (content.isError()) {
+    return Error("Failed to read '" + control + "' for the cgroup"
+                 " '" + cgroup + "': " + content.error());
+  }
+
+  return parse(*content);
+}
+
+
+Try<Owned<Trigger>> Trigger::create(
+    const string& cgroup,
+    Resource resource,
+    const Threshold& threshold)
+{
+  const string path =
+    path::join(cgroups2::path(cgroup), control_file(resource));
+
+  Try<int> fd = os::open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+  if (fd.isError()) {
+    return Error("Failed to open '" + path + "': " + fd.error());
+  }
+
+  // Format: "<some|full> $STALL $WINDOW", in microseconds. The kernel
+  // expects the trigger in a single write, including the terminating
+  // null character.
+  const string trigger =
+    string(threshold.full ? "full" : "some") + " " +
+    stringify(static_cast<int64_t>(threshold.stall.us())) + " " +
+    stringify(static_cast<int64_t>(threshold.window.us()));
+
+  if (::write(*fd, trigger.c_str(), trigger.size() + 1) < 0) {
+    ErrnoError error("Failed to write trigger '" + trigger + "'"
+                     " to '" + path + "'");
+    os::close(*fd);
+    return error;
+  }
+
+  int epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd == -1) {
+    ErrnoError error("Failed to create epoll instance");
+    os::close(*fd);
+    return error;
+  }
+
+  epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLPRI;
+  event.data.fd = *fd;
+
+  if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, *fd, &event) == -1) {
+    ErrnoError error("Failed to add '" + path + "' to epoll instance");
+    os::close(epoll_fd);
+    os::close(*fd);
+    return error;
+  }
+
+  return Owned<Trigger>(new Trigger(*fd, epoll_fd));
+}
+
+
+Trigger::Trigger(int _fd, int _epoll_fd) : fd(_fd), epoll_fd(_epoll_fd) {}
+
+
+Trigger::~Trigger()
+{
+  os::close(epoll_fd);
+  os::close(fd);
+}
+
+
+Future<Nothing> Trigger::fired() const
+{
+  // The epoll instance becomes readable once the kernel notifies the
+  // trigger. Checking the readiness consumes the notification, so the
+  // epoll instance becomes unreadable again until the next one without
+  // calling epoll_wait().
+  return process::io::poll(epoll_fd, process::io::READ)
+    .then([]() { return Nothing(); });
+}
+
+} // namespace pressure {
+
 namespace devices {
 
 // Utility class to construct an eBPF program to whitelist or blacklist
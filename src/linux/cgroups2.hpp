@@ -460,6 +460,108 @@ Try<Stats> stats(const std::string& cgroup);
 
 } // namespace memory {
 
+
+// Pressure stall information (PSI): the share of time in which the tasks of a
+// cgroup and its descendants were stalled waiting for a resource.
+//
+// Only available if the kernel was built with CONFIG_PSI and booted without
+// "psi=0".
+//
+// See: https://docs.kernel.org/accounting/psi.html
+namespace pressure {
+
+// Resources for which the kernel tracks pressure stall information.
+enum class Resource
+{
+  CPU,
+  MEMORY,
+  IO
+};
+
+
+// Pressure stall information of a resource.
+// Represents a snapshot of the "cpu.pressure", "memory.pressure" or
+// "io.pressure" control.
+struct Stats
+{
+  struct Stall
+  {
+    // Percentage of time stalled over the last 10, 60 and 300 seconds.
+    double avg10 = 0;
+    double avg60 = 0;
+    double avg300 = 0;
+
+    // Total time stalled.
+    Duration total;
+  };
+
+  // Time in which at least some tasks were stalled on the resource.
+  // "some" line in "<resource>.pressure"
+  Stall some;
+
+  // Time in which all non-idle tasks were stalled on the resource at once.
+  // "full" line in "<resource>.pressure"
+  // Always zero for the CPU of non-root cgroups on kernels before 5.13.
+  Stall full;
+};
+
+
+// Checks if pressure stall information is available on the system.
+bool supported();
+
+
+// Get the pressure stall information of a resource for a cgroup.
+Try<Stats> stats(const std::string& cgroup, Resource resource);
+
+
+// Threshold for a pressure trigger: the trigger fires when the tasks of the
+// cgroup were stalled for longer than `stall` within a `window`.
+struct Threshold
+{
+  // Whether to track "full" rather than "some" stall time.
+  bool full = false;
+
+  Duration stall;
+
+  // The kernel only accepts windows between 500ms and 10s. Unprivileged
+  // processes can only use multiples of 2s.
+  Duration window;
+};
+
+
+// A PSI trigger on a resource of a cgroup. The kernel notifies the trigger
+// at most once per window, and the trigger is removed once destroyed.
+class Trigger
+{
+public:
+  static Try<process::Owned<Trigger>> create(
+      const std::string& cgroup,
+      Resource resource,
+      const Threshold& threshold);
+
+  ~Trigger();
+
+  // Returns a future which becomes ready the next time the trigger fires.
+  // The kernel notifies us through epoll, so no polling is involved. The
+  // future should be discarded before the trigger is destroyed.
+  process::Future<Nothing> fired() const;
+
+private:
+  Trigger(int fd, int epoll_fd);
+
+  Trigger(const Trigger&) = delete; // Not copyable.
+  Trigger& operator=(const Trigger&) = delete; // Not assignable.
+
+  // The "<resource>.pressure" file which the trigger was written to.
+  const int fd;
+
+  // An epoll instance watching `fd` for EPOLLPRI events, which libprocess
+  // can watch for readability: the pressure file itself is always readable.
+  const int epoll_fd;
+};
+
+} // namespace pressure {
+
 namespace devices {
 
 using cgroups::devices::Entry;
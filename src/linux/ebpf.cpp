@@ -20,19 +20,26 @@
 #include <linux/bpf.h>
 #include <sys/syscall.h>
 
+#include <cstddef>
 #include <cstring>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "stout/check.hpp"
 #include "stout/error.hpp"
+#include "stout/foreach.hpp"
 #include "stout/none.hpp"
 #include "stout/nothing.hpp"
+#include "stout/numify.hpp"
 #include "stout/os/close.hpp"
 #include "stout/os/open.hpp"
+#include "stout/os/read.hpp"
 #include "stout/stringify.hpp"
+#include "stout/strings.hpp"
 #include "stout/try.hpp"
 
+using std::pair;
 using std::string;
 using std::vector;
 
@@ -308,6 +315,307 @@ Try<Nothing> detach(const string& cgroup, uint32_t program_id)
   return Nothing();
 }
 
+
+// Value of the network counters map, per CPU. The first key holds the
+// received traffic and the second key holds the sent traffic.
+struct NetworkCountersValue
+{
+  uint64_t packets;
+  uint64_t bytes;
+};
+
+
+static const uint32_t NETWORK_COUNTERS_RX = 0;
+static const uint32_t NETWORK_COUNTERS_TX = 1;
+
+
+// Returns the number of possible CPUs, which determines the size of
+// the values of per-CPU maps as seen from user space.
+static Try<size_t> possible_cpus()
+{
+  Try<string> read = os::read("/sys/devices/system/cpu/possible");
+  if (read.isError()) {
+    return Error("Failed to read possible CPUs: " + read.error());
+  }
+
+  // The format is a list of ranges, e.g., "0-3,8-11".
+  size_t count = 0;
+  foreach (const string& range, strings::tokenize(strings::trim(*read), ",")) {
+    vector<string> bounds = strings::tokenize(range, "-");
+    Try<size_t> first = numify<size_t>(bounds.front());
+    Try<size_t> last = numify<size_t>(bounds.back());
+    if (bounds.size() > 2 || first.isError() || last.isError() ||
+        *first > *last) {
+      return Error("Failed to parse possible CPUs '" + *read + "'");
+    }
+
+    count += *last - *first + 1;
+  }
+
+  return count;
+}
+
+
+// Builds a BPF_PROG_TYPE_CGROUP_SKB program which adds the packet to the
+// counters of `key` in the map. The program always allows the packet.
+static Program network_counters_program(int map_fd, uint32_t key)
+{
+  Program program(BPF_PROG_TYPE_CGROUP_SKB);
+
+  program.append({
+    // r6 = skb
+    BPF_MOV64_REG(BPF_REG_6, BPF_REG_1),
+    // r0 = bpf_map_lookup_elem(map, &key)
+    BPF_ST_MEM(BPF_W, BPF_REG_10, -4, (int32_t) key),
+    BPF_MOV64_REG(BPF_REG_2, BPF_REG_10),
+    BPF_ALU64_IMM(BPF_ADD, BPF_REG_2, -4),
+    BPF_LD_MAP_FD(BPF_REG_1, map_fd),
+    BPF_EMIT_CALL(BPF_FUNC_map_lookup_elem),
+    // if (r0 == NULL) goto allow
+    BPF_JMP_IMM(BPF_JEQ, BPF_REG_0, 0, 7),
+    // r0->packets += 1
+    BPF_LDX_MEM(BPF_DW, BPF_REG_1, BPF_REG_0,
+                offsetof(NetworkCountersValue, packets)),
+    BPF_ALU64_IMM(BPF_ADD, BPF_REG_1, 1),
+    BPF_STX_MEM(BPF_DW, BPF_REG_0, BPF_REG_1,
+                offsetof(NetworkCountersValue, packets)),
+    // r0->bytes += skb->len
+    BPF_LDX_MEM(BPF_W, BPF_REG_2, BPF_REG_6, offsetof(__sk_buff, len)),
+    BPF_LDX_MEM(BPF_DW, BPF_REG_1, BPF_REG_0,
+                offsetof(NetworkCountersValue, bytes)),
+    BPF_ALU64_REG(BPF_ADD, BPF_REG_1, BPF_REG_2),
+    BPF_STX_MEM(BPF_DW, BPF_REG_0, BPF_REG_1,
+                offsetof(NetworkCountersValue, bytes)),
+    // allow: return 1
+    BPF_MOV64_IMM(BPF_REG_0, 1),
+    BPF_EXIT_INSN(),
+  });
+
+  return program;
+}
+
+
+Try<int> attach_network_counters(const string& cgroup)
+{
+  // A per-CPU array lets the programs update the counters without
+  // atomic operations or contention between CPUs.
+  bpf_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.map_type = BPF_MAP_TYPE_PERCPU_ARRAY;
+  attr.key_size = sizeof(uint32_t);
+  attr.value_size = sizeof(NetworkCountersValue);
+  attr.max_entries = 2;
+
+  Try<int, ErrnoError> map_fd = bpf(BPF_MAP_CREATE, &attr, sizeof(attr));
+  if (map_fd.isError()) {
+    return Error("bpf syscall to BPF_MAP_CREATE failed: " +
+                 map_fd.error().message);
+  }
+
+  string cgroup_path = ::cgroups2::path(cgroup);
+
+  Try<int> cgroup_fd =
+    os::open(cgroup_path, O_DIRECTORY | O_RDONLY | O_CLOEXEC);
+  if (cgroup_fd.isError()) {
+    os::close(*map_fd);
+    return Error("Failed to open '" + cgroup_path + "': " + cgroup_fd.error());
+  }
+
+  vector<pair<bpf_attach_type, uint32_t>> programs = {
+    {BPF_CGROUP_INET_INGRESS, NETWORK_COUNTERS_RX},
+    {BPF_CGROUP_INET_EGRESS, NETWORK_COUNTERS_TX}
+  };
+
+  foreach (const auto& program, programs) {
+    Try<int> program_fd =
+      load(network_counters_program(*map_fd, program.second));
+    if (program_fd.isError()) {
+      os::close(*cgroup_fd);
+      os::close(*map_fd);
+      return Error("Failed to load eBPF program: " + program_fd.error());
+    }
+
+    // BPF_F_ALLOW_MULTI lets programs in the descendant cgroups, e.g.,
+    // those of nested containers, run alongside ours instead of
+    // overriding them.
+    memset(&attr, 0, sizeof(attr));
+    attr.attach_type = program.first;
+    attr.target_fd = *cgroup_fd;
+    attr.attach_bpf_fd = *program_fd;
+    attr.attach_flags = BPF_F_ALLOW_MULTI;
+
+    Try<int, ErrnoError> result = bpf(BPF_PROG_ATTACH, &attr, sizeof(attr));
+    os::close(*program_fd);
+
+    if (result.isError()) {
+      os::close(*cgroup_fd);
+      os::close(*map_fd);
+      return Error("BPF program attach syscall failed: " +
+                   result.error().message);
+    }
+  }
+
+  os::close(*cgroup_fd);
+
+  return *map_fd;
+}
+
+
+Result<int> network_counters_map(const string& cgroup)
+{
+  string cgroup_path = ::cgroups2::path(cgroup);
+
+  Try<int> cgroup_fd =
+    os::open(cgroup_path, O_DIRECTORY | O_RDONLY | O_CLOEXEC);
+  if (cgroup_fd.isError()) {
+    return Error("Failed to open '" + cgroup_path + "': " + cgroup_fd.error());
+  }
+
+  const int MAX_IDS = 64;
+  vector<uint32_t> ids(MAX_IDS);
+
+  bpf_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.query.target_fd = *cgroup_fd;
+  attr.query.attach_type = BPF_CGROUP_INET_INGRESS;
+  attr.query.prog_cnt = MAX_IDS;
+  attr.query.prog_ids = reinterpret_cast<uint64_t>(ids.data());
+
+  Try<int, ErrnoError> result = bpf(BPF_PROG_QUERY, &attr, sizeof(attr));
+  os::close(*cgroup_fd);
+
+  if (result.isError()) {
+    return Error(
+        "bpf syscall to BPF_PROG_QUERY for BPF_CGROUP_INET_INGRESS programs"
+        " failed: " + result.error().message);
+  }
+
+  ids.resize(attr.query.prog_cnt);
+
+  // Look for a program of ours, i.e., one which uses exactly one
+  // per-CPU array map holding the network counters.
+  foreach (uint32_t id, ids) {
+    Try<int> program_fd = bpf_get_fd_by_id(id);
+    if (program_fd.isError()) {
+      return Error("Could not get bpf fd from program id: " +
+                   program_fd.error());
+    }
+
+    uint32_t map_ids[2];
+    bpf_prog_info program_info;
+    memset(&program_info, 0, sizeof(program_info));
+    program_info.nr_map_ids = 2;
+    program_info.map_ids = reinterpret_cast<uint64_t>(map_ids);
+
+    memset(&attr, 0, sizeof(attr));
+    attr.info.bpf_fd = *program_fd;
+    attr.info.info_len = sizeof(program_info);
+    attr.info.info = reinterpret_cast<uint64_t>(&program_info);
+
+    result = bpf(BPF_OBJ_GET_INFO_BY_FD, &attr, sizeof(attr));
+    os::close(*program_fd);
+
+    if (result.isError()) {
+      return Error("bpf syscall to BPF_OBJ_GET_INFO_BY_FD failed: " +
+                   result.error().message);
+    }
+
+    if (program_info.type != BPF_PROG_TYPE_CGROUP_SKB ||
+        program_info.nr_map_ids != 1) {
+      continue;
+    }
+
+    memset(&attr, 0, sizeof(attr));
+    attr.map_id = map_ids[0];
+
+    Try<int, ErrnoError> map_fd =
+      bpf(BPF_MAP_GET_FD_BY_ID, &attr, sizeof(attr));
+    if (map_fd.isError()) {
+      return Error("bpf syscall to BPF_MAP_GET_FD_BY_ID failed: " +
+                   map_fd.error().message);
+    }
+
+    bpf_map_info map_info;
+    memset(&map_info, 0, sizeof(map_info));
+
+    memset(&attr, 0, sizeof(attr));
+    attr.info.bpf_fd = *map_fd;
+    attr.info.info_len = sizeof(map_info);
+    attr.info.info = reinterpret_cast<uint64_t>(&map_info);
+
+    result = bpf(BPF_OBJ_GET_INFO_BY_FD, &attr, sizeof(attr));
+    if (result.isError()) {
+      os::close(*map_fd);
+      return Error("bpf syscall to BPF_OBJ_GET_INFO_BY_FD failed: " +
+                   result.error().message);
+    }
+
+    if (map_info.type == BPF_MAP_TYPE_PERCPU_ARRAY &&
+        map_info.key_size == sizeof(uint32_t) &&
+        map_info.value_size == sizeof(NetworkCountersValue) &&
+        map_info.max_entries == 2) {
+      return *map_fd;
+    }
+
+    os::close(*map_fd);
+  }
+
+  return None();
+}
+
+
+Try<NetworkCounters> network_counters(int map_fd)
+{
+  Try<size_t> cpus = possible_cpus();
+  if (cpus.isError()) {
+    return Error(cpus.error());
+  }
+
+  // Lookups in per-CPU maps return the values of all possible CPUs.
+  vector<NetworkCountersValue> values(*cpus);
+
+  auto lookup = [&](uint32_t key) -> Try<NetworkCountersValue> {
+    bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_fd = map_fd;
+    attr.key = reinterpret_cast<uint64_t>(&key);
+    attr.value = reinterpret_cast<uint64_t>(values.data());
+
+    Try<int, ErrnoError> result =
+      bpf(BPF_MAP_LOOKUP_ELEM, &attr, sizeof(attr));
+    if (result.isError()) {
+      return Error("bpf syscall to BPF_MAP_LOOKUP_ELEM failed: " +
+                   result.error().message);
+    }
+
+    NetworkCountersValue sum = {0, 0};
+    foreach (const NetworkCountersValue& value, values) {
+      sum.packets += value.packets;
+      sum.bytes += value.bytes;
+    }
+
+    return sum;
+  };
+
+  Try<NetworkCountersValue> rx = lookup(NETWORK_COUNTERS_RX);
+  if (rx.isError()) {
+    return Error(rx.error());
+  }
+
+  Try<NetworkCountersValue> tx = lookup(NETWORK_COUNTERS_TX);
+  if (tx.isError()) {
+    return Error(tx.error());
+  }
+
+  NetworkCounters counters;
+  counters.rx_packets = rx->packets;
+  counters.rx_bytes = rx->bytes;
+  counters.tx_packets = tx->packets;
+  counters.tx_bytes = tx->bytes;
+
+  return counters;
+}
+
 } // namespace cgroups2 {
 
 } // namespace ebpf {
@@ -26,6 +26,7 @@
 #include <vector>
 
 #include "stout/nothing.hpp"
+#include "stout/result.hpp"
 #include "stout/try.hpp"
 
 namespace ebpf {
@@ -66,6 +67,36 @@ Try<Nothing> detach(const std::string& cgroup, uint32_t program_id);
 // Get the program ids of all programs that have been attached to a cgroup.
 Try<std::vector<uint32_t>> attached(const std::string& cgroup);
 
+
+// Network traffic of a cgroup and its descendants, as counted by the
+// BPF_PROG_TYPE_CGROUP_SKB programs attached by `attach_network_counters`.
+struct NetworkCounters
+{
+  uint64_t rx_packets = 0;
+  uint64_t rx_bytes = 0;
+  uint64_t tx_packets = 0;
+  uint64_t tx_bytes = 0;
+};
+
+
+// Load and attach a pair of BPF_CGROUP_INET_INGRESS and BPF_CGROUP_INET_EGRESS
+// programs to a cgroup which count the packets and bytes sent and received by
+// the cgroup into a per-CPU BPF map. Returns the file descriptor of the map,
+// which the caller owns. The programs stay attached until the cgroup is
+// removed or they are detached explicitly.
+Try<int> attach_network_counters(const std::string& cgroup);
+
+
+// Get the file descriptor of the map of the network counting programs that
+// have been attached to a cgroup, if any. Used to recover the counters after
+// the file descriptor returned by `attach_network_counters` is lost.
+Result<int> network_counters_map(const std::string& cgroup);
+
+
+// Read the network counters from a map created by `attach_network_counters`,
+// summing the values of all CPUs.
+Try<NetworkCounters> network_counters(int map_fd);
+
 } // namespace cgroups2 {
 
 
@@ -142,6 +173,69 @@ Try<std::vector<uint32_t>> attached(const std::string& cgroup);
     .imm = 0})
 
 
+#define BPF_ALU64_IMM(OP, DST, IMM)         \
+  ((bpf_insn){                              \
+    .code = BPF_ALU64 | BPF_OP(OP) | BPF_K, \
+    .dst_reg = DST,                         \
+    .src_reg = 0,                           \
+    .off = 0,                               \
+    .imm = IMM})
+
+
+#define BPF_ALU64_REG(OP, DST, SRC)         \
+  ((bpf_insn){                              \
+    .code = BPF_ALU64 | BPF_OP(OP) | BPF_X, \
+    .dst_reg = DST,                         \
+    .src_reg = SRC,                         \
+    .off = 0,                               \
+    .imm = 0})
+
+
+#define BPF_ST_MEM(SIZE, DST, OFF, IMM)        \
+  ((bpf_insn){                                 \
+    .code = BPF_ST | BPF_SIZE(SIZE) | BPF_MEM, \
+    .dst_reg = DST,                            \
+    .src_reg = 0,                              \
+    .off = OFF,                                \
+    .imm = IMM})
+
+
+#define BPF_STX_MEM(SIZE, DST, SRC, OFF)        \
+  ((bpf_insn){                                  \
+    .code = BPF_STX | BPF_SIZE(SIZE) | BPF_MEM, \
+    .dst_reg = DST,                             \
+    .src_reg = SRC,                             \
+    .off = OFF,                                 \
+    .imm = 0})
+
+
+// Loads the file descriptor of a map, which the verifier replaces with a
+// pointer to the map. This is a 16-byte instruction and therefore expands
+// to two `bpf_insn`s; it can only be used in an initializer list.
+#define BPF_LD_MAP_FD(DST, FD)                 \
+  ((bpf_insn){                                 \
+    .code = BPF_LD | BPF_DW | BPF_IMM,         \
+    .dst_reg = DST,                            \
+    .src_reg = BPF_PSEUDO_MAP_FD,              \
+    .off = 0,                                  \
+    .imm = FD}),                               \
+  ((bpf_insn){                                 \
+    .code = 0,                                 \
+    .dst_reg = 0,                              \
+    .src_reg = 0,                              \
+    .off = 0,                                  \
+    .imm = 0})
+
+
+#define BPF_EMIT_CALL(FUNC)     \
+  ((bpf_insn){                  \
+    .code = BPF_JMP | BPF_CALL, \
+    .dst_reg = 0,               \
+    .src_reg = 0,               \
+    .off = 0,                   \
+    .imm = FUNC})
+
+
 #define BPF_EXIT_INSN()         \
   ((bpf_insn){                  \
     .code = BPF_JMP | BPF_EXIT, \
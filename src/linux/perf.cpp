@@ -14,20 +14,33 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <fcntl.h>
 #include <signal.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
+#include <linux/perf_event.h>
+
+#include <sys/ioctl.h>
 #include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 
+#include <algorithm>
+#include <atomic>
+#include <limits>
 #include <list>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <tuple>
+#include <utility>
 #include <vector>
 
+#include <process/after.hpp>
 #include <process/clock.hpp>
 #include <process/collect.hpp>
 #include <process/defer.hpp>
@@ -37,6 +50,7 @@
 #include <process/subprocess.hpp>
 
 #include <stout/os.hpp>
+#include <stout/path.hpp>
 #include <stout/strings.hpp>
 
 #include <stout/os/signals.hpp>
@@ -51,11 +65,17 @@ using process::await;
 
 using std::list;
 using std::ostringstream;
+using std::shared_ptr;
 using std::set;
 using std::string;
 using std::tuple;
 using std::vector;
 
+// Available since Linux 3.14.
+#ifndef PERF_FLAG_FD_CLOEXEC
+#define PERF_FLAG_FD_CLOEXEC (1UL << 3)
+#endif
+
 namespace perf {
 
 // Delimiter for fields in perf stat output.
@@ -482,4 +502,651 @@ Try<hashmap<string, mesos::PerfStatistics>> parse(
   return statistics;
 }
 
+
+namespace native {
+namespace internal {
+
+// The maximum number of hardware events in a group of counters, which
+// most PMUs can count at once.
+constexpr size_t MAX_GROUP_HARDWARE_EVENTS = 4;
+
+// The maximum number of counters kept open if the limit on the number
+// of file descriptors of the agent cannot be determined.
+constexpr size_t DEFAULT_COUNTERS_BUDGET = 512;
+
+// The perf_event_attr type and config of an event along with the
+// PerfStatistics field it is reported in.
+struct Event
+{
+  uint32_t type;
+  uint64_t config;
+  string field;
+};
+
+
+// Returns the events known to the native sampler keyed by the names
+// used by perf-list(1), including the common aliases.
+static const hashmap<string, Event>& events()
+{
+  static const hashmap<string, Event>* events = []() {
+    hashmap<string, Event>* events = new hashmap<string, Event>();
+
+    auto add = [events](
+        const vector<string>& names,
+        uint32_t type,
+        uint64_t config) {
+      // The first name is the canonical one and matches a field.
+      const string field = perf::internal::normalize(names.front());
+
+      if (mesos::PerfStatistics::descriptor()->FindFieldByName(field) ==
+          nullptr) {
+        return;
+      }
+
+      foreach (const string& name, names) {
+        events->put(name, Event{type, config, field});
+      }
+    };
+
+    add({"cycles", "cpu-cycles"},
+        PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    add({"stalled-cycles-frontend", "idle-cycles-frontend"},
+        PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_FRONTEND);
+    add({"stalled-cycles-backend", "idle-cycles-backend"},
+        PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND);
+    add({"instructions"},
+        PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    add({"cache-references"},
+        PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES);
+    add({"cache-misses"},
+        PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    add({"branches", "branch-instructions"},
+        PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS);
+    add({"branch-misses"},
+        PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    add({"bus-cycles"},
+        PERF_TYPE_HARDWARE, PERF_COUNT_HW_BUS_CYCLES);
+    add({"ref-cycles"},
+        PERF_TYPE_HARDWARE, PERF_COUNT_HW_REF_CPU_CYCLES);
+
+    add({"cpu-clock"},
+        PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_CLOCK);
+    add({"task-clock"},
+        PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK);
+    add({"page-faults", "faults"},
+        PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS);
+    add({"minor-faults"},
+        PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MIN);
+    add({"major-faults"},
+        PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS_MAJ);
+    add({"context-switches", "cs"},
+        PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES);
+    add({"cpu-migrations", "migrations"},
+        PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS);
+    add({"alignment-faults"},
+        PERF_TYPE_SOFTWARE, PERF_COUNT_SW_ALIGNMENT_FAULTS);
+    add({"emulation-faults"},
+        PERF_TYPE_SOFTWARE, PERF_COUNT_SW_EMULATION_FAULTS);
+
+    // Hardware cache events are named '<cache>-<operation>', see
+    // perf_event_open(2) for the encoding of the config.
+    const vector<std::pair<string, uint64_t>> caches = {
+      {"L1-dcache", PERF_COUNT_HW_CACHE_L1D},
+      {"L1-icache", PERF_COUNT_HW_CACHE_L1I},
+      {"LLC", PERF_COUNT_HW_CACHE_LL},
+      {"dTLB", PERF_COUNT_HW_CACHE_DTLB},
+      {"iTLB", PERF_COUNT_HW_CACHE_ITLB},
+      {"branch", PERF_COUNT_HW_CACHE_BPU},
+      {"node", PERF_COUNT_HW_CACHE_NODE},
+    };
+
+    struct Operation
+    {
+      string name;
+      uint64_t op;
+      uint64_t result;
+    };
+
+    const vector<Operation> operations = {
+      {"loads", PERF_COUNT_HW_CACHE_OP_READ,
+       PERF_COUNT_HW_CACHE_RESULT_ACCESS},
+      {"load-misses", PERF_COUNT_HW_CACHE_OP_READ,
+       PERF_COUNT_HW_CACHE_RESULT_MISS},
+      {"stores", PERF_COUNT_HW_CACHE_OP_WRITE,
+       PERF_COUNT_HW_CACHE_RESULT_ACCESS},
+      {"store-misses", PERF_COUNT_HW_CACHE_OP_WRITE,
+       PERF_COUNT_HW_CACHE_RESULT_MISS},
+      {"prefetches", PERF_COUNT_HW_CACHE_OP_PREFETCH,
+       PERF_COUNT_HW_CACHE_RESULT_ACCESS},
+      {"prefetch-misses", PERF_COUNT_HW_CACHE_OP_PREFETCH,
+       PERF_COUNT_HW_CACHE_RESULT_MISS},
+    };
+
+    foreach (const auto& cache, caches) {
+      foreach (const Operation& operation, operations) {
+        add({cache.first + "-" + operation.name},
+            PERF_TYPE_HW_CACHE,
+            cache.second | (operation.op << 8) | (operation.result << 16));
+      }
+    }
+
+    return events;
+  }();
+
+  return *events;
+}
+
+
+// Returns whether opening a counter failed because the event is not
+// supported on this host, e.g., there is no PMU in a virtual machine.
+// Like `perf stat`, such events are ignored rather than failing.
+static bool unsupported(const ErrnoError& error)
+{
+  return error.code == ENOENT ||
+         error.code == EOPNOTSUPP ||
+         error.code == ENODEV;
+}
+
+
+// Returns the online CPUs, e.g., '0-3,8-11' yields 0,1,2,3,8,9,10,11.
+static Try<vector<int>> cpus()
+{
+  const string path = "/sys/devices/system/cpu/online";
+
+  Try<string> read = os::read(path);
+  if (read.isError()) {
+    return Error("Failed to read '" + path + "': " + read.error());
+  }
+
+  vector<int> cpus;
+
+  foreach (const string& range,
+           strings::tokenize(strings::trim(read.get()), ",")) {
+    vector<string> bounds = strings::split(range, "-");
+
+    Try<int> first = numify<int>(bounds.front());
+    Try<int> last = numify<int>(bounds.back());
+
+    if (bounds.size() > 2 || first.isError() || last.isError()) {
+      return Error("Failed to parse '" + path + "': " + read.get());
+    }
+
+    for (int cpu = first.get(); cpu <= last.get(); cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+
+  return cpus;
+}
+
+
+// Opens a counter for the event, see perf_event_open(2) for the
+// meaning of 'pid', 'cpu', 'group' and 'flags'. The counters of a
+// group are read at once from its leader, i.e., the counter opened
+// with no 'group', which is opened disabled so that the counters of
+// the group can be enabled together.
+static Try<int_fd, ErrnoError> open(
+    const Event& event,
+    int pid,
+    int cpu,
+    int group,
+    unsigned long flags)
+{
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+
+  attr.size = sizeof(attr);
+  attr.type = event.type;
+  attr.config = event.config;
+  attr.disabled = (group == -1);
+
+  // Counters are multiplexed when there are more events than hardware
+  // counters, the times are needed to scale the count accordingly.
+  attr.read_format =
+    PERF_FORMAT_GROUP |
+    PERF_FORMAT_TOTAL_TIME_ENABLED |
+    PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  long fd = ::syscall(
+      __NR_perf_event_open,
+      &attr,
+      pid,
+      cpu,
+      group,
+      flags | PERF_FLAG_FD_CLOEXEC);
+
+  if (fd < 0) {
+    return ErrnoError();
+  }
+
+  return static_cast<int_fd>(fd);
+}
+
+
+// Splits the events into the groups of counters which are opened for
+// each cgroup and CPU. All the counters of a group are scheduled onto
+// the PMU at once, hence a group is never counted if it has more
+// hardware events than the PMU has counters. The software events are
+// added to the first group.
+static Try<vector<vector<Event>>> groups(const set<string>& names)
+{
+  vector<Event> hardware;
+  vector<Event> software;
+
+  foreach (const string& name, names) {
+    if (!events().contains(name)) {
+      return Error("Unknown perf event '" + name + "'");
+    }
+
+    const Event& event = events().at(name);
+
+    if (event.type == PERF_TYPE_SOFTWARE) {
+      software.push_back(event);
+    } else {
+      hardware.push_back(event);
+    }
+  }
+
+  vector<vector<Event>> groups;
+
+  for (size_t i = 0; i < hardware.size(); i += MAX_GROUP_HARDWARE_EVENTS) {
+    groups.emplace_back(
+        hardware.begin() + i,
+        hardware.begin() +
+          std::min(i + MAX_GROUP_HARDWARE_EVENTS, hardware.size()));
+  }
+
+  if (!software.empty()) {
+    if (groups.empty()) {
+      groups.emplace_back();
+    }
+
+    groups.front().insert(
+        groups.front().end(), software.begin(), software.end());
+  }
+
+  return groups;
+}
+
+
+// Returns the maximum number of counters that the samples in flight
+// keep open, which leaves half of the file descriptors of the agent
+// for other uses.
+static size_t budget()
+{
+  struct rlimit limit;
+  if (::getrlimit(RLIMIT_NOFILE, &limit) != 0) {
+    return DEFAULT_COUNTERS_BUDGET;
+  }
+
+  if (limit.rlim_cur == RLIM_INFINITY) {
+    return std::numeric_limits<size_t>::max();
+  }
+
+  return static_cast<size_t>(limit.rlim_cur) / 2;
+}
+
+
+// The number of counters kept open by the samples in flight.
+static std::atomic<size_t> opened(0);
+
+// The position of the first cgroup to sample, which rotates when the
+// counters of all the cgroups do not fit in the budget.
+static std::atomic<size_t> offset(0);
+
+
+// A group of counters of a cgroup on a CPU.
+struct Group
+{
+  string cgroup;
+
+  // The events in the order their counts are read, and the counters,
+  // the leader of the group first.
+  vector<Event> events;
+  vector<int_fd> fds;
+};
+
+
+// Opens the counters of the events as a group for the cgroup referred
+// to by 'fd' on the CPU, and enables them. Events unsupported by the
+// host are left out of the group.
+static Try<Nothing> open(
+    const vector<Event>& events,
+    int_fd fd,
+    int cpu,
+    Group* group)
+{
+  foreach (const Event& event, events) {
+    Try<int_fd, ErrnoError> counter = open(
+        event,
+        fd,
+        cpu,
+        group->fds.empty() ? -1 : group->fds.front(),
+        PERF_FLAG_PID_CGROUP);
+
+    if (counter.isError()) {
+      if (unsupported(counter.error())) {
+        VLOG(2) << "Unsupported perf counter '" << event.field
+                << "', ignoring";
+        continue;
+      }
+
+      return Error(
+          "Failed to open perf counter '" + event.field + "' on CPU " +
+          stringify(cpu) + ": " + counter.error().message);
+    }
+
+    group->events.push_back(event);
+    group->fds.push_back(counter.get());
+  }
+
+  if (!group->fds.empty() &&
+      ::ioctl(
+          group->fds.front(),
+          PERF_EVENT_IOC_ENABLE,
+          PERF_IOC_FLAG_GROUP) < 0) {
+    return ErrnoError("Failed to enable perf counters on CPU " +
+                      stringify(cpu));
+  }
+
+  return Nothing();
+}
+
+
+// Reads the counts of the counters of a group at once, each scaled to
+// the time the group was enabled.
+static Try<vector<double>> read(const Group& group)
+{
+  // The number of counters, the time enabled, the time running and
+  // the value of each counter, see PERF_FORMAT_GROUP.
+  vector<uint64_t> values(3 + group.fds.size());
+
+  const size_t size = values.size() * sizeof(uint64_t);
+
+  ssize_t length = ::read(group.fds.front(), values.data(), size);
+  if (length < 0) {
+    return ErrnoError();
+  } else if (static_cast<size_t>(length) != size ||
+             values[0] != group.fds.size()) {
+    return Error("Unexpected size (" + stringify(length) + ")");
+  }
+
+  vector<double> counts;
+
+  for (size_t i = 3; i < values.size(); i++) {
+    // The group was never scheduled, i.e., `<not counted>`.
+    if (values[2] == 0) {
+      counts.push_back(0.0);
+    } else {
+      counts.push_back(
+          values[i] * (static_cast<double>(values[1]) / values[2]));
+    }
+  }
+
+  return counts;
+}
+
+
+// Adds the count of the event to the statistics, summing up the counts
+// of all CPUs. The clocks are counted in nanoseconds but reported in
+// milliseconds like `perf stat`.
+static Try<Nothing> add(
+    const Event& event,
+    double count,
+    mesos::PerfStatistics* statistics)
+{
+  const google::protobuf::Reflection* reflection =
+    statistics->GetReflection();
+  const google::protobuf::FieldDescriptor* field =
+    statistics->GetDescriptor()->FindFieldByName(event.field);
+
+  switch (field->type()) {
+    case google::protobuf::FieldDescriptor::TYPE_DOUBLE:
+      reflection->SetDouble(
+          statistics,
+          field,
+          reflection->GetDouble(*statistics, field) + count / 1e6);
+      break;
+    case google::protobuf::FieldDescriptor::TYPE_UINT64:
+      reflection->SetUInt64(
+          statistics,
+          field,
+          reflection->GetUInt64(*statistics, field) +
+            static_cast<uint64_t>(count));
+      break;
+    default:
+      return Error("Unsupported perf field type for '" + event.field + "'");
+  }
+
+  return Nothing();
+}
+
+
+// The counters of a sample, closed once the sample has completed or
+// has been discarded.
+struct Counters
+{
+  ~Counters()
+  {
+    foreach (const Group& group, groups) {
+      foreach (int_fd fd, group.fds) {
+        os::close(fd);
+      }
+    }
+
+    opened -= reserved;
+  }
+
+  set<string> cgroups;
+  vector<Group> groups;
+
+  // The number of counters reserved from the budget.
+  size_t reserved = 0;
+};
+
+} // namespace internal {
+
+
+Future<hashmap<string, mesos::PerfStatistics>> sample(
+    const set<string>& events,
+    const string& hierarchy,
+    const set<string>& cgroups,
+    const Duration& duration)
+{
+  // Is this a no-op?
+  if (cgroups.empty()) {
+    return hashmap<string, mesos::PerfStatistics>();
+  }
+
+  Try<vector<vector<internal::Event>>> groups = internal::groups(events);
+  if (groups.isError()) {
+    return Failure(groups.error());
+  }
+
+  Try<vector<int>> cpus = internal::cpus();
+  if (cpus.isError()) {
+    return Failure("Failed to get the online CPUs: " + cpus.error());
+  }
+
+  // The maximum number of counters opened for a cgroup.
+  const size_t needed = events.size() * cpus->size();
+  const size_t budget = internal::budget();
+
+  // When the counters of all the cgroups do not fit in the budget, the
+  // cgroups which are sampled rotate across samples.
+  vector<string> order(cgroups.begin(), cgroups.end());
+  std::rotate(
+      order.begin(),
+      order.begin() + (internal::offset.load() % order.size()),
+      order.end());
+
+  shared_ptr<internal::Counters> counters(new internal::Counters());
+
+  size_t skipped = 0;
+
+  foreach (const string& cgroup, order) {
+    if (internal::opened.fetch_add(needed) + needed > budget) {
+      internal::opened -= needed;
+      skipped++;
+      continue;
+    }
+
+    counters->reserved += needed;
+
+    // The cgroup may be destroyed concurrently, in which case it is
+    // left out of the sample.
+    Try<int_fd> fd = os::open(
+        path::join(hierarchy, cgroup),
+        O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (fd.isError()) {
+      VLOG(1) << "Skipping perf sample of cgroup '" << cgroup << "': "
+              << fd.error();
+      continue;
+    }
+
+    // The groups of the cgroup, which are only added to the sample
+    // once the counters have been opened on all CPUs.
+    vector<internal::Group> pending;
+    Option<Error> error;
+
+    // A counter in cgroup mode only counts on a single CPU, hence
+    // one group of counters is needed per CPU.
+    foreach (int cpu, cpus.get()) {
+      foreach (const vector<internal::Event>& members, groups.get()) {
+        internal::Group group;
+        group.cgroup = cgroup;
+
+        Try<Nothing> open = internal::open(members, fd.get(), cpu, &group);
+        if (open.isError()) {
+          foreach (int_fd counter, group.fds) {
+            os::close(counter);
+          }
+
+          error = Error(open.error());
+          break;
+        }
+
+        if (!group.fds.empty()) {
+          pending.push_back(std::move(group));
+        }
+      }
+
+      if (error.isSome()) {
+        break;
+      }
+    }
+
+    os::close(fd.get());
+
+    // The other cgroups are still sampled if the counters of a cgroup
+    // cannot be opened, e.g., as it is destroyed concurrently.
+    if (error.isSome()) {
+      LOG(WARNING) << "Skipping perf sample of cgroup '" << cgroup << "': "
+                   << error->message;
+
+      foreach (const internal::Group& group, pending) {
+        foreach (int_fd counter, group.fds) {
+          os::close(counter);
+        }
+      }
+
+      continue;
+    }
+
+    counters->cgroups.insert(cgroup);
+
+    foreach (internal::Group& group, pending) {
+      counters->groups.push_back(std::move(group));
+    }
+  }
+
+  if (skipped > 0) {
+    LOG(WARNING) << "Skipping perf sample of " << skipped << " out of "
+                 << order.size() << " cgroups whose counters exceed the"
+                 << " budget of " << budget << " file descriptors";
+
+    internal::offset += order.size() - skipped;
+  }
+
+  Time start = Clock::now();
+
+  return process::after(duration)
+    .then([counters, start, duration](const Nothing&)
+        -> Future<hashmap<string, mesos::PerfStatistics>> {
+      hashmap<string, mesos::PerfStatistics> statistics;
+
+      foreach (const string& cgroup, counters->cgroups) {
+        statistics[cgroup].set_timestamp(start.secs());
+        statistics[cgroup].set_duration(duration.secs());
+      }
+
+      // The cgroups whose counters could not be read, which are left
+      // out of the sample rather than failing it for all cgroups.
+      set<string> failed;
+
+      foreach (const internal::Group& group, counters->groups) {
+        if (failed.count(group.cgroup) > 0) {
+          continue;
+        }
+
+        Try<vector<double>> counts = internal::read(group);
+        if (counts.isError()) {
+          LOG(WARNING) << "Skipping perf sample of cgroup '" << group.cgroup
+                       << "': Failed to read perf counters: "
+                       << counts.error();
+
+          failed.insert(group.cgroup);
+          statistics.erase(group.cgroup);
+          continue;
+        }
+
+        for (size_t i = 0; i < group.events.size(); i++) {
+          Try<Nothing> add = internal::add(
+              group.events[i],
+              counts->at(i),
+              &statistics[group.cgroup]);
+
+          if (add.isError()) {
+            return Failure(add.error());
+          }
+        }
+      }
+
+      return statistics;
+    });
+}
+
+
+bool valid(const set<string>& events)
+{
+  foreach (const string& name, events) {
+    if (!internal::events().contains(name)) {
+      LOG(ERROR) << "Unknown perf event '" << name << "'";
+      return false;
+    }
+
+    // Check that the event can be counted, e.g., that the agent is
+    // permitted to open counters, with a counter for the calling
+    // process on any CPU.
+    Try<int_fd, ErrnoError> counter =
+      internal::open(internal::events().at(name), 0, -1, -1, 0);
+
+    if (counter.isError()) {
+      if (internal::unsupported(counter.error())) {
+        continue;
+      }
+
+      LOG(ERROR) << "Failed to open perf counter '" << name << "': "
+                 << counter.error().message;
+      return false;
+    }
+
+    os::close(counter.get());
+  }
+
+  return true;
+}
+
+} // namespace native {
 } // namespace perf {
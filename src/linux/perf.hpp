@@ -65,6 +65,34 @@ Try<Version> parseVersion(const std::string& output);
 Try<hashmap<std::string, mesos::PerfStatistics>> parse(
     const std::string& output);
 
+
+// An in-process sampler that opens perf_event_open(2) counters in
+// cgroup mode (PERF_FLAG_PID_CGROUP) on every online CPU instead of
+// forking `perf stat`. The counters of a cgroup on a CPU are opened as
+// a group and read at once (PERF_FORMAT_GROUP). The counters kept open
+// are bounded by half of the agent's limit on file descriptors; the
+// cgroups that do not fit are left out of a sample, in turn. Only the
+// events that have a field in the PerfStatistics protobuf are
+// supported.
+namespace native {
+
+// Sample the perf events for process(es) in the cgroups for duration.
+// The returned hashmap is keyed by cgroup.
+// NOTE: cgroups should be relative to the hierarchy, e.g., mesos/test
+// for /sys/fs/cgroup/perf_event/mesos/test. For cgroups v2 the
+// hierarchy is the cgroup2 mount point.
+process::Future<hashmap<std::string, mesos::PerfStatistics>> sample(
+    const std::set<std::string>& events,
+    const std::string& hierarchy,
+    const std::set<std::string>& cgroups,
+    const Duration& duration);
+
+
+// Validate a set of events are known to the native sampler and can
+// be counted on this host.
+bool valid(const std::set<std::string>& events);
+
+} // namespace native {
 } // namespace perf {
 
 #endif // __PERF_HPP__
@@ -429,7 +429,11 @@ PID<Master> launch(const Flags& flags, Allocator* _allocator)
         << slaveFlags.runtime_dir << "': " << mkdir.error();
     }
 
-    garbageCollectors->push_back(new GarbageCollector(slaveFlags.work_dir));
+    garbageCollectors->push_back(new GarbageCollector(
+        slaveFlags.work_dir,
+        slaveFlags.gc_threads,
+        slaveFlags.gc_inode_rate_limit,
+        slaveFlags.gc_io_rate_limit));
     taskStatusUpdateManagers->push_back(
         new TaskStatusUpdateManager(slaveFlags));
     fetchers->push_back(new Fetcher(slaveFlags));
@@ -16,13 +16,20 @@
 
 #include <stdint.h>
 
+#include <algorithm>
 #include <list>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
 
 #include <process/collect.hpp>
 #include <process/id.hpp>
 #include <process/process.hpp>
 #include <process/timer.hpp>
 
+#include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
 #include <stout/lambda.hpp>
 #include <stout/stringify.hpp>
 
@@ -35,11 +42,20 @@
 using namespace process;
 
 using std::list;
+using std::vector;
 
 namespace mesos {
 namespace internal {
 namespace log {
 
+// The number of ranges of positions which are fetched in bulk at once
+// during a catch-up.
+static const size_t CATCHUP_RANGES = 4;
+
+// The number of positions which are filled at once during a catch-up.
+static const size_t CATCHUP_FILLS = 16;
+
+
 class CatchUpProcess : public Process<CatchUpProcess>
 {
 public:
@@ -166,10 +182,17 @@ static Future<uint64_t> catchup(
 }
 
 
-// TODO(jieyu): Our current implementation catches-up each position in
-// the set sequentially. In the future, we may want to parallelize it
-// to improve the performance. Also, we may want to implement rate
-// control here so that we don't saturate the network or disk.
+// Catches-up an interval of positions in two phases. First, the
+// learned actions are fetched in bulk from the other replicas (see
+// 'CatchUpRequest'): the interval is split into ranges which are
+// fetched concurrently, each in chunks bounded by the size of the
+// responses. Then, only the positions that are still missing (i.e.,
+// that no replica has learned, or that could not be fetched in time,
+// e.g., because the other replicas do not support bulk catch-up) are
+// filled using Paxos, several of them at once.
+//
+// TODO(jieyu): We may want to implement rate control here so that we
+// don't saturate the network or disk.
 class BulkCatchUpProcess : public Process<BulkCatchUpProcess>
 {
 public:
@@ -199,77 +222,295 @@ protected:
     promise.future().onDiscard(lambda::bind(
         static_cast<void(*)(const UPID&, bool)>(terminate), self(), true));
 
-    // Catch-up sequentially.
-    current = positions.lower();
+    if (positions.lower() >= positions.upper()) {
+      // Nothing to catch-up (i.e., the input interval is empty).
+      promise.set(Nothing());
+      terminate(self());
+      return;
+    }
 
-    catchup();
+    fetch();
   }
 
   void finalize() override
   {
-    catching.discard();
+    foreach (Future<vector<Future<CatchUpResponse>>> future, fetching) {
+      future.discard();
+    }
+
+    foreach (Future<bool> future, learning) {
+      future.discard();
+    }
+
+    checking.discard();
 
-    // TODO(benh): Discard our promise only after 'catching' has
-    // completed (ready, failed, or discarded).
+    foreachvalue (Future<uint64_t> future, filling) {
+      future.discard();
+    }
+
+    // TODO(benh): Discard our promise only after all the futures
+    // above have completed (ready, failed, or discarded).
     promise.discard();
   }
 
 private:
+  // A range of positions [next, last] which is fetched in bulk.
+  struct Range
+  {
+    uint64_t next;
+    uint64_t last;
+  };
+
   static void timedout(Future<uint64_t> catching)
   {
     catching.discard();
   }
 
-  void catchup()
+  void fetch()
   {
-    if (current >= positions.upper()) {
-      // Stop the process if there is nothing left to catch-up. This
-      // also handles the case where the input interval is empty.
-      promise.set(Nothing());
+    const uint64_t size = positions.upper() - positions.lower();
+    const uint64_t count = std::min<uint64_t>(CATCHUP_RANGES, size);
+    const uint64_t step = (size + count - 1) / count;
+
+    for (uint64_t i = 0; i < count; i++) {
+      Range range;
+      range.next = positions.lower() + i * step;
+      range.last = std::min(range.next + step, positions.upper()) - 1;
+
+      if (range.next <= range.last) {
+        ranges.push_back(range);
+      }
+    }
+
+    fetching.resize(ranges.size());
+    learning.resize(ranges.size());
+
+    for (size_t i = 0; i < ranges.size(); i++) {
+      fetch(i);
+    }
+  }
+
+  void fetch(size_t index)
+  {
+    const Range& range = ranges[index];
+
+    if (range.next > range.last) {
+      // Once all the ranges are fetched, fill what is still missing.
+      if (++fetched == ranges.size()) {
+        check();
+      }
+      return;
+    }
+
+    CatchUpRequest request;
+    request.set_from(range.next);
+    request.set_to(range.last);
+
+    // We ask all the other replicas at once so that a position which
+    // some replica has not learned (e.g., a replica which is itself
+    // recovering) can still be caught-up from the others.
+    std::set<UPID> filter = {replica->pid()};
+
+    const Duration fetchTimeout = timeout;
+
+    fetching[index] = network->broadcast(protocol::catchup, request, filter)
+      .then([fetchTimeout](const std::set<Future<CatchUpResponse>>& set) {
+        const vector<Future<CatchUpResponse>> responses(
+            set.begin(), set.end());
+
+        // We move on with the responses which have arrived as soon as
+        // a VOTING replica (i.e., one which replies with an 'end') has
+        // covered the range, so that the replicas which never reply
+        // (e.g., older replicas during a rolling upgrade, which do not
+        // support bulk catch-up) do not hold up every chunk until the
+        // timeout. On timeout we use whatever is ready as well.
+        std::shared_ptr<process::Promise<Nothing>> covered(
+            new process::Promise<Nothing>());
+
+        foreach (const Future<CatchUpResponse>& response, responses) {
+          response.onReady([covered](const CatchUpResponse& response) {
+            if (response.has_end()) {
+              covered->set(Nothing());
+            }
+          });
+        }
+
+        Future<vector<Future<CatchUpResponse>>> all = await(responses);
+
+        all.onAny([covered](const Future<vector<Future<CatchUpResponse>>>&) {
+          covered->set(Nothing());
+        });
+
+        return covered->future()
+          .after(fetchTimeout, [](Future<Nothing> future) -> Future<Nothing> {
+            future.discard();
+            return Nothing();
+          })
+          .then([responses, all]() mutable {
+            // Give up on the replicas which have not replied yet.
+            all.discard();
+
+            foreach (Future<CatchUpResponse> response, responses) {
+              response.discard();
+            }
+
+            return responses;
+          });
+      });
+
+    fetching[index]
+      .onAny(defer(self(), &Self::_fetch, index, lambda::_1));
+  }
+
+  void _fetch(
+      size_t index,
+      const Future<vector<Future<CatchUpResponse>>>& future)
+  {
+    Range& range = ranges[index];
+
+    // Learned actions keyed by position, to skip duplicates.
+    std::map<uint64_t, Action> actions;
+    Option<uint64_t> end;
+
+    if (future.isReady()) {
+      foreach (const Future<CatchUpResponse>& response, future.get()) {
+        if (!response.isReady() || !response->has_end()) {
+          continue;
+        }
+
+        // The range is only covered up to the shortest response.
+        end = min(end, response->end());
+
+        foreach (const Action& action, response->actions()) {
+          if (action.has_learned() && action.learned()) {
+            actions.emplace(action.position(), action);
+          }
+        }
+      }
+    }
+
+    if (end.isNone() || end.get() < range.next) {
+      // Leave the rest of the range to be filled.
+      LOG(INFO) << "Unable to catch-up positions " << range.next
+                << " -> " << range.last << " in bulk, filling them instead";
+
+      range.next = range.last + 1;
+      fetch(index);
+      return;
+    }
+
+    list<Action> learned;
+    foreachvalue (const Action& action, actions) {
+      learned.push_back(action);
+    }
+
+    VLOG(1) << "Caught-up " << learned.size() << " learned positions in "
+            << range.next << " -> " << end.get();
+
+    learning[index] = replica->learn(learned);
+    learning[index]
+      .onAny(defer(self(), &Self::learned, index, end.get(), lambda::_1));
+  }
+
+  void learned(size_t index, uint64_t end, const Future<bool>& future)
+  {
+    // The future 'learning' can only be discarded in 'finalize'.
+    CHECK(!future.isDiscarded());
+
+    if (!future.isReady() || !future.get()) {
+      promise.fail(
+          "Failed to persist positions " + stringify(ranges[index].next) +
+          " -> " + stringify(end) +
+          (future.isFailed() ? ": " + future.failure() : ""));
+
       terminate(self());
       return;
     }
 
-    // Store the future so that we can discard it if the user wants to
-    // cancel the catch-up operation.
-    catching = log::catchup(quorum, replica, network, proposal, current)
-      .onDiscarded(defer(self(), &Self::discarded))
-      .onFailed(defer(self(), &Self::failed))
-      .onReady(defer(self(), &Self::succeeded));
+    ranges[index].next = end + 1;
+    fetch(index);
+  }
 
-    Clock::timer(timeout, lambda::bind(&Self::timedout, catching));
+  void check()
+  {
+    checking = replica->missing(positions.lower(), positions.upper() - 1);
+    checking.onAny(defer(self(), &Self::checked));
   }
 
+  void checked()
+  {
+    // The future 'checking' can only be discarded in 'finalize'.
+    CHECK(!checking.isDiscarded());
+
+    if (checking.isFailed()) {
+      promise.fail("Failed to get missing positions: " + checking.failure());
+      terminate(self());
+      return;
+    }
+
+    missing = checking.get();
 
-  void discarded()
+    LOG(INFO) << "Filling " << missing.size() << " missing positions in "
+              << positions;
+
+    fill();
+  }
+
+  void fill()
   {
-    LOG(INFO) << "Unable to catch-up position " << current
-              << " in " << timeout << ", retrying";
+    while (filling.size() < CATCHUP_FILLS && !missing.empty()) {
+      const uint64_t position = missing.begin()->lower();
+      missing -= position;
+
+      fill(position);
+    }
 
-    catchup();
+    if (filling.empty()) {
+      // Stop the process if there is nothing left to catch-up.
+      promise.set(Nothing());
+      terminate(self());
+    }
   }
 
-  void failed()
+  void fill(uint64_t position)
   {
-    promise.fail(
-        "Failed to catch-up position " + stringify(current) +
-        ": " + catching.failure());
+    // Store the future so that we can discard it if the user wants to
+    // cancel the catch-up operation.
+    Future<uint64_t> catching =
+      log::catchup(quorum, replica, network, proposal, position);
 
-    terminate(self());
+    filling[position] = catching;
+
+    catching.onAny(defer(self(), &Self::filled, position, lambda::_1));
+
+    Clock::timer(timeout, lambda::bind(&Self::timedout, catching));
   }
 
-  void succeeded()
+  void filled(uint64_t position, const Future<uint64_t>& catching)
   {
-    ++current;
+    filling.erase(position);
+
+    if (catching.isDiscarded()) {
+      LOG(INFO) << "Unable to catch-up position " << position
+                << " in " << timeout << ", retrying";
+
+      fill(position);
+    } else if (catching.isFailed()) {
+      promise.fail(
+          "Failed to catch-up position " + stringify(position) +
+          ": " + catching.failure());
 
-    // The single position catch-up function: 'log::catchup' will
-    // return the highest proposal number seen so far. We use this
-    // proposal number for the next 'catchup' as it is highly likely
-    // that this number is high enough, saving potentially unnecessary
-    // proposal number bumps.
-    proposal = catching.get();
+      terminate(self());
+    } else {
+      // The single position catch-up function: 'log::catchup' will
+      // return the highest proposal number seen so far. We use this
+      // proposal number for the next 'catchup' as it is highly likely
+      // that this number is high enough, saving potentially unnecessary
+      // proposal number bumps.
+      proposal = std::max(proposal, catching.get());
 
-    catchup();
+      fill();
+    }
   }
 
   const size_t quorum;
@@ -279,10 +520,20 @@ private:
   const Duration timeout;
 
   uint64_t proposal;
-  uint64_t current;
 
   process::Promise<Nothing> promise;
-  Future<uint64_t> catching;
+
+  // Bulk fetching of learned actions, the futures are indexed like
+  // the ranges.
+  vector<Range> ranges;
+  vector<Future<vector<Future<CatchUpResponse>>>> fetching;
+  vector<Future<bool>> learning;
+  size_t fetched = 0;
+
+  // Filling of the positions that are still missing.
+  Future<IntervalSet<uint64_t>> checking;
+  IntervalSet<uint64_t> missing;
+  hashmap<uint64_t, Future<uint64_t>> filling;
 };
 
 
@@ -34,14 +34,16 @@ namespace mesos {
 namespace internal {
 namespace log {
 
-// Catches-up a set of log positions in the local replica. The user of
-// this function can provide a hint on the proposal number that will
-// be used for Paxos. This could potentially save us a few Paxos
-// rounds. However, if the user has no idea what proposal number to
-// use, they can just use none. We also allow the user to specify a
-// timeout for the catch-up operation on each position and retry the
-// operation if timeout happens. This can help us tolerate network
-// blips.
+// Catches-up a set of log positions in the local replica. The actions
+// that other replicas have already learned are fetched in bulk, only
+// the remaining positions are filled using Paxos (several of them
+// concurrently). The user of this function can provide a hint on the
+// proposal number that will be used for Paxos. This could potentially
+// save us a few Paxos rounds. However, if the user has no idea what
+// proposal number to use, they can just use none. We also allow the
+// user to specify a timeout for the catch-up operation on each
+// position and retry the operation if timeout happens. This can help
+// us tolerate network blips.
 extern process::Future<Nothing> catchup(
     size_t quorum,
     const process::Shared<Replica>& replica,
@@ -27,6 +27,7 @@
 #include "log/tool.hpp"
 #include "log/tool/benchmark.hpp"
 #include "log/tool/initialize.hpp"
+#include "log/tool/migrate.hpp"
 #include "log/tool/read.hpp"
 #include "log/tool/replica.hpp"
 
@@ -69,6 +70,7 @@ int main(int argc, char** argv)
   // Register log tools.
   add(Owned<tool::Tool>(new tool::Benchmark()));
   add(Owned<tool::Tool>(new tool::Initialize()));
+  add(Owned<tool::Tool>(new tool::Migrate()));
   add(Owned<tool::Tool>(new tool::Read()));
   add(Owned<tool::Tool>(new tool::Replica()));
 
@@ -23,18 +23,25 @@
 #include <process/dispatch.hpp>
 #include <process/id.hpp>
 
+#include <stout/bytes.hpp>
 #include <stout/check.hpp>
 #include <stout/error.hpp>
 #include <stout/exit.hpp>
 #include <stout/foreach.hpp>
 #include <stout/none.hpp>
 #include <stout/nothing.hpp>
+#include <stout/option.hpp>
+#include <stout/path.hpp>
 #include <stout/result.hpp>
 #include <stout/try.hpp>
 #include <stout/utils.hpp>
 
+#include <stout/os/exists.hpp>
+#include <stout/os/getenv.hpp>
+
 #ifndef __WINDOWS__
 #include "log/leveldb.hpp"
+#include "log/segment.hpp"
 #endif // __WINDOWS__
 #include "log/replica.hpp"
 #include "log/storage.hpp"
@@ -54,10 +61,47 @@ namespace protocol {
 Protocol<PromiseRequest, PromiseResponse> promise;
 Protocol<WriteRequest, WriteResponse> write;
 Protocol<RecoverRequest, RecoverResponse> recover;
+Protocol<CatchUpRequest, CatchUpResponse> catchup;
 
 } // namespace protocol {
 
 
+// The (soft) limit on the size of the actions sent back in response
+// to a single catch-up request.
+static const Bytes MAX_CATCHUP_RESPONSE_BYTES = Megabytes(4);
+
+
+// Returns the storage to use for the log at the specified path. A log
+// keeps the storage it was created with; a new log uses the storage
+// selected through the environment (like the other storage knobs, this
+// is not a flag since it would have to be threaded through the JNI
+// layer), defaulting to leveldb.
+static Storage* createStorage(const string& path)
+{
+  if (SegmentStorage::exists(path)) {
+    return new SegmentStorage();
+  }
+
+  Option<string> storage = os::getenv("MESOS_LOG_STORAGE");
+
+  if (storage.isSome() && storage.get() == "segment") {
+    // Do not shadow an existing leveldb log, 'SegmentStorage' will
+    // refuse to restore it anyway.
+    if (!os::exists(path) || !os::exists(path::join(path, "CURRENT"))) {
+      return new SegmentStorage();
+    }
+
+    LOG(WARNING) << "Ignoring MESOS_LOG_STORAGE=segment for existing"
+                 << " leveldb log '" << path << "'";
+  } else if (storage.isSome() && storage.get() != "leveldb") {
+    LOG(WARNING) << "Ignoring unknown MESOS_LOG_STORAGE '" << storage.get()
+                 << "', using leveldb";
+  }
+
+  return new LevelDBStorage();
+}
+
+
 class ReplicaProcess : public ProtobufProcess<ReplicaProcess>
 {
 public:
@@ -103,6 +147,10 @@ public:
   // to storage. Returns true on success and false otherwise.
   bool update(const Metadata::Status& status);
 
+  // Persists actions which are known to be learned. Returns true on
+  // success and false otherwise.
+  bool learn(const list<Action>& actions);
+
 private:
   // Handles a request from a proposer to promise not to accept writes
   // from any other proposer with lower proposal number.
@@ -114,6 +162,10 @@ private:
   // Handles a request from a recover process.
   void recover(const UPID& from, const RecoverRequest& request);
 
+  // Handles a request from a recovering replica for the learned
+  // actions in a range of positions.
+  void catchup(const UPID& from, const CatchUpRequest& request);
+
   // Handles a message notifying of a learned action.
   void learned(const UPID& from, const Action& action);
 
@@ -155,8 +207,7 @@ ReplicaProcess::ReplicaProcess(const string& path)
     begin(0),
     end(0)
 {
-  // TODO(benh): Factor out and expose storage.
-  storage = new LevelDBStorage();
+  storage = createStorage(path);
 
   restore(path);
 
@@ -170,6 +221,9 @@ ReplicaProcess::ReplicaProcess(const string& path)
   install<RecoverRequest>(
       &ReplicaProcess::recover);
 
+  install<CatchUpRequest>(
+      &ReplicaProcess::catchup);
+
   install<LearnedMessage>(
       &ReplicaProcess::learned,
       &LearnedMessage::action);
@@ -690,6 +744,71 @@ void ReplicaProcess::recover(const UPID& from, const RecoverRequest& request)
 }
 
 
+void ReplicaProcess::catchup(const UPID& from, const CatchUpRequest& request)
+{
+  VLOG(1) << "Replica in " << status()
+          << " status received a catch-up request for positions "
+          << request.from() << " -> " << request.to() << " from " << from;
+
+  CatchUpResponse response;
+
+  // Only a VOTING replica can tell that a position which it has not
+  // learned is missing rather than not yet caught-up (in which case
+  // the recovering replica has to fill it).
+  if (status() != Metadata::VOTING || request.from() > request.to()) {
+    reply(response);
+    return;
+  }
+
+  response.set_end(request.to());
+
+  const uint64_t first = std::max(request.from(), begin);
+  const uint64_t last = std::min(request.to(), end);
+
+  if (first > last) {
+    reply(response);
+    return;
+  }
+
+  IntervalSet<uint64_t> learned(
+      Bound<uint64_t>::closed(first),
+      Bound<uint64_t>::closed(last));
+
+  learned -= holes;
+  learned -= unlearned;
+
+  size_t bytes = 0;
+
+  foreach (const Interval<uint64_t>& interval, learned) {
+    for (uint64_t position = interval.lower();
+         position < interval.upper();
+         position++) {
+      Try<Action> action = storage->read(position);
+
+      if (action.isError()) {
+        // The recovering replica will fill this position instead.
+        LOG(WARNING) << "Failed to read position " << position
+                     << " for catch-up: " << action.error();
+        continue;
+      }
+
+      bytes += action->ByteSizeLong();
+      response.add_actions()->CopyFrom(action.get());
+
+      // Stop early rather than sending a huge message, the recovering
+      // replica will ask for the rest of the range.
+      if (bytes >= MAX_CATCHUP_RESPONSE_BYTES.bytes()) {
+        response.set_end(position);
+        reply(response);
+        return;
+      }
+    }
+  }
+
+  reply(response);
+}
+
+
 void ReplicaProcess::learned(const UPID& from, const Action& action)
 {
   LOG(INFO) << "Replica received learned notice for position "
@@ -700,6 +819,25 @@ void ReplicaProcess::learned(const UPID& from, const Action& action)
 }
 
 
+bool ReplicaProcess::learn(const list<Action>& actions)
+{
+  foreach (const Action& action, actions) {
+    CHECK(action.has_learned() && action.learned());
+
+    // Note that truncated positions are not missing either.
+    if (!missing(action.position())) {
+      continue;
+    }
+
+    if (!persist(action)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
 bool ReplicaProcess::persist(const Action& action)
 {
   Try<Nothing> persisted = storage->persist(action);
@@ -863,6 +1001,12 @@ Future<bool> Replica::update(const Metadata::Status& status)
 }
 
 
+Future<bool> Replica::learn(const list<Action>& actions) const
+{
+  return dispatch(process, &ReplicaProcess::learn, actions);
+}
+
+
 PID<ReplicaProcess> Replica::pid() const
 {
   return process->self();
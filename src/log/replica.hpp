@@ -40,6 +40,7 @@ namespace protocol {
 extern Protocol<PromiseRequest, PromiseResponse> promise;
 extern Protocol<WriteRequest, WriteResponse> write;
 extern Protocol<RecoverRequest, RecoverResponse> recover;
+extern Protocol<CatchUpRequest, CatchUpResponse> catchup;
 
 } // namespace protocol {
 
@@ -94,6 +95,12 @@ public:
   // mocking in tests.
   virtual process::Future<bool> update(const Metadata::Status& status);
 
+  // Persists actions which are already known to be learned (e.g.,
+  // fetched in bulk from other replicas during catch-up). Actions of
+  // positions which are truncated or already learned are skipped.
+  // Returns true if all the actions were persisted, false otherwise.
+  process::Future<bool> learn(const std::list<Action>& actions) const;
+
   // Returns the PID associated with this replica.
   process::PID<ReplicaProcess> pid() const;
 
@@ -0,0 +1,712 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <list>
+#include <set>
+
+#include <stout/check.hpp>
+#include <stout/error.hpp>
+#include <stout/foreach.hpp>
+#include <stout/numify.hpp>
+#include <stout/path.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/strings.hpp>
+
+#include <stout/os/close.hpp>
+#include <stout/os/exists.hpp>
+#include <stout/os/fsync.hpp>
+#include <stout/os/ftruncate.hpp>
+#include <stout/os/ls.hpp>
+#include <stout/os/mkdir.hpp>
+#include <stout/os/open.hpp>
+#include <stout/os/read.hpp>
+#include <stout/os/rename.hpp>
+#include <stout/os/rm.hpp>
+#include <stout/os/stat.hpp>
+#include <stout/os/strerror.hpp>
+#include <stout/os/write.hpp>
+
+#include "log/segment.hpp"
+
+using std::list;
+using std::set;
+using std::string;
+
+namespace mesos {
+namespace internal {
+namespace log {
+
+// The file whose presence identifies a directory as a segment log.
+// It holds the version of the on-disk format.
+static const char VERSION_FILE[] = "SEGMENTS";
+static const char FORMAT_VERSION[] = "1\n";
+
+static const char METADATA_FILE[] = "METADATA";
+static const char SEGMENT_SUFFIX[] = ".segment";
+
+// Every record in a segment is framed by its length and the CRC32 of
+// its bytes. Since segments are preallocated (i.e., zero filled), a
+// zero length marks the end of the records in a segment.
+static const size_t HEADER_SIZE = 2 * sizeof(uint32_t);
+
+
+static string filename(uint64_t id)
+{
+  // Zero padded so that segments list in the order they were created.
+  Try<string> name = strings::format("%020llu", id);
+  CHECK_SOME(name);
+  return name.get() + SEGMENT_SUFFIX;
+}
+
+
+static uint32_t checksum(const char* data, size_t length)
+{
+  return ::crc32(
+      ::crc32(0L, Z_NULL, 0),
+      reinterpret_cast<const Bytef*>(data),
+      length);
+}
+
+
+static Try<Nothing> pwrite(int fd, const string& data, size_t offset)
+{
+  size_t written = 0;
+
+  while (written < data.size()) {
+    ssize_t length = ::pwrite(
+        fd,
+        data.data() + written,
+        data.size() - written,
+        offset + written);
+
+    if (length < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return ErrnoError();
+    }
+
+    written += length;
+  }
+
+  return Nothing();
+}
+
+
+// Flushes the written data but, unlike 'fsync', not the file metadata
+// that is not needed to read the data back (e.g., the modification
+// time). Since segments are preallocated, appending a record does not
+// change any of the metadata that is needed.
+static Try<Nothing> datasync(int fd)
+{
+#ifdef __linux__
+  if (::fdatasync(fd) < 0) {
+    return ErrnoError();
+  }
+
+  return Nothing();
+#else
+  return os::fsync(fd);
+#endif // __linux__
+}
+
+
+// Zeroes the segment from 'offset' on (e.g., a partially written
+// record) by truncating it, and then preallocating it again so that
+// it does not end with a sparse hole.
+static Try<Nothing> clear(int fd, size_t offset, size_t size)
+{
+  Try<Nothing> truncate = os::ftruncate(fd, offset);
+  if (truncate.isError()) {
+    return Error("Failed to truncate segment: " + truncate.error());
+  }
+
+#ifdef __linux__
+  int error = ::posix_fallocate(fd, offset, size - offset);
+  if (error != 0) {
+    return Error("Failed to preallocate segment: " + os::strerror(error));
+  }
+#else
+  truncate = os::ftruncate(fd, size);
+  if (truncate.isError()) {
+    return Error("Failed to truncate segment: " + truncate.error());
+  }
+#endif // __linux__
+
+  return os::fsync(fd);
+}
+
+
+bool SegmentStorage::exists(const string& path)
+{
+  return os::exists(path::join(path, VERSION_FILE));
+}
+
+
+SegmentStorage::SegmentStorage(const Bytes& _segmentSize)
+  : segmentSize(_segmentSize)
+{
+  CHECK_GT(segmentSize, Bytes(HEADER_SIZE));
+}
+
+
+SegmentStorage::~SegmentStorage()
+{
+  foreachvalue (Segment& segment, segments) {
+    close(&segment);
+  }
+}
+
+
+Try<Storage::State> SegmentStorage::restore(const string& path)
+{
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  directory = path;
+
+  Try<Nothing> mkdir = os::mkdir(directory);
+  if (mkdir.isError()) {
+    return Error(
+        "Failed to create directory '" + directory + "': " + mkdir.error());
+  }
+
+  if (!exists(directory)) {
+    // Refuse to silently shadow a log written by 'LevelDBStorage'.
+    if (os::exists(path::join(directory, "CURRENT"))) {
+      return Error(
+          "'" + directory + "' holds a leveldb log, it has to be"
+          " converted with 'mesos-log migrate' first");
+    }
+
+    Try<Nothing> write =
+      os::write(path::join(directory, VERSION_FILE), FORMAT_VERSION, true);
+
+    if (write.isError()) {
+      return Error("Failed to write version: " + write.error());
+    }
+  }
+
+  State state;
+  state.begin = 0;
+  state.end = 0;
+
+  const string metadataPath = path::join(directory, METADATA_FILE);
+
+  if (os::exists(metadataPath)) {
+    Try<string> value = os::read(metadataPath);
+    if (value.isError()) {
+      return Error("Failed to read metadata: " + value.error());
+    }
+
+    Record record;
+
+    if (!record.ParseFromString(value.get()) ||
+        record.type() != Record::METADATA) {
+      return Error("Failed to deserialize metadata");
+    }
+
+    CHECK(record.has_metadata());
+    state.metadata.CopyFrom(record.metadata());
+  }
+
+  Try<list<string>> entries = os::ls(directory);
+  if (entries.isError()) {
+    return Error(
+        "Failed to list directory '" + directory + "': " + entries.error());
+  }
+
+  set<uint64_t> ids;
+
+  foreach (const string& entry, entries.get()) {
+    if (!strings::endsWith(entry, SEGMENT_SUFFIX)) {
+      continue;
+    }
+
+    Try<uint64_t> id = numify<uint64_t>(
+        strings::remove(entry, SEGMENT_SUFFIX, strings::SUFFIX));
+
+    if (id.isError()) {
+      return Error("Unexpected segment '" + entry + "': " + id.error());
+    }
+
+    ids.insert(id.get());
+  }
+
+  foreach (uint64_t id, ids) {
+    const string segmentPath = path::join(directory, filename(id));
+
+    // A segment may have been created but not yet preallocated when
+    // we crashed, in which case it holds no records.
+    Try<Bytes> size = os::stat::size(segmentPath);
+    if (size.isError()) {
+      return Error("Failed to stat segment: " + size.error());
+    } else if (size->bytes() == 0) {
+      os::rm(segmentPath);
+      continue;
+    }
+
+    Try<Segment> segment = open(segmentPath, 0);
+    if (segment.isError()) {
+      return Error(segment.error());
+    }
+
+    segments[id] = segment.get();
+
+    Try<bool> complete = scan(id, &segments[id], &state);
+    if (complete.isError()) {
+      return Error(
+          "Failed to scan segment '" + segmentPath + "': " + complete.error());
+    }
+
+    if (!complete.get()) {
+      // Only the last segment can end with a partially written record
+      // (i.e., we crashed while appending it). Anything else means
+      // the log is corrupted.
+      if (id != *ids.rbegin()) {
+        return Error("Segment '" + segmentPath + "' is corrupted");
+      }
+
+      const Segment& last = segments[id];
+
+      LOG(WARNING) << "Discarding partially written record at offset "
+                   << last.tail << " of segment '" << segmentPath << "'";
+
+      // Zero out the partially written record so that it does not
+      // show up behind the records appended from now on.
+      Try<Nothing> clear = log::clear(last.fd, last.tail, last.size);
+      if (clear.isError()) {
+        return Error(clear.error());
+      }
+    }
+  }
+
+  // A stale version of a truncated position might still be around
+  // in a segment that holds some positions which are not truncated.
+  if (state.begin > 0) {
+    state.learned -=
+      (Bound<uint64_t>::closed(0), Bound<uint64_t>::open(state.begin));
+    state.unlearned -=
+      (Bound<uint64_t>::closed(0), Bound<uint64_t>::open(state.begin));
+  }
+
+  // Finish any truncation that we crashed in the middle of.
+  truncate(state.begin);
+
+  VLOG(1) << "Restored " << index.size() << " positions from "
+          << segments.size() << " segments in " << stopwatch.elapsed();
+
+  return state;
+}
+
+
+Try<Nothing> SegmentStorage::persist(const Metadata& metadata)
+{
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  Record record;
+  record.set_type(Record::METADATA);
+  record.mutable_metadata()->CopyFrom(metadata);
+
+  string value;
+
+  if (!record.SerializeToString(&value)) {
+    return Error("Failed to serialize record");
+  }
+
+  // Atomically replace the metadata by writing it to a temporary
+  // file and renaming the temporary file over the existing one.
+  const string metadataPath = path::join(directory, METADATA_FILE);
+  const string temporaryPath = metadataPath + ".tmp";
+
+  Try<Nothing> write = os::write(temporaryPath, value, true);
+  if (write.isError()) {
+    return Error("Failed to write metadata: " + write.error());
+  }
+
+  Try<Nothing> rename = os::rename(temporaryPath, metadataPath);
+  if (rename.isError()) {
+    return Error("Failed to rename metadata: " + rename.error());
+  }
+
+  Try<Nothing> fsync = os::fsync(directory);
+  if (fsync.isError()) {
+    return Error("Failed to sync directory: " + fsync.error());
+  }
+
+  VLOG(1) << "Persisting metadata (" << value.size()
+          << " bytes) to segments took " << stopwatch.elapsed();
+
+  return Nothing();
+}
+
+
+Try<Nothing> SegmentStorage::persist(const Action& action)
+{
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  Record record;
+  record.set_type(Record::ACTION);
+  record.mutable_action()->MergeFrom(action);
+
+  string value;
+
+  if (!record.SerializeToString(&value)) {
+    return Error("Failed to serialize record");
+  }
+
+  uint32_t header[2] = {
+    static_cast<uint32_t>(value.size()),
+    checksum(value.data(), value.size())
+  };
+
+  string frame(reinterpret_cast<const char*>(header), HEADER_SIZE);
+  frame.append(value);
+
+  // A record shorter than the one whose append failed would leave the
+  // rest of it behind, which is taken for a corruption once the segment
+  // is no longer the last one.
+  if (!segments.empty() && segments.rbegin()->second.dirty) {
+    Segment& last = segments.rbegin()->second;
+
+    Try<Nothing> clear = log::clear(last.fd, last.tail, last.size);
+    if (clear.isError()) {
+      return Error("Failed to clear the tail of the segment: " + clear.error());
+    }
+
+    last.dirty = false;
+  }
+
+  if (segments.empty() ||
+      segments.rbegin()->second.tail + frame.size() >
+        segments.rbegin()->second.size) {
+    Try<Nothing> roll = this->roll(frame.size());
+    if (roll.isError()) {
+      return Error("Failed to start a new segment: " + roll.error());
+    }
+  }
+
+  const uint64_t id = segments.rbegin()->first;
+  Segment& segment = segments.rbegin()->second;
+
+  Try<Nothing> write = pwrite(segment.fd, frame, segment.tail);
+  if (write.isSome()) {
+    write = datasync(segment.fd);
+  }
+
+  if (write.isError()) {
+    // The next record is appended at the same offset once whatever was
+    // partially written has been cleared.
+    segment.dirty = true;
+
+    Try<Nothing> clear = log::clear(segment.fd, segment.tail, segment.size);
+    if (clear.isSome()) {
+      segment.dirty = false;
+    }
+
+    return Error("Failed to append record: " + write.error());
+  }
+
+  index[action.position()] =
+    Location{id, segment.tail + HEADER_SIZE, header[0]};
+
+  segment.tail += frame.size();
+  segment.last = max(segment.last, action.position());
+
+  VLOG(1) << "Persisting action (" << value.size()
+          << " bytes) to segments took " << stopwatch.elapsed();
+
+  // Delete positions if a truncate action has been *learned*.
+  if (action.has_type() && action.type() == Action::TRUNCATE &&
+      action.has_learned() && action.learned()) {
+    CHECK(action.has_truncate());
+    truncate(action.truncate().to());
+  }
+
+  // Delete positions if a tombstone NOP action has been *learned*.
+  // Like in 'LevelDBStorage' we keep the tombstone itself so that the
+  // recovery code can learn about the truncation.
+  if (action.has_type() && action.type() == Action::NOP &&
+      action.nop().has_tombstone() && action.nop().tombstone() &&
+      action.has_learned() && action.learned()) {
+    truncate(action.position());
+  }
+
+  return Nothing();
+}
+
+
+Try<Action> SegmentStorage::read(uint64_t position)
+{
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  auto location = index.find(position);
+  if (location == index.end()) {
+    return Error("Position " + stringify(position) + " not found");
+  }
+
+  auto segment = segments.find(location->second.segment);
+  CHECK(segment != segments.end());
+
+  // Read the record straight out of the mapped segment.
+  google::protobuf::io::ArrayInputStream stream(
+      segment->second.data + location->second.offset,
+      location->second.length);
+
+  Record record;
+
+  if (!record.ParseFromZeroCopyStream(&stream)) {
+    return Error("Failed to deserialize record");
+  }
+
+  if (record.type() != Record::ACTION) {
+    return Error("Bad record");
+  }
+
+  VLOG(1) << "Reading position from segments took " << stopwatch.elapsed();
+
+  return record.action();
+}
+
+
+Try<SegmentStorage::Segment> SegmentStorage::open(
+    const string& path,
+    size_t size)
+{
+  Try<int> fd = os::open(path, O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+  if (fd.isError()) {
+    return Error("Failed to open '" + path + "': " + fd.error());
+  }
+
+  struct stat s;
+  if (::fstat(fd.get(), &s) < 0) {
+    ErrnoError error("Failed to stat '" + path + "'");
+    os::close(fd.get());
+    return error;
+  }
+
+  if (static_cast<size_t>(s.st_size) < size) {
+#ifdef __linux__
+    // Actually allocate the blocks so that appending never needs to
+    // update the file system metadata (see 'datasync').
+    int error = ::posix_fallocate(fd.get(), 0, size);
+    if (error != 0) {
+      os::close(fd.get());
+      return Error(
+          "Failed to preallocate '" + path + "': " + os::strerror(error));
+    }
+#else
+    Try<Nothing> truncate = os::ftruncate(fd.get(), size);
+    if (truncate.isError()) {
+      os::close(fd.get());
+      return Error(
+          "Failed to preallocate '" + path + "': " + truncate.error());
+    }
+#endif // __linux__
+  } else {
+    size = s.st_size;
+  }
+
+  void* data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd.get(), 0);
+  if (data == MAP_FAILED) {
+    ErrnoError error("Failed to map '" + path + "'");
+    os::close(fd.get());
+    return error;
+  }
+
+  Segment segment;
+  segment.path = path;
+  segment.fd = fd.get();
+  segment.data = static_cast<char*>(data);
+  segment.size = size;
+  segment.tail = 0;
+  segment.dirty = false;
+
+  return segment;
+}
+
+
+Try<bool> SegmentStorage::scan(uint64_t id, Segment* segment, State* state)
+{
+  while (segment->tail + HEADER_SIZE <= segment->size) {
+    uint32_t header[2];
+    memcpy(header, segment->data + segment->tail, HEADER_SIZE);
+
+    const uint32_t length = header[0];
+
+    if (length == 0) {
+      // This is the end of the records, unless a header was only
+      // partially written.
+      return header[1] == 0;
+    }
+
+    const size_t offset = segment->tail + HEADER_SIZE;
+
+    if (offset + length > segment->size ||
+        checksum(segment->data + offset, length) != header[1]) {
+      return false;
+    }
+
+    google::protobuf::io::ArrayInputStream stream(
+        segment->data + offset,
+        length);
+
+    Record record;
+
+    if (!record.ParseFromZeroCopyStream(&stream)) {
+      return Error("Failed to deserialize record");
+    }
+
+    if (record.type() != Record::ACTION) {
+      return Error("Bad record");
+    }
+
+    CHECK(record.has_action());
+    const Action& action = record.action();
+
+    if (action.has_learned() && action.learned()) {
+      state->learned.insert(action.position());
+      state->unlearned.erase(action.position());
+      if (action.has_type() && action.type() == Action::TRUNCATE) {
+        state->begin = std::max(state->begin, action.truncate().to());
+      } else if (action.has_type() && action.type() == Action::NOP &&
+                 action.nop().has_tombstone() && action.nop().tombstone()) {
+        // If we see a tombstone, this position was truncated.
+        // There must exist at least 1 position (TRUNCATE) in the
+        // log after it.
+        state->begin = std::max(state->begin, action.position() + 1);
+      }
+    } else {
+      state->learned.erase(action.position());
+      state->unlearned.insert(action.position());
+    }
+
+    state->end = std::max(state->end, action.position());
+
+    // Later records of a position always supersede earlier ones.
+    index[action.position()] = Location{id, offset, length};
+
+    segment->tail = offset + length;
+    segment->last = max(segment->last, action.position());
+  }
+
+  return true;
+}
+
+
+Try<Nothing> SegmentStorage::roll(size_t bytes)
+{
+  const uint64_t id = segments.empty() ? 0 : segments.rbegin()->first + 1;
+
+  const string segmentPath = path::join(directory, filename(id));
+
+  Try<Segment> segment =
+    open(segmentPath, std::max<size_t>(segmentSize.bytes(), bytes));
+
+  if (segment.isError()) {
+    return Error(segment.error());
+  }
+
+  // Make sure the new segment survives a crash.
+  Try<Nothing> fsync = os::fsync(directory);
+  if (fsync.isError()) {
+    Segment _segment = segment.get();
+    close(&_segment);
+    return Error("Failed to sync directory: " + fsync.error());
+  }
+
+  segments[id] = segment.get();
+
+  VLOG(1) << "Started segment '" << segmentPath << "'";
+
+  return Nothing();
+}
+
+
+void SegmentStorage::truncate(uint64_t to)
+{
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  index.erase(index.begin(), index.lower_bound(to));
+
+  // Delete the segments which only hold truncated positions. Note
+  // that we do this in a best-effort fashion since a segment that is
+  // left behind is deleted on the next truncation (or restore).
+  size_t deleted = 0;
+
+  auto segment = segments.begin();
+  while (segment != segments.end() &&
+         segment->first != segments.rbegin()->first) {
+    if (segment->second.last.isSome() && segment->second.last.get() >= to) {
+      ++segment;
+      continue;
+    }
+
+    Try<Nothing> rm = os::rm(segment->second.path);
+    if (rm.isError()) {
+      LOG(WARNING) << "Ignoring failure to delete segment '"
+                   << segment->second.path << "': " << rm.error();
+      ++segment;
+      continue;
+    }
+
+    close(&segment->second);
+    segment = segments.erase(segment);
+    deleted++;
+  }
+
+  if (deleted > 0) {
+    VLOG(1) << "Deleting " << deleted << " segments took "
+            << stopwatch.elapsed();
+  }
+}
+
+
+void SegmentStorage::close(Segment* segment)
+{
+  if (segment->data != nullptr) {
+    ::munmap(segment->data, segment->size);
+    segment->data = nullptr;
+  }
+
+  if (segment->fd >= 0) {
+    os::close(segment->fd);
+    segment->fd = -1;
+  }
+}
+
+} // namespace log {
+} // namespace internal {
+} // namespace mesos {
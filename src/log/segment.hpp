@@ -0,0 +1,126 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __LOG_SEGMENT_HPP__
+#define __LOG_SEGMENT_HPP__
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+
+#include <stout/bytes.hpp>
+#include <stout/option.hpp>
+
+#include "log/storage.hpp"
+
+namespace mesos {
+namespace internal {
+namespace log {
+
+// Concrete implementation of the storage interface using a sequence
+// of preallocated, append-only segment files.
+//
+// Every record (i.e., every version of every action) is appended to
+// the active segment and the position is indexed to the offset of its
+// latest version, so that reads never have to search. Segments are
+// memory mapped for reads. Because segments are preallocated, the
+// 'fdatasync' done for each persisted action does not need to flush
+// any file system metadata. A learned truncation drops the truncated
+// positions from the index and deletes every segment that only holds
+// truncated positions; nothing is ever rewritten or compacted.
+//
+// The metadata (i.e., the replica status and promise) is stored in a
+// separate file which is atomically replaced on every update.
+class SegmentStorage : public Storage
+{
+public:
+  // Returns true if the specified path holds a log written by this
+  // storage.
+  static bool exists(const std::string& path);
+
+  explicit SegmentStorage(const Bytes& segmentSize = Megabytes(64));
+  ~SegmentStorage() override;
+
+  Try<State> restore(const std::string& path) override;
+  Try<Nothing> persist(const Metadata& metadata) override;
+  Try<Nothing> persist(const Action& action) override;
+  Try<Action> read(uint64_t position) override;
+
+private:
+  struct Segment
+  {
+    std::string path;
+    int fd;
+
+    // Read only mapping of the entire (preallocated) segment.
+    char* data;
+    size_t size;
+
+    // Offset at which the next record will be appended.
+    size_t tail;
+
+    // Highest position with a record in this segment, if any.
+    Option<uint64_t> last;
+
+    // Whether a failed append might have left a partially written
+    // record at the tail, which has to be cleared before appending.
+    bool dirty;
+  };
+
+  // Location of the latest record of a position.
+  struct Location
+  {
+    uint64_t segment;
+    size_t offset;
+    uint32_t length;
+  };
+
+  // Opens and maps the segment at the specified path, creating it
+  // and preallocating it to at least 'size' bytes if necessary.
+  Try<Segment> open(const std::string& path, size_t size);
+
+  // Scans the records of a segment, starting at its beginning, and
+  // applies them to the specified state and to the index. Returns
+  // false if the segment ends with a partially written record.
+  Try<bool> scan(uint64_t id, Segment* segment, State* state);
+
+  // Starts a new active segment able to hold at least the specified
+  // number of bytes.
+  Try<Nothing> roll(size_t bytes);
+
+  // Drops all positions before 'to' from the index and deletes the
+  // (non-active) segments which no longer hold any live position.
+  void truncate(uint64_t to);
+
+  void close(Segment* segment);
+
+  const Bytes segmentSize;
+
+  std::string directory;
+
+  // All the segments keyed by their (monotonically increasing) id.
+  // The active segment is always the one with the highest id.
+  std::map<uint64_t, Segment> segments;
+
+  std::map<uint64_t, Location> index;
+};
+
+} // namespace log {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __LOG_SEGMENT_HPP__
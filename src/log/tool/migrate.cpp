@@ -0,0 +1,162 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+
+#include <process/process.hpp>
+
+#include <stout/error.hpp>
+#include <stout/foreach.hpp>
+#include <stout/interval.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
+
+#include "log/leveldb.hpp"
+#include "log/segment.hpp"
+#include "log/tool/migrate.hpp"
+
+#include "logging/logging.hpp"
+
+namespace mesos {
+namespace internal {
+namespace log {
+namespace tool {
+
+Migrate::Flags::Flags()
+{
+  add(&Flags::path,
+      "path",
+      "Path to the leveldb log");
+
+  add(&Flags::destination,
+      "destination",
+      "Path to the (empty or not yet existing) segment log\n"
+      "to copy the log to");
+}
+
+
+Try<Nothing> Migrate::execute(int argc, char** argv)
+{
+  flags.setUsageMessage(
+      "Usage: " + name() + " [options]\n"
+      "\n"
+      "This command is used to convert a leveldb log into a segment log.\n"
+      "Once the command succeeds the replica can be pointed at the\n"
+      "destination, which always uses the segment storage.\n"
+      "\n");
+
+  // Configure the tool by parsing command line arguments.
+  if (argc > 0 && argv != nullptr) {
+    Try<flags::Warnings> load = flags.load(None(), argc, argv);
+    if (load.isError()) {
+      return Error(flags.usage(load.error()));
+    }
+
+    if (flags.help) {
+      return Error(flags.usage());
+    }
+
+    process::initialize();
+    logging::initialize(argv[0], false, flags);
+
+    // Log any flag warnings (after logging is initialized).
+    foreach (const flags::Warning& warning, load->warnings) {
+      LOG(WARNING) << warning.message;
+    }
+  }
+
+  if (flags.path.isNone()) {
+    return Error(flags.usage("Missing required option --path"));
+  }
+
+  if (flags.destination.isNone()) {
+    return Error(flags.usage("Missing required option --destination"));
+  }
+
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  LevelDBStorage source;
+
+  Try<Storage::State> state = source.restore(flags.path.get());
+  if (state.isError()) {
+    return Error("Failed to restore the leveldb log: " + state.error());
+  }
+
+  SegmentStorage destination;
+
+  Try<Storage::State> existing = destination.restore(flags.destination.get());
+  if (existing.isError()) {
+    return Error("Failed to restore the segment log: " + existing.error());
+  }
+
+  if (existing->metadata.status() != Metadata::EMPTY ||
+      !existing->learned.empty() ||
+      !existing->unlearned.empty()) {
+    return Error("The destination log is not empty");
+  }
+
+  // Copy the actions first so that an interrupted migration leaves
+  // an EMPTY log behind, which will not be allowed to vote.
+  IntervalSet<uint64_t> positions = state->learned;
+  positions += state->unlearned;
+
+  uint64_t copied = 0;
+
+  foreach (const Interval<uint64_t>& interval, positions) {
+    for (uint64_t position = interval.lower();
+         position < interval.upper();
+         position++) {
+      Try<Action> action = source.read(position);
+
+      if (action.isError()) {
+        // Positions before the beginning of the log might already
+        // have been deleted by a truncation.
+        if (position < state->begin) {
+          continue;
+        }
+
+        return Error(
+            "Failed to read position " + stringify(position) +
+            ": " + action.error());
+      }
+
+      Try<Nothing> persist = destination.persist(action.get());
+      if (persist.isError()) {
+        return Error(
+            "Failed to write position " + stringify(position) +
+            ": " + persist.error());
+      }
+
+      copied++;
+    }
+  }
+
+  Try<Nothing> persist = destination.persist(state->metadata);
+  if (persist.isError()) {
+    return Error("Failed to write the metadata: " + persist.error());
+  }
+
+  LOG(INFO) << "Migrated " << copied << " positions (" << state->begin
+            << " -> " << state->end << ") in " << stopwatch.elapsed();
+
+  return Nothing();
+}
+
+} // namespace tool {
+} // namespace log {
+} // namespace internal {
+} // namespace mesos {
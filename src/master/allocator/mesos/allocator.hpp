@@ -17,13 +17,20 @@
 #ifndef __MASTER_ALLOCATOR_MESOS_ALLOCATOR_HPP__
 #define __MASTER_ALLOCATOR_MESOS_ALLOCATOR_HPP__
 
+#include <stdint.h>
+
+#include <mutex>
+#include <vector>
+
 #include <mesos/allocator/allocator.hpp>
 
 #include <process/dispatch.hpp>
 #include <process/future.hpp>
 #include <process/process.hpp>
 
+#include <stout/foreach.hpp>
 #include <stout/hashmap.hpp>
+#include <stout/synchronized.hpp>
 #include <stout/try.hpp>
 
 namespace mesos {
@@ -90,6 +97,9 @@ public:
       const Resources& total,
       const hashmap<FrameworkID, Resources>& used) override;
 
+  void addSlaves(
+      const std::vector<mesos::allocator::SlaveAddition>& slaves) override;
+
   void removeSlave(
       const SlaveID& slaveId) override;
 
@@ -178,7 +188,28 @@ private:
   MesosAllocator(const MesosAllocator&); // Not copyable.
   MesosAllocator& operator=(const MesosAllocator&); // Not assignable.
 
+  // Dispatches the agents added since the last dispatch as a single
+  // `addSlaves()`. This must precede every other dispatch so that the
+  // allocator process observes all calls in the order they were made.
+  void flush();
+
+  // Invoked within the allocator process to add the agents that have
+  // been pending since 'generation', unless they were flushed already.
+  void _flush(uint64_t generation);
+
   MesosAllocatorProcess* process;
+
+  // Agents added via `addSlave()` that have not been dispatched to the
+  // allocator process yet. Consecutive `addSlave()` calls (e.g., from
+  // agents reregistering after a master failover) are coalesced into a
+  // single `addSlaves()`; a batch keeps growing for as long as the
+  // allocator process is busy with earlier events.
+  std::mutex mutex;
+  std::vector<mesos::allocator::SlaveAddition> pending;
+
+  // Incremented whenever the pending agents are dispatched, so that a
+  // stale `_flush()` becomes a no-op.
+  uint64_t generation;
 };
 
 
@@ -238,6 +269,20 @@ public:
       const Resources& total,
       const hashmap<FrameworkID, Resources>& used) = 0;
 
+  virtual void addSlaves(
+      const std::vector<mesos::allocator::SlaveAddition>& slaves)
+  {
+    foreach (const mesos::allocator::SlaveAddition& slave, slaves) {
+      addSlave(
+          slave.slaveId,
+          slave.slaveInfo,
+          slave.capabilities,
+          slave.unavailability,
+          slave.total,
+          slave.used);
+    }
+  }
+
   virtual void removeSlave(
       const SlaveID& slaveId) = 0;
 
@@ -335,6 +380,7 @@ MesosAllocator<AllocatorProcess>::create()
 
 template <typename AllocatorProcess>
 MesosAllocator<AllocatorProcess>::MesosAllocator()
+  : generation(0)
 {
   process = new AllocatorProcess();
   process::spawn(process);
@@ -362,6 +408,8 @@ inline void MesosAllocator<AllocatorProcess>::initialize(
               const hashmap<SlaveID, UnavailableResources>&)>&
       inverseOfferCallback)
 {
+  flush();
+
   process::dispatch(
       process,
       &MesosAllocatorProcess::initialize,
@@ -376,6 +424,8 @@ inline void MesosAllocator<AllocatorProcess>::recover(
     const int expectedAgentCount,
     const hashmap<std::string, Quota>& quotas)
 {
+  flush();
+
   process::dispatch(
       process,
       &MesosAllocatorProcess::recover,
@@ -392,6 +442,8 @@ inline void MesosAllocator<AllocatorProcess>::addFramework(
     bool active,
     ::mesos::allocator::FrameworkOptions&& options)
 {
+  flush();
+
   process::dispatch(
       process,
       &MesosAllocatorProcess::addFramework,
@@ -407,6 +459,8 @@ template <typename AllocatorProcess>
 inline void MesosAllocator<AllocatorProcess>::removeFramework(
     const FrameworkID& frameworkId)
 {
+  flush();
+
   process::dispatch(
       process,
       &MesosAllocatorProcess::removeFramework,
@@ -418,6 +472,8 @@ template <typename AllocatorProcess>
 inline void MesosAllocator<AllocatorProcess>::activateFramework(
     const FrameworkID& frameworkId)
 {
+  flush();
+
   process::dispatch(
       process,
       &MesosAllocatorProcess::activateFramework,
@@ -429,6 +485,8 @@ template <typename AllocatorProcess>
 inline void MesosAllocator<AllocatorProcess>::deactivateFramework(
     const FrameworkID& frameworkId)
 {
+  flush();
+
   process::dispatch(
       process,
       &MesosAllocatorProcess::deactivateFramework,
@@ -442,6 +500,8 @@ inline void MesosAllocator<AllocatorProcess>::updateFramework(
     const FrameworkInfo& frameworkInfo,
     ::mesos::allocator::FrameworkOptions&& options)
 {
+  flush();
+
   process::dispatch(
       process,
       &MesosAllocatorProcess::updateFramework,
@@ -460,15 +520,33 @@ inline void MesosAllocator<AllocatorProcess>::addSlave(
     const Resources& total,
     const hashmap<FrameworkID, Resources>& used)
 {
+  synchronized (mutex) {
+    pending.push_back(mesos::allocator::SlaveAddition{
+        slaveId, slaveInfo, capabilities, unavailability, total, used});
+
+    // Make sure the batch is added eventually even if no other call
+    // flushes it in the meantime.
+    if (pending.size() == 1) {
+      const uint64_t expected = generation;
+
+      process::dispatch(process->self(), [this, expected]() {
+        _flush(expected);
+      });
+    }
+  }
+}
+
+
+template <typename AllocatorProcess>
+inline void MesosAllocator<AllocatorProcess>::addSlaves(
+    const std::vector<mesos::allocator::SlaveAddition>& slaves)
+{
+  flush();
+
   process::dispatch(
       process,
-      &MesosAllocatorProcess::addSlave,
-      slaveId,
-      slaveInfo,
-      capabilities,
-      unavailability,
-      total,
-      used);
+      &MesosAllocatorProcess::addSlaves,
+      slaves);
 }
 
 
@@ -476,6 +554,8 @@ template <typename AllocatorProcess>
 inline void MesosAllocator<AllocatorProcess>::removeSlave(
     const SlaveID& slaveId)
 {
+  flush();
+
   process::dispatch(
       process,
       &MesosAllocatorProcess::removeSlave,
@@ -490,6 +570,8 @@ inline void MesosAllocator<AllocatorProcess>::updateSlave(
     const Option<Resources>& total,
     const Option<std::vector<SlaveInfo::Capability>>& capabilities)
 {
+  flush();
+
   process::dispatch(
       process,
       &MesosAllocatorProcess::updateSlave,
@@ -505,6 +587,8 @@ void MesosAllocator<AllocatorProcess>::addResourceProvider(
     const Resources& total,
     const hashmap<FrameworkID, Resources>& used)
 {
+  flush();
+
   process::dispatch(
       process,
       &MesosAllocatorProcess::addResourceProvider,
@@ -518,6 +602,8 @@ template <typename AllocatorProcess>
 inline void MesosAllocator<AllocatorProcess>::activateSlave(
     const SlaveID& slaveId)
 {
+  flush();
+
   process::dispatch(
       process,
       &MesosAllocatorProcess::activateSlave,
@@ -529,6 +615,8 @@ template <typename AllocatorProcess>
 inline void MesosAllocator<AllocatorProcess>::deactivateSlave(
     const SlaveID& slaveId)
 {
+  flush();
+
   process::dispatch(
       process,
       &MesosAllocatorProcess::deactivateSlave,
@@ -540,6 +628,8 @@ template <typename AllocatorProcess>
 inline void MesosAllocator<AllocatorProcess>::updateWhitelist(
     const Option<hashset<std::string>>& whitelist)
 {
+  flush();
+
   process::dispatch(
       process,
       &MesosAllocatorProcess::updateWhitelist,
@@ -552,6 +642,8 @@ inline void MesosAllocator<AllocatorProcess>::requestResources(
     const FrameworkID& frameworkId,
     const std::vector<Request>& requests)
 {
+  flush();
+
   process::dispatch(
       process,
       &MesosAllocatorProcess::requestResources,
@@ -567,6 +659,8 @@ inline void MesosAllocator<AllocatorProcess>::updateAllocation(
     const Resources& offeredResources,
     const std::vector<ResourceConversion>& conversions)
 {
+  flush();
+
   process::dispatch(
       process,
       &MesosAllocatorProcess::updateAllocation,
@@ -583,6 +677,8 @@ MesosAllocator<AllocatorProcess>::updateAvailable(
     const SlaveID& slaveId,
     const std::vector<Offer::Operation>& operations)
 {
+  flush();
+
   return process::dispatch(
       process,
       &MesosAllocatorProcess::updateAvailable,
@@ -596,6 +692,8 @@ inline void MesosAllocator<AllocatorProcess>::updateUnavailability(
     const SlaveID& slaveId,
     const Option<Unavailability>& unavailability)
 {
+  flush();
+
   return process::dispatch(
       process,
       &MesosAllocatorProcess::updateUnavailability,
@@ -612,6 +710,8 @@ inline void MesosAllocator<AllocatorProcess>::updateInverseOffer(
     const Option<mesos::allocator::InverseOfferStatus>& status,
     const Option<Filters>& filters)
 {
+  flush();
+
   return process::dispatch(
       process,
       &MesosAllocatorProcess::updateInverseOffer,
@@ -629,6 +729,8 @@ inline process::Future<
             hashmap<FrameworkID, mesos::allocator::InverseOfferStatus>>>
   MesosAllocator<AllocatorProcess>::getInverseOfferStatuses()
 {
+  flush();
+
   return process::dispatch(
       process,
       &MesosAllocatorProcess::getInverseOfferStatuses);
@@ -639,6 +741,8 @@ inline void MesosAllocator<AllocatorProcess>::transitionOfferedToAllocated(
     const SlaveID& slaveId,
     const Resources& resources)
 {
+  flush();
+
   process::dispatch(
       process,
       &MesosAllocatorProcess::transitionOfferedToAllocated,
@@ -655,6 +759,8 @@ inline void MesosAllocator<AllocatorProcess>::recoverResources(
     const Option<Filters>& filters,
     bool isAllocated)
 {
+  flush();
+
   process::dispatch(
       process,
       &MesosAllocatorProcess::recoverResources,
@@ -671,6 +777,8 @@ inline void MesosAllocator<AllocatorProcess>::suppressOffers(
     const FrameworkID& frameworkId,
     const std::set<std::string>& roles)
 {
+  flush();
+
   process::dispatch(
       process,
       &MesosAllocatorProcess::suppressOffers,
@@ -684,6 +792,8 @@ inline void MesosAllocator<AllocatorProcess>::reviveOffers(
     const FrameworkID& frameworkId,
     const std::set<std::string>& roles)
 {
+  flush();
+
   process::dispatch(
       process,
       &MesosAllocatorProcess::reviveOffers,
@@ -697,6 +807,8 @@ inline void MesosAllocator<AllocatorProcess>::updateQuota(
     const std::string& role,
     const Quota& quota)
 {
+  flush();
+
   process::dispatch(
       process,
       &MesosAllocatorProcess::updateQuota,
@@ -709,6 +821,8 @@ template <typename AllocatorProcess>
 inline void MesosAllocator<AllocatorProcess>::updateWeights(
     const std::vector<WeightInfo>& weightInfos)
 {
+  flush();
+
   process::dispatch(
       process,
       &MesosAllocatorProcess::updateWeights,
@@ -719,6 +833,8 @@ inline void MesosAllocator<AllocatorProcess>::updateWeights(
 template <typename AllocatorProcess>
 inline void MesosAllocator<AllocatorProcess>::pause()
 {
+  flush();
+
   process::dispatch(process, &MesosAllocatorProcess::pause);
 }
 
@@ -726,10 +842,53 @@ inline void MesosAllocator<AllocatorProcess>::pause()
 template <typename AllocatorProcess>
 inline void MesosAllocator<AllocatorProcess>::resume()
 {
+  flush();
+
   process::dispatch(process, &MesosAllocatorProcess::resume);
 }
 
 
+template <typename AllocatorProcess>
+inline void MesosAllocator<AllocatorProcess>::flush()
+{
+  synchronized (mutex) {
+    if (pending.empty()) {
+      return;
+    }
+
+    std::vector<mesos::allocator::SlaveAddition> slaves;
+    std::swap(slaves, pending);
+    ++generation;
+
+    // NOTE: We dispatch while holding the lock so that concurrent
+    // callers cannot reorder their dispatches before this batch.
+    process::dispatch(
+        process,
+        &MesosAllocatorProcess::addSlaves,
+        std::move(slaves));
+  }
+}
+
+
+template <typename AllocatorProcess>
+inline void MesosAllocator<AllocatorProcess>::_flush(uint64_t expected)
+{
+  std::vector<mesos::allocator::SlaveAddition> slaves;
+
+  synchronized (mutex) {
+    if (generation != expected) {
+      return; // Already dispatched by `flush()`.
+    }
+
+    std::swap(slaves, pending);
+    ++generation;
+  }
+
+  // We are running within the allocator process: anything dispatched
+  // after the batch was taken is processed after it.
+  process->addSlaves(slaves);
+}
+
 } // namespace allocator {
 } // namespace master {
 } // namespace internal {
@@ -58,6 +58,7 @@ using std::weak_ptr;
 using mesos::allocator::FrameworkOptions;
 using mesos::allocator::InverseOfferStatus;
 using mesos::allocator::Options;
+using mesos::allocator::SlaveAddition;
 
 using process::after;
 using process::http::authentication::Principal;
@@ -980,6 +981,47 @@ void HierarchicalAllocatorProcess::addSlave(
     const hashmap<FrameworkID, Resources>& used)
 {
   CHECK(initialized);
+
+  _addSlave(slaveId, slaveInfo, capabilities, unavailability, total, used);
+
+  generateOffers(slaveId);
+}
+
+
+void HierarchicalAllocatorProcess::addSlaves(
+    const vector<SlaveAddition>& slaves)
+{
+  CHECK(initialized);
+
+  hashset<SlaveID> slaveIds;
+
+  foreach (const SlaveAddition& slave, slaves) {
+    _addSlave(
+        slave.slaveId,
+        slave.slaveInfo,
+        slave.capabilities,
+        slave.unavailability,
+        slave.total,
+        slave.used);
+
+    slaveIds.insert(slave.slaveId);
+  }
+
+  VLOG(1) << "Added a batch of " << slaves.size() << " agents";
+
+  // A single allocation run covers the whole batch.
+  generateOffers(slaveIds);
+}
+
+
+void HierarchicalAllocatorProcess::_addSlave(
+    const SlaveID& slaveId,
+    const SlaveInfo& slaveInfo,
+    const vector<SlaveInfo::Capability>& capabilities,
+    const Option<Unavailability>& unavailability,
+    const Resources& total,
+    const hashmap<FrameworkID, Resources>& used)
+{
   CHECK_NOT_CONTAINS(slaves, slaveId);
   CHECK_EQ(slaveId, slaveInfo.id());
   CHECK(!paused || expectedAgentCount.isSome());
@@ -1060,8 +1102,6 @@ void HierarchicalAllocatorProcess::addSlave(
     << "Added agent " << slaveId << " (" << slave.info.hostname() << ")"
     << " with " << slave.getTotal()
     << " (offered or allocated: " << slave.getTotalOfferedOrAllocated() << ")";
-
-  generateOffers(slaveId);
 }
 
 
@@ -608,6 +608,9 @@ public:
       const Resources& total,
       const hashmap<FrameworkID, Resources>& used) override;
 
+  void addSlaves(
+      const std::vector<mesos::allocator::SlaveAddition>& slaves) override;
+
   void removeSlave(
       const SlaveID& slaveId) override;
 
@@ -929,6 +932,16 @@ private:
       const Resources& resources,
       const protobuf::framework::Capabilities& frameworkCapabilities) const;
 
+  // Helper for `addSlave()` and `addSlaves()` which adds an agent to
+  // the allocator's bookkeeping without generating offers for it.
+  void _addSlave(
+      const SlaveID& slaveId,
+      const SlaveInfo& slaveInfo,
+      const std::vector<SlaveInfo::Capability>& capabilities,
+      const Option<Unavailability>& unavailability,
+      const Resources& total,
+      const hashmap<FrameworkID, Resources>& used);
+
   // Helper to track offered or allocated resources on an agent.
   //
   // TODO(asekretenko): rename `(un)trackAllocatedResources()` to reflect the
@@ -114,6 +114,21 @@ constexpr size_t DEFAULT_MAX_UNREACHABLE_TASKS_PER_FRAMEWORK = 1000;
 // Adopted operations will be acknowledged by the master.
 constexpr Duration MIN_WAIT_BEFORE_ORPHAN_OPERATION_ADOPTION = Minutes(10);
 
+// Maximum number of tasks the master reconciles for a framework before
+// yielding to other events; the remaining tasks of large
+// reconciliations are reconciled in subsequent batches.
+constexpr size_t MAX_RECONCILIATION_BATCH_SIZE = 1000;
+
+// Minimum interval between two reconciliation batches of the same
+// framework, which bounds the rate of reconciliation updates sent to
+// each framework.
+constexpr Duration RECONCILIATION_BATCH_INTERVAL = Milliseconds(10);
+
+// Maximum number of pending reconciliations of a framework; further
+// reconciliations are dropped, which the scheduler is expected to
+// retry as it does not hear back from them.
+constexpr size_t MAX_PENDING_RECONCILIATIONS = 100;
+
 // Time interval to check for updated watchers list.
 constexpr Duration WHITELIST_WATCH_INTERVAL = Seconds(5);
 
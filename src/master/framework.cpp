@@ -31,6 +31,28 @@ namespace mesos {
 namespace internal {
 namespace master {
 
+CompletedTask::CompletedTask(const Task& task)
+  : taskId_(task.task_id()),
+    slaveId_(task.slave_id()),
+    state_(task.state())
+{
+  CHECK(task.SerializePartialToString(&data))
+    << "Failed to serialize completed task " << task.task_id();
+
+  data.shrink_to_fit();
+}
+
+
+Task CompletedTask::get() const
+{
+  Task task;
+  CHECK(task.ParsePartialFromString(data))
+    << "Failed to parse completed task " << taskId_;
+
+  return task;
+}
+
+
 Framework::Framework(
     Master* const master,
     const Flags& masterFlags,
@@ -243,7 +265,7 @@ void Framework::addCompletedTask(Task&& task)
   // means that there might be multiple completed tasks with the
   // same task ID. We should consider rejecting attempts to reuse
   // task IDs (MESOS-6779).
-  completedTasks.push_back(process::Owned<Task>(new Task(std::move(task))));
+  completedTasks.push_back(CompletedTask(task));
 }
 
 
@@ -1736,6 +1736,7 @@ Future<Nothing> Master::_recover(const Registry& registry)
   scheduleRegistryGc();
 
   // Set up a timeout for slaves to reregister.
+  slaves.recoveredTime = Clock::now();
   slaves.recoveredTimer =
     delay(flags.agent_reregister_timeout,
           self(),
@@ -2023,6 +2024,10 @@ void Master::recoveredSlavesTimeout(const Registry& registry)
       << " investigate or increase this limit to proceed further";
   }
 
+  // Not all recovered agents reregistered in time, so there is no
+  // reregistration duration to report.
+  slaves.recoveredTime = None();
+
   // Remove the slaves in a rate limited manner, similar to how the
   // SlaveObserver removes slaves.
   foreach (const Registry::Slave& slave, registry.slaves().slaves()) {
@@ -7049,8 +7054,8 @@ void Master::__reregisterSlave(
             std::remove_if(
                 framework->completedTasks.begin(),
                 framework->completedTasks.end(),
-                [&](const Owned<Task>& task_) {
-                  return task_.get() && task_->task_id() == task.task_id();
+                [&](const CompletedTask& task_) {
+                  return task_.taskId() == task.task_id();
                 }),
             framework->completedTasks.end());
       }
@@ -7118,7 +7123,21 @@ void Master::__reregisterSlave(
     resourceVersion = reregisterSlaveMessage.resource_version_uuid();
   }
 
-  slaves.recovered.erase(slaveInfo.id());
+  if (slaves.recovered.contains(slaveInfo.id())) {
+    slaves.recovered.erase(slaveInfo.id());
+
+    ++metrics->recovery_slave_reregistrations;
+
+    if (slaves.recovered.empty() && slaves.recoveredTime.isSome()) {
+      const Duration elapsed = Clock::now() - slaves.recoveredTime.get();
+
+      LOG(INFO) << "All agents recovered from the registry have"
+                << " reregistered within " << elapsed;
+
+      metrics->recovery_slave_reregistration_secs = elapsed.secs();
+      slaves.recoveredTime = None();
+    }
+  }
 
   Slave* slave = new Slave(
       this,
@@ -8971,56 +8990,142 @@ void Master::reconcile(
 
   ++metrics->messages_reconcile_tasks;
 
-  if (reconcile.tasks().empty()) {
-    // Implicit reconciliation.
+  Framework::Reconciliation reconciliation;
+  reconciliation.implicit = reconcile.tasks().empty();
+
+  reconciliation.batch = reconcile.batch();
+
+  if (reconciliation.implicit) {
     LOG(INFO) << "Performing implicit task state reconciliation"
                  " for framework " << *framework;
 
-    foreachvalue (Task* task, framework->tasks) {
-      const TaskState& state = task->has_status_update_state()
-          ? task->status_update_state()
-          : task->state();
+    // The reconciliation might be answered in several batches, so we
+    // capture the tasks that are known at this point.
+    reconciliation.tasks.Reserve(framework->tasks.size());
 
-      const Option<ExecutorID>& executorId = task->has_executor_id()
-          ? Option<ExecutorID>(task->executor_id())
-          : None();
+    foreachkey (const TaskID& taskId, framework->tasks) {
+      *reconciliation.tasks.Add()->mutable_task_id() = taskId;
+    }
+  } else {
+    LOG(INFO) << "Performing explicit task state reconciliation"
+              << " for " << reconcile.tasks().size() << " tasks"
+              << " of framework " << *framework;
 
-      StatusUpdate update = protobuf::createStatusUpdate(
-          framework->id(),
-          task->slave_id(),
-          task->task_id(),
-          state,
-          TaskStatus::SOURCE_MASTER,
-          None(),
-          "Reconciliation: Latest task state",
-          TaskStatus::REASON_RECONCILIATION,
-          executorId,
-          protobuf::getTaskHealth(*task),
-          protobuf::getTaskCheckStatus(*task),
-          None(),
-          protobuf::getTaskContainerStatus(*task));
+    reconciliation.tasks.Swap(reconcile.mutable_tasks());
+  }
+
+  // An implicit reconciliation which has not been answered yet is
+  // replaced by this one, which captures the tasks known now, rather
+  // than answering the same tasks twice.
+  if (reconciliation.implicit) {
+    foreach (Framework::Reconciliation& pending,
+             framework->reconciliations) {
+      if (pending.implicit && pending.next == 0) {
+        pending = std::move(reconciliation);
+        return;
+      }
+    }
+  }
+
+  if (framework->reconciliations.size() >= MAX_PENDING_RECONCILIATIONS) {
+    LOG(WARNING) << "Dropping task state reconciliation of framework "
+                 << *framework << " because "
+                 << framework->reconciliations.size()
+                 << " reconciliations are pending";
+    return;
+  }
 
-      VLOG(1) << "Sending implicit reconciliation state "
-              << update.status().state()
-              << " for task " << update.status().task_id()
+  framework->reconciliations.push_back(std::move(reconciliation));
+
+  // If other reconciliations are pending, the next batch has been
+  // scheduled already and will answer this one after them.
+  if (framework->reconciliations.size() == 1) {
+    _reconcile(framework->id());
+  }
+}
+
+
+void Master::_reconcile(const FrameworkID& frameworkId)
+{
+  Framework* framework = getFramework(frameworkId);
+  if (framework == nullptr) {
+    return;
+  }
+
+  size_t remaining = MAX_RECONCILIATION_BATCH_SIZE;
+
+  while (remaining > 0 && !framework->reconciliations.empty()) {
+    Framework::Reconciliation& reconciliation =
+      framework->reconciliations.front();
+
+    // Only HTTP schedulers can receive 'UPDATES' events, see
+    // `Framework::send()`. This is checked for every batch since the
+    // scheduler might have reconnected through the driver since the
+    // reconciliation was requested.
+    const bool batch = reconciliation.batch && framework->http().isSome();
+
+    scheduler::Event event;
+    event.set_type(scheduler::Event::UPDATES);
+
+    while (remaining > 0 &&
+           reconciliation.next < reconciliation.tasks.size()) {
+      Option<StatusUpdate> update = reconcileTask(
+          framework,
+          reconciliation.tasks.Get(reconciliation.next++),
+          reconciliation.implicit);
+
+      --remaining;
+
+      if (update.isNone()) {
+        continue;
+      }
+
+      VLOG(1) << "Sending "
+              << (reconciliation.implicit ? "implicit" : "explicit")
+              << " reconciliation state " << update->status().state()
+              << " for task " << update->status().task_id()
               << " of framework " << *framework;
 
-      // TODO(bmahler): Consider using forward(); might lead to too
-      // much logging.
-      StatusUpdateMessage message;
-      *message.mutable_update() = std::move(update);
-      framework->send(message);
+      if (batch) {
+        TaskStatus* status = event.mutable_updates()->add_statuses();
+        *status = std::move(*update->mutable_status());
+
+        if (update->has_executor_id()) {
+          *status->mutable_executor_id() = update->executor_id();
+        }
+      } else {
+        // TODO(bmahler): Consider using forward(); might lead to too
+        // much logging.
+        StatusUpdateMessage message;
+        *message.mutable_update() = std::move(update.get());
+        framework->send(message);
+      }
     }
 
-    return;
+    if (event.updates().statuses_size() > 0) {
+      framework->send(event);
+    }
+
+    if (reconciliation.next == reconciliation.tasks.size()) {
+      framework->reconciliations.pop_front();
+    }
   }
 
-  // Explicit reconciliation.
-  LOG(INFO) << "Performing explicit task state reconciliation"
-            << " for " << reconcile.tasks().size() << " tasks"
-            << " of framework " << *framework;
+  if (!framework->reconciliations.empty()) {
+    delay(RECONCILIATION_BATCH_INTERVAL,
+          self(),
+          &Master::_reconcile,
+          frameworkId);
+  }
+}
 
-  // Explicit reconciliation occurs for the following cases:
+
+Option<StatusUpdate> Master::reconcileTask(
+    Framework* framework,
+    const scheduler::Call::Reconcile::Task& t,
+    bool implicit)
+{
+  // Reconciliation occurs for the following cases:
   //   (1) Task is known: send the latest state.
   //   (2) Task is unknown, slave is recovered: no-op.
   //   (3) Task is unknown, slave is registered: TASK_GONE.
@@ -9035,147 +9140,137 @@ void Master::reconcile(
   //
   // For cases (3), (4), (5) and (6) TASK_LOST is sent instead if the
   // framework has not opted-in to the PARTITION_AWARE capability.
-  foreach (const scheduler::Call::Reconcile::Task& t, reconcile.tasks()) {
-    Option<SlaveID> slaveId = None();
-    if (t.has_slave_id()) {
-      slaveId = t.slave_id();
-    }
-
-    Option<StatusUpdate> update = None();
-    Task* task = framework->getTask(t.task_id());
-
-    if (task != nullptr) {
-      // (1) Task is known: send the latest status update state.
-      const TaskState& state = task->has_status_update_state()
-          ? task->status_update_state()
-          : task->state();
+  Option<SlaveID> slaveId = None();
+  if (t.has_slave_id()) {
+    slaveId = t.slave_id();
+  }
 
-      const Option<ExecutorID> executorId = task->has_executor_id()
-          ? Option<ExecutorID>(task->executor_id())
-          : None();
+  Task* task = framework->getTask(t.task_id());
 
-      update = protobuf::createStatusUpdate(
-          framework->id(),
-          task->slave_id(),
-          task->task_id(),
-          state,
-          TaskStatus::SOURCE_MASTER,
-          None(),
-          "Reconciliation: Latest task state",
-          TaskStatus::REASON_RECONCILIATION,
-          executorId,
-          protobuf::getTaskHealth(*task),
-          protobuf::getTaskCheckStatus(*task),
-          None(),
-          protobuf::getTaskContainerStatus(*task));
-    } else if ((slaveId.isSome() && slaves.recovered.contains(slaveId.get())) ||
-               (slaveId.isNone() && !slaves.recovered.empty())) {
-      // (2) Task is unknown, slave is recovered: no-op. The framework
-      // will have to retry this and will not receive a response until
-      // the agent either registers, or is marked unreachable after the
-      // timeout.
-      LOG(INFO) << "Dropping reconciliation of task " << t.task_id()
-                << " for framework " << *framework << " because "
-                << (slaveId.isSome() ?
-                      "agent " + stringify(slaveId.get()) + " has" :
-                      "some agents have")
-                << " not yet reregistered with the master";
-    } else if (slaveId.isSome() && slaves.registered.contains(slaveId.get())) {
-      // (3) Task is unknown, slave is registered: TASK_GONE. If the
-      // framework does not have the PARTITION_AWARE capability, send
-      // TASK_LOST for backward compatibility.
-      TaskState taskState = TASK_GONE;
-      if (!framework->capabilities.partitionAware) {
-        taskState = TASK_LOST;
-      }
+  if (task != nullptr) {
+    // (1) Task is known: send the latest status update state.
+    const TaskState& state = task->has_status_update_state()
+        ? task->status_update_state()
+        : task->state();
 
-      update = protobuf::createStatusUpdate(
-          framework->id(),
-          slaveId.get(),
-          t.task_id(),
-          taskState,
-          TaskStatus::SOURCE_MASTER,
-          None(),
-          "Reconciliation: Task is unknown to the agent",
-          TaskStatus::REASON_RECONCILIATION);
-    } else if (slaveId.isSome() && slaves.unreachable.contains(slaveId.get())) {
-      // (4) Slave is unreachable: TASK_UNREACHABLE. If the framework
-      // does not have the PARTITION_AWARE capability, send TASK_LOST
-      // for backward compatibility. In either case, the status update
-      // also includes the time when the slave was marked unreachable.
-      const TimeInfo& unreachableTime = slaves.unreachable.at(slaveId.get());
-
-      TaskState taskState = TASK_UNREACHABLE;
-      if (!framework->capabilities.partitionAware) {
-        taskState = TASK_LOST;
-      }
+    const Option<ExecutorID> executorId = task->has_executor_id()
+        ? Option<ExecutorID>(task->executor_id())
+        : None();
 
-      update = protobuf::createStatusUpdate(
-          framework->id(),
-          slaveId.get(),
-          t.task_id(),
-          taskState,
-          TaskStatus::SOURCE_MASTER,
-          None(),
-          "Reconciliation: Task is unreachable",
-          TaskStatus::REASON_RECONCILIATION,
-          None(),
-          None(),
-          None(),
-          None(),
-          None(),
-          unreachableTime);
-    } else if (slaveId.isSome() && slaves.gone.contains(slaveId.get())) {
-      // (5) Slave is gone: TASK_GONE_BY_OPERATOR. If the framework
-      // does not have the PARTITION_AWARE capability, send TASK_LOST
-      // for backward compatibility.
-      TaskState taskState = TASK_GONE_BY_OPERATOR;
-      if (!framework->capabilities.partitionAware) {
-        taskState = TASK_LOST;
-      }
-
-      update = protobuf::createStatusUpdate(
-          framework->id(),
-          slaveId.get(),
-          t.task_id(),
-          taskState,
-          TaskStatus::SOURCE_MASTER,
-          None(),
-          "Reconciliation: Task is gone",
-          TaskStatus::REASON_RECONCILIATION);
-    } else {
-      // (6) Task is unknown, slave is unknown: TASK_UNKNOWN. If the
-      // framework does not have the PARTITION_AWARE capability, send
-      // TASK_LOST for backward compatibility.
-      TaskState taskState = TASK_UNKNOWN;
-      if (!framework->capabilities.partitionAware) {
-        taskState = TASK_LOST;
-      }
+    return protobuf::createStatusUpdate(
+        framework->id(),
+        task->slave_id(),
+        task->task_id(),
+        state,
+        TaskStatus::SOURCE_MASTER,
+        None(),
+        "Reconciliation: Latest task state",
+        TaskStatus::REASON_RECONCILIATION,
+        executorId,
+        protobuf::getTaskHealth(*task),
+        protobuf::getTaskCheckStatus(*task),
+        None(),
+        protobuf::getTaskContainerStatus(*task));
+  } else if (implicit) {
+    // The task was removed after the implicit reconciliation was
+    // requested, in which case its terminal update has been sent.
+    return None();
+  } else if ((slaveId.isSome() && slaves.recovered.contains(slaveId.get())) ||
+             (slaveId.isNone() && !slaves.recovered.empty())) {
+    // (2) Task is unknown, slave is recovered: no-op. The framework
+    // will have to retry this and will not receive a response until
+    // the agent either registers, or is marked unreachable after the
+    // timeout.
+    LOG(INFO) << "Dropping reconciliation of task " << t.task_id()
+              << " for framework " << *framework << " because "
+              << (slaveId.isSome() ?
+                    "agent " + stringify(slaveId.get()) + " has" :
+                    "some agents have")
+              << " not yet reregistered with the master";
+  } else if (slaveId.isSome() && slaves.registered.contains(slaveId.get())) {
+    // (3) Task is unknown, slave is registered: TASK_GONE. If the
+    // framework does not have the PARTITION_AWARE capability, send
+    // TASK_LOST for backward compatibility.
+    TaskState taskState = TASK_GONE;
+    if (!framework->capabilities.partitionAware) {
+      taskState = TASK_LOST;
+    }
 
-      update = protobuf::createStatusUpdate(
-          framework->id(),
-          slaveId,
-          t.task_id(),
-          taskState,
-          TaskStatus::SOURCE_MASTER,
-          None(),
-          "Reconciliation: Task is unknown",
-          TaskStatus::REASON_RECONCILIATION);
+    return protobuf::createStatusUpdate(
+        framework->id(),
+        slaveId.get(),
+        t.task_id(),
+        taskState,
+        TaskStatus::SOURCE_MASTER,
+        None(),
+        "Reconciliation: Task is unknown to the agent",
+        TaskStatus::REASON_RECONCILIATION);
+  } else if (slaveId.isSome() && slaves.unreachable.contains(slaveId.get())) {
+    // (4) Slave is unreachable: TASK_UNREACHABLE. If the framework
+    // does not have the PARTITION_AWARE capability, send TASK_LOST
+    // for backward compatibility. In either case, the status update
+    // also includes the time when the slave was marked unreachable.
+    const TimeInfo& unreachableTime = slaves.unreachable.at(slaveId.get());
+
+    TaskState taskState = TASK_UNREACHABLE;
+    if (!framework->capabilities.partitionAware) {
+      taskState = TASK_LOST;
     }
 
-    if (update.isSome()) {
-      VLOG(1) << "Sending explicit reconciliation state "
-              << update->status().state()
-              << " for task " << update->status().task_id()
-              << " of framework " << *framework;
+    return protobuf::createStatusUpdate(
+        framework->id(),
+        slaveId.get(),
+        t.task_id(),
+        taskState,
+        TaskStatus::SOURCE_MASTER,
+        None(),
+        "Reconciliation: Task is unreachable",
+        TaskStatus::REASON_RECONCILIATION,
+        None(),
+        None(),
+        None(),
+        None(),
+        None(),
+        unreachableTime);
+  } else if (slaveId.isSome() && slaves.gone.contains(slaveId.get())) {
+    // (5) Slave is gone: TASK_GONE_BY_OPERATOR. If the framework
+    // does not have the PARTITION_AWARE capability, send TASK_LOST
+    // for backward compatibility.
+    TaskState taskState = TASK_GONE_BY_OPERATOR;
+    if (!framework->capabilities.partitionAware) {
+      taskState = TASK_LOST;
+    }
 
-      // TODO(bmahler): Consider using forward(); might lead to too
-      // much logging.
-      StatusUpdateMessage message;
-      *message.mutable_update() = std::move(update.get());
-      framework->send(message);
+    return protobuf::createStatusUpdate(
+        framework->id(),
+        slaveId.get(),
+        t.task_id(),
+        taskState,
+        TaskStatus::SOURCE_MASTER,
+        None(),
+        "Reconciliation: Task is gone",
+        TaskStatus::REASON_RECONCILIATION);
+  } else {
+    // (6) Task is unknown, slave is unknown: TASK_UNKNOWN. If the
+    // framework does not have the PARTITION_AWARE capability, send
+    // TASK_LOST for backward compatibility.
+    TaskState taskState = TASK_UNKNOWN;
+    if (!framework->capabilities.partitionAware) {
+      taskState = TASK_LOST;
     }
+
+    return protobuf::createStatusUpdate(
+        framework->id(),
+        slaveId,
+        t.task_id(),
+        taskState,
+        TaskStatus::SOURCE_MASTER,
+        None(),
+        "Reconciliation: Task is unknown",
+        TaskStatus::REASON_RECONCILIATION);
   }
+
+  return None();
 }
 
 
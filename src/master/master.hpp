@@ -19,6 +19,7 @@
 
 #include <stdint.h>
 
+#include <deque>
 #include <functional>
 #include <list>
 #include <memory>
@@ -52,6 +53,7 @@
 #include <process/owned.hpp>
 #include <process/process.hpp>
 #include <process/protobuf.hpp>
+#include <process/time.hpp>
 #include <process/timer.hpp>
 
 #include <process/metrics/counter.hpp>
@@ -989,6 +991,19 @@ private:
       Framework* framework,
       mesos::scheduler::Call::Reconcile&& reconcile);
 
+  // Answers the framework's pending task reconciliations, sending at
+  // most `MAX_RECONCILIATION_BATCH_SIZE` task statuses before yielding
+  // to other events. The remaining statuses are sent in subsequent
+  // batches, at most one batch per `RECONCILIATION_BATCH_INTERVAL`.
+  void _reconcile(const FrameworkID& frameworkId);
+
+  // Returns the latest known state of the task for a reconciliation,
+  // or `None()` if no update should be sent for it.
+  Option<StatusUpdate> reconcileTask(
+      Framework* framework,
+      const mesos::scheduler::Call::Reconcile::Task& task,
+      bool implicit);
+
   void reconcileOperations(
       Framework* framework,
       mesos::scheduler::Call::ReconcileOperations&& reconcile);
@@ -2017,6 +2032,10 @@ private:
     // registry to reregister with the master.
     Option<process::Timer> recoveredTimer;
 
+    // When the slaves were recovered from the registry; used to
+    // measure how long it takes for all of them to reregister.
+    Option<process::Time> recoveredTime;
+
     // Slaves that have been recovered from the registrar after master
     // failover. Slaves are removed from this collection when they
     // either reregister with the master or are marked unreachable
@@ -2349,6 +2368,11 @@ private:
     return static_cast<double>(offers.size());
   }
 
+  double _recovery_slaves_pending()
+  {
+    return static_cast<double>(slaves.recovered.size());
+  }
+
   double _event_queue_messages()
   {
     return static_cast<double>(eventCount<process::MessageEvent>());
@@ -2392,6 +2416,32 @@ inline std::ostream& operator<<(
     const Framework& framework);
 
 
+// A task in a framework's history of completed tasks. This history
+// can grow large (see `--max_completed_tasks_per_framework`), so the
+// task is kept in its serialized form, which takes several times less
+// memory than the parsed protobuf, and is only parsed when needed in
+// full (e.g., to serve an endpoint). The fields used to index and
+// filter the history are kept parsed alongside.
+class CompletedTask
+{
+public:
+  explicit CompletedTask(const Task& task);
+
+  const TaskID& taskId() const { return taskId_; }
+  const SlaveID& slaveId() const { return slaveId_; }
+  TaskState state() const { return state_; }
+
+  // Parses the serialized task.
+  Task get() const;
+
+private:
+  TaskID taskId_;
+  SlaveID slaveId_;
+  TaskState state_;
+  std::string data;
+};
+
+
 // TODO(bmahler): Keeping the task and executor information in sync
 // across the Slave and Framework structs is error prone!
 struct Framework
@@ -2571,7 +2621,7 @@ struct Framework
   // fixed-size cache to avoid consuming too much memory. We use
   // circular_buffer rather than BoundedHashMap because there
   // can be multiple completed tasks with the same task ID.
-  circular_buffer<process::Owned<Task>> completedTasks;
+  circular_buffer<CompletedTask> completedTasks;
 
   // When an agent is marked unreachable, tasks running on it are stored
   // here. We only keep a fixed-size cache to avoid consuming too much memory.
@@ -2583,6 +2633,32 @@ struct Framework
 
   hashset<InverseOffer*> inverseOffers; // Active inverse offers for framework.
 
+  // A task reconciliation requested by the framework which the master
+  // has not fully answered yet, see `Master::_reconcile()`.
+  struct Reconciliation
+  {
+    // For an implicit reconciliation, 'tasks' holds the tasks known
+    // at the time of the request.
+    bool implicit;
+
+    // Whether the scheduler asked to bundle the task statuses into
+    // 'UPDATES' events, which is only done while it is connected
+    // through HTTP.
+    bool batch;
+
+    google::protobuf::RepeatedPtrField<
+        mesos::scheduler::Call::Reconcile::Task> tasks;
+
+    // Index of the next task in 'tasks' to reconcile.
+    int next = 0;
+  };
+
+  // Pending reconciliations, answered in the order they were requested.
+  // At most one implicit reconciliation is pending that has not been
+  // answered in part, and at most `MAX_PENDING_RECONCILIATIONS` are
+  // pending overall.
+  std::deque<Reconciliation> reconciliations;
+
   // TODO(bmahler): Make this private to enforce that `addExecutor()`
   // and `removeExecutor()` are used, and provide a const view into
   // the executors.
@@ -193,6 +193,13 @@ Metrics::Metrics(const Master& master)
         "master/invalid_operation_status_update_acknowledgements"),
     recovery_slave_removals(
         "master/recovery_slave_removals"),
+    recovery_slave_reregistrations(
+        "master/recovery_slave_reregistrations"),
+    recovery_slaves_pending(
+        "master/recovery_slaves_pending",
+        defer(master, &Master::_recovery_slaves_pending)),
+    recovery_slave_reregistration_secs(
+        "master/recovery_slave_reregistration_secs"),
     event_queue_messages(
         "master/event_queue_messages",
         defer(master, &Master::_event_queue_messages)),
@@ -312,6 +319,9 @@ Metrics::Metrics(const Master& master)
   process::metrics::add(invalid_operation_status_update_acknowledgements);
 
   process::metrics::add(recovery_slave_removals);
+  process::metrics::add(recovery_slave_reregistrations);
+  process::metrics::add(recovery_slaves_pending);
+  process::metrics::add(recovery_slave_reregistration_secs);
 
   process::metrics::add(event_queue_messages);
   process::metrics::add(event_queue_dispatches);
@@ -494,6 +504,9 @@ Metrics::~Metrics()
   process::metrics::remove(invalid_operation_status_update_acknowledgements);
 
   process::metrics::remove(recovery_slave_removals);
+  process::metrics::remove(recovery_slave_reregistrations);
+  process::metrics::remove(recovery_slaves_pending);
+  process::metrics::remove(recovery_slave_reregistration_secs);
 
   process::metrics::remove(event_queue_messages);
   process::metrics::remove(event_queue_dispatches);
@@ -228,6 +228,13 @@ struct Metrics
 
   // Recovery counters.
   process::metrics::Counter recovery_slave_removals;
+  process::metrics::Counter recovery_slave_reregistrations;
+
+  // Recovery gauges: the number of agents recovered from the registry
+  // that have not reregistered yet, and the time it took (since the
+  // registry was recovered) until all of them had reregistered.
+  process::metrics::PullGauge recovery_slaves_pending;
+  process::metrics::PushGauge recovery_slave_reregistration_secs;
 
   // Process metrics.
   process::metrics::PullGauge event_queue_messages;
@@ -213,13 +213,15 @@ void FullFrameworkWriter::operator()(JSON::ObjectWriter* writer) const
   });
 
   writer->field("completed_tasks", [this](JSON::ArrayWriter* writer) {
-    foreach (const Owned<Task>& task, framework_->completedTasks) {
+    foreach (const CompletedTask& completedTask, framework_->completedTasks) {
+      const Task task = completedTask.get();
+
       // Skip unauthorized tasks.
-      if (!approvers_->approved<VIEW_TASK>(*task, framework_->info)) {
+      if (!approvers_->approved<VIEW_TASK>(task, framework_->info)) {
         continue;
       }
 
-      writer->element(*task);
+      writer->element(task);
     }
   });
 
@@ -483,9 +485,9 @@ public:
         slavesToFrameworks[task->slave_id()].insert(frameworkId);
       }
 
-      foreach (const Owned<Task>& task, framework->completedTasks) {
-        frameworksToSlaves[frameworkId].insert(task->slave_id());
-        slavesToFrameworks[task->slave_id()].insert(frameworkId);
+      foreach (const CompletedTask& task, framework->completedTasks) {
+        frameworksToSlaves[frameworkId].insert(task.slaveId());
+        slavesToFrameworks[task.slaveId()].insert(frameworkId);
       }
     }
   }
@@ -534,10 +536,10 @@ struct TaskStateSummary
       gone_by_operator(0),
       unknown(0) {}
 
-  // Account for the state of the given task.
-  void count(const Task& task)
+  // Account for a task in the given state.
+  void count(const TaskState& state)
   {
-    switch (task.state()) {
+    switch (state) {
       case TASK_STAGING: { ++staging; break; }
       case TASK_STARTING: { ++starting; break; }
       case TASK_RUNNING: { ++running; break; }
@@ -590,18 +592,18 @@ public:
                  const Framework* framework,
                  frameworks) {
       foreachvalue (const Task* task, framework->tasks) {
-        frameworkTaskSummaries[frameworkId].count(*task);
-        slaveTaskSummaries[task->slave_id()].count(*task);
+        frameworkTaskSummaries[frameworkId].count(task->state());
+        slaveTaskSummaries[task->slave_id()].count(task->state());
       }
 
       foreachvalue (const Owned<Task>& task, framework->unreachableTasks) {
-        frameworkTaskSummaries[frameworkId].count(*task);
-        slaveTaskSummaries[task->slave_id()].count(*task);
+        frameworkTaskSummaries[frameworkId].count(task->state());
+        slaveTaskSummaries[task->slave_id()].count(task->state());
       }
 
-      foreach (const Owned<Task>& task, framework->completedTasks) {
-        frameworkTaskSummaries[frameworkId].count(*task);
-        slaveTaskSummaries[task->slave_id()].count(*task);
+      foreach (const CompletedTask& task, framework->completedTasks) {
+        frameworkTaskSummaries[frameworkId].count(task.state());
+        slaveTaskSummaries[task.slaveId()].count(task.state());
       }
     }
   }
@@ -1196,6 +1198,10 @@ pair<Response, Option<Master::ReadOnlyHandler::PostProcessing>>
   // Construct task list with both running,
   // completed and unreachable tasks.
   vector<const Task*> tasks;
+
+  // Completed tasks are stored in serialized form, hence we keep the
+  // parsed ones alive for as long as they are referenced by 'tasks'.
+  vector<Owned<Task>> completedTasks;
   foreach (const Framework* framework, frameworks) {
     foreachvalue (Task* task, framework->tasks) {
       // Skip unauthorized tasks or tasks without matching task ID.
@@ -1219,14 +1225,21 @@ pair<Response, Option<Master::ReadOnlyHandler::PostProcessing>>
       tasks.push_back(task.get());
     }
 
-    foreach (const Owned<Task>& task, framework->completedTasks) {
-      // Skip unauthorized tasks or tasks without matching task ID.
-      if (!selectTaskId.accept(task->task_id()) ||
-          !approvers->approved<VIEW_TASK>(*task, framework->info)) {
+    foreach (const CompletedTask& completedTask, framework->completedTasks) {
+      // Skip tasks without matching task ID.
+      if (!selectTaskId.accept(completedTask.taskId())) {
+        continue;
+      }
+
+      Owned<Task> task(new Task(completedTask.get()));
+
+      // Skip unauthorized tasks.
+      if (!approvers->approved<VIEW_TASK>(*task, framework->info)) {
         continue;
       }
 
       tasks.push_back(task.get());
+      completedTasks.push_back(task);
     }
   }
 
@@ -1976,13 +1989,16 @@ function<void(JSON::ObjectWriter*)> Master::ReadOnlyHandler::jsonifyGetTasks(
         descriptor->FindFieldByNumber(field)->name(),
         [&](JSON::ArrayWriter* writer) {
           foreach (const Framework* framework, frameworks) {
-            foreach (const Owned<Task>& task, framework->completedTasks) {
+            foreach (const CompletedTask& completedTask,
+                     framework->completedTasks) {
+              const Task task = completedTask.get();
+
               // Skip unauthorized tasks.
-              if (!approvers->approved<VIEW_TASK>(*task, framework->info)) {
+              if (!approvers->approved<VIEW_TASK>(task, framework->info)) {
                 continue;
               }
 
-              writer->element(asV1Protobuf(*task));
+              writer->element(asV1Protobuf(task));
             }
           }
         });
@@ -2054,15 +2070,17 @@ string Master::ReadOnlyHandler::serializeGetTasks(
     }
 
     // Completed tasks.
-    foreach (const Owned<Task>& task, framework->completedTasks) {
+    foreach (const CompletedTask& completedTask, framework->completedTasks) {
+      const Task task = completedTask.get();
+
       // Skip unauthorized tasks.
-      if (!approvers->approved<VIEW_TASK>(*task, framework->info)) {
+      if (!approvers->approved<VIEW_TASK>(task, framework->info)) {
         continue;
       }
 
       WireFormatLite2::WriteMessageWithoutCachedSizes(
           mesos::v1::master::Response::GetTasks::kCompletedTasksFieldNumber,
-          *task,
+          task,
           &writer);
     }
   }
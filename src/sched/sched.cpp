@@ -657,6 +657,33 @@ protected:
         break;
       }
 
+      case Event::UPDATES: {
+        if (!event.has_updates()) {
+          drop(event, "Expecting 'updates' to be present");
+          break;
+        }
+
+        // The master only bundles reconciliation updates, which do
+        // not have a 'uuid' and hence need no acknowledgement.
+        foreach (const TaskStatus& status, event.updates().statuses()) {
+          StatusUpdate update;
+          update.mutable_framework_id()->CopyFrom(framework.id());
+          update.mutable_status()->CopyFrom(status);
+          update.set_timestamp(status.timestamp());
+
+          if (status.has_executor_id()) {
+            update.mutable_executor_id()->CopyFrom(status.executor_id());
+          }
+
+          if (status.has_slave_id()) {
+            update.mutable_slave_id()->CopyFrom(status.slave_id());
+          }
+
+          statusUpdate(from, update, UPID());
+        }
+        break;
+      }
+
       // TODO(greggomann): Implement handling of operation status updates.
       case Event::UPDATE_OPERATION_STATUS:
         break;
@@ -58,6 +58,21 @@ constexpr Duration RECOVERY_TIMEOUT = Minutes(15);
 constexpr Duration STATUS_UPDATE_RETRY_INTERVAL_MIN = Seconds(10);
 constexpr Duration STATUS_UPDATE_RETRY_INTERVAL_MAX = Minutes(10);
 
+// Default value for `--cgroups_usage_max_staleness`.
+constexpr Duration DEFAULT_CGROUPS_USAGE_MAX_STALENESS = Seconds(5);
+
+// Default value for `--recovery_threads`.
+constexpr size_t DEFAULT_RECOVERY_THREADS = 8;
+
+// Default value for `--container_disk_usage_threads`.
+constexpr size_t DEFAULT_CONTAINER_DISK_USAGE_THREADS = 4;
+
+// Default value for `--image_provisioner_copy_threads`.
+constexpr size_t DEFAULT_IMAGE_PROVISIONER_COPY_THREADS = 4;
+
+// Default value for `--status_update_journal_compaction_interval`.
+constexpr Duration STATUS_UPDATE_JOURNAL_COMPACTION_INTERVAL = Seconds(30);
+
 // Default backoff interval used by the slave to wait before registration.
 constexpr Duration DEFAULT_REGISTRATION_BACKOFF_FACTOR = Seconds(1);
 
@@ -16,6 +16,11 @@
 
 #include "slave/containerizer/fetcher.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+
 #include <process/async.hpp>
 #include <process/check.hpp>
 #include <process/collect.hpp>
@@ -36,18 +41,25 @@
 #include <stout/windows.hpp>
 #endif // __WINDOWS__
 
+#include <stout/os/close.hpp>
 #include <stout/os/exists.hpp>
 #include <stout/os/find.hpp>
 #include <stout/os/killtree.hpp>
+#include <stout/os/open.hpp>
 #include <stout/os/realpath.hpp>
 #include <stout/os/read.hpp>
 #include <stout/os/rmdir.hpp>
+#include <stout/os/stat.hpp>
+#include <stout/os/su.hpp>
+#include <stout/os/write.hpp>
 
 #include "hdfs/hdfs.hpp"
 
+#include "common/command_utils.hpp"
 #include "common/status_utils.hpp"
 
 #include "slave/containerizer/fetcher_process.hpp"
+#include "slave/containerizer/fetcher_utils.hpp"
 
 using std::list;
 using std::map;
@@ -65,6 +77,8 @@ using process::async;
 using process::Failure;
 using process::Future;
 using process::Owned;
+using process::Promise;
+using process::Shared;
 using process::Subprocess;
 
 namespace mesos {
@@ -293,6 +307,17 @@ FetcherProcess::FetcherProcess(const Flags& _flags)
       flags(_flags),
       cache(_flags.fetcher_cache_size)
 {
+  if (flags.blob_store_capacity > 0) {
+    Try<Owned<BlobStore>> _blobStore =
+      BlobStore::create(flags.blob_store_dir, flags.blob_store_capacity);
+
+    if (_blobStore.isError()) {
+      LOG(WARNING) << "Failed to create the blob store for the fetcher "
+                   << "cache: " << _blobStore.error();
+    } else {
+      blobStore = _blobStore->share();
+    }
+  }
 }
 
 
@@ -301,6 +326,12 @@ FetcherProcess::~FetcherProcess()
   foreachkey (const ContainerID& containerId, subprocessPids) {
     kill(containerId);
   }
+
+  // The threads of the running fetches outlive this process, so they
+  // are told to abort.
+  foreach (const PendingFetch& fetch, runningFetches) {
+    fetch.cancelled->store(true);
+  }
 }
 
 
@@ -445,12 +476,23 @@ Future<Nothing> FetcherProcess::fetch(
       newEntries.put(uri.value(), newEntry);
       newEntry->reference();
 
-      entries[uri] =
-        async([=]() {
-          return fetchSize(uri.value(), flags.frameworks_home);
-        })
-        .then(defer(self(), [=](const Try<Bytes>& requestedSpace) {
-          return reserveCacheSpace(requestedSpace, newEntry);
+      entries[uri] = restore(newEntry)
+        .then(defer(self(), [=](const Option<Bytes>& restored)
+            -> Future<shared_ptr<Cache::Entry>> {
+          if (restored.isSome()) {
+            return reserveCacheSpace(restored.get(), newEntry)
+              .then([=]() {
+                newEntry->complete();
+                return newEntry;
+              });
+          }
+
+          return async([=]() {
+              return fetchSize(uri.value(), flags.frameworks_home);
+            })
+            .then(defer(self(), [=](const Try<Bytes>& requestedSpace) {
+              return reserveCacheSpace(requestedSpace, newEntry);
+            }));
         }));
     }
   }
@@ -615,6 +657,8 @@ Future<Nothing> FetcherProcess::__fetch(
             Try<Nothing> adjust = cache.adjust(entry.get());
             if (adjust.isSome()) {
               entry.get()->complete();
+
+              store(entry.get());
             } else {
               LOG(WARNING) << "Failed to adjust the cache size for entry '"
                            << entry.get()->key << "' with error: "
@@ -634,6 +678,81 @@ Future<Nothing> FetcherProcess::__fetch(
 }
 
 
+Future<Option<Bytes>> FetcherProcess::restore(
+    const shared_ptr<Cache::Entry>& entry)
+{
+  if (blobStore.isNone() || !digests.contains(entry->key)) {
+    return None();
+  }
+
+  const string key = entry->key;
+  const string digest = digests.at(key);
+  const string path = entry->path().string();
+
+  return BlobStore::materialize(blobStore.get(), digest, path)
+    .then([=](bool restored) -> Future<Option<Bytes>> {
+      if (!restored) {
+        return None();
+      }
+
+      Try<Bytes> size = os::stat::size(path);
+      if (size.isError()) {
+        return Failure(size.error());
+      }
+
+      VLOG(1) << "Restored cache entry '" << key << "' from blob '"
+              << digest << "'";
+
+      return size.get();
+    })
+    .repair([=](const Future<Option<Bytes>>& restore) {
+      LOG(WARNING) << "Failed to restore cache entry '" << key
+                   << "' from blob '" << digest << "': "
+                   << (restore.isFailed() ? restore.failure() : "discarded");
+
+      return Option<Bytes>::none();
+    });
+}
+
+
+void FetcherProcess::store(const shared_ptr<Cache::Entry>& entry)
+{
+  if (blobStore.isNone()) {
+    return;
+  }
+
+  const string key = entry->key;
+  const string path = entry->path().string();
+  const Shared<BlobStore> blobStore = this->blobStore.get();
+
+  Try<int_fd> fd = os::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd.isError()) {
+    LOG(WARNING) << "Failed to open cache file '" << path << "' to add it "
+                 << "to the blob store: " << fd.error();
+    return;
+  }
+
+  const int_fd input = fd.get();
+
+  command::sha256(input)
+    .onAny([input]() { os::close(input); })
+    .then(defer(self(), [=](const string& checksum) {
+      const string digest = "sha256:" + checksum;
+
+      // The digest is recorded before the file is added, since a blob
+      // which is not in the store only means that the entry has to be
+      // downloaded again.
+      digests[key] = digest;
+
+      return BlobStore::add(blobStore, digest, path);
+    }))
+    .onFailed([=](const string& failure) {
+      LOG(WARNING) << "Failed to add cache file '" << path << "' to the "
+                   << "blob store: " << failure;
+    });
+}
+
+
 static off_t delta(
     const Bytes& actualSize,
     const shared_ptr<FetcherProcess::Cache::Entry>& entry)
@@ -824,6 +943,19 @@ Future<Nothing> FetcherProcess::run(
       return Nothing();
   }
 
+  // The agent only leaves the URIs to the mesos-fetcher if they have to
+  // be fetched as another user, which requires the process to switch to
+  // that user.
+  if (flags.fetcher_threads > 0) {
+    const Result<string> agentUser = os::user();
+
+    if (user.isNone() ||
+        (agentUser.isSome() && agentUser.get() == user.get())) {
+      os::close(out.get());
+      return fetchInProcess(containerId, user, info, err.get());
+    }
+  }
+
 #ifdef __WINDOWS__
   string fetcherPath = path::join(flags.launcher_dir, "mesos-fetcher.exe");
 #else
@@ -940,6 +1072,230 @@ Future<Nothing> FetcherProcess::run(
 }
 
 
+Future<Nothing> FetcherProcess::fetchInProcess(
+    const ContainerID& containerId,
+    const Option<string>& user,
+    const FetcherInfo& info,
+    int_fd err)
+{
+  VLOG(1) << "Fetching URIs for container '" << containerId << "' in-process";
+
+  Try<Nothing> mkdir = createFetcherCacheDirectory(info);
+  if (mkdir.isError()) {
+    os::close(err);
+    return Failure(
+        "Could not create the fetcher cache directory: " + mkdir.error());
+  }
+
+  const string sandboxDirectory = info.sandbox_directory();
+
+  const Option<string> cacheDirectory =
+    info.has_cache_directory()
+      ? Option<string>::some(info.cache_directory())
+      : Option<string>::none();
+
+  const Option<string> frameworksHome =
+    info.has_frameworks_home()
+      ? Option<string>::some(info.frameworks_home())
+      : Option<string>::none();
+
+  const Option<Duration> stallTimeout =
+    info.has_stall_timeout()
+      ? Nanoseconds(info.stall_timeout().nanoseconds())
+      : Option<Duration>::none();
+
+  const Option<string> hadoopHome = flags.hadoop_home;
+
+  auto fetch = [=](const FetcherInfo::Item& item) {
+    return [=](const std::atomic_bool* cancelled) {
+      return fetchItem(
+          item,
+          cacheDirectory,
+          sandboxDirectory,
+          frameworksHome,
+          stallTimeout,
+          hadoopHome,
+          cancelled);
+    };
+  };
+
+  // Duplicate URIs of the container share the same cache file, which is
+  // only downloaded by the first of them. The others retrieve it from
+  // the cache once that is done.
+  hashmap<string, Future<string>> downloads;
+
+  vector<Future<string>> futures;
+
+  foreach (const FetcherInfo::Item& item, info.items()) {
+    if (item.action() != FetcherInfo::Item::DOWNLOAD_AND_CACHE) {
+      futures.push_back(schedule(containerId, fetch(item)));
+      continue;
+    }
+
+    if (downloads.contains(item.cache_filename())) {
+      FetcherInfo::Item retrieve = item;
+      retrieve.set_action(FetcherInfo::Item::RETRIEVE_FROM_CACHE);
+
+      futures.push_back(downloads.at(item.cache_filename())
+        .then(defer(self(), [=](const string&) {
+          return schedule(containerId, fetch(retrieve));
+        })));
+
+      continue;
+    }
+
+    Future<string> download = schedule(containerId, fetch(item))
+      .onReady(defer(self(), [=](const string&) {
+        // Complete the cache entry right away for the other containers
+        // waiting for it. If this fails, `__fetch` takes care of the
+        // entry once all the URIs of this container have been fetched.
+        const Option<shared_ptr<Cache::Entry>> entry =
+          cache.get(user, item.uri().value());
+
+        if (entry.isSome() &&
+            entry.get()->filename == item.cache_filename() &&
+            entry.get()->completion().isPending() &&
+            cache.adjust(entry.get()).isSome()) {
+          entry.get()->complete();
+        }
+      }));
+
+    downloads.put(item.cache_filename(), download);
+    futures.push_back(download);
+  }
+
+  return await(futures)
+    .then(defer(self(), [=](const vector<Future<string>>& results)
+        -> Future<Nothing> {
+      // Log the results to the sandbox like the mesos-fetcher does.
+      string log;
+      Option<string> failure;
+
+      for (int i = 0; i < info.items_size(); i++) {
+        const string& uri = info.items(i).uri().value();
+
+        if (results[i].isReady()) {
+          log += "Fetched '" + uri + "' to '" + results[i].get() + "'\n";
+          continue;
+        }
+
+        const string error =
+          results[i].isFailed() ? results[i].failure() : "discarded";
+
+        log += "Failed to fetch '" + uri + "': " + error + "\n";
+
+        if (failure.isNone()) {
+          failure = "Failed to fetch '" + uri + "': " + error;
+        }
+      }
+
+      if (failure.isNone()) {
+        log += "Successfully fetched all URIs into '" +
+               sandboxDirectory + "'\n";
+      }
+
+      Try<Nothing> write = os::write(err, log);
+      if (write.isError()) {
+        LOG(WARNING) << "Failed to write the fetcher log for container "
+                     << containerId << ": " << write.error();
+      }
+
+      if (failure.isSome()) {
+        LOG(WARNING) << "Failed to fetch all URIs for container "
+                     << containerId << ": " << failure.get();
+
+        return Failure(
+            "Failed to fetch all URIs for container '" +
+            stringify(containerId) + "': " + failure.get());
+      }
+
+      return Nothing();
+    }))
+    .onAny([=](const Future<Nothing>&) {
+      os::close(err);
+    });
+}
+
+
+Future<string> FetcherProcess::schedule(
+    const ContainerID& containerId,
+    const lambda::function<Try<string>(const std::atomic_bool*)>& fetch)
+{
+  PendingFetch pending{
+    containerId,
+    fetch,
+    Owned<Promise<string>>(new Promise<string>()),
+    std::make_shared<std::atomic_bool>(false)};
+
+  pending.promise->future()
+    .onDiscard(defer(self(), [=]() { cancel(pending); }));
+
+  pendingFetches.push_back(pending);
+  dequeue();
+
+  return pending.promise->future();
+}
+
+
+void FetcherProcess::dequeue()
+{
+  while (runningFetches.size() < flags.fetcher_threads &&
+         !pendingFetches.empty()) {
+    const PendingFetch pending = pendingFetches.front();
+    pendingFetches.pop_front();
+
+    runningFetches.push_back(pending);
+
+    // Each fetch runs on a dedicated thread rather than on a libprocess
+    // worker, since it blocks for as long as the download takes.
+    std::shared_ptr<Promise<Try<string>>> result(new Promise<Try<string>>());
+
+    const lambda::function<Try<string>(const std::atomic_bool*)> fetch =
+      pending.fetch;
+
+    const std::shared_ptr<std::atomic_bool> cancelled = pending.cancelled;
+
+    std::thread([fetch, cancelled, result]() {
+      result->set(fetch(cancelled.get()));
+    }).detach();
+
+    result->future()
+      .onAny(defer(self(), [=](const Future<Try<string>>& result) {
+        runningFetches.remove_if([&](const PendingFetch& fetch) {
+          return fetch.cancelled == pending.cancelled;
+        });
+
+        // NOTE: The promise has already been discarded if the fetch was
+        // cancelled, in which case these are no-ops.
+        if (result->isError()) {
+          pending.promise->fail(result->error());
+        } else {
+          pending.promise->set(result->get());
+        }
+
+        dequeue();
+      }));
+  }
+}
+
+
+void FetcherProcess::cancel(const PendingFetch& fetch)
+{
+  auto same = [&](const PendingFetch& pending) {
+    return pending.cancelled == fetch.cancelled;
+  };
+
+  // A queued fetch is dropped, while a running one keeps counting
+  // against `--fetcher_threads` until its thread has returned.
+  pendingFetches.erase(
+      std::remove_if(pendingFetches.begin(), pendingFetches.end(), same),
+      pendingFetches.end());
+
+  fetch.cancelled->store(true);
+  fetch.promise->discard();
+}
+
+
 void FetcherProcess::kill(const ContainerID& containerId)
 {
   if (subprocessPids.contains(containerId)) {
@@ -949,6 +1305,29 @@ void FetcherProcess::kill(const ContainerID& containerId)
 
     subprocessPids.erase(containerId);
   }
+
+  vector<PendingFetch> fetches;
+
+  foreach (const PendingFetch& fetch, pendingFetches) {
+    if (fetch.containerId == containerId) {
+      fetches.push_back(fetch);
+    }
+  }
+
+  foreach (const PendingFetch& fetch, runningFetches) {
+    if (fetch.containerId == containerId) {
+      fetches.push_back(fetch);
+    }
+  }
+
+  if (!fetches.empty()) {
+    VLOG(1) << "Cancelling " << fetches.size() << " in-process fetches "
+            << "for container '" << containerId << "'";
+  }
+
+  foreach (const PendingFetch& fetch, fetches) {
+    cancel(fetch);
+  }
 }
 
 
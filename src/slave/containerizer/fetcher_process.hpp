@@ -17,6 +17,8 @@
 #ifndef __SLAVE_CONTAINERIZER_FETCHER_PROCESS_HPP__
 #define __SLAVE_CONTAINERIZER_FETCHER_PROCESS_HPP__
 
+#include <atomic>
+#include <deque>
 #include <list>
 #include <memory>
 #include <string>
@@ -25,15 +27,22 @@
 #include <mesos/type_utils.hpp>
 
 #include <process/future.hpp>
+#include <process/owned.hpp>
 #include <process/process.hpp>
+#include <process/shared.hpp>
 
 #include <process/metrics/counter.hpp>
 #include <process/metrics/pull_gauge.hpp>
 
 #include <stout/hashmap.hpp>
+#include <stout/lambda.hpp>
+
+#include <stout/os/int_fd.hpp>
 
 #include "slave/flags.hpp"
 
+#include "slave/containerizer/mesos/provisioner/blob_store.hpp"
+
 namespace mesos {
 namespace internal {
 namespace slave {
@@ -51,7 +60,9 @@ public:
       const Option<std::string>& user);
 
   // Runs the mesos-fetcher, creating a "stdout" and "stderr" file
-  // in the given directory, using these for trace output.
+  // in the given directory, using these for trace output. The URIs
+  // are fetched within the agent instead if `--fetcher_threads` is
+  // set and no other user has to be switched to for them.
   virtual process::Future<Nothing> run(
       const ContainerID& containerId,
       const std::string& sandboxDirectory,
@@ -59,7 +70,8 @@ public:
       const mesos::fetcher::FetcherInfo& info);
 
   // Best effort attempt to kill the external mesos-fetcher process
-  // running on behalf of the given container ID, if any.
+  // running on behalf of the given container ID, if any, and to cancel
+  // the URIs being fetched for it within the agent.
   void kill(const ContainerID& containerId);
 
   // Representation of the fetcher cache and its contents. There is
@@ -242,6 +254,48 @@ private:
       const std::string& cacheDirectory,
       const Option<std::string>& user);
 
+  // Fetches the URIs in the agent on the pool of `--fetcher_threads`,
+  // all of them in parallel, and logs the results to the given 'stderr'
+  // file of the sandbox like the mesos-fetcher would. Cache entries are
+  // completed as soon as they are downloaded, so that other containers
+  // waiting for them do not have to wait for the remaining URIs.
+  process::Future<Nothing> fetchInProcess(
+      const ContainerID& containerId,
+      const Option<std::string>& user,
+      const mesos::fetcher::FetcherInfo& info,
+      int_fd err);
+
+  // Runs the given fetch on a dedicated thread once fewer than
+  // `--fetcher_threads` fetches are running, and returns its result.
+  // Discarding the result cancels the fetch.
+  process::Future<std::string> schedule(
+      const ContainerID& containerId,
+      const lambda::function<Try<std::string>(const std::atomic_bool*)>&
+        fetch);
+
+  // Starts the queued fetches while fewer than `--fetcher_threads`
+  // fetches are running.
+  void dequeue();
+
+  struct PendingFetch;
+
+  // Discards the result of a queued or running fetch. A running fetch
+  // is told to abort, but keeps its thread until it returns.
+  void cancel(const PendingFetch& fetch);
+
+  // Materializes the content of a new entry from the blob store if it
+  // has been added to it under the same key before, e.g., before the
+  // entry was evicted. Returns the size of the restored file, or None
+  // if the entry has to be downloaded.
+  process::Future<Option<Bytes>> restore(
+      const std::shared_ptr<Cache::Entry>& entry);
+
+  // Adds the file of a completed entry to the blob store, keyed by its
+  // SHA 256 digest. The file stays referenced by the entry until the
+  // entry is evicted, and only counts against the capacity of the blob
+  // store from then on.
+  void store(const std::shared_ptr<Cache::Entry>& entry);
+
   // Calls Cache::reserve() and returns a ready entry future if successful,
   // else Failure. Claims the space and assigns the entry's size to this
   // amount if and only if successful.
@@ -269,7 +323,30 @@ private:
 
   Cache cache;
 
+  Option<process::Shared<BlobStore>> blobStore;
+
+  // Maps the keys of the cache entries which have been added to the
+  // blob store to the digests of their content.
+  hashmap<std::string, std::string> digests;
+
   hashmap<ContainerID, pid_t> subprocessPids;
+
+  struct PendingFetch
+  {
+    ContainerID containerId;
+    lambda::function<Try<std::string>(const std::atomic_bool*)> fetch;
+    process::Owned<process::Promise<std::string>> promise;
+
+    // Shared with the thread running the fetch, which aborts once this
+    // is set.
+    std::shared_ptr<std::atomic_bool> cancelled;
+  };
+
+  // Fetches waiting for a thread of the in-process fetcher.
+  std::deque<PendingFetch> pendingFetches;
+
+  // Fetches running on a thread of the in-process fetcher.
+  std::list<PendingFetch> runningFetches;
 };
 
 
@@ -0,0 +1,61 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __SLAVE_CONTAINERIZER_FETCHER_UTILS_HPP__
+#define __SLAVE_CONTAINERIZER_FETCHER_UTILS_HPP__
+
+#include <atomic>
+#include <string>
+
+#include <mesos/fetcher/fetcher.hpp>
+
+#include <stout/duration.hpp>
+#include <stout/nothing.hpp>
+#include <stout/option.hpp>
+#include <stout/try.hpp>
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+// Checks to see if it's necessary to create a fetcher cache directory
+// for the user of the `FetcherInfo`, and creates it if so.
+Try<Nothing> createFetcherCacheDirectory(
+    const mesos::fetcher::FetcherInfo& fetcherInfo);
+
+
+// Fetches a single item of a `FetcherInfo` into the sandbox directory,
+// either directly or through the cache as selected by its action, and
+// extracts or chmods the result as requested by its URI. This is used
+// by both the `mesos-fetcher` program and the agent's in-process
+// fetcher, and blocks the calling thread. Returns the resulting file
+// or in case of extraction the destination directory (for logging).
+// Setting `cancelled`, if given, aborts downloads over the network and
+// makes the fetch fail before its next step.
+Try<std::string> fetchItem(
+    const mesos::fetcher::FetcherInfo::Item& item,
+    const Option<std::string>& cacheDirectory,
+    const std::string& sandboxDirectory,
+    const Option<std::string>& frameworksHome,
+    const Option<Duration>& stallTimeout,
+    const Option<std::string>& hadoopHome = None(),
+    const std::atomic_bool* cancelled = nullptr);
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __SLAVE_CONTAINERIZER_FETCHER_UTILS_HPP__
@@ -456,6 +456,7 @@ Try<MesosContainerizer*> MesosContainerizer::create(
     {"cgroups/devices", cgroupsIsolatorSelector},
     {"cgroups/hugetlb", cgroupsIsolatorSelector},
     {"cgroups/mem", cgroupsIsolatorSelector},
+    {"cgroups/net", cgroupsIsolatorSelector},
     {"cgroups/net_cls", cgroupsIsolatorSelector},
     {"cgroups/net_prio", cgroupsIsolatorSelector},
     {"cgroups/perf_event", cgroupsIsolatorSelector},
@@ -2756,6 +2757,10 @@ Future<Option<ContainerTermination>> MesosContainerizerProcess::destroy(
 
   transition(containerId, DESTROYING);
 
+  // Time the destroy until the container has terminated, including the
+  // destroys of its nested containers.
+  metrics.container_destroy.time(container->termination.future());
+
   vector<Future<Option<ContainerTermination>>> destroys;
   foreach (const ContainerID& child, container->children) {
     destroys.push_back(destroy(child, termination));
@@ -3385,21 +3390,33 @@ ContainerClass MesosContainerizerProcess::Container::containerClass()
 
 MesosContainerizerProcess::Metrics::Metrics()
   : container_destroy_errors(
-        "containerizer/mesos/container_destroy_errors")
+        "containerizer/mesos/container_destroy_errors"),
+    container_destroy(
+        "containerizer/mesos/container_destroy", Hours(1)),
+    isolators_cleanup(
+        "containerizer/mesos/isolators_cleanup", Hours(1))
 {
   process::metrics::add(container_destroy_errors);
+  process::metrics::add(container_destroy);
+  process::metrics::add(isolators_cleanup);
 }
 
 
 MesosContainerizerProcess::Metrics::~Metrics()
 {
   process::metrics::remove(container_destroy_errors);
+  process::metrics::remove(container_destroy);
+  process::metrics::remove(isolators_cleanup);
 }
 
 
 Future<vector<Future<Nothing>>> MesosContainerizerProcess::cleanupIsolators(
     const ContainerID& containerId)
 {
+  // Isolators whose cleanup does not depend on other isolators are
+  // cleaned up right away, concurrently with all other isolators.
+  vector<Future<Nothing>> concurrent;
+
   Future<vector<Future<Nothing>>> f = vector<Future<Nothing>>();
 
   // NOTE: We clean up each isolator in the reverse order they were
@@ -3412,6 +3429,11 @@ Future<vector<Future<Nothing>>> MesosContainerizerProcess::cleanupIsolators(
       continue;
     }
 
+    if (isolator->supportsConcurrentCleanup()) {
+      concurrent.push_back(isolator->cleanup(containerId));
+      continue;
+    }
+
     // We'll try to clean up all isolators, waiting for each to
     // complete and continuing if one fails.
     // TODO(jieyu): Technically, we cannot bind 'isolator' here
@@ -3431,7 +3453,18 @@ Future<vector<Future<Nothing>>> MesosContainerizerProcess::cleanupIsolators(
     });
   }
 
-  return f;
+  // Wait for the concurrent cleanups as well before returning the
+  // list, again without propagating any failure.
+  f = f.then([concurrent](vector<Future<Nothing>> cleanups) {
+    cleanups.insert(cleanups.end(), concurrent.begin(), concurrent.end());
+
+    return await(concurrent)
+      .then([cleanups]() -> Future<vector<Future<Nothing>>> {
+        return cleanups;
+      });
+  });
+
+  return metrics.isolators_cleanup.time(f);
 }
 
 
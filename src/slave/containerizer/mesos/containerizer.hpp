@@ -31,6 +31,7 @@
 #include <process/time.hpp>
 
 #include <process/metrics/counter.hpp>
+#include <process/metrics/timer.hpp>
 
 #include <stout/hashmap.hpp>
 #include <stout/multihashmap.hpp>
@@ -463,6 +464,8 @@ private:
     ~Metrics();
 
     process::metrics::Counter container_destroy_errors;
+    process::metrics::Timer<Milliseconds> container_destroy;
+    process::metrics::Timer<Milliseconds> isolators_cleanup;
   } metrics;
 };
 
@@ -43,6 +43,7 @@ public:
 
   bool supportsNesting() override;
   bool supportsStandalone() override;
+  bool supportsConcurrentCleanup() override;
 
   process::Future<Nothing> recover(
       const std::vector<mesos::slave::ContainerState>& states,
@@ -94,6 +95,11 @@ public:
     return false;
   }
 
+  virtual bool supportsConcurrentCleanup()
+  {
+    return false;
+  }
+
   virtual process::Future<Nothing> recover(
       const std::vector<mesos::slave::ContainerState>& states,
       const hashset<ContainerID>& orphans)
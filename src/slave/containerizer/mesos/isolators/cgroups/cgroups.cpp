@@ -15,12 +15,17 @@
 // limitations under the License.
 
 #include <set>
+#include <utility>
 #include <vector>
 
+#include <process/after.hpp>
+#include <process/clock.hpp>
 #include <process/collect.hpp>
 #include <process/defer.hpp>
 #include <process/id.hpp>
+#include <process/loop.hpp>
 #include <process/pid.hpp>
+#include <process/time.hpp>
 
 #include <stout/error.hpp>
 #include <stout/foreach.hpp>
@@ -52,11 +57,16 @@ using mesos::slave::ContainerMountInfo;
 using mesos::slave::ContainerState;
 using mesos::slave::Isolator;
 
+using process::Clock;
+using process::Continue;
+using process::ControlFlow;
 using process::Failure;
 using process::Future;
 using process::Owned;
 using process::PID;
+using process::Time;
 
+using std::pair;
 using std::set;
 using std::string;
 using std::vector;
@@ -199,6 +209,12 @@ bool CgroupsIsolatorProcess::supportsStandalone()
 }
 
 
+bool CgroupsIsolatorProcess::supportsConcurrentCleanup()
+{
+  return true;
+}
+
+
 Future<Nothing> CgroupsIsolatorProcess::recover(
     const vector<ContainerState>& states,
     const hashset<ContainerID>& orphans)
@@ -905,6 +921,28 @@ Future<Nothing> CgroupsIsolatorProcess::_update(
 }
 
 
+void CgroupsIsolatorProcess::initialize()
+{
+  if (flags.cgroups_usage_sampling_interval.isNone()) {
+    return;
+  }
+
+  const Duration interval = flags.cgroups_usage_sampling_interval.get();
+
+  // Start a loop to periodically sample the resource statistics of all
+  // containers, which `usage()` serves while they are recent enough.
+  process::loop(
+      PID<CgroupsIsolatorProcess>(this),
+      [=]() {
+        return process::after(interval);
+      },
+      [=](const Nothing&) {
+        return sample()
+          .then([]() -> ControlFlow<Nothing> { return Continue(); });
+      });
+}
+
+
 Future<ResourceStatistics> CgroupsIsolatorProcess::usage(
     const ContainerID& containerId)
 {
@@ -912,6 +950,24 @@ Future<ResourceStatistics> CgroupsIsolatorProcess::usage(
     return Failure("Unknown container");
   }
 
+  // Serve the latest sample, if it is recent enough.
+  const Option<pair<Time, ResourceStatistics>>& usage =
+    infos[containerId]->usage;
+
+  if (usage.isSome() &&
+      Clock::now() - usage->first <= flags.cgroups_usage_max_staleness) {
+    return usage->second;
+  }
+
+  return _usage(containerId);
+}
+
+
+Future<ResourceStatistics> CgroupsIsolatorProcess::_usage(
+    const ContainerID& containerId)
+{
+  CHECK(infos.contains(containerId));
+
   vector<Future<ResourceStatistics>> usages;
   foreachvalue (const Owned<Subsystem>& subsystem, subsystems) {
     if (infos[containerId]->subsystems.contains(subsystem->name())) {
@@ -941,6 +997,40 @@ Future<ResourceStatistics> CgroupsIsolatorProcess::usage(
 }
 
 
+Future<Nothing> CgroupsIsolatorProcess::sample()
+{
+  const Time time = Clock::now();
+
+  vector<ContainerID> containerIds;
+  vector<Future<ResourceStatistics>> usages;
+
+  foreachkey (const ContainerID& containerId, infos) {
+    containerIds.push_back(containerId);
+    usages.push_back(_usage(containerId));
+  }
+
+  return await(usages)
+    .then(defer(
+        PID<CgroupsIsolatorProcess>(this),
+        [=](const vector<Future<ResourceStatistics>>& _usages) {
+          for (size_t i = 0; i < containerIds.size(); i++) {
+            // The container might have been cleaned up meanwhile.
+            if (infos.contains(containerIds[i]) && _usages[i].isReady()) {
+              // The sample is stamped with the time it was taken, which
+              // the containerizer keeps when it is served later on, so
+              // that the rates computed from it remain correct.
+              ResourceStatistics usage = _usages[i].get();
+              usage.set_timestamp(time.secs());
+
+              infos[containerIds[i]]->usage = std::make_pair(time, usage);
+            }
+          }
+
+          return Nothing();
+        }));
+}
+
+
 Future<ContainerStatus> CgroupsIsolatorProcess::status(
     const ContainerID& containerId)
 {
@@ -18,11 +18,13 @@
 #define __CGROUPS_ISOLATOR_HPP__
 
 #include <string>
+#include <utility>
 
 #include <mesos/resources.hpp>
 
 #include <process/future.hpp>
 #include <process/owned.hpp>
+#include <process/time.hpp>
 
 #include <stout/hashmap.hpp>
 #include <stout/hashset.hpp>
@@ -52,6 +54,7 @@ public:
 
   bool supportsNesting() override;
   bool supportsStandalone() override;
+  bool supportsConcurrentCleanup() override;
 
   process::Future<Nothing> recover(
       const std::vector<mesos::slave::ContainerState>& states,
@@ -83,6 +86,9 @@ public:
   process::Future<Nothing> cleanup(
       const ContainerID& containerId) override;
 
+protected:
+  void initialize() override;
+
 private:
   struct Info
   {
@@ -99,6 +105,10 @@ private:
     // This `hashset` stores the name of subsystems which are recovered
     // or prepared for the container.
     hashset<std::string> subsystems;
+
+    // The latest resource statistics of the container collected by
+    // the usage sampler, along with the time the sampling started.
+    Option<std::pair<process::Time, ResourceStatistics>> usage;
   };
 
   CgroupsIsolatorProcess(
@@ -143,6 +153,13 @@ private:
   process::Future<Nothing> _update(
       const std::vector<process::Future<Nothing>>& futures);
 
+  // Collects the resource statistics of all containers at once, see
+  // `--cgroups_usage_sampling_interval`.
+  process::Future<Nothing> sample();
+
+  process::Future<ResourceStatistics> _usage(
+      const ContainerID& containerId);
+
   process::Future<Nothing> _cleanup(
       const ContainerID& containerId,
       const std::vector<process::Future<Nothing>>& futures);
@@ -51,7 +51,8 @@ Try<Owned<SubsystemProcess>> PerfEventSubsystemProcess::create(
         new PerfEventSubsystemProcess(flags, hierarchy, set<string>{}));
   }
 
-  if (!perf::supported()) {
+  // The native sampler does not need the perf binary.
+  if (!flags.perf_native && !perf::supported()) {
     return Error("Perf is not supported");
   }
 
@@ -67,7 +68,8 @@ Try<Owned<SubsystemProcess>> PerfEventSubsystemProcess::create(
     events.insert(event);
   }
 
-  if (!perf::valid(events)) {
+  if (!(flags.perf_native ? perf::native::valid(events)
+                          : perf::valid(events))) {
     return Error("Invalid perf events: " + stringify(events));
   }
 
@@ -178,7 +180,11 @@ void PerfEventSubsystemProcess::sample()
   Duration timeout = flags.perf_duration + process::MAX_REAP_INTERVAL() * 2;
   Duration duration = flags.perf_duration;
 
-  perf::sample(events, cgroups, flags.perf_duration)
+  Future<hashmap<string, PerfStatistics>> statistics = flags.perf_native
+    ? perf::native::sample(events, hierarchy, cgroups, duration)
+    : perf::sample(events, cgroups, duration);
+
+  statistics
     .after(timeout, [=](Future<hashmap<string, PerfStatistics>> future) {
       LOG(ERROR) << "Perf sample of " << stringify(duration)
                  << " failed to complete within " << stringify(timeout)
@@ -27,15 +27,22 @@
 #include "slave/containerizer/mesos/isolators/cgroups2/controllers/hugetlb.hpp"
 #include "slave/containerizer/mesos/isolators/cgroups2/controllers/cpuset.hpp"
 #include "slave/containerizer/mesos/isolators/cgroups2/controllers/pids.hpp"
+#include "slave/containerizer/mesos/isolators/cgroups2/controllers/net.hpp"
 
+#include <algorithm>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include <process/after.hpp>
+#include <process/clock.hpp>
 #include <process/collect.hpp>
 #include <process/defer.hpp>
 #include <process/id.hpp>
+#include <process/loop.hpp>
 #include <process/pid.hpp>
+#include <process/time.hpp>
 
 #include <stout/foreach.hpp>
 #include <stout/os.hpp>
@@ -53,11 +60,16 @@ using mesos::slave::ContainerLimitation;
 using mesos::slave::ContainerState;
 using mesos::slave::Isolator;
 
+using process::Clock;
+using process::Continue;
+using process::ControlFlow;
 using process::Failure;
 using process::Future;
 using process::Owned;
 using process::PID;
+using process::Time;
 
+using std::pair;
 using std::set;
 using std::string;
 using std::vector;
@@ -93,7 +105,8 @@ Try<Isolator*> Cgroups2IsolatorProcess::create(
     {"io", &IoControllerProcess::create},
     {"hugetlb", &HugetlbControllerProcess::create},
     {"cpuset", &CpusetControllerProcess::create},
-    {"pids", &PidsControllerProcess::create}
+    {"pids", &PidsControllerProcess::create},
+    {"net", &NetControllerProcess::create}
   };
 
   hashmap<string, Try<Owned<ControllerProcess>>(*)(
@@ -110,7 +123,17 @@ Try<Isolator*> Cgroups2IsolatorProcess::create(
   set<string> controllersToCreate = { "core" };
 
   if (strings::contains(flags.isolation, "cgroups/all")) {
+    const vector<string> isolators = strings::tokenize(flags.isolation, ",");
+
     foreachkey (const string& creator, creators) {
+      // The "net" controller attaches eBPF programs to every container
+      // cgroup, hence it is only enabled when it is asked for explicitly.
+      if (creator == "net" &&
+          std::find(isolators.begin(), isolators.end(), "cgroups/net") ==
+            isolators.end()) {
+        continue;
+      }
+
       controllersToCreate.insert(creator);
     }
     foreachkey (const string& creator, creatorsWithDeviceManager) {
@@ -172,6 +195,12 @@ bool Cgroups2IsolatorProcess::supportsStandalone()
 }
 
 
+bool Cgroups2IsolatorProcess::supportsConcurrentCleanup()
+{
+  return true;
+}
+
+
 Future<Option<ContainerLaunchInfo>> Cgroups2IsolatorProcess::prepare(
     const ContainerID& containerId,
     const ContainerConfig& containerConfig)
@@ -238,10 +267,10 @@ Future<Option<ContainerLaunchInfo>> Cgroups2IsolatorProcess::prepare(
   CHECK(containerConfig.container_class() != ContainerClass::DEBUG);
 
   vector<Future<Nothing>> prepares;
-  hashset<string> skip_enable = {"core", "perf_event", "devices"};
+  hashset<string> skip_enable = {"core", "perf_event", "devices", "net"};
   foreachvalue (const Owned<Controller>& controller, controllers) {
-    // The "core", "perf_event" and "devices" controllers do not exist in
-    // cgroup.controllers file, and therefore we cannot call
+    // The "core", "perf_event", "devices" and "net" controllers do not exist
+    // in cgroup.controllers file, and therefore we cannot call
     // cgroups2::controllers::enable with it as it cannot be written into
     // cgroup.subtree_control, but we still need to push it into the controllers
     // of the containers, so we will only skip the call for
@@ -620,7 +649,10 @@ Future<Nothing> Cgroups2IsolatorProcess::___recover(
   vector<Future<Nothing>> recovers;
   hashset<string> recoveredControllers;
   foreachvalue (const Owned<Controller>& controller, controllers) {
-    if (enabled->count(controller->name()) == 0) {
+    // The "net" controller is implemented with eBPF programs, which are
+    // attached to the cgroup, and therefore never shows up as enabled.
+    if (controller->name() != CGROUPS2_CONTROLLER_NET_NAME &&
+        enabled->count(controller->name()) == 0) {
       // Controller is expected to be enabled but isn't.
       LOG(WARNING) << "Controller '" << controller->name() << "' is not enabled"
                    << " for container '" << stringify(containerId) << "'";
@@ -832,6 +864,28 @@ Future<Nothing> Cgroups2IsolatorProcess::_update(
 }
 
 
+void Cgroups2IsolatorProcess::initialize()
+{
+  if (flags.cgroups_usage_sampling_interval.isNone()) {
+    return;
+  }
+
+  const Duration interval = flags.cgroups_usage_sampling_interval.get();
+
+  // Start a loop to periodically sample the resource statistics of all
+  // containers, which `usage()` serves while they are recent enough.
+  process::loop(
+      PID<Cgroups2IsolatorProcess>(this),
+      [=]() {
+        return process::after(interval);
+      },
+      [=](const Nothing&) {
+        return sample()
+          .then([]() -> ControlFlow<Nothing> { return Continue(); });
+      });
+}
+
+
 Future<ResourceStatistics> Cgroups2IsolatorProcess::usage(
     const ContainerID& containerId)
 {
@@ -839,6 +893,24 @@ Future<ResourceStatistics> Cgroups2IsolatorProcess::usage(
     return Failure("Unknown container");
   }
 
+  // Serve the latest sample, if it is recent enough.
+  const Option<pair<Time, ResourceStatistics>>& usage =
+    infos[containerId]->usage;
+
+  if (usage.isSome() &&
+      Clock::now() - usage->first <= flags.cgroups_usage_max_staleness) {
+    return usage->second;
+  }
+
+  return _usage(containerId);
+}
+
+
+Future<ResourceStatistics> Cgroups2IsolatorProcess::_usage(
+    const ContainerID& containerId)
+{
+  CHECK(infos.contains(containerId));
+
   vector<Future<ResourceStatistics>> usages;
   foreachvalue (const Owned<Controller>& controller, controllers) {
     if (infos[containerId]->controllers.contains(controller->name())) {
@@ -868,6 +940,40 @@ Future<ResourceStatistics> Cgroups2IsolatorProcess::usage(
 }
 
 
+Future<Nothing> Cgroups2IsolatorProcess::sample()
+{
+  const Time time = Clock::now();
+
+  vector<ContainerID> containerIds;
+  vector<Future<ResourceStatistics>> usages;
+
+  foreachkey (const ContainerID& containerId, infos) {
+    containerIds.push_back(containerId);
+    usages.push_back(_usage(containerId));
+  }
+
+  return await(usages)
+    .then(defer(
+        PID<Cgroups2IsolatorProcess>(this),
+        [=](const vector<Future<ResourceStatistics>>& _usages) {
+          for (size_t i = 0; i < containerIds.size(); i++) {
+            // The container might have been cleaned up meanwhile.
+            if (infos.contains(containerIds[i]) && _usages[i].isReady()) {
+              // The sample is stamped with the time it was taken, which
+              // the containerizer keeps when it is served later on, so
+              // that the rates computed from it remain correct.
+              ResourceStatistics usage = _usages[i].get();
+              usage.set_timestamp(time.secs());
+
+              infos[containerIds[i]]->usage = std::make_pair(time, usage);
+            }
+          }
+
+          return Nothing();
+        }));
+}
+
+
 Future<ContainerStatus> Cgroups2IsolatorProcess::status(
     const ContainerID& containerId)
 {
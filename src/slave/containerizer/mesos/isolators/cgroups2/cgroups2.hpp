@@ -18,10 +18,12 @@
 #define __CGROUPS_V2_ISOLATOR_HPP__
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <process/future.hpp>
 #include <process/owned.hpp>
+#include <process/time.hpp>
 
 #include <stout/nothing.hpp>
 #include <stout/hashmap.hpp>
@@ -68,6 +70,8 @@ public:
 
   bool supportsStandalone() override;
 
+  bool supportsConcurrentCleanup() override;
+
   process::Future<Option<mesos::slave::ContainerLaunchInfo>> prepare(
       const ContainerID& containerId,
       const mesos::slave::ContainerConfig& containerConfig) override;
@@ -96,6 +100,10 @@ public:
       const ContainerID& containerId) override;
 
   process::Future<Nothing> cleanup(const ContainerID& containerId) override;
+
+protected:
+  void initialize() override;
+
 private:
   struct Info
   {
@@ -126,6 +134,10 @@ private:
     //
     // This field is derived from LinuxInfo::share_cgroups.
     const bool isolate;
+
+    // The latest resource statistics of the container collected by
+    // the usage sampler, along with the time the sampling started.
+    Option<std::pair<process::Time, ResourceStatistics>> usage;
   };
 
   Cgroups2IsolatorProcess(
@@ -171,6 +183,13 @@ private:
   process::Future<Nothing> _update(
       const std::vector<process::Future<Nothing>>& futures);
 
+  // Collects the resource statistics of all containers at once, see
+  // `--cgroups_usage_sampling_interval`.
+  process::Future<Nothing> sample();
+
+  process::Future<ResourceStatistics> _usage(
+      const ContainerID& containerId);
+
   process::Future<Nothing> _cleanup(
       const ContainerID& containerId,
       const std::vector<process::Future<Nothing>>& futures);
@@ -44,6 +44,7 @@ const std::string CGROUPS2_CONTROLLER_IO_NAME = "io";
 const std::string CGROUPS2_CONTROLLER_HUGETLB_NAME = "hugetlb";
 const std::string CGROUPS2_CONTROLLER_CPUSET_NAME = "cpuset";
 const std::string CGROUPS2_CONTROLLER_PIDS_NAME = "pids";
+const std::string CGROUPS2_CONTROLLER_NET_NAME = "net";
 
 } // namespace slave {
 } // namespace internal {
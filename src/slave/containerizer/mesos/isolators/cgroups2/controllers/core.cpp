@@ -36,15 +36,38 @@ namespace mesos {
 namespace internal {
 namespace slave {
 
+// Converts the pressure stall information of a resource into its protobuf.
+static PressureStatistics protobuf(const cgroups2::pressure::Stats& stats)
+{
+  auto convert = [](const cgroups2::pressure::Stats::Stall& stall) {
+    PressureStatistics::Stall result;
+    result.set_avg10(stall.avg10);
+    result.set_avg60(stall.avg60);
+    result.set_avg300(stall.avg300);
+    result.set_total_secs(stall.total.secs());
+    return result;
+  };
+
+  PressureStatistics result;
+  *result.mutable_some() = convert(stats.some);
+  *result.mutable_full() = convert(stats.full);
+  return result;
+}
+
+
 Try<Owned<ControllerProcess>> CoreControllerProcess::create(const Flags& flags)
 {
-  return Owned<ControllerProcess>(new CoreControllerProcess(flags));
+  return Owned<ControllerProcess>(
+      new CoreControllerProcess(flags, cgroups2::pressure::supported()));
 }
 
 
-CoreControllerProcess::CoreControllerProcess(const Flags& _flags)
+CoreControllerProcess::CoreControllerProcess(
+    const Flags& _flags,
+    bool _pressure)
   : ProcessBase(process::ID::generate("cgroups-v2-core-controller")),
-    ControllerProcess(_flags) {}
+    ControllerProcess(_flags),
+    pressure(_pressure) {}
 
 
 string CoreControllerProcess::name() const
@@ -82,6 +105,32 @@ process::Future<ResourceStatistics> CoreControllerProcess::usage(
     stats.set_threads(tids->size());
   }
 
+  if (pressure) {
+    using cgroups2::pressure::Resource;
+
+    Try<cgroups2::pressure::Stats> cpu =
+      cgroups2::pressure::stats(cgroup, Resource::CPU);
+    if (cpu.isError()) {
+      return Failure("Failed to get cpu pressure: " + cpu.error());
+    }
+
+    Try<cgroups2::pressure::Stats> memory =
+      cgroups2::pressure::stats(cgroup, Resource::MEMORY);
+    if (memory.isError()) {
+      return Failure("Failed to get memory pressure: " + memory.error());
+    }
+
+    Try<cgroups2::pressure::Stats> io =
+      cgroups2::pressure::stats(cgroup, Resource::IO);
+    if (io.isError()) {
+      return Failure("Failed to get io pressure: " + io.error());
+    }
+
+    *stats.mutable_cpu_pressure() = protobuf(*cpu);
+    *stats.mutable_mem_pressure() = protobuf(*memory);
+    *stats.mutable_io_pressure() = protobuf(*io);
+  }
+
   return stats;
 }
 
@@ -29,7 +29,7 @@ namespace internal {
 namespace slave {
 
 // Controller to interface with the cgroups core control files. That is,
-// control files "cgroup.*", which exist in all cgroups.
+// control files "cgroup.*" and "*.pressure", which exist in all cgroups.
 class CoreControllerProcess : public ControllerProcess
 {
 public:
@@ -45,7 +45,10 @@ public:
       const std::string& cgroup) override;
 
 private:
-  CoreControllerProcess(const Flags& flags);
+  CoreControllerProcess(const Flags& flags, bool pressure);
+
+  // Whether pressure stall information is available.
+  const bool pressure;
 };
 
 } // namespace slave {
@@ -0,0 +1,167 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slave/containerizer/mesos/isolators/cgroups2/controllers/net.hpp"
+
+#include <process/id.hpp>
+
+#include <stout/foreach.hpp>
+#include <stout/os/close.hpp>
+
+#include "linux/ebpf.hpp"
+#include "slave/containerizer/mesos/isolators/cgroups2/constants.hpp"
+
+using mesos::slave::ContainerConfig;
+
+using process::Failure;
+using process::Future;
+using process::Owned;
+
+using std::string;
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+Try<Owned<ControllerProcess>> NetControllerProcess::create(const Flags& flags)
+{
+  return Owned<ControllerProcess>(new NetControllerProcess(flags));
+}
+
+
+NetControllerProcess::NetControllerProcess(const Flags& _flags)
+  : ProcessBase(process::ID::generate("cgroups-v2-net-controller")),
+    ControllerProcess(_flags) {}
+
+
+NetControllerProcess::~NetControllerProcess()
+{
+  foreachvalue (int fd, maps) {
+    os::close(fd);
+  }
+}
+
+
+string NetControllerProcess::name() const
+{
+  return CGROUPS2_CONTROLLER_NET_NAME;
+}
+
+
+Future<Nothing> NetControllerProcess::recover(
+    const ContainerID& containerId,
+    const string& cgroup)
+{
+  if (maps.contains(containerId)) {
+    return Failure(
+        "The controller '" + name() + "' has already been recovered");
+  }
+
+  // The programs outlive the agent, as they are attached to the cgroup,
+  // so we only need to find their map again.
+  Result<int> map = ebpf::cgroups2::network_counters_map(cgroup);
+  if (map.isError()) {
+    return Failure(
+        "Failed to recover the network counters of cgroup '" + cgroup + "': "
+        + map.error());
+  }
+
+  if (map.isNone()) {
+    LOG(WARNING) << "Network counters of cgroup '" << cgroup << "'"
+                 << " not found; network statistics of container "
+                 << containerId << " will not be available";
+
+    return Nothing();
+  }
+
+  maps.put(containerId, *map);
+
+  return Nothing();
+}
+
+
+Future<Nothing> NetControllerProcess::prepare(
+    const ContainerID& containerId,
+    const string& cgroup,
+    const ContainerConfig& containerConfig)
+{
+  if (maps.contains(containerId)) {
+    return Failure(
+        "The controller '" + name() + "' has already been prepared");
+  }
+
+  Try<int> map = ebpf::cgroups2::attach_network_counters(cgroup);
+  if (map.isError()) {
+    return Failure(
+        "Failed to attach the network counters to cgroup '" + cgroup + "': "
+        + map.error());
+  }
+
+  maps.put(containerId, *map);
+
+  return Nothing();
+}
+
+
+Future<ResourceStatistics> NetControllerProcess::usage(
+    const ContainerID& containerId,
+    const string& cgroup)
+{
+  if (!maps.contains(containerId)) {
+    // The counters may be missing for a recovered container.
+    return ResourceStatistics();
+  }
+
+  Try<ebpf::cgroups2::NetworkCounters> counters =
+    ebpf::cgroups2::network_counters(maps.at(containerId));
+  if (counters.isError()) {
+    return Failure(
+        "Failed to read the network counters of cgroup '" + cgroup + "': "
+        + counters.error());
+  }
+
+  ResourceStatistics stats;
+  stats.set_net_rx_packets(counters->rx_packets);
+  stats.set_net_rx_bytes(counters->rx_bytes);
+  stats.set_net_tx_packets(counters->tx_packets);
+  stats.set_net_tx_bytes(counters->tx_bytes);
+
+  return stats;
+}
+
+
+Future<Nothing> NetControllerProcess::cleanup(
+    const ContainerID& containerId,
+    const string& cgroup)
+{
+  if (!maps.contains(containerId)) {
+    VLOG(1) << "Ignoring cleanup controller '" << name() << "' "
+            << "request for unknown container " << containerId;
+
+    return Nothing();
+  }
+
+  // The programs are detached by the kernel once the cgroup is removed,
+  // which also releases the map after we close our reference to it.
+  os::close(maps.at(containerId));
+  maps.erase(containerId);
+
+  return Nothing();
+}
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
@@ -23,6 +23,7 @@
 #include <stout/duration.hpp>
 #include <stout/error.hpp>
 
+#include "linux/cgroups2.hpp"
 #include "linux/perf.hpp"
 #include "slave/containerizer/mesos/isolators/cgroups2/constants.hpp"
 
@@ -48,7 +49,8 @@ Try<process::Owned<ControllerProcess>> PerfEventControllerProcess::create(
       new PerfEventControllerProcess(flags, set<string>{}));
   }
 
-  if (!perf::supported()) {
+  // The native sampler does not need the perf binary.
+  if (!flags.perf_native && !perf::supported()) {
     return Error("Perf is not supported");
   }
 
@@ -63,7 +65,8 @@ Try<process::Owned<ControllerProcess>> PerfEventControllerProcess::create(
     events.insert(event);
   }
 
-  if (!perf::valid(events)) {
+  if (!(flags.perf_native ? perf::native::valid(events)
+                          : perf::valid(events))) {
     return Error("Invalid perf events: " + stringify(events));
   }
 
@@ -175,7 +178,11 @@ void PerfEventControllerProcess::sample()
   Duration timeout = flags.perf_duration + process::MAX_REAP_INTERVAL() * 2;
   Duration duration = flags.perf_duration;
 
-  perf::sample(events, cgroups, flags.perf_duration)
+  Future<hashmap<string, PerfStatistics>> statistics = flags.perf_native
+    ? perf::native::sample(events, cgroups2::path(""), cgroups, duration)
+    : perf::sample(events, cgroups, duration);
+
+  statistics
     .after(timeout, [=](Future<hashmap<string, PerfStatistics>> future) {
       LOG(ERROR) << "Perf sample of " << stringify(duration)
                  << " failed to complete within " << stringify(timeout)
@@ -20,12 +20,15 @@
 
 #include <sys/types.h>
 
+#include <utility>
+
 #include <process/after.hpp>
 #include <process/async.hpp>
 #include <process/defer.hpp>
 #include <process/id.hpp>
 #include <process/loop.hpp>
 
+#include <stout/hashset.hpp>
 #include <stout/lambda.hpp>
 #include <stout/numify.hpp>
 #include <stout/path.hpp>
@@ -67,18 +70,91 @@ namespace mesos {
 namespace internal {
 namespace slave {
 
+// The listening sockets attributed to containers by the previous
+// checks, which allows a check to only look for the owners of the new
+// listening sockets in the container processes.
+struct ListenerCache
+{
+  // The container owning each listening socket, keyed by inode.
+  hashmap<uint32_t, ContainerID> owners;
+
+  // The listening sockets that are not owned by any container, e.g.,
+  // those of the agent itself, keyed by inode. These are only looked
+  // for again once the processes of a container change.
+  hashset<uint32_t> foreign;
+
+  // The processes of each container as of the previous check.
+  hashmap<ContainerID, set<pid_t>> processes;
+};
+
+
+// Return the inodes of the listening sockets that are open in the
+// given processes of a container.
+static hashset<uint32_t> getContainerListeners(
+    const ContainerID& containerId,
+    const set<pid_t>& pids,
+    const hashmap<uint32_t, socket::Info>& listenInfos)
+{
+  hashset<uint32_t> inodes;
+
+  // For each process in this container, check whether any of its open
+  // sockets matches something in the listening set.
+  foreach (pid_t pid, pids) {
+    Try<vector<uint32_t>> sockets =
+      NetworkPortsIsolatorProcess::getProcessSockets(pid);
+
+    // The PID might have exited since we sampled the cgroup tasks, so
+    // don't worry too much if this fails.
+    if (sockets.isError()) {
+      VLOG(1) << "Failed to list sockets for PID "
+              << stringify(pid) << ": " << sockets.error();
+      continue;
+    }
+
+    foreach (uint32_t inode, sockets.get()) {
+      if (!listenInfos.contains(inode)) {
+        continue;
+      }
+
+      if (VLOG_IS_ON(1)) {
+        const uint16_t port = ntohs(listenInfos.at(inode).sourcePort.get());
+
+        Result<string> cmd = proc::cmdline(pid);
+        if (cmd.isSome()) {
+          VLOG(1) << "PID " << pid << " in container " << containerId
+                  << " (" << cmd.get() << ")"
+                  << " is listening on port " << port;
+        } else {
+          VLOG(1) << "PID " << pid << " in container " << containerId
+                  << " is listening on port " << port;
+        }
+      }
+
+      inodes.insert(inode);
+    }
+  }
+
+  return inodes;
+}
+
+
 // Given a cgroup hierarchy and a set of container IDs, collect
 // the ports of all the listening sockets open in each cgroup,
-// indexed by container ID.
+// indexed by container ID. If a cache is given, only the owners
+// of the listening sockets that are not in the cache are looked
+// for in the container processes.
 static hashmap<ContainerID, IntervalSet<uint16_t>>
 collectContainerListeners(
     const string& cgroupsRoot,
     const string& freezerHierarchy,
     const Option<IntervalSet<uint16_t>>& isolatedPorts,
-    const hashset<ContainerID>& containerIds)
+    const hashset<ContainerID>& containerIds,
+    const Owned<ListenerCache>& cache)
 {
   hashmap<ContainerID, IntervalSet<uint16_t>> listeners;
 
+  // NOTE: The listening sockets are filtered by the kernel based on
+  // the socket state, so only the listeners are returned.
   Try<hashmap<uint32_t, socket::Info>> listenInfos =
     NetworkPortsIsolatorProcess::getListeningSockets();
 
@@ -88,10 +164,12 @@ collectContainerListeners(
     return listeners;
   }
 
-  if (listenInfos->empty()) {
+  if (listenInfos->empty() && cache.get() == nullptr) {
     return listeners;
   }
 
+  hashmap<ContainerID, set<pid_t>> processes;
+
   foreach (const ContainerID& containerId, containerIds) {
     // Reconstruct the cgroup path from the container ID.
     string cgroup =
@@ -107,56 +185,109 @@ collectContainerListeners(
       continue;
     }
 
-    // For each process in this container, check whether any of its open
-    // sockets matches something in the listening set.
-    foreach (pid_t pid, pids.get()) {
-      Try<vector<uint32_t>> sockets =
-        NetworkPortsIsolatorProcess::getProcessSockets(pid);
-
-      // The PID might have exited since we sampled the cgroup tasks, so
-      // don't worry too much if this fails.
-      if (sockets.isError()) {
-        VLOG(1) << "Failed to list sockets for PID "
-                << stringify(pid) << ": " << sockets.error();
-        continue;
-      }
+    processes.put(containerId, pids.get());
+  }
 
-      if (sockets->empty()) {
-        continue;
-      }
+  hashmap<uint32_t, ContainerID> owners;
 
-      foreach (uint32_t inode, sockets.get()) {
-        if (!listenInfos->contains(inode)) {
-          continue;
+  if (cache.get() == nullptr) {
+    foreachpair (const ContainerID& containerId,
+                 const set<pid_t>& pids,
+                 processes) {
+      foreach (uint32_t inode,
+               getContainerListeners(containerId, pids, listenInfos.get())) {
+        // Only collect this listen socket if it falls within the
+        // isolated range.
+        const uint16_t port = ntohs(listenInfos->at(inode).sourcePort.get());
+        if (isolatedPorts.isNone() || isolatedPorts->contains(port)) {
+          listeners[containerId].add(port);
         }
+      }
+    }
 
-        const auto& socketInfo = listenInfos->at(inode);
-
-        process::network::inet::Address address(
-            socketInfo.sourceIP.get(),
-            ntohs(socketInfo.sourcePort.get()));
-
-        if (VLOG_IS_ON(1)) {
-          Result<string> cmd = proc::cmdline(pid);
-          if (cmd.isSome()) {
-            VLOG(1) << "PID " << pid << " in container " << containerId
-                    << " (" << cmd.get() << ")"
-                    << " is listening on port " << address.port;
-          } else {
-            VLOG(1) << "PID " << pid << " in container " << containerId
-                    << " is listening on port " << address.port;
-          }
-        }
+    return listeners;
+  }
 
-        // Only collect this listen socket if it falls within the
-        // isolated range.
-        if (isolatedPorts.isNone() || isolatedPorts->contains(address.port)) {
-          listeners[containerId].add(address.port);
+  // Forget the sockets that are no longer listening, or whose
+  // container is gone.
+  foreachpair (uint32_t inode, const ContainerID& containerId, cache->owners) {
+    if (listenInfos->contains(inode) && processes.contains(containerId)) {
+      owners.put(inode, containerId);
+    }
+  }
+
+  // Look for the owners of the new listening sockets in the containers
+  // whose processes changed since the previous check first, as these
+  // most likely opened them, and then in the other containers.
+  vector<ContainerID> containers;
+  vector<ContainerID> unchanged;
+
+  foreachpair (const ContainerID& containerId,
+               const set<pid_t>& pids,
+               processes) {
+    if (cache->processes.get(containerId) == pids) {
+      unchanged.push_back(containerId);
+    } else {
+      containers.push_back(containerId);
+    }
+  }
+
+  // A listening socket that is not owned by any container may be
+  // inherited by a process that joins a container later, hence the
+  // foreign listening sockets are looked for again whenever the
+  // processes of a container change.
+  const bool changed =
+    !containers.empty() || cache->processes.size() != processes.size();
+
+  containers.insert(containers.end(), unchanged.begin(), unchanged.end());
+
+  hashset<uint32_t> foreign;
+  hashset<uint32_t> unknown;
+
+  foreachkey (uint32_t inode, listenInfos.get()) {
+    if (!changed && cache->foreign.contains(inode)) {
+      foreign.insert(inode);
+    } else if (!owners.contains(inode)) {
+      unknown.insert(inode);
+    }
+  }
+
+  if (!unknown.empty()) {
+
+    foreach (const ContainerID& containerId, containers) {
+      if (unknown.empty()) {
+        break;
+      }
+
+      foreach (uint32_t inode,
+               getContainerListeners(
+                   containerId,
+                   processes.at(containerId),
+                   listenInfos.get())) {
+        if (unknown.contains(inode)) {
+          owners.put(inode, containerId);
+          unknown.erase(inode);
         }
       }
     }
+
+    // The remaining listening sockets are not owned by any container.
+    foreign.insert(unknown.begin(), unknown.end());
   }
 
+  foreachpair (uint32_t inode, const ContainerID& containerId, owners) {
+    // Only collect this listen socket if it falls within the
+    // isolated range.
+    const uint16_t port = ntohs(listenInfos->at(inode).sourcePort.get());
+    if (isolatedPorts.isNone() || isolatedPorts->contains(port)) {
+      listeners[containerId].add(port);
+    }
+  }
+
+  cache->owners = std::move(owners);
+  cache->foreign = std::move(foreign);
+  cache->processes = std::move(processes);
+
   return listeners;
 }
 
@@ -387,6 +518,7 @@ Try<Isolator*> NetworkPortsIsolatorProcess::create(const Flags& flags)
       new NetworkPortsIsolatorProcess(
           strings::contains(flags.isolation, "network/cni"),
           flags.container_ports_watch_interval,
+          flags.container_ports_watch_incremental,
           flags.enforce_container_ports,
           flags.cgroups_root,
           freezerHierarchy.get(),
@@ -397,6 +529,7 @@ Try<Isolator*> NetworkPortsIsolatorProcess::create(const Flags& flags)
 NetworkPortsIsolatorProcess::NetworkPortsIsolatorProcess(
     bool _cniIsolatorEnabled,
     const Duration& _watchInterval,
+    bool _watchIncremental,
     const bool& _enforceContainerPorts,
     const string& _cgroupsRoot,
     const string& _freezerHierarchy,
@@ -409,6 +542,9 @@ NetworkPortsIsolatorProcess::NetworkPortsIsolatorProcess(
     freezerHierarchy(_freezerHierarchy),
     isolatedPorts(_isolatedPorts)
 {
+  if (_watchIncremental) {
+    listenerCache.reset(new ListenerCache());
+  }
 }
 
 
@@ -677,7 +813,8 @@ void NetworkPortsIsolatorProcess::initialize()
             cgroupsRoot,
             freezerHierarchy,
             isolatedPorts,
-            infos.keys())
+            infos.keys(),
+            listenerCache)
           .then(defer(self, &NetworkPortsIsolatorProcess::check, lambda::_1))
           .then([]() -> ControlFlow<Nothing> { return Continue(); });
       });
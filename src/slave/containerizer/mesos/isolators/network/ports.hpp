@@ -39,6 +39,10 @@ namespace mesos {
 namespace internal {
 namespace slave {
 
+// Forward declarations.
+struct ListenerCache;
+
+
 // The `network/ports` isolator provides isolation of TCP listener
 // ports for tasks that share the host network namespace. It ensures
 // that tasks listen only on ports for which they hold `ports` resources.
@@ -87,6 +91,7 @@ private:
   NetworkPortsIsolatorProcess(
       bool _cniIsolatorEnabled,
       const Duration& _watchInterval,
+      bool _watchIncremental,
       const bool& _enforcePortsEnabled,
       const std::string& _cgroupsRoot,
       const std::string& _freezerHierarchy,
@@ -106,6 +111,10 @@ private:
   const std::string freezerHierarchy;
   const Option<IntervalSet<uint16_t>> isolatedPorts;
 
+  // The owners of the listening sockets as of the previous check, if
+  // the checks are incremental.
+  process::Owned<ListenerCache> listenerCache;
+
   hashmap<ContainerID, process::Owned<Info>> infos;
 };
 
@@ -22,6 +22,8 @@
 #include <sys/types.h>
 
 #include <deque>
+#include <memory>
+#include <thread>
 #include <tuple>
 
 #include <glog/logging.h>
@@ -53,6 +55,7 @@
 namespace io = process::io;
 
 using std::deque;
+using std::shared_ptr;
 using std::string;
 using std::vector;
 
@@ -97,10 +100,25 @@ PosixDiskIsolatorProcess::Info::PathInfo::~PathInfo()
 }
 
 
+// Returns the options of the in-process disk usage walker, if enabled.
+static Option<DiskUsageWalker::Options> walker(const Flags& flags)
+{
+  if (!flags.container_disk_native_usage) {
+    return None();
+  }
+
+  DiskUsageWalker::Options options;
+  options.threads = flags.container_disk_usage_threads;
+  options.budget = flags.container_disk_usage_budget;
+
+  return options;
+}
+
+
 PosixDiskIsolatorProcess::PosixDiskIsolatorProcess(const Flags& _flags)
   : ProcessBase(process::ID::generate("posix-disk-isolator")),
     flags(_flags),
-    collector(flags.container_disk_watch_interval) {}
+    collector(flags.container_disk_watch_interval, walker(flags)) {}
 
 
 PosixDiskIsolatorProcess::~PosixDiskIsolatorProcess() {}
@@ -118,6 +136,12 @@ bool PosixDiskIsolatorProcess::supportsStandalone()
 }
 
 
+bool PosixDiskIsolatorProcess::supportsConcurrentCleanup()
+{
+  return true;
+}
+
+
 Future<Nothing> PosixDiskIsolatorProcess::recover(
     const vector<ContainerState>& states,
     const hashset<ContainerID>& orphans)
@@ -519,9 +543,13 @@ Bytes PosixDiskIsolatorProcess::Info::ephemeralUsage() const
 class DiskUsageCollectorProcess : public Process<DiskUsageCollectorProcess>
 {
 public:
-  DiskUsageCollectorProcess(const Duration& _interval)
+  DiskUsageCollectorProcess(
+      const Duration& _interval,
+      const Option<DiskUsageWalker::Options>& _walker)
     : ProcessBase(process::ID::generate("posix-disk-usage-collector")),
-      interval(_interval) {}
+      interval(_interval),
+      walker(_walker),
+      watcher(DiskUsageWalker::createWatcher()) {}
   ~DiskUsageCollectorProcess() override {}
 
   Future<Bytes> usage(
@@ -575,14 +603,21 @@ private:
     string path;
     vector<string> excludes;
     Option<Subprocess> du;
+    Option<Future<Try<Bytes>>> walk;
     Promise<Bytes> promise;
   };
 
   void discard(const string& path)
   {
+    // The path is no longer of interest, e.g., the container has been
+    // cleaned up, so we stop watching its directories.
+    walkers.erase(path);
+
     for (auto it = entries.begin(); it != entries.end(); ++it) {
       // We only cancel those checks whose 'du' haven't been launched.
-      if ((*it)->path == path && (*it)->du.isNone()) {
+      if ((*it)->path == path &&
+          (*it)->du.isNone() &&
+          (*it)->walk.isNone()) {
         (*it)->promise.discard();
         entries.erase(it);
         break;
@@ -603,6 +638,11 @@ private:
 
     const Owned<Entry>& entry = entries.front();
 
+    if (walker.isSome()) {
+      walk(entry);
+      return;
+    }
+
     // Invoke 'du' and report number of 1K-byte blocks. We fix the
     // block size here so that we can get consistent results on all
     // platforms (e.g., OS X uses 512 byte blocks).
@@ -719,16 +759,80 @@ private:
     delay(interval, self(), &Self::schedule);
   }
 
+  // Walks the path of the entry in-process rather than invoking 'du'.
+  // The walker of a path is kept across walks so that only the changed
+  // directories are rescanned.
+  void walk(const Owned<Entry>& entry)
+  {
+    if (!walkers.contains(entry->path)) {
+      walkers.put(
+          entry->path,
+          shared_ptr<DiskUsageWalker>(
+              new DiskUsageWalker(entry->path, walker.get(), watcher)));
+    }
+
+    shared_ptr<DiskUsageWalker> _walker = walkers.at(entry->path);
+    const vector<string> excludes = entry->excludes;
+
+    shared_ptr<Promise<Try<Bytes>>> promise(new Promise<Try<Bytes>>());
+    entry->walk = promise->future();
+
+    // NOTE: The walk blocks the thread it runs on, including while it
+    // waits for the budget, hence it is run on its own thread rather
+    // than on a libprocess worker.
+    std::thread([_walker, excludes, promise]() {
+      promise->set(_walker->walk(excludes));
+    }).detach();
+
+    entry->walk->onAny(defer(self(), &Self::_walk, lambda::_1));
+  }
+
+  void _walk(const Future<Try<Bytes>>& future)
+  {
+    CHECK(!entries.empty());
+
+    const Owned<Entry>& entry = entries.front();
+    CHECK_SOME(entry->walk);
+
+    if (!future.isReady()) {
+      entry->promise.fail(
+          "Failed to walk '" + entry->path + "': " +
+          (future.isFailed() ? future.failure() : "discarded"));
+    } else if (future->isError()) {
+      // The path may have been removed, in which case there is no
+      // need to keep its walker around.
+      walkers.erase(entry->path);
+
+      entry->promise.fail(
+          "Failed to walk '" + entry->path + "': " + future->error());
+    } else {
+      entry->promise.set(future->get());
+    }
+
+    entries.pop_front();
+    delay(interval, self(), &Self::schedule);
+  }
+
   const Duration interval;
+  const Option<DiskUsageWalker::Options> walker;
+
+  // The inotify instance shared by the walkers, which do not walk
+  // concurrently since the entries are walked one at a time.
+  const shared_ptr<DiskUsageWatcher> watcher;
 
   // A queue of pending checks.
   deque<Owned<Entry>> entries;
+
+  // The in-process walkers keyed by path.
+  hashmap<string, shared_ptr<DiskUsageWalker>> walkers;
 };
 
 
-DiskUsageCollector::DiskUsageCollector(const Duration& interval)
+DiskUsageCollector::DiskUsageCollector(
+    const Duration& interval,
+    const Option<DiskUsageWalker::Options>& walker)
 {
-  process = new DiskUsageCollectorProcess(interval);
+  process = new DiskUsageCollectorProcess(interval, walker);
   spawn(process);
 }
 
@@ -25,11 +25,14 @@
 #include <stout/duration.hpp>
 #include <stout/hashmap.hpp>
 #include <stout/hashset.hpp>
+#include <stout/option.hpp>
 
 #include "slave/flags.hpp"
 
 #include "slave/containerizer/mesos/isolator.hpp"
 
+#include "slave/containerizer/mesos/isolators/posix/disk_usage.hpp"
+
 namespace mesos {
 namespace internal {
 namespace slave {
@@ -39,11 +42,15 @@ class DiskUsageCollectorProcess;
 
 
 // Responsible for collecting disk usage for paths, while ensuring
-// that an interval elapses between each collection.
+// that an interval elapses between each collection. The usage is
+// collected by running 'du' unless the options of an in-process
+// DiskUsageWalker are given.
 class DiskUsageCollector
 {
 public:
-  DiskUsageCollector(const Duration& interval);
+  DiskUsageCollector(
+      const Duration& interval,
+      const Option<DiskUsageWalker::Options>& walker = None());
   ~DiskUsageCollector();
 
   // Returns the disk usage rooted at 'path'. The user can discard the
@@ -80,6 +87,7 @@ public:
 
   bool supportsNesting() override;
   bool supportsStandalone() override;
+  bool supportsConcurrentCleanup() override;
 
   process::Future<Nothing> recover(
       const std::vector<mesos::slave::ContainerState>& states,
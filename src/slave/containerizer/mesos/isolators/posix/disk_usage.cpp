@@ -0,0 +1,756 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <stout/error.hpp>
+#include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/nothing.hpp>
+#include <stout/path.hpp>
+#include <stout/stringify.hpp>
+
+#include <stout/os/close.hpp>
+
+#include "slave/containerizer/mesos/isolators/posix/disk_usage.hpp"
+
+using std::deque;
+using std::map;
+using std::pair;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+#ifdef __linux__
+// The changes to a watched directory that require it to be rescanned.
+static const uint32_t WATCH_MASK =
+  IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+  IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+#endif
+
+
+// A directory under the walked path along with the blocks allocated to
+// its entries as of the last time it was scanned.
+struct DiskUsageNode
+{
+  string name;
+  DiskUsageNode* parent = nullptr;
+
+  // Whether the directory needs to be scanned on the next walk.
+  bool dirty = true;
+
+  // The inotify watch descriptor of the directory, if it is watched.
+  int wd = -1;
+
+  // The bytes allocated to the directory itself and to its entries
+  // that are neither directories nor hard links.
+  uint64_t bytes = 0;
+
+  // The bytes allocated to the hard linked entries keyed by device and
+  // inode, since these are counted once across the walked path.
+  map<pair<dev_t, ino_t>, uint64_t> links;
+
+  map<string, unique_ptr<DiskUsageNode>> children;
+};
+
+
+// An inotify instance along with the watched directories keyed by
+// watch descriptor, which may be shared by the trees of a number of
+// walkers. The events are read by whichever walker walks next.
+struct DiskUsageWatcher
+{
+  ~DiskUsageWatcher()
+  {
+    if (inotify >= 0) {
+      os::close(inotify);
+    }
+  }
+
+  // Initializes the inotify instance if it has not been initialized
+  // yet. A failure is only logged the first time since it is retried
+  // whenever a tree is reset.
+  bool initialize()
+  {
+#ifdef __linux__
+    if (inotify < 0) {
+      inotify = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+      if (inotify < 0) {
+        PLOG_IF(WARNING, !failed) << "Failed to initialize inotify, all "
+                                  << "directories will be rescanned on "
+                                  << "every walk";
+        failed = true;
+      }
+    }
+#endif
+
+    return inotify >= 0;
+  }
+
+  int inotify = -1;
+  bool failed = false;
+
+  // The number of times the inotify queue has overflowed, which each
+  // tree compares to the number as of its last walk to tell whether
+  // any of its changes have been lost.
+  size_t overflows = 0;
+
+  // NOTE: A directory is watched by several nodes if it is walked by
+  // several walkers, or if it has been moved within a walked path, in
+  // which case its watch descriptor is the same for all of them.
+  std::mutex mutex;
+  hashmap<int, vector<DiskUsageNode*>> watches;
+};
+
+
+// The directories of the walked path as of the last walk.
+struct DiskUsageTree
+{
+  ~DiskUsageTree();
+
+  vector<string> excludes;
+
+  // The device and inode of the walked path, which are used to detect
+  // that the path has been replaced since the last walk.
+  dev_t device = 0;
+  ino_t inode = 0;
+
+  unique_ptr<DiskUsageNode> root;
+
+  // The watcher of the directories, if they are watched, and the
+  // number of overflows of its queue as of the last walk.
+  DiskUsageWatcher* watcher = nullptr;
+  size_t overflows = 0;
+};
+
+
+// Limits the rate at which the entries are stat'ed across threads.
+class DiskUsageBudget
+{
+public:
+  explicit DiskUsageBudget(const Option<size_t>& _limit)
+    : limit(_limit),
+      start(std::chrono::steady_clock::now()) {}
+
+  void acquire()
+  {
+    if (limit.isNone()) {
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
+
+    if (now - start >= std::chrono::seconds(1)) {
+      start = now;
+      used = 0;
+    }
+
+    // NOTE: The lock is held while sleeping so that the other threads
+    // wait for the next second as well.
+    if (used >= limit.get()) {
+      std::this_thread::sleep_until(start + std::chrono::seconds(1));
+      start = std::chrono::steady_clock::now();
+      used = 0;
+    }
+
+    used++;
+  }
+
+private:
+  const Option<size_t> limit;
+
+  std::mutex mutex;
+  std::chrono::steady_clock::time_point start;
+  size_t used = 0;
+};
+
+
+// Returns the path of the directory relative to the walked path.
+static string relative(const DiskUsageNode* node)
+{
+  vector<string> names;
+  for (; node->parent != nullptr; node = node->parent) {
+    names.push_back(node->name);
+  }
+
+  if (names.empty()) {
+    return ".";
+  }
+
+  string result = names.back();
+  for (auto it = ++names.rbegin(); it != names.rend(); ++it) {
+    result = path::join(result, *it);
+  }
+
+  return result;
+}
+
+
+// Returns whether the path matches one of the patterns. Like with
+// `du --exclude`, a pattern matches any trailing path components.
+static bool excluded(const string& path, const vector<string>& excludes)
+{
+  foreach (const string& pattern, excludes) {
+    size_t position = 0;
+
+    while (true) {
+      if (::fnmatch(pattern.c_str(), path.c_str() + position, 0) == 0) {
+        return true;
+      }
+
+      position = path.find('/', position);
+      if (position == string::npos) {
+        break;
+      }
+
+      position++;
+    }
+  }
+
+  return false;
+}
+
+
+// Stops watching the directory and its subdirectories.
+static void unwatch(DiskUsageTree* tree, DiskUsageNode* node)
+{
+  foreachvalue (const unique_ptr<DiskUsageNode>& child, node->children) {
+    unwatch(tree, child.get());
+  }
+
+#ifdef __linux__
+  if (node->wd >= 0 && tree->watcher != nullptr) {
+    DiskUsageWatcher* watcher = tree->watcher;
+
+    std::lock_guard<std::mutex> lock(watcher->mutex);
+
+    if (watcher->watches.contains(node->wd)) {
+      vector<DiskUsageNode*>& nodes = watcher->watches.at(node->wd);
+      nodes.erase(
+          std::remove(nodes.begin(), nodes.end(), node),
+          nodes.end());
+
+      // The directory is only unwatched once no node watches it.
+      if (nodes.empty()) {
+        watcher->watches.erase(node->wd);
+        ::inotify_rm_watch(watcher->inotify, node->wd);
+      }
+    }
+  }
+#endif
+
+  node->wd = -1;
+}
+
+
+DiskUsageTree::~DiskUsageTree()
+{
+  // The watcher may outlive the tree, hence its watches are removed.
+  if (root.get() != nullptr) {
+    unwatch(this, root.get());
+  }
+}
+
+
+// Marks the watched directories that changed since the last walk as
+// dirty. Returns false if changes were lost, e.g., due to an overflow
+// of the inotify queue, in which case all directories must be scanned.
+static Try<bool> changes(DiskUsageTree* tree)
+{
+#ifdef __linux__
+  DiskUsageWatcher* watcher = tree->watcher;
+  CHECK_NOTNULL(watcher);
+
+  alignas(struct inotify_event) char buffer[64 * 1024];
+
+  std::lock_guard<std::mutex> lock(watcher->mutex);
+
+  while (true) {
+    ssize_t length = ::read(watcher->inotify, buffer, sizeof(buffer));
+
+    if (length < 0) {
+      if (errno == EINTR) {
+        continue;
+      } else if (errno == EAGAIN) {
+        break;
+      }
+
+      return ErrnoError("Failed to read inotify events");
+    }
+
+    for (char* p = buffer; p < buffer + length;) {
+      const struct inotify_event* event =
+        reinterpret_cast<const struct inotify_event*>(p);
+
+      // NOTE: The nodes may belong to the trees of other walkers that
+      // share the watcher, which do not walk concurrently.
+      if (event->mask & IN_Q_OVERFLOW) {
+        watcher->overflows++;
+      } else if (watcher->watches.contains(event->wd)) {
+        foreach (DiskUsageNode* node, watcher->watches.at(event->wd)) {
+          node->dirty = true;
+
+          // The watch is removed when the directory is deleted.
+          if (event->mask & IN_IGNORED) {
+            node->wd = -1;
+          }
+        }
+
+        if (event->mask & IN_IGNORED) {
+          watcher->watches.erase(event->wd);
+        }
+      }
+
+      p += sizeof(struct inotify_event) + event->len;
+    }
+  }
+
+  bool complete = tree->overflows == watcher->overflows;
+  tree->overflows = watcher->overflows;
+
+  return complete;
+#else
+  return false;
+#endif
+}
+
+
+// A single walk of the directories, which are scanned by a number of
+// threads that share a queue of the directories to walk.
+class DiskUsageWalk
+{
+public:
+  DiskUsageWalk(
+      const string& _path,
+      int _fd,
+      DiskUsageTree* _tree,
+      DiskUsageBudget* _budget)
+    : path(_path),
+      fd(_fd),
+      tree(_tree),
+      budget(_budget) {}
+
+  Try<Nothing> run(size_t threads)
+  {
+    queue.push_back(tree->root.get());
+
+    vector<std::thread> workers;
+    for (size_t i = 1; i < threads; i++) {
+      workers.emplace_back(&DiskUsageWalk::work, this);
+    }
+
+    work();
+
+    foreach (std::thread& worker, workers) {
+      worker.join();
+    }
+
+    if (error.isSome()) {
+      return error.get();
+    }
+
+    return Nothing();
+  }
+
+  // Whether the inotify watches have been exhausted during the walk.
+  std::atomic_bool exhausted{false};
+
+private:
+  void work()
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+      condition.wait(lock, [this]() {
+        return !queue.empty() || active == 0;
+      });
+
+      if (queue.empty()) {
+        break;
+      }
+
+      DiskUsageNode* node = queue.front();
+      queue.pop_front();
+      active++;
+
+      lock.unlock();
+
+      Try<Nothing> scan = node->dirty ? this->scan(node) : Nothing();
+
+      lock.lock();
+
+      if (scan.isError()) {
+        if (error.isNone()) {
+          error = Error(scan.error());
+        }
+
+        queue.clear();
+      } else if (error.isNone()) {
+        foreachvalue (const unique_ptr<DiskUsageNode>& child,
+                      node->children) {
+          queue.push_back(child.get());
+        }
+      }
+
+      active--;
+      condition.notify_all();
+    }
+
+    condition.notify_all();
+  }
+
+  // Returns the path of a directory or entry under the walked path.
+  string absolute(const string& relative) const
+  {
+    return relative == "." ? path : path::join(path, relative);
+  }
+
+  // Opens the directory one path component at a time relative to its
+  // parent, since `O_NOFOLLOW` only applies to the last component of a
+  // path and any directory on the way may have been replaced by a
+  // symbolic link since it was scanned.
+  int open(const DiskUsageNode* node) const
+  {
+    if (node->parent == nullptr) {
+      return ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    }
+
+    int parent = open(node->parent);
+    if (parent < 0) {
+      return -1;
+    }
+
+    int result = ::openat(
+        parent,
+        node->name.c_str(),
+        O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+
+    // Preserve the errno of `openat` for the caller.
+    int error = errno;
+    os::close(parent);
+    errno = error;
+
+    return result;
+  }
+
+  // Scans the entries of the directory.
+  Try<Nothing> scan(DiskUsageNode* node)
+  {
+    const string directory = relative(node);
+
+    int dfd = open(node);
+
+    if (dfd < 0) {
+      // The directory has been removed or replaced concurrently, which
+      // its parent will notice when it is scanned on the next walk.
+      if (errno == ENOENT || errno == ENOTDIR || errno == ELOOP) {
+        unwatch(tree, node);
+        node->bytes = 0;
+        node->links.clear();
+        node->children.clear();
+        return Nothing();
+      }
+
+      return ErrnoError("Failed to open '" + absolute(directory) + "'");
+    }
+
+    // Whether changes to the directory will be noticed on the next walk,
+    // otherwise it has to be scanned again.
+    bool watched = false;
+
+#ifdef __linux__
+    // NOTE: The directory is watched before it is read so that no
+    // change is missed. It is watched through its file descriptor so
+    // that the watched directory is the one that is read.
+    if (tree->watcher != nullptr && !exhausted) {
+      DiskUsageWatcher* watcher = tree->watcher;
+
+      const string proc = path::join("/proc/self/fd", stringify(dfd));
+
+      std::lock_guard<std::mutex> lock(watcher->mutex);
+
+      int wd = ::inotify_add_watch(watcher->inotify, proc.c_str(), WATCH_MASK);
+
+      if (wd >= 0) {
+        // The directory may have been watched by this node before,
+        // e.g., if it was not unwatched after it was modified.
+        vector<DiskUsageNode*>& nodes = watcher->watches[wd];
+        if (std::find(nodes.begin(), nodes.end(), node) == nodes.end()) {
+          nodes.push_back(node);
+        }
+
+        node->wd = wd;
+        watched = true;
+      } else if (errno == ENOSPC) {
+        exhausted = true;
+      }
+    }
+#endif
+
+    DIR* dir = ::fdopendir(dfd);
+    if (dir == nullptr) {
+      ErrnoError error("Failed to open '" + absolute(directory) + "'");
+      os::close(dfd);
+      return error;
+    }
+
+    struct stat s;
+    if (::fstat(dfd, &s) < 0) {
+      ErrnoError error("Failed to stat '" + absolute(directory) + "'");
+      ::closedir(dir);
+      return error;
+    }
+
+    node->bytes = s.st_blocks * 512;
+    node->links.clear();
+
+    map<string, unique_ptr<DiskUsageNode>> children;
+
+    while (true) {
+      errno = 0;
+
+      struct dirent* entry = ::readdir(dir);
+      if (entry == nullptr) {
+        break;
+      }
+
+      const string name = entry->d_name;
+      if (name == "." || name == "..") {
+        continue;
+      }
+
+      const string file = directory == "."
+        ? absolute(name)
+        : absolute(path::join(directory, name));
+
+      if (excluded(file, tree->excludes)) {
+        continue;
+      }
+
+      budget->acquire();
+
+      if (::fstatat(dfd, name.c_str(), &s, AT_SYMLINK_NOFOLLOW) < 0) {
+        // The entry has been removed concurrently.
+        if (errno == ENOENT) {
+          continue;
+        }
+
+        ErrnoError error("Failed to stat '" + file + "'");
+        ::closedir(dir);
+        return error;
+      }
+
+      if (S_ISDIR(s.st_mode)) {
+        auto child = node->children.find(name);
+
+        if (child != node->children.end()) {
+          children[name] = std::move(child->second);
+          node->children.erase(child);
+        } else {
+          children[name].reset(new DiskUsageNode());
+          children[name]->name = name;
+          children[name]->parent = node;
+        }
+      } else if (s.st_nlink > 1) {
+        node->links[{s.st_dev, s.st_ino}] = s.st_blocks * 512;
+      } else {
+        node->bytes += s.st_blocks * 512;
+      }
+    }
+
+    if (errno != 0) {
+      ErrnoError error("Failed to read '" + absolute(directory) + "'");
+      ::closedir(dir);
+      return error;
+    }
+
+    ::closedir(dir);
+
+    // The remaining directories have been removed.
+    foreachvalue (const unique_ptr<DiskUsageNode>& child, node->children) {
+      unwatch(tree, child.get());
+    }
+
+    node->children = std::move(children);
+    node->dirty = !watched;
+
+    return Nothing();
+  }
+
+  const string path;
+  const int fd;
+  DiskUsageTree* tree;
+  DiskUsageBudget* budget;
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  deque<DiskUsageNode*> queue;
+  size_t active = 0;
+  Option<Error> error;
+};
+
+
+std::shared_ptr<DiskUsageWatcher> DiskUsageWalker::createWatcher()
+{
+  return std::make_shared<DiskUsageWatcher>();
+}
+
+
+DiskUsageWalker::DiskUsageWalker(
+    const string& _path,
+    const Options& _options,
+    const std::shared_ptr<DiskUsageWatcher>& _watcher)
+  : path(_path),
+    options(_options),
+    watcher(_watcher != nullptr ? _watcher : createWatcher()),
+    incremental(_options.incremental) {}
+
+
+DiskUsageWalker::~DiskUsageWalker() {}
+
+
+Try<Bytes> DiskUsageWalker::walk(const vector<string>& excludes)
+{
+  // NOTE: Like `du`, a symbolic link is only followed if the path has
+  // a trailing slash, in which case `lstat` follows it.
+  struct stat s;
+  if (::lstat(path.c_str(), &s) < 0) {
+    tree.reset();
+    return ErrnoError("Failed to stat '" + path + "'");
+  }
+
+  if (!S_ISDIR(s.st_mode)) {
+    tree.reset();
+    return Bytes(s.st_blocks * 512);
+  }
+
+  bool reset = tree.get() == nullptr ||
+               tree->watcher == nullptr ||
+               tree->device != s.st_dev ||
+               tree->inode != s.st_ino ||
+               tree->excludes != excludes;
+
+  if (!reset) {
+    Try<bool> complete = changes(tree.get());
+    if (complete.isError()) {
+      LOG(WARNING) << "Rescanning all directories of '" << path << "': "
+                   << complete.error();
+    }
+
+    reset = !complete.isSome() || !complete.get();
+  }
+
+  if (reset) {
+    tree.reset(new DiskUsageTree());
+    tree->excludes = excludes;
+    tree->device = s.st_dev;
+    tree->inode = s.st_ino;
+    tree->root.reset(new DiskUsageNode());
+
+    if (incremental && watcher->initialize()) {
+      tree->watcher = watcher.get();
+      tree->overflows = watcher->overflows;
+    }
+  }
+
+  int fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) {
+    tree.reset();
+    return ErrnoError("Failed to open '" + path + "'");
+  }
+
+  DiskUsageBudget budget(options.budget);
+  DiskUsageWalk walk(path, fd, tree.get(), &budget);
+
+  Try<Nothing> run = walk.run(options.threads);
+
+  os::close(fd);
+
+  if (run.isError()) {
+    tree.reset();
+    return Error(run.error());
+  }
+
+  if (walk.exhausted) {
+    LOG(WARNING) << "Exhausted the inotify watches when walking '" << path
+                 << "', all directories will be rescanned on every walk";
+
+    incremental = false;
+  }
+
+  // Sum up the bytes allocated to all directories, counting the hard
+  // linked entries once.
+  uint64_t bytes = 0;
+  map<pair<dev_t, ino_t>, uint64_t> links;
+
+  deque<const DiskUsageNode*> nodes = {tree->root.get()};
+  while (!nodes.empty()) {
+    const DiskUsageNode* node = nodes.front();
+    nodes.pop_front();
+
+    bytes += node->bytes;
+    links.insert(node->links.begin(), node->links.end());
+
+    foreachvalue (const unique_ptr<DiskUsageNode>& child, node->children) {
+      nodes.push_back(child.get());
+    }
+  }
+
+  foreachvalue (uint64_t link, links) {
+    bytes += link;
+  }
+
+  if (!incremental) {
+    tree.reset();
+  }
+
+  return Bytes(bytes);
+}
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
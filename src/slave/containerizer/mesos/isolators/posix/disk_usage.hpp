@@ -0,0 +1,101 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __POSIX_DISK_USAGE_HPP__
+#define __POSIX_DISK_USAGE_HPP__
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <process/owned.hpp>
+
+#include <stout/bytes.hpp>
+#include <stout/option.hpp>
+#include <stout/try.hpp>
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+// Forward declarations.
+struct DiskUsageTree;
+struct DiskUsageWatcher;
+
+
+// Computes the disk usage of a path in-process like `du -k -s`, i.e.,
+// the blocks allocated to the files and directories under the path
+// with hard links counted once and symbolic links not followed. The
+// directories are walked with `openat` and `fstatat` by a number of
+// threads. On Linux, the walked directories are watched with inotify
+// so that subsequent walks only rescan the directories that changed.
+class DiskUsageWalker
+{
+public:
+  struct Options
+  {
+    // The number of threads walking the directories.
+    size_t threads = 1;
+
+    // The maximum number of entries to stat per second, if any.
+    Option<size_t> budget;
+
+    // Whether to watch the walked directories for changes to only
+    // rescan the changed directories on the next walk.
+    bool incremental = true;
+  };
+
+  // Returns an inotify instance that can be shared by the walkers of
+  // a number of paths, since the inotify instances of a user are
+  // limited (see `fs.inotify.max_user_instances`). It is initialized
+  // on the first walk that needs it.
+  static std::shared_ptr<DiskUsageWatcher> createWatcher();
+
+  // The walker uses its own inotify instance unless a 'watcher' is
+  // given, in which case it must not walk concurrently with the other
+  // walkers sharing the watcher.
+  DiskUsageWalker(
+      const std::string& path,
+      const Options& options,
+      const std::shared_ptr<DiskUsageWatcher>& watcher = nullptr);
+
+  ~DiskUsageWalker();
+
+  // Walks the path and returns its disk usage. The 'excludes' are
+  // patterns matched like `du --exclude`. This blocks the calling
+  // thread and must not be called concurrently.
+  Try<Bytes> walk(const std::vector<std::string>& excludes);
+
+private:
+  const std::string path;
+  const Options options;
+
+  // NOTE: This is declared before the tree so that the tree, which
+  // removes its watches when it is destroyed, is destroyed first.
+  const std::shared_ptr<DiskUsageWatcher> watcher;
+
+  // Cleared once the inotify watches are exhausted, after which every
+  // walk rescans all the directories.
+  bool incremental;
+
+  process::Owned<DiskUsageTree> tree;
+};
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __POSIX_DISK_USAGE_HPP__
@@ -14,6 +14,8 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <process/collect.hpp>
+
 #include <stout/os.hpp>
 #include <stout/strings.hpp>
 
@@ -36,6 +38,8 @@ using process::Future;
 using process::Owned;
 using process::Shared;
 
+using process::await;
+
 namespace mesos {
 namespace internal {
 namespace slave {
@@ -147,15 +151,29 @@ Try<Owned<Fetcher>> Fetcher::create(
     return Error("Invalid simple discovery uri prefix: " + prefix);
   }
 
-  return new Fetcher(prefix, fetcher);
+  Option<Shared<BlobStore>> blobStore;
+  if (flags.blob_store_capacity > 0) {
+    Try<Owned<BlobStore>> _blobStore =
+      BlobStore::create(flags.blob_store_dir, flags.blob_store_capacity);
+
+    if (_blobStore.isError()) {
+      return Error("Failed to create the blob store: " + _blobStore.error());
+    }
+
+    blobStore = _blobStore->share();
+  }
+
+  return new Fetcher(prefix, fetcher, blobStore);
 }
 
 
 Fetcher::Fetcher(
     const string& _uriPrefix,
-    const Shared<uri::Fetcher>& _fetcher)
+    const Shared<uri::Fetcher>& _fetcher,
+    const Option<Shared<BlobStore>>& _blobStore)
   : uriPrefix(_uriPrefix),
-    fetcher(_fetcher) {}
+    fetcher(_fetcher),
+    blobStore(_blobStore) {}
 
 
 Future<Nothing> Fetcher::fetch(const Image::Appc& appc, const Path& directory)
@@ -191,22 +209,74 @@ Future<Nothing> Fetcher::fetch(const Image::Appc& appc, const Path& directory)
       directory,
       Path(uri->path()).basename()));
 
-  return fetcher->fetch(uri.get(), directory)
-    .then([=]() -> Future<Nothing> {
-      // Change the extension to ".gz" as gzip utility expects it.
-      const Path _aciBundle(aciBundle.string() + ".gz");
+  // The image ID is the SHA 512 digest of the uncompressed bundle,
+  // which is how bundles are keyed in the blob store.
+  Future<bool> retrieved = false;
+  if (blobStore.isSome() &&
+      appc.has_id() &&
+      strings::startsWith(appc.id(), "sha512-")) {
+    const string digest =
+      "sha512:" + strings::remove(appc.id(), "sha512-", strings::PREFIX);
+
+    retrieved = BlobStore::materialize(blobStore.get(), digest, aciBundle)
+      .repair([=](const Future<bool>& materialize) {
+        LOG(WARNING) << "Failed to retrieve image '" << appc.name()
+                     << "' from the blob store: "
+                     << (materialize.isFailed()
+                          ? materialize.failure() : "discarded");
+
+        return false;
+      });
+  }
 
-      Try<Nothing> rename = os::rename(aciBundle, _aciBundle);
-      if (rename.isError()) {
-        return Failure(
-            "Failed to change extension to 'gz' for bundle '" +
-            stringify(aciBundle) + "': " + rename.error());
+  const Shared<uri::Fetcher> fetcher = this->fetcher;
+  const Option<Shared<BlobStore>> blobStore = this->blobStore;
+
+  return retrieved
+    .then([=](bool retrieved) -> Future<string> {
+      if (retrieved) {
+        VLOG(1) << "Retrieved image '" << appc.name() << "' with image id '"
+                << appc.id() << "' from the blob store";
+
+        return strings::remove(appc.id(), "sha512-", strings::PREFIX);
       }
 
-      return command::decompress(_aciBundle);
-    })
-    .then([=]() -> Future<string> {
-      return command::sha512(aciBundle);
+      return fetcher->fetch(uri.get(), directory)
+        .then([=]() -> Future<Nothing> {
+          // Change the extension to ".gz" as gzip utility expects it.
+          const Path _aciBundle(aciBundle.string() + ".gz");
+
+          Try<Nothing> rename = os::rename(aciBundle, _aciBundle);
+          if (rename.isError()) {
+            return Failure(
+                "Failed to change extension to 'gz' for bundle '" +
+                stringify(aciBundle) + "': " + rename.error());
+          }
+
+          return command::decompress(_aciBundle);
+        })
+        .then([=]() -> Future<string> {
+          return command::sha512(aciBundle);
+        })
+        .then([=](const string& shasum) -> Future<string> {
+          if (blobStore.isNone()) {
+            return shasum;
+          }
+
+          // The bundle stays in the blob store once it is removed
+          // below, and only counts against its capacity from then on.
+          return await(BlobStore::add(
+              blobStore.get(), "sha512:" + shasum, aciBundle))
+            .then([=](const Future<Nothing>& add) {
+              if (!add.isReady()) {
+                LOG(WARNING) << "Failed to add image '" << appc.name()
+                             << "' to the blob store: "
+                             << (add.isFailed() ? add.failure() : "discarded");
+              }
+
+              return shasum;
+            });
+        });
     })
     .then([=](const string& shasum) -> Future<Nothing> {
       const string imagePath(path::join(directory, "sha512-" + shasum));
@@ -22,10 +22,13 @@
 #include <process/process.hpp>
 #include <process/shared.hpp>
 
+#include <stout/option.hpp>
 #include <stout/path.hpp>
 
 #include "slave/flags.hpp"
 
+#include "slave/containerizer/mesos/provisioner/blob_store.hpp"
+
 #include "uri/fetcher.hpp"
 
 namespace mesos {
@@ -63,13 +66,19 @@ public:
 private:
   Fetcher(
       const std::string& uriPrefix,
-      const process::Shared<uri::Fetcher>& fetcher);
+      const process::Shared<uri::Fetcher>& fetcher,
+      const Option<process::Shared<BlobStore>>& blobStore);
 
   Fetcher(const Fetcher&) = delete;
   Fetcher& operator=(const Fetcher&) = delete;
 
   const std::string uriPrefix;
   process::Shared<uri::Fetcher> fetcher;
+
+  // The image bundles are kept in the blob store, if any, keyed by
+  // their image IDs, so that images whose ID is known do not have to
+  // be downloaded again.
+  Option<process::Shared<BlobStore>> blobStore;
 };
 
 } // namespace appc {
@@ -14,6 +14,8 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <memory>
+#include <thread>
 #include <vector>
 
 #ifndef __WINDOWS__
@@ -37,6 +39,10 @@
 
 #include "slave/containerizer/mesos/provisioner/backends/copy.hpp"
 
+#ifdef __linux__
+#include "slave/containerizer/mesos/provisioner/backends/layer_copier.hpp"
+#endif // __linux__
+
 using namespace process;
 
 using std::string;
@@ -49,8 +55,9 @@ namespace slave {
 class CopyBackendProcess : public Process<CopyBackendProcess>
 {
 public:
-  CopyBackendProcess()
-    : ProcessBase(process::ID::generate("copy-provisioner-backend")) {}
+  explicit CopyBackendProcess(size_t _threads)
+    : ProcessBase(process::ID::generate("copy-provisioner-backend")),
+      threads(_threads) {}
 
   Future<Option<vector<Path>>> provision(
       const vector<string>& layers, const string& rootfs);
@@ -59,13 +66,17 @@ public:
 
 private:
   Future<Nothing> _provision(string layer, const string& rootfs);
+
+  // The number of threads copying a layer.
+  const size_t threads;
 };
 
 
-Try<Owned<Backend>> CopyBackend::create(const Flags&)
+Try<Owned<Backend>> CopyBackend::create(const Flags& flags)
 {
   return Owned<Backend>(new CopyBackend(
-      Owned<CopyBackendProcess>(new CopyBackendProcess())));
+      Owned<CopyBackendProcess>(
+          new CopyBackendProcess(flags.image_provisioner_copy_threads))));
 }
 
 
@@ -135,7 +146,30 @@ Future<Nothing> CopyBackendProcess::_provision(
     string layer,
     const string& rootfs)
 {
-#ifndef __WINDOWS__
+#ifdef __linux__
+  VLOG(1) << "Copying layer path '" << layer << "' to rootfs '" << rootfs
+          << "'";
+
+  // The layer is copied in-process, which applies its whiteouts in the
+  // same pass. The copy runs on a dedicated thread rather than on a
+  // libprocess worker, since it blocks on the filesystem for as long as
+  // the layer takes to copy.
+  const size_t threads = this->threads;
+
+  std::shared_ptr<Promise<Nothing>> promise(new Promise<Nothing>());
+  Future<Nothing> future = promise->future();
+
+  std::thread([layer, rootfs, threads, promise]() {
+    Try<Nothing> copy = copyLayer(layer, rootfs, threads);
+    if (copy.isError()) {
+      promise->fail("Failed to copy layer '" + layer + "': " + copy.error());
+    } else {
+      promise->set(Nothing());
+    }
+  }).detach();
+
+  return future;
+#elif !defined(__WINDOWS__)
   // Traverse the layer to check if there is any whiteout files, if
   // yes, remove the corresponding files/directories from the rootfs.
   // Note: We assume all image types use AUFS whiteout format.
@@ -307,7 +341,7 @@ Future<Nothing> CopyBackendProcess::_provision(
 #else
   return Failure(
       "Provisioning a rootfs from an image is not supported on Windows");
-#endif // __WINDOWS__
+#endif // __linux__
 }
 
 
@@ -40,8 +40,7 @@ class CopyBackend : public Backend
 public:
   ~CopyBackend() override;
 
-  // CopyBackend doesn't use any flag.
-  static Try<process::Owned<Backend>> create(const Flags&);
+  static Try<process::Owned<Backend>> create(const Flags& flags);
 
   // Provisions a rootfs given the layers' paths and target rootfs
   // path.
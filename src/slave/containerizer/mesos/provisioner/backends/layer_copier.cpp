@@ -0,0 +1,731 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <linux/fs.h>
+
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/xattr.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <mesos/docker/spec.hpp>
+
+#include <stout/error.hpp>
+#include <stout/foreach.hpp>
+#include <stout/option.hpp>
+#include <stout/path.hpp>
+#include <stout/strings.hpp>
+
+#include <stout/os/close.hpp>
+#include <stout/os/rmdir.hpp>
+
+#include "slave/containerizer/mesos/provisioner/backends/layer_copier.hpp"
+
+using std::deque;
+using std::map;
+using std::pair;
+using std::string;
+using std::vector;
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+// NOTE: The directories are never followed if they are symbolic links.
+constexpr int DIRECTORY_FLAGS = O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC;
+
+
+// Returns the entries of the directory along with their status.
+static Try<vector<pair<string, struct stat>>> entries(
+    int fd,
+    const string& directory)
+{
+  // NOTE: `fdopendir` takes over the file descriptor it is given.
+  int dfd = ::openat(fd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dfd < 0) {
+    return ErrnoError("Failed to open '" + directory + "'");
+  }
+
+  DIR* dir = ::fdopendir(dfd);
+  if (dir == nullptr) {
+    ErrnoError error("Failed to open '" + directory + "'");
+    os::close(dfd);
+    return error;
+  }
+
+  vector<pair<string, struct stat>> result;
+
+  while (true) {
+    errno = 0;
+
+    struct dirent* entry = ::readdir(dir);
+    if (entry == nullptr) {
+      break;
+    }
+
+    const string name = entry->d_name;
+    if (name == "." || name == "..") {
+      continue;
+    }
+
+    struct stat s;
+    if (::fstatat(fd, name.c_str(), &s, AT_SYMLINK_NOFOLLOW) < 0) {
+      ErrnoError error(
+          "Failed to stat '" + path::join(directory, name) + "'");
+      ::closedir(dir);
+      return error;
+    }
+
+    result.emplace_back(name, s);
+  }
+
+  if (errno != 0) {
+    ErrnoError error("Failed to read '" + directory + "'");
+    ::closedir(dir);
+    return error;
+  }
+
+  ::closedir(dir);
+
+  return result;
+}
+
+
+// Removes the entry of the directory, if it exists, without following
+// it if it is a symbolic link.
+static Try<Nothing> remove(int fd, const string& directory, const string& name)
+{
+  const string path = path::join(directory, name);
+
+  struct stat s;
+  if (::fstatat(fd, name.c_str(), &s, AT_SYMLINK_NOFOLLOW) < 0) {
+    if (errno == ENOENT) {
+      return Nothing();
+    }
+
+    return ErrnoError("Failed to stat '" + path + "'");
+  }
+
+  if (S_ISDIR(s.st_mode)) {
+    Try<Nothing> rmdir = os::rmdir(path);
+    if (rmdir.isError()) {
+      return Error(
+          "Failed to remove directory '" + path + "': " + rmdir.error());
+    }
+  } else if (::unlinkat(fd, name.c_str(), 0) < 0) {
+    return ErrnoError("Failed to remove '" + path + "'");
+  }
+
+  return Nothing();
+}
+
+
+// Changes the ownership of a file like `cp -a`, which ignores the lack
+// of permission when it is not run as root.
+static Try<Nothing> chown(
+    int fd,
+    const char* name,
+    const struct stat& s,
+    const string& path)
+{
+  const int flags = name[0] == '\0' ? AT_EMPTY_PATH : AT_SYMLINK_NOFOLLOW;
+
+  if (::fchownat(fd, name, s.st_uid, s.st_gid, flags) < 0) {
+    if ((errno == EPERM || errno == EINVAL) && ::geteuid() != 0) {
+      return Nothing();
+    }
+
+    return ErrnoError("Failed to change the ownership of '" + path + "'");
+  }
+
+  return Nothing();
+}
+
+
+// Copies the extended attributes on a best effort basis like `cp -a`,
+// since the target filesystem might not support them.
+static void copyXattrs(int from, int to)
+{
+  ssize_t size = ::flistxattr(from, nullptr, 0);
+  if (size <= 0) {
+    return;
+  }
+
+  vector<char> names(size);
+  size = ::flistxattr(from, names.data(), names.size());
+  if (size <= 0) {
+    return;
+  }
+
+  const string list(names.data(), size);
+
+  foreach (const string& name, strings::split(list, string(1, '\0'))) {
+    if (name.empty()) {
+      continue;
+    }
+
+    ssize_t length = ::fgetxattr(from, name.c_str(), nullptr, 0);
+    if (length < 0) {
+      continue;
+    }
+
+    vector<char> value(length);
+    length = ::fgetxattr(from, name.c_str(), value.data(), value.size());
+    if (length < 0) {
+      continue;
+    }
+
+    ::fsetxattr(to, name.c_str(), value.data(), length, 0);
+  }
+}
+
+
+// Copies the content of a regular file, sharing its extents with a
+// reflink if the filesystem supports it.
+static Try<Nothing> copyData(int from, int to, const string& path)
+{
+  if (::ioctl(to, FICLONE, from) == 0) {
+    return Nothing();
+  }
+
+#ifdef SYS_copy_file_range
+  // NOTE: `copy_file_range` lets the filesystem copy the data without
+  // passing it through userspace, and falls back to copying it within
+  // the kernel otherwise.
+  bool copied = false;
+
+  while (true) {
+    ssize_t length = ::syscall(
+        SYS_copy_file_range, from, nullptr, to, nullptr, 1 << 30, 0);
+
+    if (length < 0) {
+      if (!copied &&
+          (errno == ENOSYS ||
+           errno == EXDEV ||
+           errno == EINVAL ||
+           errno == EOPNOTSUPP)) {
+        break;
+      }
+
+      return ErrnoError("Failed to copy '" + path + "'");
+    }
+
+    if (length == 0) {
+      return Nothing();
+    }
+
+    copied = true;
+  }
+#endif // SYS_copy_file_range
+
+  char buffer[64 * 1024];
+
+  while (true) {
+    ssize_t length = ::read(from, buffer, sizeof(buffer));
+    if (length < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      return ErrnoError("Failed to read '" + path + "'");
+    }
+
+    if (length == 0) {
+      return Nothing();
+    }
+
+    for (ssize_t offset = 0; offset < length;) {
+      ssize_t written = ::write(to, buffer + offset, length - offset);
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+
+        return ErrnoError("Failed to write '" + path + "'");
+      }
+
+      offset += written;
+    }
+  }
+}
+
+
+// A single copy of a layer onto a rootfs, whose directories are copied
+// by a number of threads that share a queue of the directories to copy.
+class LayerCopy
+{
+public:
+  LayerCopy(const string& _layer, const string& _rootfs)
+    : layer(_layer), rootfs(_rootfs) {}
+
+  Try<Nothing> run(size_t threads)
+  {
+    struct stat s;
+    if (::lstat(layer.c_str(), &s) < 0) {
+      return ErrnoError("Failed to stat '" + layer + "'");
+    }
+
+    if (!S_ISDIR(s.st_mode)) {
+      return Error("'" + layer + "' is not a directory");
+    }
+
+    directories.emplace_back(".", s);
+    queue.push_back(".");
+
+    vector<std::thread> workers;
+    for (size_t i = 1; i < threads; i++) {
+      workers.emplace_back(&LayerCopy::work, this);
+    }
+
+    work();
+
+    foreach (std::thread& worker, workers) {
+      worker.join();
+    }
+
+    if (error.isSome()) {
+      return error.get();
+    }
+
+    // The metadata of the directories is copied once their entries
+    // have been copied, since copying an entry changes the timestamps
+    // of its directory and a read-only directory could not be written
+    // to. The directories are discovered before their subdirectories,
+    // hence the subdirectories are done first in the reverse order.
+    for (auto directory = directories.rbegin();
+         directory != directories.rend();
+         ++directory) {
+      Try<Nothing> metadata =
+        copyMetadata(directory->first, directory->second);
+
+      if (metadata.isError()) {
+        return metadata;
+      }
+    }
+
+    return Nothing();
+  }
+
+private:
+  void work()
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+      condition.wait(lock, [this]() {
+        return !queue.empty() || active == 0;
+      });
+
+      if (queue.empty()) {
+        break;
+      }
+
+      const string directory = queue.front();
+      queue.pop_front();
+      active++;
+
+      lock.unlock();
+
+      vector<pair<string, struct stat>> subdirectories;
+      Try<Nothing> copy = this->copy(directory, &subdirectories);
+
+      lock.lock();
+
+      if (copy.isError()) {
+        if (error.isNone()) {
+          error = Error(copy.error());
+        }
+
+        queue.clear();
+      } else if (error.isNone()) {
+        foreach (const auto& subdirectory, subdirectories) {
+          directories.push_back(subdirectory);
+          queue.push_back(subdirectory.first);
+        }
+      }
+
+      active--;
+      condition.notify_all();
+    }
+
+    condition.notify_all();
+  }
+
+  string source(const string& relative) const
+  {
+    return relative == "." ? layer : path::join(layer, relative);
+  }
+
+  string target(const string& relative) const
+  {
+    return relative == "." ? rootfs : path::join(rootfs, relative);
+  }
+
+  // Copies the entries of the directory other than its subdirectories,
+  // which are only created and returned to be copied in turn.
+  Try<Nothing> copy(
+      const string& directory,
+      vector<pair<string, struct stat>>* subdirectories)
+  {
+    const string from = source(directory);
+    const string to = target(directory);
+
+    // NOTE: The parent directories have been checked already.
+    int sfd = ::open(from.c_str(), DIRECTORY_FLAGS);
+    if (sfd < 0) {
+      return ErrnoError("Failed to open '" + from + "'");
+    }
+
+    int dfd = ::open(to.c_str(), DIRECTORY_FLAGS);
+    if (dfd < 0) {
+      ErrnoError error("Failed to open '" + to + "'");
+      os::close(sfd);
+      return error;
+    }
+
+    Try<Nothing> copy = _copy(sfd, dfd, directory, subdirectories);
+
+    os::close(sfd);
+    os::close(dfd);
+
+    return copy;
+  }
+
+  Try<Nothing> _copy(
+      int sfd,
+      int dfd,
+      const string& directory,
+      vector<pair<string, struct stat>>* subdirectories)
+  {
+    const string from = source(directory);
+    const string to = target(directory);
+
+    Try<vector<pair<string, struct stat>>> _entries = entries(sfd, from);
+    if (_entries.isError()) {
+      return Error(_entries.error());
+    }
+
+    auto whiteout = [](const pair<string, struct stat>& entry) {
+      return S_ISREG(entry.second.st_mode) &&
+        strings::startsWith(entry.first, ::docker::spec::WHITEOUT_PREFIX);
+    };
+
+    // The whiteouts hide the entries of the lower layers, hence they
+    // are applied before the entries of this layer are copied.
+    foreach (const auto& entry, _entries.get()) {
+      if (!whiteout(entry)) {
+        continue;
+      }
+
+      if (entry.first == ::docker::spec::WHITEOUT_OPAQUE_PREFIX) {
+        Try<vector<pair<string, struct stat>>> existing = entries(dfd, to);
+        if (existing.isError()) {
+          return Error(existing.error());
+        }
+
+        foreach (const auto& _entry, existing.get()) {
+          Try<Nothing> remove = slave::remove(dfd, to, _entry.first);
+          if (remove.isError()) {
+            return remove;
+          }
+        }
+      } else {
+        Try<Nothing> remove = slave::remove(
+            dfd,
+            to,
+            entry.first.substr(strlen(::docker::spec::WHITEOUT_PREFIX)));
+
+        if (remove.isError()) {
+          return remove;
+        }
+      }
+    }
+
+    foreach (const auto& entry, _entries.get()) {
+      if (whiteout(entry)) {
+        continue;
+      }
+
+      const string& name = entry.first;
+      const struct stat& s = entry.second;
+      const string path = path::join(to, name);
+
+      struct stat existing;
+      bool exists = true;
+
+      if (::fstatat(dfd, name.c_str(), &existing, AT_SYMLINK_NOFOLLOW) < 0) {
+        if (errno != ENOENT) {
+          return ErrnoError("Failed to stat '" + path + "'");
+        }
+
+        exists = false;
+      }
+
+      if (S_ISDIR(s.st_mode)) {
+        // The directories are merged, whereas anything else including
+        // a symbolic link to a directory is replaced by the directory.
+        if (exists && !S_ISDIR(existing.st_mode)) {
+          Try<Nothing> remove = slave::remove(dfd, to, name);
+          if (remove.isError()) {
+            return remove;
+          }
+
+          exists = false;
+        }
+
+        if (!exists && ::mkdirat(dfd, name.c_str(), S_IRWXU) < 0) {
+          return ErrnoError("Failed to create directory '" + path + "'");
+        }
+
+        subdirectories->emplace_back(
+            directory == "." ? name : path::join(directory, name),
+            s);
+
+        continue;
+      }
+
+      // Anything else replaces the existing entry rather than being
+      // written through it, which might be a symbolic link.
+      if (exists) {
+        Try<Nothing> remove = slave::remove(dfd, to, name);
+        if (remove.isError()) {
+          return remove;
+        }
+      }
+
+      Try<Nothing> copy = copyEntry(sfd, dfd, path::join(from, name), path, s);
+      if (copy.isError()) {
+        return copy;
+      }
+    }
+
+    return Nothing();
+  }
+
+  // Copies an entry which is not a directory along with its metadata.
+  Try<Nothing> copyEntry(
+      int sfd,
+      int dfd,
+      const string& from,
+      const string& to,
+      const struct stat& s)
+  {
+    const string name = Path(to).basename();
+
+    // The other links to a file which has been copied already are
+    // linked to the copy as well.
+    // NOTE: If two links are copied concurrently, both are copied.
+    if (s.st_nlink > 1) {
+      Option<string> link;
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto copied = links.find({s.st_dev, s.st_ino});
+        if (copied != links.end()) {
+          link = copied->second;
+        }
+      }
+
+      if (link.isSome()) {
+        if (::linkat(AT_FDCWD, link->c_str(), dfd, name.c_str(), 0) < 0) {
+          return ErrnoError(
+              "Failed to link '" + to + "' to '" + link.get() + "'");
+        }
+
+        return Nothing();
+      }
+    }
+
+    if (S_ISREG(s.st_mode)) {
+      int in = ::openat(
+          sfd, name.c_str(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+
+      if (in < 0) {
+        return ErrnoError("Failed to open '" + from + "'");
+      }
+
+      int out = ::openat(
+          dfd,
+          name.c_str(),
+          O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC,
+          S_IRUSR | S_IWUSR);
+
+      if (out < 0) {
+        ErrnoError error("Failed to create '" + to + "'");
+        os::close(in);
+        return error;
+      }
+
+      Try<Nothing> copy = copyData(in, out, from);
+      if (copy.isSome()) {
+        copy = copyFileMetadata(in, out, to, s);
+      }
+
+      os::close(in);
+      os::close(out);
+
+      if (copy.isError()) {
+        return copy;
+      }
+    } else {
+      if (S_ISLNK(s.st_mode)) {
+        vector<char> target(s.st_size + 1);
+
+        ssize_t length = ::readlinkat(
+            sfd, name.c_str(), target.data(), target.size());
+
+        if (length < 0) {
+          return ErrnoError("Failed to read link '" + from + "'");
+        }
+
+        if (static_cast<size_t>(length) >= target.size()) {
+          return Error("Link '" + from + "' changed while being copied");
+        }
+
+        target[length] = '\0';
+
+        if (::symlinkat(target.data(), dfd, name.c_str()) < 0) {
+          return ErrnoError("Failed to create link '" + to + "'");
+        }
+      } else if (::mknodat(dfd, name.c_str(), s.st_mode, s.st_rdev) < 0) {
+        return ErrnoError("Failed to create '" + to + "'");
+      }
+
+      Try<Nothing> chown = slave::chown(dfd, name.c_str(), s, to);
+      if (chown.isError()) {
+        return chown;
+      }
+
+      // NOTE: The mode of a symbolic link cannot be changed on Linux.
+      if (!S_ISLNK(s.st_mode) &&
+          ::fchmodat(dfd, name.c_str(), s.st_mode & 07777, 0) < 0) {
+        return ErrnoError("Failed to change the mode of '" + to + "'");
+      }
+
+      const struct timespec times[2] = {s.st_atim, s.st_mtim};
+      if (::utimensat(dfd, name.c_str(), times, AT_SYMLINK_NOFOLLOW) < 0) {
+        return ErrnoError("Failed to change the timestamps of '" + to + "'");
+      }
+    }
+
+    if (s.st_nlink > 1) {
+      std::lock_guard<std::mutex> lock(mutex);
+      links.emplace(std::make_pair(s.st_dev, s.st_ino), to);
+    }
+
+    return Nothing();
+  }
+
+  // Copies the ownership, mode, extended attributes and timestamps of
+  // an open file or directory.
+  Try<Nothing> copyFileMetadata(
+      int from,
+      int to,
+      const string& path,
+      const struct stat& s)
+  {
+    Try<Nothing> chown = slave::chown(to, "", s, path);
+    if (chown.isError()) {
+      return chown;
+    }
+
+    // NOTE: The mode is changed after the ownership, which clears the
+    // set-user-ID and set-group-ID bits.
+    if (::fchmod(to, s.st_mode & 07777) < 0) {
+      return ErrnoError("Failed to change the mode of '" + path + "'");
+    }
+
+    copyXattrs(from, to);
+
+    const struct timespec times[2] = {s.st_atim, s.st_mtim};
+    if (::futimens(to, times) < 0) {
+      return ErrnoError("Failed to change the timestamps of '" + path + "'");
+    }
+
+    return Nothing();
+  }
+
+  Try<Nothing> copyMetadata(const string& directory, const struct stat& s)
+  {
+    const string from = source(directory);
+    const string to = target(directory);
+
+    int sfd = ::open(from.c_str(), DIRECTORY_FLAGS);
+    if (sfd < 0) {
+      return ErrnoError("Failed to open '" + from + "'");
+    }
+
+    int dfd = ::open(to.c_str(), DIRECTORY_FLAGS);
+    if (dfd < 0) {
+      ErrnoError error("Failed to open '" + to + "'");
+      os::close(sfd);
+      return error;
+    }
+
+    Try<Nothing> metadata = copyFileMetadata(sfd, dfd, to, s);
+
+    os::close(sfd);
+    os::close(dfd);
+
+    return metadata;
+  }
+
+  const string layer;
+  const string rootfs;
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  deque<string> queue;
+  size_t active = 0;
+  Option<Error> error;
+
+  // The directories of the layer relative to it, in the order in which
+  // they are discovered.
+  vector<pair<string, struct stat>> directories;
+
+  // The copies of the files with multiple links, keyed by the device
+  // and inode of the file in the layer.
+  map<pair<dev_t, ino_t>, string> links;
+};
+
+
+Try<Nothing> copyLayer(
+    const string& layer,
+    const string& rootfs,
+    size_t threads)
+{
+  LayerCopy copy(layer, rootfs);
+  return copy.run(std::max<size_t>(threads, 1));
+}
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
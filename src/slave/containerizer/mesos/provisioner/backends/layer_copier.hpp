@@ -0,0 +1,46 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __PROVISIONER_BACKENDS_LAYER_COPIER_HPP__
+#define __PROVISIONER_BACKENDS_LAYER_COPIER_HPP__
+
+#include <string>
+
+#include <stout/nothing.hpp>
+#include <stout/try.hpp>
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+// Copies the layer onto the rootfs in-process like `cp -aT`, i.e.,
+// preserving ownership, modes, timestamps, extended attributes and
+// the hard links within the layer, and applies the AUFS whiteouts of
+// the layer in the same pass instead of copying them. The directories
+// of the layer are copied by a number of threads in parallel, and the
+// files are copied with reflinks where the filesystem supports them
+// (e.g., XFS and btrfs), or with `copy_file_range` otherwise. This
+// blocks the calling thread.
+Try<Nothing> copyLayer(
+    const std::string& layer,
+    const std::string& rootfs,
+    size_t threads);
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __PROVISIONER_BACKENDS_LAYER_COPIER_HPP__
@@ -0,0 +1,477 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifdef __linux__
+#include <linux/fs.h>
+
+#include <sys/ioctl.h>
+#endif // __linux__
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <list>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <process/future.hpp>
+
+#include <stout/error.hpp>
+#include <stout/foreach.hpp>
+#include <stout/path.hpp>
+#include <stout/strings.hpp>
+
+#include <stout/os/close.hpp>
+#include <stout/os/copyfile.hpp>
+#include <stout/os/exists.hpp>
+#include <stout/os/ls.hpp>
+#include <stout/os/mkdir.hpp>
+#include <stout/os/mktemp.hpp>
+#include <stout/os/open.hpp>
+#include <stout/os/read.hpp>
+#include <stout/os/rename.hpp>
+#include <stout/os/rm.hpp>
+#include <stout/os/rmdir.hpp>
+#include <stout/os/stat.hpp>
+#include <stout/os/strerror.hpp>
+#include <stout/os/utime.hpp>
+#include <stout/os/write.hpp>
+
+#include "slave/containerizer/mesos/provisioner/blob_store.hpp"
+
+using std::list;
+using std::string;
+using std::vector;
+
+using process::Future;
+using process::Owned;
+using process::Promise;
+using process::Shared;
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+constexpr char STAGING_DIR[] = "staging";
+
+
+// Hard links `target` to the file at `source`.
+static Try<Nothing, ErrnoError> hardlink(
+    const string& source,
+    const string& target)
+{
+#ifdef __WINDOWS__
+  // NOTE: Blobs are always copied on Windows.
+  return ErrnoError(EXDEV, "Hard links are not supported");
+#else
+  if (::link(source.c_str(), target.c_str()) != 0) {
+    return ErrnoError(
+        "Failed to link '" + target + "' to '" + source + "'");
+  }
+
+  return Nothing();
+#endif // __WINDOWS__
+}
+
+
+Try<Owned<BlobStore>> BlobStore::create(
+    const string& rootDir,
+    const Bytes& capacity)
+{
+  Try<Nothing> mkdir = os::mkdir(rootDir);
+  if (mkdir.isError()) {
+    return Error(
+        "Failed to create blob store directory '" + rootDir + "': " +
+        mkdir.error());
+  }
+
+  // Blobs which were staged before a restart are never added.
+  const string staging = path::join(rootDir, STAGING_DIR);
+  if (os::exists(staging)) {
+    Try<Nothing> rmdir = os::rmdir(staging);
+    if (rmdir.isError()) {
+      return Error(
+          "Failed to remove blob store staging directory '" + staging +
+          "': " + rmdir.error());
+    }
+  }
+
+  mkdir = os::mkdir(staging);
+  if (mkdir.isError()) {
+    return Error(
+        "Failed to create blob store staging directory '" + staging +
+        "': " + mkdir.error());
+  }
+
+  Owned<BlobStore> store(new BlobStore(rootDir, capacity));
+
+  // The capacity might have been lowered since the last run.
+  Try<Nothing> prune = store->prune();
+  if (prune.isError()) {
+    return Error("Failed to prune the blob store: " + prune.error());
+  }
+
+  return store;
+}
+
+
+Result<int_fd> BlobStore::open(const string& digest) const
+{
+  Try<string> path = getBlobPath(digest);
+  if (path.isError()) {
+    return Error(path.error());
+  }
+
+  Try<int_fd> fd = os::open(path.get(), O_RDONLY | O_CLOEXEC);
+  if (fd.isError()) {
+    // NOTE: The blob might also have been evicted concurrently.
+    if (!os::exists(path.get())) {
+      return None();
+    }
+
+    return Error("Failed to open blob '" + digest + "': " + fd.error());
+  }
+
+  Try<Nothing> utime = os::utime(path.get());
+  if (utime.isError()) {
+    LOG(WARNING) << "Failed to mark blob '" << digest << "' as used: "
+                 << utime.error();
+  }
+
+  return fd.get();
+}
+
+
+Try<string> BlobStore::stage() const
+{
+  return os::mktemp(path::join(rootDir, STAGING_DIR, "XXXXXX"));
+}
+
+
+Try<Nothing> BlobStore::put(
+    const string& digest,
+    const string& path) const
+{
+  Try<string> blobPath = getBlobPath(digest);
+  if (blobPath.isError()) {
+    return Error(blobPath.error());
+  }
+
+  Try<Nothing> mkdir = os::mkdir(Path(blobPath.get()).dirname());
+  if (mkdir.isError()) {
+    return Error(
+        "Failed to create directory for blob '" + digest + "': " +
+        mkdir.error());
+  }
+
+  Try<Nothing, ErrnoError> link = hardlink(path, blobPath.get());
+  if (link.isError()) {
+    if (link.error().code == EEXIST) {
+      // The blob has been added by another consumer in the meantime.
+      os::utime(blobPath.get());
+      return Nothing();
+    }
+
+    if (link.error().code != EXDEV) {
+      return Error(
+          "Failed to add blob '" + digest + "': " + link.error().message);
+    }
+
+    // The file is on another filesystem, so the blob is copied to the
+    // staging directory first to add it atomically.
+    Try<string> staged = stage();
+    if (staged.isError()) {
+      return Error("Failed to stage blob '" + digest + "': " + staged.error());
+    }
+
+    Try<Nothing> copy = os::copyfile(path, staged.get());
+    if (copy.isError()) {
+      os::rm(staged.get());
+      return Error("Failed to copy blob '" + digest + "': " + copy.error());
+    }
+
+    Try<Nothing> rename = os::rename(staged.get(), blobPath.get());
+    if (rename.isError()) {
+      os::rm(staged.get());
+      return Error("Failed to add blob '" + digest + "': " + rename.error());
+    }
+  }
+
+  VLOG(1) << "Added blob '" << digest << "' to blob store '" << rootDir << "'";
+
+  return prune();
+}
+
+
+Result<Nothing> BlobStore::link(
+    const string& digest,
+    const string& target) const
+{
+  Try<string> blobPath = getBlobPath(digest);
+  if (blobPath.isError()) {
+    return Error(blobPath.error());
+  }
+
+  if (!os::exists(blobPath.get())) {
+    return None();
+  }
+
+  Try<Nothing, ErrnoError> link = hardlink(blobPath.get(), target);
+  if (link.isError()) {
+    if (link.error().code != EXDEV) {
+      if (!os::exists(blobPath.get())) {
+        return None();
+      }
+
+      return Error(
+          "Failed to link blob '" + digest + "': " + link.error().message);
+    }
+
+    return copy(digest, target);
+  }
+
+  os::utime(blobPath.get());
+
+  return Nothing();
+}
+
+
+Result<Nothing> BlobStore::copy(
+    const string& digest,
+    const string& target) const
+{
+  // NOTE: The blob is copied from an open file descriptor so that an
+  // eviction in the meantime does not affect the copy.
+  Result<int_fd> source = open(digest);
+  if (!source.isSome()) {
+    return source.isError() ? Error(source.error()) : Result<Nothing>::none();
+  }
+
+  Try<int_fd> destination = os::open(
+      target,
+      O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+      S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+  if (destination.isError()) {
+    os::close(source.get());
+    return Error(
+        "Failed to create '" + target + "' for blob '" + digest + "': " +
+        destination.error());
+  }
+
+  Try<Nothing> copy = [&]() -> Try<Nothing> {
+#ifdef __linux__
+    if (::ioctl(destination.get(), FICLONE, source.get()) == 0) {
+      return Nothing();
+    }
+
+    VLOG(2) << "Falling back to copying blob '" << digest << "' to '"
+            << target << "' since it cannot be cloned: "
+            << os::strerror(errno);
+#endif // __linux__
+
+    const size_t BUFFER_SIZE = 64 * 1024;
+    vector<char> buffer(BUFFER_SIZE);
+
+    while (true) {
+      ssize_t length = os::read(source.get(), buffer.data(), buffer.size());
+      if (length < 0) {
+        return ErrnoError("Failed to read blob '" + digest + "'");
+      }
+
+      if (length == 0) {
+        return Nothing();
+      }
+
+      Try<Nothing> write =
+        os::write(destination.get(), string(buffer.data(), length));
+
+      if (write.isError()) {
+        return Error("Failed to write '" + target + "': " + write.error());
+      }
+    }
+  }();
+
+  os::close(source.get());
+  os::close(destination.get());
+
+  if (copy.isError()) {
+    os::rm(target);
+    return Error(copy.error());
+  }
+
+  return Nothing();
+}
+
+
+Try<Nothing> BlobStore::prune() const
+{
+  struct Blob
+  {
+    string path;
+    Bytes size;
+    time_t mtime;
+  };
+
+  Try<list<string>> algorithms = os::ls(rootDir);
+  if (algorithms.isError()) {
+    return Error(
+        "Failed to list blob store directory '" + rootDir + "': " +
+        algorithms.error());
+  }
+
+  vector<Blob> blobs;
+  Bytes unreferenced;
+
+  foreach (const string& algorithm, algorithms.get()) {
+    if (algorithm == STAGING_DIR) {
+      continue;
+    }
+
+    const string directory = path::join(rootDir, algorithm);
+
+    Try<list<string>> entries = os::ls(directory);
+    if (entries.isError()) {
+      return Error(
+          "Failed to list blob directory '" + directory + "': " +
+          entries.error());
+    }
+
+    foreach (const string& entry, entries.get()) {
+      const string path = path::join(directory, entry);
+
+      Try<struct ::stat> s = os::stat::internal::stat(
+          path, os::stat::FollowSymlink::DO_NOT_FOLLOW_SYMLINK);
+
+      // The blob might have been evicted by another instance.
+      if (s.isError()) {
+        continue;
+      }
+
+      // Blobs that are linked into consumers do not take any space of
+      // their own, so evicting them would not free any.
+      if (s->st_nlink > 1) {
+        continue;
+      }
+
+      blobs.push_back({path, Bytes(s->st_size), s->st_mtime});
+      unreferenced += Bytes(s->st_size);
+    }
+  }
+
+  if (unreferenced <= capacity) {
+    return Nothing();
+  }
+
+  std::sort(blobs.begin(), blobs.end(), [](const Blob& a, const Blob& b) {
+    return a.mtime < b.mtime;
+  });
+
+  foreach (const Blob& blob, blobs) {
+    if (unreferenced <= capacity) {
+      break;
+    }
+
+    VLOG(1) << "Evicting blob '" << blob.path << "' of size " << blob.size
+            << " from blob store '" << rootDir << "'";
+
+    Try<Nothing> rm = os::rm(blob.path);
+    if (rm.isError()) {
+      LOG(WARNING) << "Failed to evict blob '" << blob.path << "': "
+                   << rm.error();
+      continue;
+    }
+
+    unreferenced -= blob.size;
+  }
+
+  return Nothing();
+}
+
+
+Future<Nothing> BlobStore::add(
+    const Shared<BlobStore>& store,
+    const string& digest,
+    const string& path)
+{
+  std::shared_ptr<Promise<Nothing>> promise(new Promise<Nothing>());
+  Future<Nothing> future = promise->future();
+
+  std::thread([store, digest, path, promise]() {
+    Try<Nothing> put = store->put(digest, path);
+    if (put.isError()) {
+      promise->fail(put.error());
+    } else {
+      promise->set(Nothing());
+    }
+  }).detach();
+
+  return future;
+}
+
+
+Future<bool> BlobStore::materialize(
+    const Shared<BlobStore>& store,
+    const string& digest,
+    const string& target)
+{
+  std::shared_ptr<Promise<bool>> promise(new Promise<bool>());
+  Future<bool> future = promise->future();
+
+  std::thread([store, digest, target, promise]() {
+    Result<Nothing> link = store->link(digest, target);
+    if (link.isError()) {
+      promise->fail(link.error());
+    } else {
+      promise->set(link.isSome());
+    }
+  }).detach();
+
+  return future;
+}
+
+
+Try<string> BlobStore::getBlobPath(const string& digest) const
+{
+  const vector<string> tokens = strings::split(digest, ":");
+
+  auto valid = [](const string& token) {
+    return !token.empty() &&
+      std::all_of(token.begin(), token.end(), [](char c) {
+        return ::isalnum(c) || c == '+' || c == '.' || c == '_' || c == '-';
+      });
+  };
+
+  // NOTE: This also rules out digests which would escape the store.
+  if (tokens.size() != 2 ||
+      !valid(tokens[0]) ||
+      !valid(tokens[1]) ||
+      tokens[0] == STAGING_DIR ||
+      tokens[0][0] == '.' ||
+      tokens[1][0] == '.') {
+    return Error("Invalid blob digest '" + digest + "'");
+  }
+
+  return path::join(rootDir, tokens[0], tokens[1]);
+}
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
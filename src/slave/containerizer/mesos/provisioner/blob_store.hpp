@@ -0,0 +1,135 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __PROVISIONER_BLOB_STORE_HPP__
+#define __PROVISIONER_BLOB_STORE_HPP__
+
+#include <string>
+
+#include <process/future.hpp>
+#include <process/owned.hpp>
+#include <process/shared.hpp>
+
+#include <stout/bytes.hpp>
+#include <stout/nothing.hpp>
+#include <stout/result.hpp>
+#include <stout/try.hpp>
+
+#include <stout/os/int_fd.hpp>
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+// A content addressed store of blobs (e.g., image layer tarballs),
+// keyed by their digests of the form '<algorithm>:<hex>', which the
+// image stores share so that the same bytes are only downloaded once.
+//
+// Blobs are materialized into their consumers by hard links, so the
+// number of links of a blob other than its own one is its reference
+// count. Referenced blobs take no space beyond what their consumers
+// hold anyway, and are never evicted. Only the unreferenced blobs
+// count against the capacity of the store, and the least recently
+// used of them are evicted once they exceed it.
+//
+// NOTE: The store keeps all its state in the filesystem, so several
+// instances may be created on the same directory. Evicting a blob only
+// removes its own link, which leaves concurrent readers and the links
+// created in the meantime intact.
+//
+// Directory layout:
+//
+// <root>
+//   |--staging
+//   |  |--<temp_file>
+//   |--<algorithm>
+//      |--<hex>
+class BlobStore
+{
+public:
+  static Try<process::Owned<BlobStore>> create(
+      const std::string& rootDir,
+      const Bytes& capacity);
+
+  // Opens the blob for reading and marks it as recently used.
+  // Returns None if the blob is not in the store.
+  Result<int_fd> open(const std::string& digest) const;
+
+  // Returns a new file in the staging directory, which a blob can be
+  // written to before it is added with `put`.
+  Try<std::string> stage() const;
+
+  // Adds the file at `path` as the blob of `digest` by linking it into
+  // the store, and evicts blobs if the store exceeds its capacity. The
+  // caller is responsible for verifying that the content matches the
+  // digest, and for removing the file at `path` afterwards.
+  Try<Nothing> put(const std::string& digest, const std::string& path) const;
+
+  // Hard links the blob to `target`, which references the blob until
+  // `target` is removed. The consumer must not modify the file since
+  // it shares the content with the store. Falls back to a private copy
+  // if `target` is on a different filesystem. Returns None if the blob
+  // is not in the store.
+  Result<Nothing> link(
+      const std::string& digest,
+      const std::string& target) const;
+
+  // Creates a private copy of the blob at `target` which the consumer
+  // may modify, e.g., in a sandbox. Uses a reflink if the filesystem
+  // supports it so that the content is only copied once written to.
+  // Returns None if the blob is not in the store.
+  Result<Nothing> copy(
+      const std::string& digest,
+      const std::string& target) const;
+
+  // Evicts the least recently used unreferenced blobs until their
+  // total size is within the capacity of the store.
+  Try<Nothing> prune() const;
+
+  // Calls `put` on a dedicated thread, since copying the file and
+  // evicting blobs block on the filesystem. Callers running on an
+  // actor use this rather than `put`, so that libprocess workers are
+  // never blocked by the store.
+  static process::Future<Nothing> add(
+      const process::Shared<BlobStore>& store,
+      const std::string& digest,
+      const std::string& path);
+
+  // Calls `link` on a dedicated thread for the same reason, since it
+  // may fall back to a copy. Returns whether the blob was in the store.
+  static process::Future<bool> materialize(
+      const process::Shared<BlobStore>& store,
+      const std::string& digest,
+      const std::string& target);
+
+private:
+  BlobStore(const std::string& _rootDir, const Bytes& _capacity)
+    : rootDir(_rootDir), capacity(_capacity) {}
+
+  BlobStore(const BlobStore&) = delete;
+  BlobStore& operator=(const BlobStore&) = delete;
+
+  Try<std::string> getBlobPath(const std::string& digest) const;
+
+  const std::string rootDir;
+  const Bytes capacity;
+};
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __PROVISIONER_BLOB_STORE_HPP__
@@ -14,6 +14,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -24,6 +25,7 @@
 #include <stout/os.hpp>
 #include <stout/protobuf.hpp>
 
+#include <process/clock.hpp>
 #include <process/defer.hpp>
 #include <process/dispatch.hpp>
 #include <process/owned.hpp>
@@ -41,6 +43,7 @@ namespace spec = docker::spec;
 using std::string;
 using std::vector;
 
+using process::Clock;
 using process::Failure;
 using process::Future;
 using process::Owned;
@@ -68,6 +71,10 @@ public:
   Future<hashset<string>> prune(
       const vector<spec::ImageReference>& excludedImages);
 
+  Future<Option<hashset<string>>> evict(
+      const vector<spec::ImageReference>& excludedImages,
+      const hashset<string>& activeLayerIds);
+
 private:
   // Write out metadata manager state to persistent store.
   Try<Nothing> persist();
@@ -78,6 +85,10 @@ private:
   // by image name.
   // For example, "ubuntu:14.04" -> ubuntu14:04 Image.
   hashmap<string, Image> storedImages;
+
+  // The time each stored image was last put or retrieved, keyed by
+  // image name.
+  hashmap<string, process::Time> lastUsed;
 };
 
 
@@ -140,10 +151,23 @@ Future<hashset<string>> MetadataManager::prune(
 }
 
 
+Future<Option<hashset<string>>> MetadataManager::evict(
+    const vector<spec::ImageReference>& excludedImages,
+    const hashset<string>& activeLayerIds)
+{
+  return dispatch(
+      process.get(),
+      &MetadataManagerProcess::evict,
+      excludedImages,
+      activeLayerIds);
+}
+
+
 Future<Image> MetadataManagerProcess::put(const Image& image)
 {
   const string imageReference = stringify(image.reference());
   storedImages[imageReference] = image;
+  lastUsed[imageReference] = Clock::now();
 
   Try<Nothing> status = persist();
   if (status.isError()) {
@@ -173,6 +197,8 @@ Future<Option<Image>> MetadataManagerProcess::get(
     return None();
   }
 
+  lastUsed[imageReference] = Clock::now();
+
   return storedImages[imageReference];
 }
 
@@ -209,6 +235,12 @@ Future<hashset<string>> MetadataManagerProcess::prune(
 
   storedImages = std::move(retainedImages);
 
+  foreach (const string& imageName, lastUsed.keys()) {
+    if (!storedImages.contains(imageName)) {
+      lastUsed.erase(imageName);
+    }
+  }
+
   Try<Nothing> status = persist();
   if (status.isError()) {
     return Failure("Failed to save state of Docker images: " + status.error());
@@ -218,6 +250,81 @@ Future<hashset<string>> MetadataManagerProcess::prune(
 }
 
 
+Future<Option<hashset<string>>> MetadataManagerProcess::evict(
+    const vector<spec::ImageReference>& excludedImages,
+    const hashset<string>& activeLayerIds)
+{
+  hashset<string> excludedImageNames;
+  foreach (const spec::ImageReference& reference, excludedImages) {
+    excludedImageNames.insert(stringify(reference));
+  }
+
+  Option<string> victim;
+
+  foreachpair (const string& imageName, const Image& image, storedImages) {
+    if (excludedImageNames.contains(imageName)) {
+      continue;
+    }
+
+    const bool active = std::any_of(
+        image.layer_ids().begin(),
+        image.layer_ids().end(),
+        [&](const string& layerId) {
+          return activeLayerIds.contains(layerId);
+        });
+
+    if (active) {
+      continue;
+    }
+
+    if (victim.isNone() || lastUsed[imageName] < lastUsed[victim.get()]) {
+      victim = imageName;
+    }
+  }
+
+  if (victim.isNone()) {
+    return None();
+  }
+
+  const Image image = storedImages.at(victim.get());
+
+  storedImages.erase(victim.get());
+
+  Try<Nothing> status = persist();
+  if (status.isError()) {
+    storedImages[victim.get()] = image;
+    return Failure("Failed to save state of Docker images: " + status.error());
+  }
+
+  lastUsed.erase(victim.get());
+
+  hashset<string> layerIds;
+  foreach (const string& layerId, image.layer_ids()) {
+    layerIds.insert(layerId);
+  }
+
+  if (image.has_config_digest()) {
+    layerIds.insert(image.config_digest());
+  }
+
+  // The layers shared with the remaining images are kept.
+  foreachvalue (const Image& retained, storedImages) {
+    foreach (const string& layerId, retained.layer_ids()) {
+      layerIds.erase(layerId);
+    }
+
+    if (retained.has_config_digest()) {
+      layerIds.erase(retained.config_digest());
+    }
+  }
+
+  VLOG(1) << "Evicted image '" << victim.get() << "' with "
+          << layerIds.size() << " unshared layers";
+
+  return layerIds;
+}
+
+
 Try<Nothing> MetadataManagerProcess::persist()
 {
   Images images;
@@ -268,6 +375,7 @@ Future<Nothing> MetadataManagerProcess::recover()
                    << imageReference << "'";
     } else {
       storedImages[imageReference] = image;
+      lastUsed[imageReference] = Clock::now();
     }
 
     VLOG(1) << "Successfully loaded image '" << imageReference << "'";
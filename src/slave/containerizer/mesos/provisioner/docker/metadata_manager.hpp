@@ -98,6 +98,21 @@ public:
   process::Future<hashset<std::string>> prune(
       const std::vector<::docker::spec::ImageReference>& excludedImages);
 
+  /**
+   * Remove the least recently used image which is neither excluded
+   * nor composed of any active layer, and return its layers which no
+   * other image is composed of. The caller should remove such layers.
+   * The last use of an image is only tracked in memory, so all images
+   * count as used upon recovery.
+   *
+   * @param excludedImages all images to exclude from eviction.
+   * @param activeLayerIds the layers used by active containers.
+   * @return the layers to remove, or None if no image can be evicted.
+   */
+  process::Future<Option<hashset<std::string>>> evict(
+      const std::vector<::docker::spec::ImageReference>& excludedImages,
+      const hashset<std::string>& activeLayerIds);
+
 private:
   explicit MetadataManager(process::Owned<MetadataManagerProcess> process);
 
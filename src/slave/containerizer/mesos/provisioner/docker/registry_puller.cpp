@@ -14,6 +14,16 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#ifndef __WINDOWS__
+#include <sys/stat.h>
+#endif // __WINDOWS__
+
+#include <algorithm>
+#include <memory>
+#include <tuple>
+
+#include <boost/shared_array.hpp>
+
 #include <glog/logging.h>
 
 #include <mesos/secret/resolver.hpp>
@@ -22,17 +32,27 @@
 #include <process/defer.hpp>
 #include <process/dispatch.hpp>
 #include <process/http.hpp>
+#include <process/io.hpp>
+#include <process/loop.hpp>
 
+#include <stout/os/close.hpp>
+#include <stout/os/dup.hpp>
 #include <stout/os/exists.hpp>
 #include <stout/os/mkdir.hpp>
-#include <stout/os/rename.hpp>
+#include <stout/os/open.hpp>
+#include <stout/os/pipe.hpp>
 #include <stout/os/rm.hpp>
+#include <stout/os/rmdir.hpp>
 #include <stout/os/write.hpp>
 
 #include "common/command_utils.hpp"
 
+#include "uri/fetchers/docker.hpp"
+
 #include "uri/schemes/docker.hpp"
 
+#include "slave/containerizer/mesos/provisioner/blob_store.hpp"
+
 #include "slave/containerizer/mesos/provisioner/docker/paths.hpp"
 #include "slave/containerizer/mesos/provisioner/docker/registry_puller.hpp"
 
@@ -42,14 +62,20 @@ namespace spec = docker::spec;
 using std::string;
 using std::vector;
 
+using process::Break;
+using process::Continue;
+using process::ControlFlow;
 using process::Failure;
 using process::Future;
 using process::Owned;
 using process::Process;
 using process::Shared;
 
+using process::await;
+using process::collect;
 using process::defer;
 using process::dispatch;
+using process::loop;
 using process::spawn;
 using process::wait;
 
@@ -65,7 +91,9 @@ public:
       const string& _storeDir,
       const http::URL& _defaultRegistryUrl,
       const Shared<uri::Fetcher>& _fetcher,
-      SecretResolver* _secretResolver);
+      SecretResolver* _secretResolver,
+      size_t _concurrency,
+      const Option<Shared<BlobStore>>& _blobStore);
 
   Future<Image> pull(
       const spec::ImageReference& reference,
@@ -90,35 +118,35 @@ private:
     const spec::ImageReference& reference,
     const string& directory,
     const spec::v2::ImageManifest& manifest,
-    const hashset<string>& blobSums,
-    const string& backend);
+    const string& backend,
+    const Option<Secret::Value>& config);
 
   Future<Image> ____pull(
     const spec::ImageReference& reference,
     const string& directory,
     const spec::v2_2::ImageManifest& manifest,
-    const hashset<string>& digests,
-    const string& backend);
-
-  Future<hashset<string>> fetchBlobs(
-    const spec::ImageReference& normalizedRef,
-    const string& directory,
-    const spec::v2::ImageManifest& manifest,
     const string& backend,
     const Option<Secret::Value>& config);
 
-  Future<hashset<string>> fetchBlobs(
+  // Fetches the given layers and extracts each of them into its
+  // rootfses, with at most `concurrency` layers at a time.
+  Future<Nothing> fetchLayers(
       const spec::ImageReference& normalizedRef,
       const string& directory,
-      const spec::v2_2::ImageManifest& manifest,
-      const string& backend,
+      const hashmap<string, vector<string>>& layers,
       const Option<Secret::Value>& config);
 
-  Future<hashset<string>> fetchBlobs(
+  Future<Nothing> fetchLayer(
       const spec::ImageReference& normalizedRef,
       const string& directory,
-      const hashset<string>& digests,
-      const string& backend,
+      const string& digest,
+      const vector<string>& rootfses,
+      const Option<Secret::Value>& config);
+
+  Future<Nothing> fetchBlob(
+      const spec::ImageReference& normalizedRef,
+      const string& directory,
+      const string& digest,
       const Option<Secret::Value>& config);
 
   RegistryPullerProcess(const RegistryPullerProcess&) = delete;
@@ -132,6 +160,14 @@ private:
 
   Shared<uri::Fetcher> fetcher;
   SecretResolver* secretResolver;
+
+  // The maximum number of layers that are fetched in parallel.
+  const size_t concurrency;
+
+  // The layer tarballs are kept in the blob store, if any, so that
+  // they do not have to be downloaded again, e.g., after the layers
+  // have been removed from the image store.
+  Option<Shared<BlobStore>> blobStore;
 };
 
 
@@ -147,6 +183,18 @@ Try<Owned<Puller>> RegistryPuller::create(
         defaultRegistryUrl.error());
   }
 
+  Option<Shared<BlobStore>> blobStore;
+  if (flags.blob_store_capacity > 0) {
+    Try<Owned<BlobStore>> _blobStore =
+      BlobStore::create(flags.blob_store_dir, flags.blob_store_capacity);
+
+    if (_blobStore.isError()) {
+      return Error("Failed to create the blob store: " + _blobStore.error());
+    }
+
+    blobStore = _blobStore->share();
+  }
+
   VLOG(1) << "Creating registry puller with docker registry '"
           << flags.docker_registry << "'";
 
@@ -155,7 +203,9 @@ Try<Owned<Puller>> RegistryPuller::create(
           flags.docker_store_dir,
           defaultRegistryUrl.get(),
           fetcher,
-          secretResolver));
+          secretResolver,
+          flags.docker_registry_concurrency,
+          blobStore));
 
   return Owned<Puller>(new RegistryPuller(process));
 }
@@ -195,12 +245,16 @@ RegistryPullerProcess::RegistryPullerProcess(
     const string& _storeDir,
     const http::URL& _defaultRegistryUrl,
     const Shared<uri::Fetcher>& _fetcher,
-    SecretResolver* _secretResolver)
+    SecretResolver* _secretResolver,
+    size_t _concurrency,
+    const Option<Shared<BlobStore>>& _blobStore)
   : ProcessBase(process::ID::generate("docker-provisioner-registry-puller")),
     storeDir(_storeDir),
     defaultRegistryUrl(_defaultRegistryUrl),
     fetcher(_fetcher),
-    secretResolver(_secretResolver) {}
+    secretResolver(_secretResolver),
+    concurrency(_concurrency),
+    blobStore(_blobStore) {}
 
 
 static spec::ImageReference normalize(
@@ -238,6 +292,186 @@ static spec::ImageReference normalize(
 }
 
 
+#ifndef __WINDOWS__
+// Returns the compression of a layer tarball based on the magic number
+// at its start, because tar cannot detect the compression of a stream.
+static Option<command::Compression> compression(const string& header)
+{
+  if (strings::startsWith(header, "\x1f\x8b")) {
+    return command::Compression::GZIP;
+  }
+
+  if (strings::startsWith(header, "BZh")) {
+    return command::Compression::BZIP2;
+  }
+
+  if (strings::startsWith(header, string("\xfd" "7zXZ\0", 6))) {
+    return command::Compression::XZ;
+  }
+
+  return None();
+}
+
+
+// Writes the data to all the given file descriptors.
+static Future<Nothing> write(const vector<int_fd>& fds, const string& data)
+{
+  vector<Future<Nothing>> futures;
+  foreach (int_fd fd, fds) {
+    futures.push_back(process::io::write(fd, data));
+  }
+
+  return collect(futures)
+    .then([]() { return Nothing(); });
+}
+
+
+// Extracts the layer tarball read from 'input' until EOF into each of
+// the 'rootfses', and verifies its checksum against the 'digest' on
+// the way if the digest is a SHA 256 one. The tarball is also written
+// to 'blob' if set, which the caller remains responsible for.
+static Future<Nothing> extractLayer(
+    int_fd input,
+    const string& digest,
+    const vector<string>& rootfses,
+    const Option<int_fd>& blob = None())
+{
+  // The longest magic number is the one of xz.
+  const size_t HEADER_SIZE = 6;
+  const size_t BUFFER_SIZE = 64 * 1024;
+
+  Try<Nothing> async = process::io::prepare_async(input);
+  if (async.isError()) {
+    return Failure(
+        "Failed to make the layer input asynchronous: " + async.error());
+  }
+
+  boost::shared_array<char> data(new char[BUFFER_SIZE]);
+  std::shared_ptr<string> header(new string());
+
+  // First, read enough of the tarball to detect its compression.
+  return loop(
+      [=]() {
+        return process::io::read(input, data.get(), BUFFER_SIZE);
+      },
+      [=](size_t length) -> ControlFlow<Nothing> {
+        header->append(data.get(), length);
+
+        if (length == 0 || header->size() >= HEADER_SIZE) {
+          return Break();
+        }
+
+        return Continue();
+      })
+    .then([=]() -> Future<Nothing> {
+      vector<int_fd> outputs;
+      vector<Future<Nothing>> untars;
+      Option<Future<string>> checksum;
+
+      auto close = [](const vector<int_fd>& fds) {
+        foreach (int_fd fd, fds) {
+          os::close(fd);
+        }
+      };
+
+      foreach (const string& rootfs, rootfses) {
+        Try<std::array<int_fd, 2>> pipe = os::pipe();
+        if (pipe.isError()) {
+          close(outputs);
+          return Failure("Failed to create pipe: " + pipe.error());
+        }
+
+        untars.push_back(
+            command::untar(pipe->at(0), Path(rootfs), compression(*header)));
+
+        os::close(pipe->at(0));
+        outputs.push_back(pipe->at(1));
+      }
+
+      if (strings::startsWith(digest, "sha256:")) {
+        Try<std::array<int_fd, 2>> pipe = os::pipe();
+        if (pipe.isError()) {
+          close(outputs);
+          return Failure("Failed to create pipe: " + pipe.error());
+        }
+
+        checksum = command::sha256(pipe->at(0));
+
+        os::close(pipe->at(0));
+        outputs.push_back(pipe->at(1));
+      }
+
+      if (blob.isSome()) {
+        Try<int_fd> dup = os::dup(blob.get());
+        if (dup.isError()) {
+          close(outputs);
+          return Failure("Failed to duplicate the blob file: " + dup.error());
+        }
+
+        outputs.push_back(dup.get());
+      }
+
+      // Then, pass the read part and the rest of the tarball on.
+      Future<Nothing> copy = write(outputs, *header)
+        .then([=]() {
+          return loop(
+              [=]() {
+                return process::io::read(input, data.get(), BUFFER_SIZE);
+              },
+              [=](size_t length) -> Future<ControlFlow<Nothing>> {
+                if (length == 0) {
+                  return Break();
+                }
+
+                return write(outputs, string(data.get(), length))
+                  .then([]() -> ControlFlow<Nothing> { return Continue(); });
+              });
+        });
+
+      return await(copy)
+        .then([=](const Future<Nothing>& copied) {
+          // Closing the pipes lets tar know the tarball is complete.
+          close(outputs);
+
+          return await(untars)
+            .then([=](const vector<Future<Nothing>>& extracted)
+                -> Future<Nothing> {
+              // NOTE: A failed extraction makes the copy fail as well,
+              // so its failure is reported first.
+              foreach (const Future<Nothing>& untar, extracted) {
+                if (!untar.isReady()) {
+                  return Failure(
+                      untar.isFailed() ? untar.failure() : "discarded");
+                }
+              }
+
+              if (!copied.isReady()) {
+                return Failure(
+                    "Failed to read the layer: " +
+                    (copied.isFailed() ? copied.failure() : "discarded"));
+              }
+
+              if (checksum.isNone()) {
+                return Nothing();
+              }
+
+              return checksum->then([=](const string& sha256)
+                  -> Future<Nothing> {
+                if ("sha256:" + sha256 != digest) {
+                  return Failure(
+                      "The checksum 'sha256:" + sha256 + "' of the layer "
+                      "does not match its digest");
+                }
+
+                return Nothing();
+              });
+            });
+        });
+    });
+}
+#endif // __WINDOWS__
+
+
 Future<Image> RegistryPullerProcess::pull(
     const spec::ImageReference& reference,
     const string& directory,
@@ -360,14 +594,7 @@ Future<Image> RegistryPullerProcess::__pull(
       return Failure("Failed to parse the manifest: " + manifest.error());
     }
 
-    return fetchBlobs(normalizedRef, directory, manifest.get(), backend, config)
-      .then(defer(self(),
-                  &Self::____pull,
-                  reference,
-                  directory,
-                  manifest.get(),
-                  lambda::_1,
-                  backend));
+    return ____pull(reference, directory, manifest.get(), backend, config);
   }
 
   // By default treat the manifest format as schema 1.
@@ -382,14 +609,7 @@ Future<Image> RegistryPullerProcess::__pull(
     return Failure("'fsLayers' and 'history' have different size in manifest");
   }
 
-  return fetchBlobs(normalizedRef, directory, manifest.get(), backend, config)
-    .then(defer(self(),
-                &Self::___pull,
-                reference,
-                directory,
-                manifest.get(),
-                lambda::_1,
-                backend));
+  return ___pull(reference, directory, manifest.get(), backend, config);
 }
 
 
@@ -397,9 +617,11 @@ Future<Image> RegistryPullerProcess::___pull(
     const spec::ImageReference& reference,
     const string& directory,
     const spec::v2::ImageManifest& manifest,
-    const hashset<string>& blobSums,
-    const string& backend)
+    const string& backend,
+    const Option<Secret::Value>& config)
 {
+  spec::ImageReference normalizedRef = normalize(reference, defaultRegistryUrl);
+
   // Docker reads the layer ids from the disk:
   // https://github.com/docker/docker/blob/v1.13.0/layer/filestore.go#L310
   //
@@ -420,10 +642,14 @@ Future<Image> RegistryPullerProcess::___pull(
   // sure ids are unique.
   hashset<string> uniqueIds;
   vector<string> layerIds;
-  vector<Future<Nothing>> futures;
 
-  LOG(INFO) << "Extracting layers to '" << directory
-            << "' for image '" << reference << "'";
+  // The rootfses each blob has to be extracted into, keyed by the blob
+  // sum. There might exist duplicated blob sums in 'fsLayers', which
+  // are only fetched once.
+  hashmap<string, vector<string>> blobs;
+
+  LOG(INFO) << "Pulling layers to '" << directory
+            << "' for image '" << normalizedRef << "'";
 
   // The order of `fslayers` should be [child, parent, ...].
   //
@@ -452,12 +678,12 @@ Future<Image> RegistryPullerProcess::___pull(
     }
 
     const string layerPath = path::join(directory, v1.id());
-    const string tar = path::join(directory, blobSum);
     const string rootfs = paths::getImageLayerRootfsPath(layerPath, backend);
     const string json = paths::getImageLayerManifestPath(layerPath);
 
-    VLOG(1) << "Extracting layer tar ball '" << tar << " to rootfs '"
-            << rootfs << "' for image '" << reference << "'";
+    VLOG(1) << "Fetching blob '" << blobSum << "' for layer '" << v1.id()
+            << "' of image '" << normalizedRef << "' to rootfs '"
+            << rootfs << "'";
 
     // NOTE: This will create 'layerPath' as well.
     Try<Nothing> mkdir = os::mkdir(rootfs, true);
@@ -474,23 +700,11 @@ Future<Image> RegistryPullerProcess::___pull(
           v1.id() + "': " + write.error());
     }
 
-    futures.push_back(command::untar(Path(tar), Path(rootfs)));
+    blobs[blobSum].push_back(rootfs);
   }
 
-  return collect(futures)
-    .then([=]() -> Future<Image> {
-      // Remove the tarballs after the extraction.
-      foreach (const string& blobSum, blobSums) {
-        const string tar = path::join(directory, blobSum);
-
-        Try<Nothing> rm = os::rm(tar);
-        if (rm.isError()) {
-          return Failure(
-              "Failed to remove '" + tar + "' "
-              "after extraction: " + rm.error());
-        }
-      }
-
+  return fetchLayers(normalizedRef, directory, blobs, config)
+    .then([=]() -> Image {
       Image image;
       image.mutable_reference()->CopyFrom(reference);
       foreach (const string& layerId, layerIds) {
@@ -506,15 +720,28 @@ Future<Image> RegistryPullerProcess::____pull(
     const spec::ImageReference& reference,
     const string& directory,
     const spec::v2_2::ImageManifest& manifest,
-    const hashset<string>& digests,
-    const string& backend)
+    const string& backend,
+    const Option<Secret::Value>& config)
 {
+  spec::ImageReference normalizedRef = normalize(reference, defaultRegistryUrl);
+
+  // The config is fetched along with the layers.
+  Future<Nothing> fetchConfig = Nothing();
+
+  const string& configDigest = manifest.config().digest();
+  if (!os::exists(paths::getImageLayerPath(storeDir, configDigest))) {
+    LOG(INFO) << "Fetching config '" << configDigest << "' to '" << directory
+              << "' for image '" << normalizedRef << "'";
+
+    fetchConfig = fetchBlob(normalizedRef, directory, configDigest, config);
+  }
+
   hashset<string> uniqueIds;
   vector<string> layerIds;
-  vector<Future<Nothing>> futures;
+  hashmap<string, vector<string>> layers;
 
-  LOG(INFO) << "Extracting layers to '" << directory
-            << "' for image '" << reference << "'";
+  LOG(INFO) << "Pulling layers to '" << directory
+            << "' for image '" << normalizedRef << "'";
 
   for (int i = 0; i < manifest.layers_size(); i++) {
     const string& digest = manifest.layers(i).digest();
@@ -531,23 +758,10 @@ Future<Image> RegistryPullerProcess::____pull(
     }
 
     const string layerPath = path::join(directory, digest);
-    const string originalTar = path::join(directory, digest);
-    const string tar = path::join(directory, digest + "-archive");
     const string rootfs = paths::getImageLayerRootfsPath(layerPath, backend);
 
-    VLOG(1) << "Moving layer tar ball '" << originalTar << "' to '"
-            << tar << "' for image '" << reference << "'";
-
-    // Move layer tar ball to use its name for the extracted layer directory.
-    Try<Nothing> rename = os::rename(originalTar, tar);
-    if (rename.isError()) {
-      return Failure(
-          "Failed to move the layer tar ball from '" + originalTar +
-          "' to '" + tar + "': " + rename.error());
-    }
-
-    VLOG(1) << "Extracting layer tar ball '" << tar << "' to rootfs '"
-            << rootfs << "' for image '" << reference << "'";
+    VLOG(1) << "Fetching layer '" << digest << "' of image '"
+            << normalizedRef << "' to rootfs '" << rootfs << "'";
 
     // NOTE: This will create 'layerPath' as well.
     Try<Nothing> mkdir = os::mkdir(rootfs, true);
@@ -557,26 +771,14 @@ Future<Image> RegistryPullerProcess::____pull(
           "for layer '" + digest + "': " + mkdir.error());
     }
 
-    futures.push_back(command::untar(Path(tar), Path(rootfs)));
+    layers[digest].push_back(rootfs);
   }
 
-  return collect(futures)
-    .then([=]() -> Future<Image> {
-      // Remove the tarballs after the extraction.
-      foreach (const string& digest, digests) {
-        // Skip if the digest represents the image manifest config.
-        if (digest == manifest.config().digest()) {
-          continue;
-        }
-
-        const string tar = path::join(directory, digest + "-archive");
-        Try<Nothing> rm = os::rm(tar);
-        if (rm.isError()) {
-          return Failure(
-              "Failed to remove '" + tar + "' after extraction: " + rm.error());
-        }
-      }
+  Future<Nothing> fetchLayers =
+    this->fetchLayers(normalizedRef, directory, layers, config);
 
+  return collect(fetchConfig, fetchLayers)
+    .then([=]() -> Image {
       Image image;
       image.set_config_digest(manifest.config().digest());
       image.mutable_reference()->CopyFrom(reference);
@@ -589,145 +791,299 @@ Future<Image> RegistryPullerProcess::____pull(
 }
 
 
-Future<hashset<string>> RegistryPullerProcess::fetchBlobs(
+Future<Nothing> RegistryPullerProcess::fetchLayers(
     const spec::ImageReference& normalizedRef,
     const string& directory,
-    const spec::v2::ImageManifest& manifest,
-    const string& backend,
+    const hashmap<string, vector<string>>& layers,
     const Option<Secret::Value>& config)
 {
-  // First, find all the blobs that need to be fetched.
-  //
-  // NOTE: There might exist duplicated blob sums in 'fsLayers'. We
-  // just need to fetch one of them.
-  hashset<string> blobSums;
-
-  LOG(INFO) << "Fetching blobs to '" << directory << "' for image '"
-            << normalizedRef << "'";
-
-  for (int i = 0; i < manifest.fslayers_size(); i++) {
-    CHECK(manifest.history(i).has_v1());
-    const spec::v1::ImageManifest& v1 = manifest.history(i).v1();
-
-    // Check if the layer is in the store or not. If yes, skip the
-    // unnecessary fetching.
-    if (os::exists(
-        paths::getImageLayerRootfsPath(storeDir, v1.id(), backend))) {
-      continue;
-    }
+  if (layers.empty()) {
+    return Nothing();
+  }
 
-    const string& blobSum = manifest.fslayers(i).blobsum();
+  // The layer tarballs are streamed through this directory instead of
+  // the staging directory, where the schema 2 layers are extracted to
+  // directories named after their digests.
+  const string blobsDir = path::join(directory, "blobs");
 
-    VLOG(1) << "Fetching blob '" << blobSum << "' for layer '" << v1.id()
-            << "' of image '" << normalizedRef << "' to '" << directory << "'";
+  Try<Nothing> mkdir = os::mkdir(blobsDir);
+  if (mkdir.isError()) {
+    return Failure(
+        "Failed to create blobs directory '" + blobsDir + "': " +
+        mkdir.error());
+  }
 
-    blobSums.insert(blobSum);
+  // Distribute the layers over at most `concurrency` lanes, each of
+  // which fetches its layers one after the other, so that an image
+  // with many layers does not open as many connections to the registry.
+  vector<Future<Nothing>> lanes(
+      std::min(concurrency, layers.size()),
+      Future<Nothing>(Nothing()));
+
+  size_t i = 0;
+  foreachpair (const string& digest,
+               const vector<string>& rootfses,
+               layers) {
+    Future<Nothing>& lane = lanes[i++ % lanes.size()];
+
+    lane = lane.then(defer(
+        self(),
+        &Self::fetchLayer,
+        normalizedRef,
+        blobsDir,
+        digest,
+        rootfses,
+        config));
   }
 
-  return fetchBlobs(normalizedRef, directory, blobSums, backend, config);
+  return collect(lanes)
+    .then([blobsDir]() -> Future<Nothing> {
+      Try<Nothing> rmdir = os::rmdir(blobsDir);
+      if (rmdir.isError()) {
+        return Failure(
+            "Failed to remove blobs directory '" + blobsDir + "': " +
+            rmdir.error());
+      }
+
+      return Nothing();
+    });
 }
 
 
-Future<hashset<string>> RegistryPullerProcess::fetchBlobs(
+Future<Nothing> RegistryPullerProcess::fetchLayer(
     const spec::ImageReference& normalizedRef,
     const string& directory,
-    const spec::v2_2::ImageManifest& manifest,
-    const string& backend,
+    const string& digest,
+    const vector<string>& rootfses,
     const Option<Secret::Value>& config)
 {
-  // First, find all the blobs that need to be fetched.
-  //
-  // NOTE: There might exist duplicated digests in 'layers'. We
-  // just need to fetch one of them.
-  hashset<string> digests;
+#ifdef __WINDOWS__
+  // There are no named pipes which the fetcher could write to on
+  // Windows, so the layer tarball is extracted once it is fetched.
+  return fetchBlob(normalizedRef, directory, digest, config)
+    .then([=]() -> Future<Nothing> {
+      const string tar =
+        uri::DockerFetcherPlugin::getBlobPath(directory, digest);
+
+      vector<Future<Nothing>> futures;
+      foreach (const string& rootfs, rootfses) {
+        futures.push_back(command::untar(Path(tar), Path(rootfs)));
+      }
 
-  const string& configDigest = manifest.config().digest();
-  if (!os::exists(paths::getImageLayerPath(storeDir, configDigest))) {
-    LOG(INFO) << "Fetching config '" << configDigest << "' to '" << directory
-              << "' for image '" << normalizedRef << "'";
+      return collect(futures)
+        .then([tar]() -> Future<Nothing> {
+          Try<Nothing> rm = os::rm(tar);
+          if (rm.isError()) {
+            return Failure(
+                "Failed to remove '" + tar + "' "
+                "after extraction: " + rm.error());
+          }
+
+          return Nothing();
+        });
+    });
+#else
+  // A layer tarball which is in the blob store is not downloaded again.
+  if (blobStore.isSome()) {
+    Result<int_fd> blob = blobStore.get()->open(digest);
+    if (blob.isError()) {
+      LOG(WARNING) << "Failed to open layer '" << digest << "' in the "
+                   << "blob store: " << blob.error();
+    } else if (blob.isSome()) {
+      VLOG(1) << "Extracting layer '" << digest << "' from the blob store";
+
+      const int_fd input = blob.get();
+
+      return extractLayer(input, digest, rootfses)
+        .onAny([input]() { os::close(input); });
+    }
+  }
+
+  // The fetcher writes the layer tarball into a FIFO, from which it
+  // is extracted and verified while it is being downloaded. This way
+  // the tarball is never written to disk and the extraction does not
+  // have to wait for the download.
+  const string fifo = uri::DockerFetcherPlugin::getBlobPath(directory, digest);
+
+  if (::mkfifo(fifo.c_str(), 0600) != 0) {
+    return Failure(ErrnoError("Failed to create FIFO '" + fifo + "'").message);
+  }
 
-    digests.insert(configDigest);
+  // NOTE: The reading end has to be opened before the fetcher opens
+  // the FIFO for writing, which would block otherwise. We also keep a
+  // writing end open until the fetch is done, so that the extraction
+  // does not see an EOF before the fetcher opens the FIFO, or between
+  // the attempts of the fetcher (e.g., after authenticating).
+  Try<int_fd> reader = os::open(fifo, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+  if (reader.isError()) {
+    os::rm(fifo);
+    return Failure(
+        "Failed to open FIFO '" + fifo + "' for reading: " + reader.error());
   }
 
-  LOG(INFO) << "Fetching layers to '" << directory << "' for image '"
-            << normalizedRef << "'";
+  Try<int_fd> writer = os::open(fifo, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+  if (writer.isError()) {
+    os::close(reader.get());
+    os::rm(fifo);
+    return Failure(
+        "Failed to open FIFO '" + fifo + "' for writing: " + writer.error());
+  }
 
-  for (int i = 0; i < manifest.layers_size(); i++) {
-    const string& digest = manifest.layers(i).digest();
+  const int_fd input = reader.get();
+  const int_fd output = writer.get();
 
-    // Check if the layer is in the store or not. If yes, skip the unnecessary
-    // fetching.
-    if (os::exists(paths::getImageLayerRootfsPath(storeDir, digest, backend))) {
-      continue;
+  // Only tarballs whose checksum is verified while they are extracted
+  // are added to the blob store.
+  Option<string> staged;
+  Option<int_fd> blob;
+
+  if (blobStore.isSome() && strings::startsWith(digest, "sha256:")) {
+    Try<string> stage = blobStore.get()->stage();
+    Try<int_fd> open = stage.isError()
+      ? Error(stage.error())
+      : os::open(stage.get(), O_WRONLY | O_CLOEXEC);
+
+    if (open.isError()) {
+      LOG(WARNING) << "Failed to stage layer '" << digest << "' in the "
+                   << "blob store: " << open.error();
+
+      if (stage.isSome()) {
+        os::rm(stage.get());
+      }
+    } else {
+      staged = stage.get();
+      blob = open.get();
     }
+  }
 
-    VLOG(1) << "Fetching layer '" << digest << "' to '" << directory
-            << "' for image '" << normalizedRef << "'";
+  Future<Nothing> extract = extractLayer(input, digest, rootfses, blob)
+    .onAny([input, blob]() {
+      os::close(input);
+
+      if (blob.isSome()) {
+        os::close(blob.get());
+      }
+    });
+
+  Future<Nothing> fetch = fetchBlob(normalizedRef, directory, digest, config)
+    .onAny([output]() { os::close(output); });
+
+  Future<Nothing> layer = await(fetch, extract)
+    .then([=](const std::tuple<Future<Nothing>, Future<Nothing>>& t)
+        -> Future<Nothing> {
+      Try<Nothing> rm = os::rm(fifo);
+      if (rm.isError()) {
+        return Failure("Failed to remove FIFO '" + fifo + "': " + rm.error());
+      }
+
+      // A failed fetch fails the extraction as well, so report the
+      // cause of the failure in that case.
+      const Future<Nothing>& fetched = std::get<0>(t);
+      if (!fetched.isReady()) {
+        return Failure(
+            "Failed to fetch layer '" + digest + "': " +
+            (fetched.isFailed() ? fetched.failure() : "discarded"));
+      }
+
+      const Future<Nothing>& extracted = std::get<1>(t);
+      if (!extracted.isReady()) {
+        return Failure(
+            "Failed to extract layer '" + digest + "': " +
+            (extracted.isFailed() ? extracted.failure() : "discarded"));
+      }
+
+      return Nothing();
+    });
 
-    digests.insert(digest);
+  if (staged.isNone()) {
+    return layer;
   }
 
-  return fetchBlobs(normalizedRef, directory, digests, backend, config);
+  const Shared<BlobStore> store = blobStore.get();
+
+  auto removeStaged = [=]() {
+    Try<Nothing> rm = os::rm(staged.get());
+    if (rm.isError()) {
+      LOG(WARNING) << "Failed to remove staged layer '" << staged.get()
+                   << "': " << rm.error();
+    }
+  };
+
+  return await(layer)
+    .then([=](const Future<Nothing>& layer) -> Future<Nothing> {
+      if (!layer.isReady()) {
+        removeStaged();
+        return layer;
+      }
+
+      // The staged tarball is added on a dedicated thread, since it
+      // may be copied and blobs may be evicted. Removing it afterwards
+      // merely drops a link once it has been added.
+      return await(BlobStore::add(store, digest, staged.get()))
+        .then([=](const Future<Nothing>& add) {
+          if (!add.isReady()) {
+            LOG(WARNING) << "Failed to add layer '" << digest << "' to the "
+                         << "blob store: "
+                         << (add.isFailed() ? add.failure() : "discarded");
+          }
+
+          removeStaged();
+          return Nothing();
+        });
+    });
+#endif // __WINDOWS__
 }
 
 
-Future<hashset<string>> RegistryPullerProcess::fetchBlobs(
+Future<Nothing> RegistryPullerProcess::fetchBlob(
     const spec::ImageReference& normalizedRef,
     const string& directory,
-    const hashset<string>& digests,
-    const string& backend,
+    const string& digest,
     const Option<Secret::Value>& config)
 {
-  vector<Future<Nothing>> futures;
+  URI blobUri;
 
-  foreach (const string& digest, digests) {
-    URI blobUri;
+  if (normalizedRef.has_registry()) {
+    Result<int> port = spec::getRegistryPort(normalizedRef.registry());
+    if (port.isError()) {
+      return Failure("Failed to get registry port: " + port.error());
+    }
 
-    if (normalizedRef.has_registry()) {
-      Result<int> port = spec::getRegistryPort(normalizedRef.registry());
-      if (port.isError()) {
-        return Failure("Failed to get registry port: " + port.error());
-      }
+    Try<string> scheme = spec::getRegistryScheme(normalizedRef.registry());
+    if (scheme.isError()) {
+      return Failure("Failed to get registry scheme: " + scheme.error());
+    }
 
-      Try<string> scheme = spec::getRegistryScheme(normalizedRef.registry());
-      if (scheme.isError()) {
-        return Failure("Failed to get registry scheme: " + scheme.error());
-      }
+    // If users want to use the registry specified in '--docker_image',
+    // an URL scheme must be specified in '--docker_registry', because
+    // there is no scheme allowed in docker image name.
+    blobUri = uri::docker::blob(
+        normalizedRef.repository(),
+        digest,
+        spec::getRegistryHost(normalizedRef.registry()),
+        scheme.get(),
+        port.isSome() ? port.get() : Option<int>());
+  } else {
+    const string registry = defaultRegistryUrl.domain.isSome()
+      ? defaultRegistryUrl.domain.get()
+      : stringify(defaultRegistryUrl.ip.get());
 
-      // If users want to use the registry specified in '--docker_image',
-      // an URL scheme must be specified in '--docker_registry', because
-      // there is no scheme allowed in docker image name.
-      blobUri = uri::docker::blob(
-          normalizedRef.repository(),
-          digest,
-          spec::getRegistryHost(normalizedRef.registry()),
-          scheme.get(),
-          port.isSome() ? port.get() : Option<int>());
-    } else {
-      const string registry = defaultRegistryUrl.domain.isSome()
-        ? defaultRegistryUrl.domain.get()
-        : stringify(defaultRegistryUrl.ip.get());
-
-      const Option<int> port = defaultRegistryUrl.port.isSome()
-        ? static_cast<int>(defaultRegistryUrl.port.get())
-        : Option<int>();
-
-      blobUri = uri::docker::blob(
-          normalizedRef.repository(),
-          digest,
-          registry,
-          defaultRegistryUrl.scheme,
-          port);
-    }
+    const Option<int> port = defaultRegistryUrl.port.isSome()
+      ? static_cast<int>(defaultRegistryUrl.port.get())
+      : Option<int>();
 
-    futures.push_back(fetcher->fetch(
-        blobUri,
-        directory,
-        config.isSome() ? config->data() : Option<string>()));
+    blobUri = uri::docker::blob(
+        normalizedRef.repository(),
+        digest,
+        registry,
+        defaultRegistryUrl.scheme,
+        port);
   }
 
-  return collect(futures)
-    .then([digests]() -> hashset<string> { return digests; });
+  return fetcher->fetch(
+      blobUri,
+      directory,
+      config.isSome() ? config->data() : Option<string>());
 }
 
 } // namespace docker {
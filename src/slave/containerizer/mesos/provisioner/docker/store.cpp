@@ -23,6 +23,7 @@
 
 #include <mesos/secret/resolver.hpp>
 
+#include <stout/bytes.hpp>
 #include <stout/hashmap.hpp>
 #include <stout/hashset.hpp>
 #include <stout/json.hpp>
@@ -34,9 +35,12 @@
 #include <process/executor.hpp>
 #include <process/id.hpp>
 
+#include <process/metrics/counter.hpp>
 #include <process/metrics/metrics.hpp>
 #include <process/metrics/timer.hpp>
 
+#include "slave/containerizer/mesos/isolators/posix/disk_usage.hpp"
+
 #include "slave/containerizer/mesos/provisioner/constants.hpp"
 #include "slave/containerizer/mesos/provisioner/utils.hpp"
 
@@ -96,22 +100,42 @@ public:
       const std::vector<mesos::Image>& excludeImages,
       const hashset<string>& activeLayerPaths);
 
+  Future<Option<Bytes>> evict(
+      const std::vector<mesos::Image>& excludedImages,
+      const hashset<string>& activeLayerPaths);
+
 private:
   struct Metrics
   {
     Metrics() :
         image_pull(
-          "containerizer/mesos/provisioner/docker_store/image_pull", Hours(1))
+          "containerizer/mesos/provisioner/docker_store/image_pull", Hours(1)),
+        gc_reclaimed_bytes(
+          "containerizer/mesos/provisioner/docker_store/gc_reclaimed_bytes"),
+        gc_pause(
+          "containerizer/mesos/provisioner/docker_store/gc_pause", Hours(1))
     {
       process::metrics::add(image_pull);
+      process::metrics::add(gc_reclaimed_bytes);
+      process::metrics::add(gc_pause);
     }
 
     ~Metrics()
     {
       process::metrics::remove(image_pull);
+      process::metrics::remove(gc_reclaimed_bytes);
+      process::metrics::remove(gc_pause);
     }
 
     process::metrics::Timer<Milliseconds> image_pull;
+
+    // The disk space freed by removing the layers of pruned or evicted
+    // images.
+    process::metrics::Counter gc_reclaimed_bytes;
+
+    // The time the layers of pruned or evicted images are being marked
+    // for removal, during which images cannot be provisioned.
+    process::metrics::Timer<Milliseconds> gc_pause;
   };
 
   Future<Image> _get(
@@ -138,6 +162,10 @@ private:
       const hashset<string>& activeLayerPaths,
       const hashset<string>& retainedImageLayers);
 
+  Future<Option<Bytes>> _evict(const Option<hashset<string>>& layerIds);
+
+  void resume(const Owned<Promise<Nothing>>& gate);
+
   const Flags flags;
 
   Owned<MetadataManager> metadataManager;
@@ -163,6 +191,15 @@ private:
   // for the image being pulled.
   hashmap<string, Pull> pulling;
 
+  // The number of `get()` calls in flight. The layers they return are
+  // not referenced by the provisioner until they complete, so images
+  // are not evicted meanwhile.
+  size_t getting = 0;
+
+  // Set while an eviction is marking layers for removal. The `get()`
+  // calls wait for it, so that they never return the evicted layers.
+  Option<Owned<Promise<Nothing>>> evicting;
+
   // For executing path removals in a separated actor.
   process::Executor executor;
 
@@ -182,6 +219,8 @@ Try<Owned<slave::Store>> Store::create(
 #ifndef __WINDOWS__
   _flags.docker_config = flags.docker_config;
   _flags.docker_stall_timeout = flags.fetcher_stall_timeout;
+  _flags.docker_registry_native_client = flags.docker_registry_native_client;
+  _flags.docker_registry_max_connections = flags.docker_registry_concurrency;
 #endif
 
   if (flags.hadoop_home.isSome()) {
@@ -279,6 +318,49 @@ Future<Nothing> Store::prune(
 }
 
 
+Future<Option<Bytes>> Store::evict(
+    const vector<mesos::Image>& excludedImages,
+    const hashset<string>& activeLayerPaths)
+{
+  return dispatch(
+      process.get(), &StoreProcess::evict, excludedImages, activeLayerPaths);
+}
+
+
+// Removes a layer which has been marked for removal by moving it to
+// the gc directory. Returns the disk space reclaimed.
+static Bytes removeLayer(const string& path)
+{
+  DiskUsageWalker::Options options;
+  options.incremental = false;
+
+  Try<Bytes> usage = DiskUsageWalker(path, options).walk({});
+  if (usage.isError()) {
+    LOG(WARNING) << "Failed to get the disk usage of '" << path << "': "
+                 << usage.error();
+
+    usage = Bytes(0);
+  }
+
+  // Run the removal operation with 'continueOnError = false'.
+  // A possible situation is that we incorrectly marked a layer
+  // which is still used by certain layer based backends (aufs, overlay).
+  // In such a case, we proceed with a warning and try to free up as much
+  // disk spaces as possible.
+  LOG(INFO) << "Deleting path '" << path << "'";
+  Try<Nothing> rmdir = os::rmdir(path, true, true, false);
+
+  if (rmdir.isError()) {
+    LOG(WARNING) << "Failed to delete '" << path << "': " << rmdir.error();
+    return Bytes(0);
+  }
+
+  LOG(INFO) << "Deleted '" << path << "'";
+
+  return usage.get();
+}
+
+
 Future<Nothing> StoreProcess::recover()
 {
   return metadataManager->recover();
@@ -301,6 +383,13 @@ Future<ImageInfo> StoreProcess::get(
                    "': " + reference.error());
   }
 
+  if (evicting.isSome()) {
+    return evicting.get()->future()
+      .then(defer(self(), &Self::get, image, backend));
+  }
+
+  ++getting;
+
   return metadataManager->get(reference.get(), image.cached())
     .then(defer(self(),
                 &Self::_get,
@@ -310,7 +399,11 @@ Future<ImageInfo> StoreProcess::get(
                   : Option<Secret>(),
                 lambda::_1,
                 backend))
-    .then(defer(self(), &Self::__get, lambda::_1, backend));
+    .then(defer(self(), &Self::__get, lambda::_1, backend))
+    .onAny(defer(self(), [this](const Future<ImageInfo>&) {
+      CHECK_GT(getting, 0u);
+      --getting;
+    }));
 }
 
 
@@ -613,8 +706,8 @@ Future<Nothing> StoreProcess::prune(
     imageReferences.push_back(reference.get());
   }
 
-  return metadataManager->prune(imageReferences)
-      .then(defer(self(), &Self::_prune, activeLayerPaths, lambda::_1));
+  return metrics.gc_pause.time(metadataManager->prune(imageReferences)
+      .then(defer(self(), &Self::_prune, activeLayerPaths, lambda::_1)));
 }
 
 
@@ -668,7 +761,9 @@ Future<Nothing> StoreProcess::_prune(
   }
 
   const string gcDir = paths::getGcDir(flags.docker_store_dir);
-  auto rmdirs = [gcDir]() {
+  process::metrics::Counter reclaimed = metrics.gc_reclaimed_bytes;
+
+  auto rmdirs = [gcDir, reclaimed]() mutable {
     Try<list<string>> targets = os::ls(gcDir);
     if (targets.isError()) {
       LOG(WARNING) << "Error when listing gcDir '" << gcDir
@@ -677,21 +772,7 @@ Future<Nothing> StoreProcess::_prune(
     }
 
     foreach (const string& target, targets.get()) {
-      const string path = path::join(gcDir, target);
-      // Run the removal operation with 'continueOnError = false'.
-      // A possible situation is that we incorrectly marked a layer
-      // which is still used by certain layer based backends (aufs, overlay).
-      // In such a case, we proceed with a warning and try to free up as much
-      // disk spaces as possible.
-      LOG(INFO) << "Deleting path '" << path << "'";
-      Try<Nothing> rmdir = os::rmdir(path, true, true, false);
-
-      if (rmdir.isError()) {
-        LOG(WARNING) << "Failed to delete '" << path << "': "
-                     << rmdir.error();
-      } else {
-        LOG(INFO) << "Deleted '" << path << "'";
-      }
+      reclaimed += removeLayer(path::join(gcDir, target)).bytes();
     }
 
     return Nothing();
@@ -705,6 +786,150 @@ Future<Nothing> StoreProcess::_prune(
   return Nothing();
 }
 
+
+Future<Option<Bytes>> StoreProcess::evict(
+    const vector<mesos::Image>& excludedImages,
+    const hashset<string>& activeLayerPaths)
+{
+  // The layers of an image being pulled are only referenced by the
+  // metadata once the pull completes, and those of an image being
+  // retrieved only by the provisioner once `get()` completes, so both
+  // might be shared with the evicted image. The eviction is retried
+  // later instead.
+  if (!pulling.empty() || getting > 0 || evicting.isSome()) {
+    VLOG(1) << "Skipping image eviction while getting images";
+    return None();
+  }
+
+  vector<spec::ImageReference> imageReferences;
+  imageReferences.reserve(excludedImages.size());
+
+  foreach (const mesos::Image& image, excludedImages) {
+    Try<spec::ImageReference> reference =
+      spec::parseImageReference(image.docker().name());
+
+    if (reference.isError()) {
+      return Failure(
+          "Failed to parse docker image '" + image.docker().name() +
+          "': " + reference.error());
+    }
+
+    imageReferences.push_back(reference.get());
+  }
+
+  // Paths in provisioner are layer rootfses within the layer paths,
+  // or the layer paths themselves for the image configs.
+  hashset<string> activeLayerIds;
+
+  foreach (const string& activeLayerPath, activeLayerPaths) {
+    const vector<string> layerPaths = {
+      Path(activeLayerPath).dirname(), activeLayerPath};
+
+    foreach (const string& layerPath, layerPaths) {
+      const string layerId = Path(layerPath).basename();
+
+      if (paths::getImageLayerPath(flags.docker_store_dir, layerId) ==
+            layerPath) {
+        activeLayerIds.insert(layerId);
+      }
+    }
+  }
+
+  // No image can be retrieved from now on until the evicted layers
+  // are marked for removal, see `_evict`.
+  Owned<Promise<Nothing>> gate(new Promise<Nothing>());
+  evicting = gate;
+
+  return metadataManager->evict(imageReferences, activeLayerIds)
+    .then(defer(self(), &Self::_evict, lambda::_1))
+    .onAny(defer(self(), [=](const Future<Option<Bytes>>&) {
+      resume(gate);
+    }));
+}
+
+
+Future<Option<Bytes>> StoreProcess::_evict(
+    const Option<hashset<string>>& layerIds)
+{
+  CHECK_SOME(evicting);
+  const Owned<Promise<Nothing>> gate = evicting.get();
+
+  // No `get()` could have started since `evict`, so none of the
+  // layers below can have been handed out to the provisioner.
+  CHECK(pulling.empty());
+  CHECK_EQ(0u, getting);
+
+  if (layerIds.isNone()) {
+    resume(gate);
+    return None();
+  }
+
+  metrics.gc_pause.start();
+
+  vector<string> targets;
+
+  foreach (const string& layerId, layerIds.get()) {
+    const string layerPath =
+      paths::getImageLayerPath(flags.docker_store_dir, layerId);
+
+    if (!os::exists(layerPath)) {
+      continue;
+    }
+
+    const string target =
+      paths::getGcLayerPath(flags.docker_store_dir, layerId);
+
+    VLOG(1) << "Marking layer '" << layerId << "' to gc by renaming '"
+            << layerPath << "' to '" << target << "'";
+
+    Try<Nothing> rename = os::rename(layerPath, target);
+    if (rename.isError()) {
+      metrics.gc_pause.stop();
+      resume(gate);
+
+      return Failure(
+          "Failed to move layer from '" + layerPath +
+          "' to '" + target + "': " + rename.error());
+    }
+
+    targets.push_back(target);
+  }
+
+  metrics.gc_pause.stop();
+
+  // The layers are no longer in the store, so images can be retrieved
+  // again while the layers are being removed.
+  resume(gate);
+
+  process::metrics::Counter reclaimed = metrics.gc_reclaimed_bytes;
+
+  // NOTE: The removal is dispatched to the same executor as the one of
+  // `_prune`, so that it does not occupy more than one worker thread.
+  return executor.execute([targets, reclaimed]() mutable {
+      Bytes bytes;
+      foreach (const string& target, targets) {
+        bytes += removeLayer(target);
+      }
+
+      reclaimed += bytes.bytes();
+
+      return bytes;
+    })
+    .then([](const Bytes& bytes) -> Option<Bytes> { return bytes; });
+}
+
+
+void StoreProcess::resume(const Owned<Promise<Nothing>>& gate)
+{
+  gate->set(Nothing());
+
+  // NOTE: This is a no-op if the eviction has already resumed the
+  // `get()` calls, and another eviction might have started since.
+  if (evicting.isSome() && evicting->get() == gate.get()) {
+    evicting = None();
+  }
+}
+
 } // namespace docker {
 } // namespace slave {
 } // namespace internal {
@@ -63,6 +63,10 @@ public:
       const std::vector<mesos::Image>& excludeImages,
       const hashset<std::string>& activeLayerPaths) override;
 
+  process::Future<Option<Bytes>> evict(
+      const std::vector<mesos::Image>& excludedImages,
+      const hashset<std::string>& activeLayerPaths) override;
+
 private:
   explicit Store(process::Owned<StoreProcess> process);
 
@@ -266,6 +266,20 @@ string getBackendDir(
              backend);
 }
 
+
+string getPoolDir(const string& provisionerDir)
+{
+  return path::join(provisionerDir, "pool");
+}
+
+
+string getPoolRootfsDir(
+    const string& provisionerDir,
+    const string& rootfsId)
+{
+  return getRootfsDir(getPoolDir(provisionerDir), rootfsId);
+}
+
 } // namespace paths {
 } // namespace provisioner {
 } // namespace slave {
@@ -34,6 +34,8 @@ namespace paths {
 // The provisioner rootfs directory is as follows:
 // <work_dir> ('--work_dir' flag)
 // |-- provisioner
+//     |-- pool
+//         |-- <rootfs_id> (a pre-provisioned rootfs)
 //     |-- containers
 //         |-- <container_id>
 //             |-- layers (paths to all layers to provision)
@@ -52,6 +54,9 @@ namespace paths {
 // There can be multiple backends due to the change of backend flags.
 // Under each backend a rootfs is identified by the 'rootfs_id' which
 // is a UUID.
+//
+// The rootfses in the pool are provisioned by the copy backend, and
+// are moved to the 'rootfses' directory of the container claiming it.
 
 
 constexpr char LAYERS_FILE[] = "layers";
@@ -93,6 +98,14 @@ std::string getBackendDir(
     const ContainerID& containerId,
     const std::string& backend);
 
+
+std::string getPoolDir(const std::string& provisionerDir);
+
+
+std::string getPoolRootfsDir(
+    const std::string& provisionerDir,
+    const std::string& rootfsId);
+
 } // namespace paths {
 } // namespace provisioner {
 } // namespace slave {
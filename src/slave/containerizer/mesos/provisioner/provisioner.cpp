@@ -28,10 +28,13 @@
 
 #include <process/collect.hpp>
 #include <process/defer.hpp>
+#include <process/delay.hpp>
 #include <process/dispatch.hpp>
 #include <process/process.hpp>
 
+#include <stout/bytes.hpp>
 #include <stout/foreach.hpp>
+#include <stout/fs.hpp>
 #include <stout/hashmap.hpp>
 #include <stout/hashset.hpp>
 #include <stout/lambda.hpp>
@@ -40,6 +43,7 @@
 #include <stout/uuid.hpp>
 
 #include <stout/os/realpath.hpp>
+#include <stout/os/rename.hpp>
 
 #ifdef __linux__
 #include "linux/fs.hpp"
@@ -54,6 +58,7 @@
 #include "slave/containerizer/mesos/provisioner/provisioner.hpp"
 #include "slave/containerizer/mesos/provisioner/store.hpp"
 
+using std::list;
 using std::string;
 using std::vector;
 
@@ -321,7 +326,10 @@ Try<Owned<Provisioner>> Provisioner::create(
           rootDir,
           defaultBackend,
           stores.get(),
-          backends))));
+          backends,
+          flags.image_provisioner_pool_size,
+          flags.image_gc_config,
+          flags.docker_store_dir))));
 }
 
 
@@ -386,12 +394,18 @@ ProvisionerProcess::ProvisionerProcess(
     const string& _rootDir,
     const string& _defaultBackend,
     const hashmap<Image::Type, Owned<Store>>& _stores,
-    const hashmap<string, Owned<Backend>>& _backends)
+    const hashmap<string, Owned<Backend>>& _backends,
+    size_t _poolSize,
+    const Option<ImageGcConfig>& _imageGcConfig,
+    const string& _dockerStoreDir)
   : ProcessBase(process::ID::generate("mesos-provisioner")),
     rootDir(_rootDir),
     defaultBackend(_defaultBackend),
     stores(_stores),
-    backends(_backends) {}
+    backends(_backends),
+    poolSize(_poolSize),
+    imageGcConfig(_imageGcConfig),
+    dockerStoreDir(_dockerStoreDir) {}
 
 
 Future<Nothing> ProvisionerProcess::recover(
@@ -465,6 +479,8 @@ Future<Nothing> ProvisionerProcess::recover(
         if (layers->has_config()) {
           info->layers->push_back(layers->config());
         }
+
+        reference(info->layers.get());
       }
     }
 
@@ -492,6 +508,23 @@ Future<Nothing> ProvisionerProcess::recover(
     cleanups.push_back(destroy(containerId));
   }
 
+  // The pre-provisioned rootfses are not checkpointed, hence the pool
+  // is refilled from scratch once containers are launched again.
+  const string poolDir = provisioner::paths::getPoolDir(rootDir);
+
+  if (os::exists(poolDir) && backends.contains(COPY_BACKEND)) {
+    Try<list<string>> rootfsIds = os::ls(poolDir);
+    if (rootfsIds.isError()) {
+      return Failure(
+          "Failed to list the pre-provisioned rootfses in '" + poolDir +
+          "': " + rootfsIds.error());
+    }
+
+    foreach (const string& rootfsId, rootfsIds.get()) {
+      cleanups.push_back(destroyPooled(rootfsId));
+    }
+  }
+
   Future<Nothing> cleanup = collect(cleanups)
     .then([]() -> Future<Nothing> { return Nothing(); });
 
@@ -514,10 +547,17 @@ Future<Nothing> ProvisionerProcess::recover(
   // in 'store', which might fail if there still exist unknown
   // containers holding references to them.
   return collect(cleanup, recover)
-    .then([=]() -> Future<Nothing> {
+    .then(defer(self(), [=]() -> Future<Nothing> {
       LOG(INFO) << "Provisioner recovery complete";
+
+      if (imageGcConfig.isSome() &&
+          imageGcConfig->incremental() &&
+          stores.contains(Image::DOCKER)) {
+        checkImageDiskUsage();
+      }
+
       return Nothing();
-    });
+    }));
 }
 
 
@@ -536,8 +576,13 @@ Future<ProvisionInfo> ProvisionerProcess::provision(
 
       Owned<Promise<ProvisionInfo>> promise(new Promise<ProvisionInfo>());
 
+      // The image is not evicted by the incremental image garbage
+      // collection until its layers are referenced by the container.
+      list<Image>::iterator pending =
+        pendingImages.insert(pendingImages.end(), image);
+
       // Get and then provision image layers from the store.
-      Future<ProvisionInfo> future =
+      Future<ProvisionInfo> future = metrics.provision.time(
         stores.at(image.type())->get(image, defaultBackend)
           .then(defer(
               self(),
@@ -545,10 +590,12 @@ Future<ProvisionInfo> ProvisionerProcess::provision(
               containerId,
               image,
               defaultBackend,
-              lambda::_1))
+              lambda::_1)))
           .onAny(defer(self(), [=](const Future<ProvisionInfo>& provisionInfo) {
             CHECK(!provisionInfo.isPending());
 
+            pendingImages.erase(pending);
+
             if (provisionInfo.isReady()) {
               promise->set(provisionInfo);
             } else if (provisionInfo.isDiscarded()) {
@@ -586,9 +633,30 @@ Future<ProvisionInfo> ProvisionerProcess::_provision(
       backend,
       rootfsId);
 
-  LOG(INFO) << "Provisioning image rootfs '" << rootfs
-            << "' for container " << containerId
-            << " using " << backend << " backend";
+  // Only the rootfses of the copy backend can be moved between
+  // containers, the others are mounted into the container directory.
+  const bool pooled = poolSize > 0 && backend == COPY_BACKEND;
+
+  Option<string> claimed;
+  if (pooled) {
+    claimed = claim(imageInfo.layers, rootfs);
+
+    if (claimed.isSome()) {
+      ++metrics.pool_hits;
+    } else {
+      ++metrics.pool_misses;
+    }
+  }
+
+  if (claimed.isSome()) {
+    LOG(INFO) << "Claimed pre-provisioned rootfs '" << claimed.get()
+              << "' as image rootfs '" << rootfs << "' for container "
+              << containerId;
+  } else {
+    LOG(INFO) << "Provisioning image rootfs '" << rootfs
+              << "' for container " << containerId
+              << " using " << backend << " backend";
+  }
 
   // NOTE: It's likely that the container ID already exists in 'infos'
   // because one container might provision multiple images.
@@ -597,21 +665,41 @@ Future<ProvisionInfo> ProvisionerProcess::_provision(
   }
 
   infos[containerId]->rootfses[backend].insert(rootfsId);
+
+  if (infos[containerId]->layers.isSome()) {
+    unreference(infos[containerId]->layers.get());
+  }
+
   infos[containerId]->layers = imageInfo.layers;
 
   if (imageInfo.config.isSome()) {
     infos[containerId]->layers->push_back(imageInfo.config.get());
   }
 
+  reference(infos[containerId]->layers.get());
+
   string backendDir = provisioner::paths::getBackendDir(
       rootDir,
       containerId,
       backend);
 
-  infos[containerId]->provisioning = backends.at(backend)->provision(
-      imageInfo.layers,
-      rootfs,
-      backendDir)
+  // NOTE: The copy backend does not create any ephemeral volumes.
+  Future<Option<vector<Path>>> provisioning = claimed.isSome()
+    ? Future<Option<vector<Path>>>(None())
+    : backends.at(backend)->provision(imageInfo.layers, rootfs, backendDir);
+
+  // The pool is refilled once the container has its rootfs, so that
+  // it does not compete with the launch for the disk.
+  if (pooled) {
+    const vector<string> layers = imageInfo.layers;
+
+    provisioning
+      .onReady(defer(self(), [this, layers](const Option<vector<Path>>&) {
+        refill(layers);
+      }));
+  }
+
+  infos[containerId]->provisioning = provisioning
     .then(defer(self(), [=](const Option<vector<Path>>& ephemeral)
     -> Future<ProvisionInfo> {
       const string path =
@@ -806,11 +894,192 @@ void ProvisionerProcess::__destroy(
     ++metrics.remove_container_errors;
   }
 
+  if (infos[containerId]->layers.isSome()) {
+    unreference(infos[containerId]->layers.get());
+  }
+
   infos[containerId]->termination.set(true);
   infos.erase(containerId);
 }
 
 
+Option<string> ProvisionerProcess::claim(
+    const vector<string>& layers,
+    const string& rootfs)
+{
+  const string key = strings::join("\n", layers);
+
+  if (!pools.contains(key)) {
+    return None();
+  }
+
+  Try<Nothing> mkdir = os::mkdir(Path(rootfs).dirname());
+  if (mkdir.isError()) {
+    LOG(WARNING) << "Failed to create the parent directory of rootfs '"
+                 << rootfs << "': " << mkdir.error();
+
+    return None();
+  }
+
+  Pool& pool = pools.at(key);
+
+  while (!pool.rootfses.empty()) {
+    const string rootfsId = pool.rootfses.front();
+    pool.rootfses.pop_front();
+
+    const string pooled =
+      provisioner::paths::getPoolRootfsDir(rootDir, rootfsId);
+
+    // The pool is in the provisioner directory, so this is a cheap
+    // rename on the same filesystem.
+    Try<Nothing> rename = os::rename(pooled, rootfs);
+    if (rename.isError()) {
+      LOG(WARNING) << "Failed to move pre-provisioned rootfs '" << pooled
+                   << "' to '" << rootfs << "': " << rename.error();
+
+      destroyPooled(rootfsId);
+      continue;
+    }
+
+    return pooled;
+  }
+
+  return None();
+}
+
+
+void ProvisionerProcess::refill(const vector<string>& layers)
+{
+  Pool& pool = pools[strings::join("\n", layers)];
+  pool.layers = layers;
+
+  while (pool.rootfses.size() + pool.provisioning < poolSize) {
+    const string rootfsId = id::UUID::random().toString();
+
+    const string rootfs =
+      provisioner::paths::getPoolRootfsDir(rootDir, rootfsId);
+
+    VLOG(1) << "Pre-provisioning rootfs '" << rootfs << "'";
+
+    ++pool.provisioning;
+
+    // The layers are referenced while they are copied, so that they
+    // are not evicted by the incremental image garbage collection.
+    reference(layers);
+
+    // Like `provision`, this excludes `pruneImages` which might
+    // remove the layers while they are copied.
+    rwLock.read_lock()
+      .then(defer(self(), [=]() {
+        return backends.at(COPY_BACKEND)->provision(
+            layers,
+            rootfs,
+            provisioner::paths::getPoolDir(rootDir));
+      }))
+      .onAny(defer(self(), [=](
+          const Future<Option<vector<Path>>>& provisioning) {
+        rwLock.read_unlock();
+        unreference(layers);
+        _refill(layers, rootfsId, provisioning);
+      }));
+  }
+}
+
+
+void ProvisionerProcess::_refill(
+    const vector<string>& layers,
+    const string& rootfsId,
+    const Future<Option<vector<Path>>>& provisioning)
+{
+  const string key = strings::join("\n", layers);
+
+  // NOTE: `drain` keeps the pools with pending rootfses.
+  CHECK(pools.contains(key));
+
+  Pool& pool = pools.at(key);
+
+  CHECK_GT(pool.provisioning, 0u);
+  --pool.provisioning;
+
+  if (!provisioning.isReady()) {
+    LOG(WARNING) << "Failed to pre-provision rootfs '"
+                 << provisioner::paths::getPoolRootfsDir(rootDir, rootfsId)
+                 << "': "
+                 << (provisioning.isFailed()
+                       ? provisioning.failure()
+                       : "discarded");
+
+    // NOTE: The pool is not refilled until the next container is
+    // launched with the image to not retry in a tight loop.
+    destroyPooled(rootfsId);
+    return;
+  }
+
+  pool.rootfses.push_back(rootfsId);
+}
+
+
+Future<Nothing> ProvisionerProcess::drain(
+    const hashset<string>& activeLayerPaths)
+{
+  return drain([&](const vector<string>& layers) {
+    return !std::all_of(
+        layers.begin(),
+        layers.end(),
+        [&](const string& layer) {
+          return activeLayerPaths.contains(layer);
+        });
+  });
+}
+
+
+Future<Nothing> ProvisionerProcess::drain(
+    const lambda::function<bool(const vector<string>&)>& drained)
+{
+  vector<Future<bool>> destroys;
+
+  foreach (const string& key, pools.keys()) {
+    Pool& pool = pools.at(key);
+
+    if (!drained(pool.layers)) {
+      continue;
+    }
+
+    foreach (const string& rootfsId, pool.rootfses) {
+      VLOG(1) << "Removing pre-provisioned rootfs '"
+              << provisioner::paths::getPoolRootfsDir(rootDir, rootfsId)
+              << "' of unused image";
+
+      destroys.push_back(destroyPooled(rootfsId));
+    }
+
+    pool.rootfses.clear();
+
+    if (pool.provisioning == 0) {
+      pools.erase(key);
+    }
+  }
+
+  return await(destroys)
+    .then([]() { return Nothing(); });
+}
+
+
+Future<bool> ProvisionerProcess::destroyPooled(const string& rootfsId)
+{
+  const string rootfs =
+    provisioner::paths::getPoolRootfsDir(rootDir, rootfsId);
+
+  return backends.at(COPY_BACKEND)->destroy(
+      rootfs,
+      provisioner::paths::getPoolDir(rootDir))
+    .onFailed([rootfs](const string& failure) {
+      LOG(WARNING) << "Failed to destroy pre-provisioned rootfs '" << rootfs
+                   << "': " << failure;
+    });
+}
+
+
 Future<Nothing> ProvisionerProcess::pruneImages(
     const vector<Image>& excludedImages)
 {
@@ -843,6 +1112,10 @@ Future<Nothing> ProvisionerProcess::pruneImages(
 
       vector<Future<Nothing>> futures;
 
+      // The pools of the images which are no longer used are removed
+      // along with the images.
+      futures.push_back(drain(activeLayerPaths));
+
       foreachpair (
           const Image::Type& type, const Owned<Store>& store, stores) {
         vector<Image> images;
@@ -864,17 +1137,119 @@ Future<Nothing> ProvisionerProcess::pruneImages(
 }
 
 
+void ProvisionerProcess::reference(const vector<string>& layers)
+{
+  foreach (const string& layer, layers) {
+    layerReferences[layer]++;
+  }
+}
+
+
+void ProvisionerProcess::unreference(const vector<string>& layers)
+{
+  foreach (const string& layer, layers) {
+    if (layerReferences.contains(layer) && --layerReferences[layer] == 0) {
+      layerReferences.erase(layer);
+    }
+  }
+}
+
+
+void ProvisionerProcess::checkImageDiskUsage()
+{
+  Future<double>(::fs::usage(dockerStoreDir))
+    .onAny(defer(self(), &Self::_checkImageDiskUsage, lambda::_1));
+}
+
+
+void ProvisionerProcess::_checkImageDiskUsage(const Future<double>& usage)
+{
+  CHECK_SOME(imageGcConfig);
+
+  const Duration interval = Nanoseconds(
+      imageGcConfig->image_disk_watch_interval().nanoseconds());
+
+  if (!usage.isReady()) {
+    LOG(ERROR) << "Failed to get image store disk usage: "
+               << (usage.isFailed() ? usage.failure() : "future discarded");
+
+    delay(interval, self(), &Self::checkImageDiskUsage);
+    return;
+  }
+
+  if (imageGcConfig->image_disk_headroom() + usage.get() <= 1.0) {
+    delay(interval, self(), &Self::checkImageDiskUsage);
+    return;
+  }
+
+  // Unlike `pruneImages`, this does not take the lock: the images
+  // being provisioned are excluded, and the layers of the others are
+  // referenced by their containers or pools before the images are
+  // released. The images provisioned after this point are retrieved
+  // from the store once the eviction has marked the evicted layers
+  // for removal, and the store skips the eviction while images are
+  // still being retrieved.
+  vector<Image> excludedImages(
+      imageGcConfig->excluded_images().begin(),
+      imageGcConfig->excluded_images().end());
+
+  foreach (const Image& image, pendingImages) {
+    excludedImages.push_back(image);
+  }
+
+  stores.at(Image::DOCKER)->evict(excludedImages, layerReferences.keys())
+    .onAny(defer(self(), [=](const Future<Option<Bytes>>& evicted) {
+      if (!evicted.isReady()) {
+        LOG(ERROR) << "Failed to evict an image: "
+                   << (evicted.isFailed() ? evicted.failure() : "discarded");
+      } else if (evicted->isSome()) {
+        LOG(INFO) << "Evicted an image to reclaim " << evicted->get()
+                  << " in the docker image store";
+
+        // The pools of the evicted image are removed along with it,
+        // since `pruneImages` does not run with the incremental image
+        // garbage collection. Their layers are no longer in the store,
+        // while those of the pools being refilled are referenced.
+        drain([](const vector<string>& layers) {
+          return std::any_of(
+              layers.begin(),
+              layers.end(),
+              [](const string& layer) { return !os::exists(layer); });
+        })
+          .onAny(defer(self(), [this](const Future<Nothing>&) {
+            // Keep evicting images until the disk usage is below the
+            // threshold, or nothing can be evicted.
+            checkImageDiskUsage();
+          }));
+
+        return;
+      }
+
+      delay(interval, self(), &Self::checkImageDiskUsage);
+    }));
+}
+
+
 ProvisionerProcess::Metrics::Metrics()
   : remove_container_errors(
-      "containerizer/mesos/provisioner/remove_container_errors")
+      "containerizer/mesos/provisioner/remove_container_errors"),
+    pool_hits("containerizer/mesos/provisioner/pool_hits"),
+    pool_misses("containerizer/mesos/provisioner/pool_misses"),
+    provision("containerizer/mesos/provisioner/provision", Hours(1))
 {
   process::metrics::add(remove_container_errors);
+  process::metrics::add(pool_hits);
+  process::metrics::add(pool_misses);
+  process::metrics::add(provision);
 }
 
 
 ProvisionerProcess::Metrics::~Metrics()
 {
   process::metrics::remove(remove_container_errors);
+  process::metrics::remove(pool_hits);
+  process::metrics::remove(pool_misses);
+  process::metrics::remove(provision);
 }
 
 } // namespace slave {
@@ -17,6 +17,9 @@
 #ifndef __PROVISIONER_HPP__
 #define __PROVISIONER_HPP__
 
+#include <deque>
+#include <list>
+#include <string>
 #include <vector>
 
 #include <mesos/resources.hpp>
@@ -29,6 +32,7 @@
 
 #include <mesos/slave/isolator.hpp> // For ContainerState.
 
+#include <stout/lambda.hpp>
 #include <stout/nothing.hpp>
 #include <stout/path.hpp>
 #include <stout/try.hpp>
@@ -39,6 +43,7 @@
 
 #include <process/metrics/counter.hpp>
 #include <process/metrics/metrics.hpp>
+#include <process/metrics/timer.hpp>
 
 #include "slave/flags.hpp"
 
@@ -141,7 +146,10 @@ public:
       const std::string& rootDir,
       const std::string& defaultBackend,
       const hashmap<Image::Type, process::Owned<Store>>& stores,
-      const hashmap<std::string, process::Owned<Backend>>& backends);
+      const hashmap<std::string, process::Owned<Backend>>& backends,
+      size_t poolSize = 0,
+      const Option<ImageGcConfig>& imageGcConfig = None(),
+      const std::string& dockerStoreDir = "");
 
   process::Future<Nothing> recover(
       const hashset<ContainerID>& knownContainerIds);
@@ -170,6 +178,42 @@ private:
       const ContainerID& containerId,
       const process::Future<std::vector<process::Future<bool>>>& futures);
 
+  // Moves a rootfs pre-provisioned from the given layers out of the
+  // pool to `rootfs`. Returns None if there is none in the pool.
+  Option<std::string> claim(
+      const std::vector<std::string>& layers,
+      const std::string& rootfs);
+
+  // Pre-provisions rootfses from the given layers in the background
+  // until the pool holds `poolSize` of them.
+  void refill(const std::vector<std::string>& layers);
+
+  void _refill(
+      const std::vector<std::string>& layers,
+      const std::string& rootfsId,
+      const process::Future<Option<std::vector<Path>>>& provisioning);
+
+  // Removes the pre-provisioned rootfses whose layers are not used by
+  // any container.
+  process::Future<Nothing> drain(const hashset<std::string>& activeLayerPaths);
+
+  // Removes the pre-provisioned rootfses of the pools whose layers
+  // match the predicate.
+  process::Future<Nothing> drain(
+      const lambda::function<bool(const std::vector<std::string>&)>& drained);
+
+  process::Future<bool> destroyPooled(const std::string& rootfsId);
+
+  // Updates the number of containers using each of the layers.
+  void reference(const std::vector<std::string>& layers);
+  void unreference(const std::vector<std::string>& layers);
+
+  // Evicts images from the Docker store one at a time for as long as
+  // its disk usage exceeds the threshold of the incremental image
+  // garbage collection, and checks the disk usage again periodically.
+  void checkImageDiskUsage();
+  void _checkImageDiskUsage(const process::Future<double>& usage);
+
   // Absolute path to the provisioner root directory. It can be
   // derived from '--work_dir' but we keep a separate copy here
   // because we converted it into an absolute path so managed rootfs
@@ -209,12 +253,50 @@ private:
 
   hashmap<ContainerID, process::Owned<Info>> infos;
 
+  // Mappings: layer path -> number of containers using the layer.
+  hashmap<std::string, size_t> layerReferences;
+
+  // The images being retrieved from the stores, whose layers are not
+  // referenced by the containers yet. They are never evicted.
+  std::list<Image> pendingImages;
+
+  // The configuration of the incremental image garbage collection, if
+  // enabled, which runs without the exclusive lock below.
+  const Option<ImageGcConfig> imageGcConfig;
+  const std::string dockerStoreDir;
+
+  // The number of rootfses kept pre-provisioned for each image.
+  const size_t poolSize;
+
+  struct Pool
+  {
+    std::vector<std::string> layers;
+
+    // The ids of the rootfses which are ready to be claimed.
+    std::deque<std::string> rootfses;
+
+    // The number of rootfses being provisioned.
+    size_t provisioning = 0;
+  };
+
+  // Mappings: layers -> pool. The pools are keyed by the layers of the
+  // images rather than by the images, so that a rootfs is never handed
+  // out for an image which has been updated since it was provisioned.
+  hashmap<std::string, Pool> pools;
+
   struct Metrics
   {
     Metrics();
     ~Metrics();
 
     process::metrics::Counter remove_container_errors;
+
+    // The rootfses which were claimed from or missing in the pool.
+    process::metrics::Counter pool_hits;
+    process::metrics::Counter pool_misses;
+
+    // The time to get the image and provision the rootfs.
+    process::metrics::Timer<Milliseconds> provision;
   } metrics;
 
   // This `ReadWriteLock` instance is used to protect the critical section which
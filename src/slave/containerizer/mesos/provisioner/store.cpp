@@ -106,6 +106,14 @@ process::Future<Nothing> Store::prune(
   return Nothing();
 }
 
+
+process::Future<Option<Bytes>> Store::evict(
+    const vector<Image>& excludedImages,
+    const hashset<string>& activeLayerPaths)
+{
+  return None();
+}
+
 } // namespace slave {
 } // namespace internal {
 } // namespace mesos {
@@ -31,7 +31,9 @@
 #include <process/future.hpp>
 #include <process/owned.hpp>
 
+#include <stout/bytes.hpp>
 #include <stout/hashset.hpp>
+#include <stout/option.hpp>
 #include <stout/try.hpp>
 
 #include "slave/flags.hpp"
@@ -108,6 +110,17 @@ public:
   virtual process::Future<Nothing> prune(
       const std::vector<Image>& excludedImages,
       const hashset<std::string>& activeLayerPaths);
+
+  // Evict the least recently used image which is neither in
+  // `excludedImages` nor composed of any of the `activeLayerPaths`,
+  // along with the layers no other image is composed of. Unlike
+  // `prune`, this is not called within the exclusive lock of the
+  // `provisioner`, so it is called repeatedly to free up disk space
+  // incrementally while images are being provisioned. Returns the
+  // number of bytes reclaimed, or None if no image can be evicted.
+  virtual process::Future<Option<Bytes>> evict(
+      const std::vector<Image>& excludedImages,
+      const hashset<std::string>& activeLayerPaths);
 };
 
 } // namespace slave {
@@ -211,6 +211,31 @@ mesos::internal::slave::Flags::Flags()
       "Strategy for provisioning container rootfs from images,\n"
       "e.g., `aufs`, `bind`, `copy`, `overlay`.");
 
+  add(&Flags::image_provisioner_copy_threads,
+      "image_provisioner_copy_threads",
+      "Number of threads used by the `copy` provisioner backend to copy the\n"
+      "directories of a layer in parallel on Linux.",
+      DEFAULT_IMAGE_PROVISIONER_COPY_THREADS,
+      [](const size_t& value) -> Option<Error> {
+        if (value == 0) {
+          return Error(
+              "Expected --image_provisioner_copy_threads to be positive");
+        }
+
+        return None();
+      });
+
+  add(&Flags::image_provisioner_pool_size,
+      "image_provisioner_pool_size",
+      "Number of root filesystems kept pre-provisioned for each image used\n"
+      "by the containers on the agent, which are claimed by the containers\n"
+      "launched with the image instead of provisioning them on launch. The\n"
+      "pool is refilled in the background, and the root filesystems of an\n"
+      "image are removed by the image garbage collection once no container\n"
+      "uses the image. This only applies to the `copy` provisioner backend.\n"
+      "A value of 0 disables the pool.",
+      0);
+
   add(&Flags::image_gc_config,
       "image_gc_config",
       "JSON-formatted configuration for automatic container image garbage\n"
@@ -247,6 +272,22 @@ mesos::internal::slave::Flags::Flags()
       "Directory the appc provisioner will store images in.\n",
       path::join(os::temp(), "mesos", "store", "appc"));
 
+  add(&Flags::blob_store_dir,
+      "blob_store_dir",
+      "Directory the image stores and the fetcher cache keep the downloaded\n"
+      "blobs (e.g., Docker layer tarballs, Appc image bundles, or evicted\n"
+      "fetcher cache files) in, keyed by their digests, so that the same blob\n"
+      "is only downloaded once.",
+      path::join(os::temp(), "mesos", "store", "blobs"));
+
+  add(&Flags::blob_store_capacity,
+      "blob_store_capacity",
+      "Maximum size of the blobs in `--blob_store_dir` that are not in use\n"
+      "by any image store or the fetcher cache. The least recently used of\n"
+      "them are removed once this size is exceeded. A size of 0B disables\n"
+      "the blob store.",
+      Bytes(0));
+
   add(&Flags::docker_registry,
       "docker_registry",
       "The default url for Mesos containerizer to pull Docker images. It\n"
@@ -258,6 +299,30 @@ mesos::internal::slave::Flags::Flags()
       "change the default registry server for Docker containerizer.",
       "https://registry-1.docker.io");
 
+  add(&Flags::docker_registry_concurrency,
+      "docker_registry_concurrency",
+      "Maximum number of layers of an image that the Mesos containerizer\n"
+      "pulls from a Docker registry in parallel. Each layer is extracted\n"
+      "and verified while it is being downloaded.",
+      3,
+      [](const size_t& value) -> Option<Error> {
+        if (value == 0) {
+          return Error("Expected --docker_registry_concurrency to be positive");
+        }
+
+        return None();
+      });
+
+  add(&Flags::docker_registry_native_client,
+      "docker_registry_native_client",
+      "Whether the Mesos containerizer sends the requests to Docker\n"
+      "registries with the HTTP client built into the agent instead of\n"
+      "running a `curl` command for each of them. The native client keeps\n"
+      "up to `--docker_registry_concurrency` connections to each registry\n"
+      "open across requests and resumes interrupted layer downloads.\n"
+      "NOTE: HTTPS registries require the agent to be built with SSL.",
+      false);
+
   add(&Flags::docker_store_dir,
       "docker_store_dir",
       "Directory the Docker provisioner will store images in",
@@ -323,6 +388,17 @@ mesos::internal::slave::Flags::Flags()
       "does not apply to HDFS.",
       DEFAULT_FETCHER_STALL_TIMEOUT);
 
+  add(&Flags::fetcher_threads,
+      "fetcher_threads",
+      "Number of threads the agent uses to fetch URIs itself, i.e., without\n"
+      "running the `mesos-fetcher` program for each container. The URIs of\n"
+      "a container are fetched in parallel, and each archive is extracted\n"
+      "as soon as it has been downloaded. The `mesos-fetcher` program is\n"
+      "still used for the containers whose URIs have to be fetched as a\n"
+      "user other than the one the agent is running as. A value of 0 runs\n"
+      "the `mesos-fetcher` program for all containers.",
+      0);
+
   add(&Flags::work_dir,
       "work_dir",
       "Path of the agent work directory. This is where executor sandboxes\n"
@@ -551,6 +627,47 @@ mesos::internal::slave::Flags::Flags()
       "be a value between 0.0 and 1.0",
       GC_DISK_HEADROOM);
 
+  add(&Flags::gc_threads,
+      "gc_threads",
+      "Number of threads used to remove the directories which are due for\n"
+      "garbage collection. The subdirectories of the sandboxes are removed\n"
+      "in parallel, and the sandboxes are removed oldest first.",
+      1,
+      [](const size_t& value) -> Option<Error> {
+        if (value == 0) {
+          return Error("Expected --gc_threads to be positive");
+        }
+
+        return None();
+      });
+
+  add(&Flags::gc_inode_rate_limit,
+      "gc_inode_rate_limit",
+      "Maximum number of files and directories removed per second by the\n"
+      "garbage collection of sandboxes, across all the `--gc_threads`.\n"
+      "If not set, the removals are not limited.",
+      [](const Option<size_t>& value) -> Option<Error> {
+        if (value.isSome() && value.get() == 0) {
+          return Error("Expected --gc_inode_rate_limit to be positive");
+        }
+
+        return None();
+      });
+
+  add(&Flags::gc_io_rate_limit,
+      "gc_io_rate_limit",
+      "Maximum disk space per second (e.g., 500MB) reclaimed by the garbage\n"
+      "collection of sandboxes, across all the `--gc_threads`, so that the\n"
+      "disk IO of the removal of large files does not starve the running\n"
+      "tasks. If not set, the removals are not limited.",
+      [](const Option<Bytes>& value) -> Option<Error> {
+        if (value.isSome() && value.get() == Bytes(0)) {
+          return Error("Expected --gc_io_rate_limit to be positive");
+        }
+
+        return None();
+      });
+
   add(&Flags::gc_non_executor_container_sandboxes,
       "gc_non_executor_container_sandboxes",
       "Determines whether nested container sandboxes created via the\n"
@@ -599,6 +716,29 @@ mesos::internal::slave::Flags::Flags()
       "successfully reconnect to the framework.",
       RECOVERY_TIMEOUT);
 
+  add(&Flags::recovery_threads,
+      "recovery_threads",
+      "Maximum number of threads used to recover the checkpointed state of\n"
+      "the frameworks and executors in parallel when the agent starts.",
+      DEFAULT_RECOVERY_THREADS,
+      [](const size_t& value) -> Option<Error> {
+        if (value == 0) {
+          return Error("Expected --recovery_threads to be positive");
+        }
+
+        return None();
+      });
+
+  add(&Flags::recovery_index,
+      "recovery_index",
+      "If set, the agent writes a consolidated index of the tasks of each\n"
+      "executor run when the run completes, and reads the index instead of\n"
+      "the checkpoints of the individual tasks when it recovers the run,\n"
+      "e.g., across agent restarts within the garbage collection delay of\n"
+      "the run. Completed runs without an index are indexed when they are\n"
+      "recovered.",
+      false);
+
   add(&Flags::reconfiguration_policy,
       "reconfiguration_policy",
       "This flag controls which agent configuration changes are considered\n"
@@ -622,6 +762,22 @@ mesos::internal::slave::Flags::Flags()
       "state as possible is recovered.\n",
       true);
 
+  add(&Flags::status_update_journal,
+      "status_update_journal",
+      "If set, the agent appends the checkpointed task status updates and\n"
+      "acknowledgements to a single, agent-wide journal instead of to a\n"
+      "file per task. Records appended at about the same time are written\n"
+      "together (group commit). The journal is periodically compacted into\n"
+      "the per-task files, see `--status_update_journal_compaction_interval`,\n"
+      "and replayed into them when the agent recovers.",
+      false);
+
+  add(&Flags::status_update_journal_compaction_interval,
+      "status_update_journal_compaction_interval",
+      "Interval at which the status update journal is compacted into the\n"
+      "per-task status update files, see `--status_update_journal`.",
+      STATUS_UPDATE_JOURNAL_COMPACTION_INTERVAL);
+
   add(&Flags::max_completed_executors_per_framework,
       "max_completed_executors_per_framework",
       "Maximum number of completed executors per framework to store\n"
@@ -679,6 +835,24 @@ mesos::internal::slave::Flags::Flags()
       "inside a container.\n",
       false);
 
+  add(&Flags::cgroups_usage_sampling_interval,
+      "cgroups_usage_sampling_interval",
+      "If set, the `cgroups/*` isolators collect the resource statistics of\n"
+      "all containers at once at this interval, and serve the resource\n"
+      "usage of a container (e.g., for the `/monitor/statistics` endpoint,\n"
+      "the QoS controller and the resource estimator) from the latest\n"
+      "sample while it is more recent than\n"
+      "`--cgroups_usage_max_staleness`, instead of reading the cgroups of\n"
+      "the container on every request.");
+
+  add(&Flags::cgroups_usage_max_staleness,
+      "cgroups_usage_max_staleness",
+      "Maximum age of the sampled resource statistics of a container that\n"
+      "are served as its resource usage, see\n"
+      "`--cgroups_usage_sampling_interval`. This should be larger than the\n"
+      "sampling interval.",
+      DEFAULT_CGROUPS_USAGE_MAX_STALENESS);
+
   add(&Flags::cgroups_net_cls_primary_handle,
       "cgroups_net_cls_primary_handle",
       "A non-zero, 16-bit handle of the form `0xAAAA`. This will be \n"
@@ -774,6 +948,15 @@ mesos::internal::slave::Flags::Flags()
       "than the `perf_interval`.",
       Seconds(10));
 
+  add(&Flags::perf_native,
+      "perf_native",
+      "Whether the perf_event isolator samples perf events in-process by\n"
+      "opening `perf_event_open(2)` counters for the container cgroups\n"
+      "rather than by launching `perf stat`. This avoids forking perf and\n"
+      "parsing its output on every `perf_interval`, but only supports the\n"
+      "events that have a field in the PerfStatistics protobuf.",
+      false);
+
   add(&Flags::revocable_cpu_low_priority,
       "revocable_cpu_low_priority",
       "Run containers with revocable CPU at a lower priority than\n"
@@ -1397,6 +1580,15 @@ mesos::internal::slave::Flags::Flags()
       "containers listening on ports they don't have resources for.",
       Seconds(30));
 
+  add(&Flags::container_ports_watch_incremental,
+      "container_ports_watch_incremental",
+      "When this is true, the `network/ports` isolator remembers which\n"
+      "container owns each listening socket across checks, and only scans\n"
+      "the open sockets of the container processes when there are new\n"
+      "listening sockets, starting with the containers whose processes\n"
+      "changed since the previous check.",
+      false);
+
   add(&Flags::check_agent_port_range_only,
       "check_agent_port_range_only",
       "When this is true, the `network/ports` isolator allows tasks to\n"
@@ -1451,6 +1643,42 @@ mesos::internal::slave::Flags::Flags()
       "used by the `disk/du` and `disk/xfs` isolators.",
       Seconds(15));
 
+  add(&Flags::container_disk_native_usage,
+      "container_disk_native_usage",
+      "If set, the `disk/du` isolator computes the disk usage of containers\n"
+      "in-process by walking their directories rather than by running\n"
+      "`du`. On Linux, the walked directories are watched with inotify so\n"
+      "that subsequent walks only rescan the directories that changed.",
+      false);
+
+  add(&Flags::container_disk_usage_threads,
+      "container_disk_usage_threads",
+      "Number of threads used to walk the directories of a container when\n"
+      "`--container_disk_native_usage` is set.",
+      DEFAULT_CONTAINER_DISK_USAGE_THREADS,
+      [](const size_t& value) -> Option<Error> {
+        if (value == 0) {
+          return Error(
+              "Expected --container_disk_usage_threads to be positive");
+        }
+
+        return None();
+      });
+
+  add(&Flags::container_disk_usage_budget,
+      "container_disk_usage_budget",
+      "Maximum number of files and directories per second that are stat'ed\n"
+      "when walking the directories of a container with\n"
+      "`--container_disk_native_usage`. Unlimited if not set.",
+      [](const Option<size_t>& value) -> Option<Error> {
+        if (value.isSome() && value.get() == 0) {
+          return Error(
+              "Expected --container_disk_usage_budget to be positive");
+        }
+
+        return None();
+      });
+
   // TODO(jieyu): Consider enabling this flag by default. Remember
   // to update the user doc if we decide to do so.
   add(&Flags::enforce_container_disk_quota,
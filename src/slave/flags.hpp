@@ -53,12 +53,18 @@ public:
 
   Option<std::string> image_providers;
   Option<std::string> image_provisioner_backend;
+  size_t image_provisioner_copy_threads;
+  size_t image_provisioner_pool_size;
   Option<ImageGcConfig> image_gc_config;
 
   std::string appc_simple_discovery_uri_prefix;
   std::string appc_store_dir;
+  Bytes blob_store_capacity;
+  std::string blob_store_dir;
 
   std::string docker_registry;
+  size_t docker_registry_concurrency;
+  bool docker_registry_native_client;
   std::string docker_store_dir;
   std::string docker_volume_checkpoint_dir;
   bool docker_volume_chown;
@@ -69,6 +75,7 @@ public:
   Bytes fetcher_cache_size;
   std::string fetcher_cache_dir;
   Duration fetcher_stall_timeout;
+  size_t fetcher_threads;
   std::string work_dir;
   std::string runtime_dir;
   std::string launcher_dir;
@@ -95,6 +102,9 @@ public:
 #endif // USE_SSL_SOCKET
   Duration gc_delay;
   double gc_disk_headroom;
+  size_t gc_threads;
+  Option<size_t> gc_inode_rate_limit;
+  Option<Bytes> gc_io_rate_limit;
   bool gc_non_executor_container_sandboxes;
   Duration disk_watch_interval;
 
@@ -103,7 +113,11 @@ public:
   std::string reconfiguration_policy;
   std::string recover;
   Duration recovery_timeout;
+  size_t recovery_threads;
+  bool recovery_index;
   bool strict;
+  bool status_update_journal;
+  Duration status_update_journal_compaction_interval;
   Duration register_retry_interval_min;
 #ifdef __linux__
   Duration cgroups_destroy_timeout;
@@ -112,6 +126,8 @@ public:
   bool cgroups_enable_cfs;
   bool cgroups_limit_swap;
   bool cgroups_cpu_enable_pids_and_tids_count;
+  Option<Duration> cgroups_usage_sampling_interval;
+  Duration cgroups_usage_max_staleness;
   Option<std::string> cgroups_net_cls_primary_handle;
   Option<std::string> cgroups_net_cls_secondary_handles;
   Option<DeviceWhitelist> allowed_devices;
@@ -121,6 +137,7 @@ public:
   Option<std::string> perf_events;
   Duration perf_interval;
   Duration perf_duration;
+  bool perf_native;
   bool revocable_cpu_low_priority;
   bool systemd_enable_support;
   std::string systemd_runtime_directory;
@@ -178,6 +195,7 @@ public:
 
 #ifdef ENABLE_NETWORK_PORTS_ISOLATOR
   Duration container_ports_watch_interval;
+  bool container_ports_watch_incremental;
   bool check_agent_port_range_only;
   bool enforce_container_ports;
   Option<std::string> container_ports_isolated_range;
@@ -188,6 +206,9 @@ public:
   bool network_cni_root_dir_persist;
   bool network_cni_metrics;
   Duration container_disk_watch_interval;
+  bool container_disk_native_usage;
+  size_t container_disk_usage_threads;
+  Option<size_t> container_disk_usage_budget;
   bool enforce_container_disk_quota;
   Option<Modules> modules;
   Option<std::string> modulesDir;
@@ -17,6 +17,8 @@
 #include "slave/gc.hpp"
 
 #include <list>
+#include <memory>
+#include <thread>
 
 #include <process/check.hpp>
 #include <process/defer.hpp>
@@ -46,6 +48,7 @@ using process::wait; // Necessary on some OS's to disambiguate.
 using std::list;
 using std::map;
 using std::string;
+using std::vector;
 
 using process::metrics::Counter;
 
@@ -61,11 +64,15 @@ GarbageCollectorProcess::Metrics::Metrics(GarbageCollectorProcess *gc)
       // basically has to be tracked as a member variable, which means we
       // can safely do concurrent reads while the map is being updated.
       return static_cast<double>(gc->paths.size());
-    })
+    }),
+    inodes_removed("gc/inodes_removed"),
+    bytes_removed("gc/bytes_removed")
 {
   process::metrics::add(path_removals_succeeded);
   process::metrics::add(path_removals_failed);
   process::metrics::add(path_removals_pending);
+  process::metrics::add(inodes_removed);
+  process::metrics::add(bytes_removed);
 }
 
 
@@ -73,6 +80,8 @@ GarbageCollectorProcess::Metrics::~Metrics()
 {
   process::metrics::remove(path_removals_succeeded);
   process::metrics::remove(path_removals_failed);
+  process::metrics::remove(inodes_removed);
+  process::metrics::remove(bytes_removed);
 
   // Wait for the metric to be removed to protect against asynchronous
   // evaluation referencing a deleted object.
@@ -200,8 +209,14 @@ void GarbageCollectorProcess::remove(const Timeout& removalTime)
     Counter _failed = metrics.path_removals_failed;
     const string _workDir = workDir;
 
-    auto rmdirs =
-      [_succeeded, _failed, _workDir, infos]() mutable -> Future<Nothing> {
+#ifndef __WINDOWS__
+    Counter inodesRemoved = metrics.inodes_removed;
+    Counter bytesRemoved = metrics.bytes_removed;
+    const size_t _threads = threads;
+    std::shared_ptr<RemovalBudget> _budget = budget;
+#endif // __WINDOWS__
+
+    auto rmdirs = [=]() mutable -> Future<Nothing> {
       // Make mutable copies of the counters to work around MESOS-7907.
       Counter succeeded = _succeeded;
       Counter failed = _failed;
@@ -263,43 +278,72 @@ void GarbageCollectorProcess::remove(const Timeout& removalTime)
       }
 #endif // __linux__
 
+      // The removals continue on errors: it's possible for tasks and
+      // isolators to lay down files that are not deletable by GC. In
+      // the face of such errors GC needs to free up disk space wherever
+      // it can because the disk space has already been re-offered to
+      // frameworks.
+      vector<Try<Nothing>> rmdirs;
+
+#ifdef __WINDOWS__
+      foreach (const Owned<PathInfo>& info, infos) {
+        LOG(INFO) << "Deleting " << info->path;
+        rmdirs.push_back(os::rmdir(info->path, true, true, true));
+      }
+#else
+      // The paths are removed by a number of threads in parallel, which
+      // share the subtrees of the paths and the removal budget.
+      vector<string> paths;
       foreach (const Owned<PathInfo>& info, infos) {
-        // Run the removal operation with 'continueOnError = true'.
-        // It's possible for tasks and isolators to lay down files
-        // that are not deletable by GC. In the face of such errors
-        // GC needs to free up disk space wherever it can because the
-        // disk space has already been re-offered to frameworks.
         LOG(INFO) << "Deleting " << info->path;
-        Try<Nothing> rmdir = os::rmdir(info->path, true, true, true);
+        paths.push_back(info->path);
+      }
 
-        if (rmdir.isError()) {
+      rmdirs = removePaths(
+          paths, _threads, _budget.get(), inodesRemoved, bytesRemoved);
+#endif // __WINDOWS__
+
+      CHECK_EQ(infos.size(), rmdirs.size());
+
+      auto rmdir = rmdirs.begin();
+      foreach (const Owned<PathInfo>& info, infos) {
+        if (rmdir->isError()) {
           // TODO(zhitao): Change return value type of `rmdir` to
           // `Try<Nothing, ErrnoError>` and check error type instead.
-          if (rmdir.error() == ErrnoError(ENOENT).message) {
+          if (rmdir->error() == ErrnoError(ENOENT).message) {
             LOG(INFO) << "Skipped '" << info->path << "' which does not exist";
           } else {
             LOG(WARNING) << "Failed to delete '" << info->path << "': "
-                         << rmdir.error();
-            info->promise.fail(rmdir.error());
+                         << rmdir->error();
+            info->promise.fail(rmdir->error());
 
             ++failed;
           }
         } else {
           LOG(INFO) << "Deleted '" << info->path << "'";
-          info->promise.set(rmdir.get());
+          info->promise.set(rmdir->get());
 
           ++succeeded;
         }
+
+        ++rmdir;
       }
 
       return Nothing();
     };
 
-    // NOTE: All `rmdirs` calls are dispatched to one executor so that:
+    // NOTE: The `rmdirs` calls run on their own threads so that:
     //   1. They do not block other dispatches (MESOS-6549).
-    //   2. They do not occupy all worker threads (MESOS-7964).
-    executor.execute(rmdirs)
+    //   2. They do not occupy any worker thread (MESOS-7964) while
+    //      they wait for the removal budget.
+    std::shared_ptr<Promise<Nothing>> promise(new Promise<Nothing>());
+
+    promise->future()
       .onAny(defer(self(), &Self::_remove, lambda::_1, infos));
+
+    std::thread([rmdirs, promise]() mutable {
+      promise->associate(rmdirs());
+    }).detach();
   } else {
     // This occurs when either:
     //   1. The path(s) has already been removed (e.g. by prune()).
@@ -336,9 +380,14 @@ void GarbageCollectorProcess::prune(const Duration& d)
 }
 
 
-GarbageCollector::GarbageCollector(const string& workDir)
+GarbageCollector::GarbageCollector(
+    const string& workDir,
+    size_t threads,
+    const Option<size_t>& inodeRateLimit,
+    const Option<Bytes>& ioRateLimit)
 {
-  process = new GarbageCollectorProcess(workDir);
+  process = new GarbageCollectorProcess(
+      workDir, threads, inodeRateLimit, ioRateLimit);
   spawn(process);
 }
 
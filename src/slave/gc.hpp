@@ -22,8 +22,10 @@
 
 #include <process/future.hpp>
 
+#include <stout/bytes.hpp>
 #include <stout/duration.hpp>
 #include <stout/nothing.hpp>
+#include <stout/option.hpp>
 
 namespace mesos {
 namespace internal {
@@ -42,7 +44,14 @@ class GarbageCollectorProcess;
 class GarbageCollector
 {
 public:
-  explicit GarbageCollector(const std::string& workDir);
+  // The paths due for removal at the same time are removed by up to
+  // `threads` threads in parallel, and the rate at which the inodes
+  // and bytes are removed is limited across all the removals.
+  explicit GarbageCollector(
+      const std::string& workDir,
+      size_t threads = 1,
+      const Option<size_t>& inodeRateLimit = None(),
+      const Option<Bytes>& ioRateLimit = None());
   virtual ~GarbageCollector();
 
   // Schedules the specified path for removal after the specified
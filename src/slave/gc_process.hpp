@@ -18,9 +18,9 @@
 #define __SLAVE_GC_PROCESS_HPP__
 
 #include <list>
+#include <memory>
 #include <string>
 
-#include <process/executor.hpp>
 #include <process/future.hpp>
 #include <process/id.hpp>
 #include <process/owned.hpp>
@@ -31,12 +31,18 @@
 #include <process/metrics/counter.hpp>
 #include <process/metrics/pull_gauge.hpp>
 
+#include <stout/bytes.hpp>
 #include <stout/duration.hpp>
 #include <stout/hashmap.hpp>
 #include <stout/multimap.hpp>
 #include <stout/nothing.hpp>
+#include <stout/option.hpp>
 #include <stout/try.hpp>
 
+#ifndef __WINDOWS__
+#include "slave/gc_remover.hpp"
+#endif // __WINDOWS__
+
 namespace mesos {
 namespace internal {
 namespace slave {
@@ -45,10 +51,19 @@ class GarbageCollectorProcess :
     public process::Process<GarbageCollectorProcess>
 {
 public:
-  explicit GarbageCollectorProcess(const std::string& _workDir)
+  explicit GarbageCollectorProcess(
+      const std::string& _workDir,
+      size_t _threads = 1,
+      const Option<size_t>& inodeRateLimit = None(),
+      const Option<Bytes>& ioRateLimit = None())
     : ProcessBase(process::ID::generate("agent-garbage-collector")),
       metrics(this),
-      workDir(_workDir) {}
+      workDir(_workDir),
+      threads(_threads)
+#ifndef __WINDOWS__
+      , budget(new RemovalBudget(inodeRateLimit, ioRateLimit))
+#endif // __WINDOWS__
+  {}
 
   ~GarbageCollectorProcess() override;
 
@@ -96,10 +111,22 @@ private:
     process::metrics::Counter path_removals_succeeded;
     process::metrics::Counter path_removals_failed;
     process::metrics::PullGauge path_removals_pending;
+
+    // The progress of the path removals.
+    process::metrics::Counter inodes_removed;
+    process::metrics::Counter bytes_removed;
   } metrics;
 
   const std::string workDir;
 
+  // The number of threads removing the paths of a removal in parallel.
+  const size_t threads;
+
+#ifndef __WINDOWS__
+  // The budget shared by all the path removals.
+  std::shared_ptr<RemovalBudget> budget;
+#endif // __WINDOWS__
+
   // Store all the timeouts and corresponding paths to delete.
   // NOTE: We are using Multimap here instead of Multihashmap, because
   // we need the keys of the map (deletion time) to be sorted.
@@ -110,9 +137,6 @@ private:
   hashmap<std::string, process::Timeout> timeouts;
 
   process::Timer timer;
-
-  // For executing path removals in a separate actor.
-  process::Executor executor;
 };
 
 } // namespace slave {
@@ -0,0 +1,474 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#include <glog/logging.h>
+
+#include <stout/error.hpp>
+#include <stout/foreach.hpp>
+#include <stout/path.hpp>
+#include <stout/stringify.hpp>
+
+#include <stout/os/close.hpp>
+#include <stout/os/strerror.hpp>
+
+#include "slave/gc_remover.hpp"
+
+using std::deque;
+using std::pair;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+using process::metrics::Counter;
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+// NOTE: The directories are never followed if they are symbolic links.
+constexpr int DIRECTORY_FLAGS = O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC;
+
+// NOTE: Unlike the paths, their parent directories might be reached
+// through symbolic links, e.g., if the work directory is one.
+constexpr int PARENT_FLAGS = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+
+
+// Returns the number of bytes freed by removing the inode, which is
+// none unless this is its last link.
+static Bytes reclaimable(const struct stat& s)
+{
+  if (!S_ISDIR(s.st_mode) && s.st_nlink > 1) {
+    return Bytes(0);
+  }
+
+  return Bytes(static_cast<uint64_t>(s.st_blocks) * 512);
+}
+
+
+RemovalBudget::RemovalBudget(
+    const Option<size_t>& _inodesPerSecond,
+    const Option<Bytes>& _bytesPerSecond)
+  : inodesPerSecond(_inodesPerSecond.isSome()
+      ? Option<double>(static_cast<double>(_inodesPerSecond.get()))
+      : None()),
+    bytesPerSecond(_bytesPerSecond.isSome()
+      ? Option<double>(static_cast<double>(_bytesPerSecond->bytes()))
+      : None()),
+    inodes(inodesPerSecond.getOrElse(0.0)),
+    bytes(bytesPerSecond.getOrElse(0.0)),
+    refilled(std::chrono::steady_clock::now()) {}
+
+
+void RemovalBudget::acquire(const Bytes& size)
+{
+  if (inodesPerSecond.isNone() && bytesPerSecond.isNone()) {
+    return;
+  }
+
+  double wait = 0.0;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
+
+    const double elapsed =
+      std::chrono::duration<double>(now - refilled).count();
+
+    refilled = now;
+
+    // The budget goes into debt for the removals that do not fit, so
+    // that the following removals wait for the debt to be paid off.
+    if (inodesPerSecond.isSome()) {
+      inodes = std::min(
+          inodesPerSecond.get(),
+          inodes + elapsed * inodesPerSecond.get()) - 1;
+
+      wait = std::max(wait, -inodes / inodesPerSecond.get());
+    }
+
+    if (bytesPerSecond.isSome()) {
+      bytes = std::min(
+          bytesPerSecond.get(),
+          bytes + elapsed * bytesPerSecond.get()) -
+        static_cast<double>(size.bytes());
+
+      wait = std::max(wait, -bytes / bytesPerSecond.get());
+    }
+  }
+
+  if (wait > 0.0) {
+    std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+  }
+}
+
+
+// A single removal of a number of paths, whose directories are removed
+// by a number of threads that share a queue of the directories to scan.
+class PathRemoval
+{
+public:
+  PathRemoval(
+      const vector<string>& _paths,
+      RemovalBudget* _budget,
+      const Counter& _inodesRemoved,
+      const Counter& _bytesRemoved)
+    : paths(_paths),
+      budget(_budget),
+      inodesRemoved(_inodesRemoved),
+      bytesRemoved(_bytesRemoved),
+      roots(_paths.size()) {}
+
+  vector<Try<Nothing>> run(size_t threads)
+  {
+    for (size_t i = 0; i < paths.size(); i++) {
+      const Path target(paths[i]);
+
+      // The paths are only looked up here, everything below them is
+      // opened and removed relative to the descriptors of their
+      // directories, which are kept open until they are removed.
+      roots[i].fd = ::open(target.dirname().c_str(), PARENT_FLAGS);
+      if (roots[i].fd < 0) {
+        roots[i].error = ErrnoError(errno);
+        continue;
+      }
+
+      const string name = target.basename();
+
+      struct stat s;
+      if (::fstatat(roots[i].fd, name.c_str(), &s, AT_SYMLINK_NOFOLLOW) < 0) {
+        roots[i].error = ErrnoError(errno);
+        continue;
+      }
+
+      if (!S_ISDIR(s.st_mode)) {
+        remove(
+            roots[i].fd, name, paths[i], reclaimable(s), false,
+            &roots[i].errors);
+        continue;
+      }
+
+      roots[i].device = s.st_dev;
+
+      nodes.emplace_back(
+          new Node{paths[i], name, nullptr, i, reclaimable(s), 1, -1});
+
+      queue.push_back(nodes.back().get());
+    }
+
+    vector<std::thread> workers;
+    for (size_t i = 1; i < threads; i++) {
+      workers.emplace_back(&PathRemoval::work, this);
+    }
+
+    work();
+
+    foreach (std::thread& worker, workers) {
+      worker.join();
+    }
+
+    vector<Try<Nothing>> results;
+    foreach (const Root& root, roots) {
+      if (root.fd >= 0) {
+        os::close(root.fd);
+      }
+
+      if (root.error.isSome()) {
+        results.push_back(root.error.get());
+      } else if (root.errors > 0) {
+        results.push_back(
+            Error("Failed to delete " + stringify(root.errors) + " paths"));
+      } else {
+        results.push_back(Nothing());
+      }
+    }
+
+    return results;
+  }
+
+private:
+  struct Node
+  {
+    // The path is only used for logging.
+    const string path;
+
+    // The name of this directory within its parent directory.
+    const string name;
+
+    // The directory which contains this one, if not a root.
+    Node* const parent;
+
+    // The index of the path this directory belongs to.
+    const size_t root;
+
+    const Bytes size;
+
+    // The number of subdirectories which are not removed yet, plus one
+    // until the directory has been scanned.
+    size_t pending;
+
+    // The descriptor of this directory once it has been scanned, which
+    // its subdirectories are opened and removed relative to.
+    int fd;
+  };
+
+  struct Root
+  {
+    // The descriptor of the directory which contains the path.
+    int fd = -1;
+
+    dev_t device = 0;
+    size_t errors = 0;
+    Option<Error> error;
+  };
+
+  // Returns the descriptor of the directory containing the node.
+  int parent(const Node* node) const
+  {
+    return node->parent != nullptr
+      ? node->parent->fd
+      : roots[node->root].fd;
+  }
+
+  void work()
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+      condition.wait(lock, [this]() {
+        return !queue.empty() || active == 0;
+      });
+
+      if (queue.empty()) {
+        break;
+      }
+
+      Node* node = queue.front();
+      queue.pop_front();
+      active++;
+
+      const dev_t device = roots[node->root].device;
+
+      lock.unlock();
+
+      vector<pair<string, Bytes>> subdirectories;
+      size_t errors = 0;
+      scan(node, device, &subdirectories, &errors);
+
+      lock.lock();
+
+      roots[node->root].errors += errors;
+
+      // The subdirectories are scanned first, so that a path is mostly
+      // removed before the next one is started and the queue stays
+      // small, while the threads still share the subtrees of a path.
+      node->pending += subdirectories.size();
+      for (auto subdirectory = subdirectories.rbegin();
+           subdirectory != subdirectories.rend();
+           ++subdirectory) {
+        nodes.emplace_back(new Node{
+            path::join(node->path, subdirectory->first),
+            subdirectory->first,
+            node,
+            node->root,
+            subdirectory->second,
+            1,
+            -1});
+
+        queue.push_front(nodes.back().get());
+      }
+
+      // Remove the directories whose entries have all been removed,
+      // up to the first one which still has pending subdirectories.
+      while (node != nullptr && --node->pending == 0) {
+        lock.unlock();
+
+        if (node->fd >= 0) {
+          os::close(node->fd);
+          node->fd = -1;
+        }
+
+        errors = 0;
+        remove(
+            parent(node), node->name, node->path, node->size, true, &errors);
+
+        lock.lock();
+
+        roots[node->root].errors += errors;
+        node = node->parent;
+      }
+
+      active--;
+      condition.notify_all();
+    }
+
+    condition.notify_all();
+  }
+
+  // Removes the entries of the directory other than its subdirectories,
+  // whose names are returned along with their sizes to be removed in
+  // turn. The descriptor of the directory is kept in the node.
+  void scan(
+      Node* node,
+      dev_t device,
+      vector<pair<string, Bytes>>* subdirectories,
+      size_t* errors)
+  {
+    const string& directory = node->path;
+
+    int fd = ::openat(parent(node), node->name.c_str(), DIRECTORY_FLAGS);
+    if (fd < 0) {
+      if (errno != ENOENT) {
+        LOG(ERROR) << "Failed to open directory '" << directory << "': "
+                   << os::strerror(errno);
+        ++(*errors);
+      }
+      return;
+    }
+
+    // NOTE: The stream owns the descriptor it is opened with, so it is
+    // given a duplicate to keep the directory open after the scan.
+    int streamFd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (streamFd < 0) {
+      LOG(ERROR) << "Failed to duplicate the descriptor of directory '"
+                 << directory << "': " << os::strerror(errno);
+      ++(*errors);
+      os::close(fd);
+      return;
+    }
+
+    DIR* dir = ::fdopendir(streamFd);
+    if (dir == nullptr) {
+      LOG(ERROR) << "Failed to open directory '" << directory << "': "
+                 << os::strerror(errno);
+      ++(*errors);
+      os::close(streamFd);
+      os::close(fd);
+      return;
+    }
+
+    struct dirent* entry;
+    while ((entry = ::readdir(dir)) != nullptr) {
+      const string name = entry->d_name;
+      if (name == "." || name == "..") {
+        continue;
+      }
+
+      struct stat s;
+      if (::fstatat(fd, name.c_str(), &s, AT_SYMLINK_NOFOLLOW) < 0) {
+        if (errno != ENOENT) {
+          LOG(ERROR) << "Failed to stat '" << path::join(directory, name)
+                     << "': " << os::strerror(errno);
+          ++(*errors);
+        }
+        continue;
+      }
+
+      if (!S_ISDIR(s.st_mode)) {
+        remove(
+            fd, name, path::join(directory, name), reclaimable(s), false,
+            errors);
+      } else if (s.st_dev != device) {
+        // Unlike `os::rmdir`, nothing is removed from the filesystems
+        // which are still mounted under the path, e.g., a persistent
+        // volume that failed to be unmounted.
+        LOG(WARNING) << "Skipping mount point '"
+                     << path::join(directory, name) << "'";
+        ++(*errors);
+      } else {
+        subdirectories->emplace_back(name, reclaimable(s));
+      }
+    }
+
+    ::closedir(dir);
+
+    node->fd = fd;
+  }
+
+  // Removes the inode `name` relative to the directory descriptor `fd`
+  // within the budget, and reports the progress.
+  void remove(
+      int fd,
+      const string& name,
+      const string& path,
+      const Bytes& size,
+      bool directory,
+      size_t* errors)
+  {
+    if (budget != nullptr) {
+      budget->acquire(size);
+    }
+
+    if (::unlinkat(fd, name.c_str(), directory ? AT_REMOVEDIR : 0) < 0) {
+      if (errno != ENOENT) {
+        LOG(ERROR) << "Failed to delete "
+                   << (directory ? "directory" : "path") << " '" << path
+                   << "': " << os::strerror(errno);
+        ++(*errors);
+      }
+      return;
+    }
+
+    ++inodesRemoved;
+    bytesRemoved += static_cast<int64_t>(size.bytes());
+  }
+
+  const vector<string> paths;
+  RemovalBudget* const budget;
+
+  Counter inodesRemoved;
+  Counter bytesRemoved;
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  deque<Node*> queue;
+  size_t active = 0;
+
+  vector<Root> roots;
+  deque<unique_ptr<Node>> nodes;
+};
+
+
+vector<Try<Nothing>> removePaths(
+    const vector<string>& paths,
+    size_t threads,
+    RemovalBudget* budget,
+    Counter inodesRemoved,
+    Counter bytesRemoved)
+{
+  PathRemoval removal(paths, budget, inodesRemoved, bytesRemoved);
+  return removal.run(std::max<size_t>(threads, 1));
+}
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,83 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __SLAVE_GC_REMOVER_HPP__
+#define __SLAVE_GC_REMOVER_HPP__
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <process/metrics/counter.hpp>
+
+#include <stout/bytes.hpp>
+#include <stout/nothing.hpp>
+#include <stout/option.hpp>
+#include <stout/try.hpp>
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+// Limits the rate at which the garbage collector removes inodes and
+// reclaims bytes, across all the threads removing paths. Each limit
+// allows a burst of up to one second worth of removals.
+class RemovalBudget
+{
+public:
+  RemovalBudget(
+      const Option<size_t>& inodesPerSecond,
+      const Option<Bytes>& bytesPerSecond);
+
+  // Blocks the calling thread until the removal of an inode holding
+  // the given number of bytes fits within the budget.
+  void acquire(const Bytes& size);
+
+private:
+  const Option<double> inodesPerSecond;
+  const Option<double> bytesPerSecond;
+
+  std::mutex mutex;
+  double inodes;
+  double bytes;
+  std::chrono::steady_clock::time_point refilled;
+};
+
+
+// Removes the paths like `rm -rf`, by a number of threads that share a
+// queue of the directories to remove, so that the subtrees of the paths
+// are removed in parallel. Only the parents of the paths are opened by
+// path, the entries below them are opened and removed with `openat`
+// and `unlinkat` on the descriptors of their directories, which are
+// kept open meanwhile. The paths are started in the given order.
+// Mount points are not crossed, and the errors are logged and skipped
+// so that as much as possible is reclaimed. The removed inodes and the
+// reclaimed bytes are added to the counters as the removal progresses.
+// Returns the result of each path in order, where a missing path
+// results in an `ErrnoError(ENOENT)`. This blocks the calling thread.
+std::vector<Try<Nothing>> removePaths(
+    const std::vector<std::string>& paths,
+    size_t threads,
+    RemovalBudget* budget,
+    process::metrics::Counter inodesRemoved,
+    process::metrics::Counter bytesRemoved);
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __SLAVE_GC_REMOVER_HPP__
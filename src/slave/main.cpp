@@ -681,7 +681,11 @@ int main(int argc, char** argv)
 #endif // __linux__
 
   Fetcher* fetcher = new Fetcher(flags);
-  GarbageCollector* gc = new GarbageCollector(flags.work_dir);
+  GarbageCollector* gc = new GarbageCollector(
+      flags.work_dir,
+      flags.gc_threads,
+      flags.gc_inode_rate_limit,
+      flags.gc_io_rate_limit);
 
   // Initialize SecretResolver.
   Try<SecretResolver*> secretResolver =
@@ -54,6 +54,7 @@ namespace paths {
 
 // File names.
 const char BOOT_ID_FILE[] = "boot_id";
+const char STATUS_UPDATE_JOURNAL_FILE[] = "status_updates.journal";
 const char SLAVE_INFO_FILE[] = "slave.info";
 const char DRAIN_CONFIG_FILE[] = "drain.config";
 const char FRAMEWORK_PID_FILE[] = "framework.pid";
@@ -61,6 +62,7 @@ const char FRAMEWORK_INFO_FILE[] = "framework.info";
 const char LIBPROCESS_PID_FILE[] = "libprocess.pid";
 const char EXECUTOR_INFO_FILE[] = "executor.info";
 const char EXECUTOR_SENTINEL_FILE[] = "executor.sentinel";
+const char TASKS_INDEX_FILE[] = "tasks.index";
 const char HTTP_MARKER_FILE[] = "http.marker";
 const char FORKED_PID_FILE[] = "forked.pid";
 const char TASK_INFO_FILE[] = "task.info";
@@ -162,6 +164,12 @@ string getBootIdPath(const string& rootDir)
 }
 
 
+string getStatusUpdateJournalPath(const string& rootDir)
+{
+  return path::join(rootDir, STATUS_UPDATE_JOURNAL_FILE);
+}
+
+
 string getLatestSlavePath(const string& rootDir)
 {
   return path::join(rootDir, SLAVES_DIR, LATEST_SYMLINK);
@@ -353,6 +361,24 @@ string getExecutorSentinelPath(
 }
 
 
+string getTasksIndexPath(
+    const string& rootDir,
+    const SlaveID& slaveId,
+    const FrameworkID& frameworkId,
+    const ExecutorID& executorId,
+    const ContainerID& containerId)
+{
+  return path::join(
+      getExecutorRunPath(
+          rootDir,
+          slaveId,
+          frameworkId,
+          executorId,
+          containerId),
+      TASKS_INDEX_FILE);
+}
+
+
 string getExecutorVirtualPath(
     const FrameworkID& frameworkId,
     const ExecutorID& executorId)
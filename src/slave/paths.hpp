@@ -68,6 +68,7 @@ namespace paths {
 //   |                           |-- <container_id> (sandbox)
 //   |-- meta
 //   |   |-- boot_id
+//   |   |-- status_updates.journal
 //   |   |-- resources
 //   |   |   |-- resources.info
 //   |   |   |-- resources.target
@@ -100,6 +101,7 @@ namespace paths {
 //   |   |                           |-- latest (symlink)
 //   |   |                           |-- <container_id> (sandbox)
 //   |   |                               |-- executor.sentinel (if completed)
+//   |   |                               |-- tasks.index (if completed)
 //   |   |                               |-- pids
 //   |   |                               |   |-- forked.pid
 //   |   |                               |   |-- libprocess.pid
@@ -162,6 +164,9 @@ std::string getLatestSlavePath(const std::string& rootDir);
 std::string getBootIdPath(const std::string& rootDir);
 
 
+std::string getStatusUpdateJournalPath(const std::string& rootDir);
+
+
 std::string getSlaveInfoPath(
     const std::string& rootDir,
     const SlaveID& slaveId);
@@ -262,6 +267,14 @@ std::string getExecutorSentinelPath(
     const ContainerID& containerId);
 
 
+std::string getTasksIndexPath(
+    const std::string& rootDir,
+    const SlaveID& slaveId,
+    const FrameworkID& frameworkId,
+    const ExecutorID& executorId,
+    const ContainerID& containerId);
+
+
 // Returns the "virtual" path used to expose the executor's sandbox
 // via the /files endpoints: `/frameworks/FID/executors/EID/latest`.
 std::string getExecutorVirtualPath(
@@ -0,0 +1,357 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <list>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <mesos/module/qos_controller.hpp>
+
+#include <mesos/slave/qos_controller.hpp>
+
+#include <process/defer.hpp>
+#include <process/dispatch.hpp>
+#include <process/id.hpp>
+#include <process/owned.hpp>
+#include <process/process.hpp>
+
+#include <stout/duration.hpp>
+#include <stout/foreach.hpp>
+#include <stout/lambda.hpp>
+#include <stout/option.hpp>
+#include <stout/strings.hpp>
+
+#include "slave/qos_controllers/pressure.hpp"
+
+using namespace mesos;
+using namespace process;
+
+using std::list;
+using std::pair;
+using std::string;
+using std::vector;
+
+using mesos::modules::Module;
+
+using mesos::slave::QoSController;
+using mesos::slave::QoSCorrection;
+
+namespace pressure = cgroups2::pressure;
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+static string stringify(pressure::Resource resource)
+{
+  switch (resource) {
+    case pressure::Resource::CPU:    return "cpu";
+    case pressure::Resource::MEMORY: return "memory";
+    case pressure::Resource::IO:     return "io";
+  }
+
+  UNREACHABLE();
+}
+
+
+// Returns the share of time in which the tasks of an executor were stalled
+// on the resource over the last 10 seconds.
+static double stalled(
+    const ResourceStatistics& statistics,
+    pressure::Resource resource)
+{
+  switch (resource) {
+    case pressure::Resource::CPU:
+      return statistics.cpu_pressure().some().avg10();
+    case pressure::Resource::MEMORY:
+      return statistics.mem_pressure().some().avg10();
+    case pressure::Resource::IO:
+      return statistics.io_pressure().some().avg10();
+  }
+
+  UNREACHABLE();
+}
+
+
+class PressureQoSControllerProcess
+  : public Process<PressureQoSControllerProcess>
+{
+public:
+  PressureQoSControllerProcess(
+      const lambda::function<Future<ResourceUsage>()>& _usage,
+      vector<pair<pressure::Resource, Owned<pressure::Trigger>>>&& _triggers)
+    : ProcessBase(process::ID::generate("qos-pressure-controller")),
+      usage(_usage),
+      triggers(std::move(_triggers)) {}
+
+  void finalize() override
+  {
+    // The triggers must not be polled once they are destroyed.
+    discard();
+  }
+
+  Future<list<QoSCorrection>> corrections()
+  {
+    discard();
+
+    // Wait for the kernel to notify any of the triggers. A notification
+    // which arrives in between two calls is not lost, as the trigger stays
+    // readable until it is polled.
+    Owned<Promise<pressure::Resource>> promise(
+        new Promise<pressure::Resource>());
+
+    foreach (const auto& trigger, triggers) {
+      const pressure::Resource resource = trigger.first;
+
+      Future<Nothing> fired = trigger.second->fired();
+      fired.onReady([promise, resource]() { promise->set(resource); });
+
+      notifications.push_back(fired);
+    }
+
+    return promise->future()
+      .then(defer(self(), [this](pressure::Resource resource) {
+        discard();
+
+        LOG(INFO) << "Tasks stalled on " << stringify(resource)
+                  << " for longer than the threshold";
+
+        return usage()
+          .then(defer(self(), &Self::_corrections, resource, lambda::_1));
+      }));
+  }
+
+  Future<list<QoSCorrection>> _corrections(
+      pressure::Resource resource,
+      const ResourceUsage& usage)
+  {
+    // Evict the revocable executor whose tasks are stalled the most on
+    // the resource, which are the ones contending for it the most.
+    Option<ResourceUsage::Executor> victim;
+    double highest = 0;
+
+    foreach (const ResourceUsage::Executor& executor, usage.executors()) {
+      if (Resources(executor.allocated()).revocable().empty()) {
+        continue;
+      }
+
+      double current = executor.has_statistics()
+        ? stalled(executor.statistics(), resource)
+        : 0;
+
+      if (victim.isNone() || current > highest) {
+        victim = executor;
+        highest = current;
+      }
+    }
+
+    if (victim.isNone()) {
+      LOG(INFO) << "No revocable executors to evict";
+      return list<QoSCorrection>();
+    }
+
+    LOG(INFO) << "Evicting revocable executor "
+              << victim->executor_info().executor_id()
+              << " of framework " << victim->executor_info().framework_id()
+              << " with " << stringify(resource) << " pressure " << highest;
+
+    QoSCorrection correction;
+    correction.set_type(mesos::slave::QoSCorrection_Type_KILL);
+    correction.mutable_kill()->mutable_framework_id()->CopyFrom(
+      victim->executor_info().framework_id());
+    correction.mutable_kill()->mutable_executor_id()->CopyFrom(
+      victim->executor_info().executor_id());
+    correction.mutable_kill()->mutable_container_id()->CopyFrom(
+      victim->container_id());
+
+    return list<QoSCorrection>({correction});
+  }
+
+private:
+  void discard()
+  {
+    foreach (Future<Nothing>& notification, notifications) {
+      notification.discard();
+    }
+
+    notifications.clear();
+  }
+
+  const lambda::function<Future<ResourceUsage>()> usage;
+  const vector<pair<pressure::Resource, Owned<pressure::Trigger>>> triggers;
+
+  // Pending notifications of the triggers.
+  vector<Future<Nothing>> notifications;
+};
+
+
+PressureQoSController::~PressureQoSController()
+{
+  if (process.get() != nullptr) {
+    terminate(process.get());
+    wait(process.get());
+  }
+}
+
+
+Try<Nothing> PressureQoSController::initialize(
+  const lambda::function<Future<ResourceUsage>()>& usage)
+{
+  if (process.get() != nullptr) {
+    return Error("Pressure QoS Controller has already been initialized");
+  }
+
+  vector<pair<pressure::Resource, Owned<pressure::Trigger>>> triggers;
+
+  foreach (const auto& threshold, thresholds) {
+    Try<Owned<pressure::Trigger>> trigger =
+      pressure::Trigger::create(cgroup, threshold.first, threshold.second);
+    if (trigger.isError()) {
+      return Error(
+          "Failed to create " + stringify(threshold.first) + " pressure"
+          " trigger for cgroup '" + cgroup + "': " + trigger.error());
+    }
+
+    triggers.emplace_back(threshold.first, *trigger);
+  }
+
+  process.reset(
+      new PressureQoSControllerProcess(usage, std::move(triggers)));
+
+  spawn(process.get());
+
+  return Nothing();
+}
+
+
+process::Future<list<QoSCorrection>> PressureQoSController::corrections()
+{
+  if (process.get() == nullptr) {
+    return Failure("Pressure QoS Controller is not initialized");
+  }
+
+  return dispatch(
+      process.get(),
+      &PressureQoSControllerProcess::corrections);
+}
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
+
+
+// Parses a threshold of the form "<some|full> <stall>", e.g., "some 100ms".
+static Try<pressure::Threshold> parseThreshold(
+    const string& value,
+    const Duration& window)
+{
+  vector<string> tokens = strings::tokenize(value, " ");
+  if (tokens.size() != 2 || (tokens[0] != "some" && tokens[0] != "full")) {
+    return Error("Expected '<some|full> <stall>' but received '" + value + "'");
+  }
+
+  Try<Duration> stall = Duration::parse(tokens[1]);
+  if (stall.isError()) {
+    return Error("Failed to parse stall '" + tokens[1] + "': " + stall.error());
+  }
+
+  if (*stall <= Duration::zero() || *stall > window) {
+    return Error("The stall must be positive and within the window");
+  }
+
+  pressure::Threshold threshold;
+  threshold.full = tokens[0] == "full";
+  threshold.stall = *stall;
+  threshold.window = window;
+
+  return threshold;
+}
+
+
+static QoSController* create(const Parameters& parameters)
+{
+  string cgroup = cgroups2::ROOT_CGROUP;
+  Duration window = Seconds(2);
+  hashmap<string, string> thresholds;
+
+  foreach (const Parameter& parameter, parameters.parameter()) {
+    if (parameter.key() == "cgroup") {
+      cgroup = parameter.value();
+    } else if (parameter.key() == "window") {
+      Try<Duration> _window = Duration::parse(parameter.value());
+      if (_window.isError()) {
+        LOG(ERROR) << "Failed to parse window: " << _window.error();
+        return nullptr;
+      }
+
+      window = *_window;
+    } else if (parameter.key() == "cpu_threshold" ||
+               parameter.key() == "memory_threshold" ||
+               parameter.key() == "io_threshold") {
+      thresholds[parameter.key()] = parameter.value();
+    }
+  }
+
+  if (thresholds.empty()) {
+    LOG(ERROR) << "No pressure thresholds are configured for"
+               << " PressureQoSController";
+    return nullptr;
+  }
+
+  if (!cgroups2::enabled() || !pressure::supported()) {
+    LOG(ERROR) << "PressureQoSController requires cgroups v2 and"
+               << " pressure stall information";
+    return nullptr;
+  }
+
+  const vector<pair<string, pressure::Resource>> resources = {
+    {"cpu_threshold", pressure::Resource::CPU},
+    {"memory_threshold", pressure::Resource::MEMORY},
+    {"io_threshold", pressure::Resource::IO}
+  };
+
+  vector<pair<pressure::Resource, pressure::Threshold>> _thresholds;
+
+  foreach (const auto& resource, resources) {
+    if (!thresholds.contains(resource.first)) {
+      continue;
+    }
+
+    Try<pressure::Threshold> threshold =
+      parseThreshold(thresholds.at(resource.first), window);
+    if (threshold.isError()) {
+      LOG(ERROR) << "Failed to parse " << resource.first << ": "
+                 << threshold.error();
+      return nullptr;
+    }
+
+    _thresholds.emplace_back(resource.second, *threshold);
+  }
+
+  return new mesos::internal::slave::PressureQoSController(
+      cgroup, _thresholds);
+}
+
+
+Module<QoSController> org_apache_mesos_PressureQoSController(
+    MESOS_MODULE_API_VERSION,
+    MESOS_VERSION,
+    "Apache Mesos",
+    "modules@mesos.apache.org",
+    "Pressure Stall Information QoS Controller Module.",
+    nullptr,
+    create);
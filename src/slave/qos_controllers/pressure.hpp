@@ -0,0 +1,82 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __SLAVE_QOS_CONTROLLERS_PRESSURE_HPP__
+#define __SLAVE_QOS_CONTROLLERS_PRESSURE_HPP__
+
+#include <list>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <mesos/slave/qos_controller.hpp>
+
+#include <stout/lambda.hpp>
+#include <stout/try.hpp>
+
+#include <process/future.hpp>
+#include <process/owned.hpp>
+
+#include "linux/cgroups2.hpp"
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+// Forward declaration.
+class PressureQoSControllerProcess;
+
+
+// The `PressureQoSController` evicts revocable executors when the tasks of
+// a cgroup are stalled on the CPU, memory or IO for longer than configured,
+// as reported by the pressure stall information (PSI) of cgroups v2. Rather
+// than sampling, it registers PSI triggers with the kernel and waits for
+// their notifications. Each notification evicts the revocable executor
+// under the most pressure on the resource, and the kernel notifies at most
+// once per window, so evictions continue one by one while the pressure
+// persists.
+class PressureQoSController : public mesos::slave::QoSController
+{
+public:
+  PressureQoSController(
+      const std::string& _cgroup,
+      const std::vector<std::pair<
+          cgroups2::pressure::Resource,
+          cgroups2::pressure::Threshold>>& _thresholds)
+    : cgroup(_cgroup),
+      thresholds(_thresholds) {}
+
+  ~PressureQoSController() override;
+
+  Try<Nothing> initialize(
+    const lambda::function<process::Future<ResourceUsage>()>& usage) override;
+
+  process::Future<std::list<mesos::slave::QoSCorrection>> corrections()
+    override;
+
+private:
+  const std::string cgroup;
+  const std::vector<std::pair<
+      cgroups2::pressure::Resource,
+      cgroups2::pressure::Threshold>> thresholds;
+  process::Owned<PressureQoSControllerProcess> process;
+};
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __SLAVE_QOS_CONTROLLERS_PRESSURE_HPP__
@@ -0,0 +1,388 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <mesos/type_utils.hpp>
+
+#include <mesos/module/resource_estimator.hpp>
+
+#include <mesos/slave/resource_estimator.hpp>
+
+#include <process/defer.hpp>
+#include <process/dispatch.hpp>
+#include <process/id.hpp>
+#include <process/owned.hpp>
+#include <process/process.hpp>
+
+#include <stout/bytes.hpp>
+#include <stout/duration.hpp>
+#include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/hashset.hpp>
+#include <stout/lambda.hpp>
+#include <stout/numify.hpp>
+#include <stout/option.hpp>
+#include <stout/stringify.hpp>
+
+#include "slave/resource_estimators/usage.hpp"
+
+using namespace mesos;
+using namespace process;
+
+using std::deque;
+using std::string;
+using std::vector;
+
+using mesos::modules::Module;
+
+using mesos::slave::ResourceEstimator;
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+// Usage samples of a single resource observed within the window,
+// ordered by the time they were taken.
+class Samples
+{
+public:
+  void add(double timestamp, double value)
+  {
+    samples.push_back({timestamp, value});
+  }
+
+  // Drops the samples taken before `timestamp`.
+  void expire(double timestamp)
+  {
+    while (!samples.empty() && samples.front().timestamp < timestamp) {
+      samples.pop_front();
+    }
+  }
+
+  // Returns the smallest sample which is not exceeded by at least a
+  // `quantile` fraction of the samples, i.e., the nearest-rank quantile.
+  Option<double> quantile(double quantile) const
+  {
+    if (samples.empty()) {
+      return None();
+    }
+
+    vector<double> values;
+    values.reserve(samples.size());
+    foreach (const Sample& sample, samples) {
+      values.push_back(sample.value);
+    }
+
+    size_t rank = static_cast<size_t>(std::ceil(quantile * values.size()));
+    size_t index = rank > 0 ? rank - 1 : 0;
+
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+
+    return values[index];
+  }
+
+private:
+  struct Sample
+  {
+    double timestamp;
+    double value;
+  };
+
+  deque<Sample> samples;
+};
+
+
+class UsageResourceEstimatorProcess
+  : public Process<UsageResourceEstimatorProcess>
+{
+public:
+  UsageResourceEstimatorProcess(
+      const lambda::function<Future<ResourceUsage>()>& _usage,
+      double _confidence,
+      const Duration& _window,
+      double _minChange)
+    : ProcessBase(process::ID::generate("usage-resource-estimator")),
+      usage(_usage),
+      confidence(_confidence),
+      window(_window),
+      minChange(_minChange) {}
+
+  Future<Resources> oversubscribable()
+  {
+    return usage().then(defer(self(), &Self::_oversubscribable, lambda::_1));
+  }
+
+  Future<Resources> _oversubscribable(const ResourceUsage& usage)
+  {
+    hashset<ContainerID> containerIds;
+
+    Resources allocatedRevocable;
+    double cpus = 0.0;
+    Bytes mem;
+
+    foreach (const ResourceUsage::Executor& executor, usage.executors()) {
+      const Resources allocated = executor.allocated();
+      allocatedRevocable += allocated.revocable();
+
+      // Only the resources of executors which are not revocable
+      // themselves can be lent out as revocable resources.
+      const Resources nonRevocable = allocated.nonRevocable();
+      if (nonRevocable.empty()) {
+        continue;
+      }
+
+      if (!executor.has_container_id() || !executor.has_statistics()) {
+        continue;
+      }
+
+      const ContainerID& containerId = executor.container_id();
+      containerIds.insert(containerId);
+
+      Usage& container = containers[containerId];
+      sample(&container, executor.statistics());
+
+      // Executors whose usage has not been observed yet are assumed to
+      // use all of their allocated resources.
+      Option<double> cpusUsed = container.cpus.quantile(confidence);
+      if (cpusUsed.isSome() && nonRevocable.cpus().isSome()) {
+        cpus += std::max(0.0, nonRevocable.cpus().get() - cpusUsed.get());
+      }
+
+      Option<double> memUsed = container.mem.quantile(confidence);
+      if (memUsed.isSome() && nonRevocable.mem().isSome()) {
+        Bytes used(static_cast<uint64_t>(memUsed.get()));
+        if (nonRevocable.mem().get() > used) {
+          mem += nonRevocable.mem().get() - used;
+        }
+      }
+    }
+
+    // Forget the containers which are gone.
+    foreach (const ContainerID& containerId, containers.keys()) {
+      if (!containerIds.contains(containerId)) {
+        containers.erase(containerId);
+      }
+    }
+
+    // Only update the estimate when it changed materially, otherwise
+    // the agent would forward every fluctuation in usage to the master.
+    if (slackCpus.isNone() ||
+        slackMem.isNone() ||
+        changed(slackCpus.get(), cpus) ||
+        changed(slackMem->bytes(), mem.bytes())) {
+      VLOG(1) << "Updating the estimated slack from "
+              << (slackCpus.isSome() ? stringify(slackCpus.get()) : "none")
+              << " cpus and "
+              << (slackMem.isSome() ? stringify(slackMem.get()) : "none")
+              << " memory to " << cpus << " cpus and " << mem << " memory";
+
+      slackCpus = cpus;
+      slackMem = mem;
+    }
+
+    Resources slack;
+
+    Try<Resource> _cpus = Resources::parse(
+        "cpus", stringify(slackCpus.get()), "*");
+    CHECK_SOME(_cpus);
+    _cpus->mutable_revocable();
+    slack += _cpus.get();
+
+    Try<Resource> _mem = Resources::parse(
+        "mem", stringify(slackMem->bytes() / Bytes::MEGABYTES), "*");
+    CHECK_SOME(_mem);
+    _mem->mutable_revocable();
+    slack += _mem.get();
+
+    auto unallocated = [](const Resources& resources) {
+      Resources result = resources;
+      result.unallocate();
+      return result;
+    };
+
+    return slack - unallocated(allocatedRevocable);
+  }
+
+protected:
+  // Usage observed for a single container.
+  struct Usage
+  {
+    // The last cumulative cpu time of the container, used to turn
+    // the cpu time into the number of cpus used since.
+    Option<double> timestamp;
+    Option<double> cpusTime;
+
+    Samples cpus;
+    Samples mem;
+  };
+
+  void sample(Usage* container, const ResourceStatistics& statistics)
+  {
+    const double timestamp = statistics.timestamp();
+
+    container->cpus.expire(timestamp - window.secs());
+    container->mem.expire(timestamp - window.secs());
+
+    if (statistics.has_cpus_user_time_secs() &&
+        statistics.has_cpus_system_time_secs()) {
+      const double cpusTime =
+        statistics.cpus_user_time_secs() + statistics.cpus_system_time_secs();
+
+      if (container->timestamp.isSome() &&
+          container->cpusTime.isSome() &&
+          timestamp > container->timestamp.get()) {
+        container->cpus.add(
+            timestamp,
+            (cpusTime - container->cpusTime.get()) /
+              (timestamp - container->timestamp.get()));
+      }
+
+      container->timestamp = timestamp;
+      container->cpusTime = cpusTime;
+    }
+
+    if (statistics.has_mem_total_bytes()) {
+      container->mem.add(timestamp, statistics.mem_total_bytes());
+    } else if (statistics.has_mem_rss_bytes()) {
+      container->mem.add(timestamp, statistics.mem_rss_bytes());
+    }
+  }
+
+  bool changed(double previous, double current) const
+  {
+    if (previous == 0.0) {
+      return current != 0.0;
+    }
+
+    return std::abs(current - previous) > minChange * previous;
+  }
+
+  const lambda::function<Future<ResourceUsage>()> usage;
+  const double confidence;
+  const Duration window;
+  const double minChange;
+
+  hashmap<ContainerID, Usage> containers;
+
+  // The last estimated slack, i.e., the resources allocated to
+  // non-revocable executors which they are not expected to use.
+  Option<double> slackCpus;
+  Option<Bytes> slackMem;
+};
+
+
+UsageResourceEstimator::~UsageResourceEstimator()
+{
+  if (process.get() != nullptr) {
+    terminate(process.get());
+    wait(process.get());
+  }
+}
+
+
+Try<Nothing> UsageResourceEstimator::initialize(
+    const lambda::function<Future<ResourceUsage>()>& usage)
+{
+  if (process.get() != nullptr) {
+    return Error("Usage resource estimator has already been initialized");
+  }
+
+  process.reset(
+      new UsageResourceEstimatorProcess(
+          usage,
+          confidence,
+          window,
+          minChange));
+
+  spawn(process.get());
+
+  return Nothing();
+}
+
+
+Future<Resources> UsageResourceEstimator::oversubscribable()
+{
+  if (process.get() == nullptr) {
+    return Failure("Usage resource estimator is not initialized");
+  }
+
+  return dispatch(
+      process.get(),
+      &UsageResourceEstimatorProcess::oversubscribable);
+}
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
+
+
+static ResourceEstimator* create(const Parameters& parameters)
+{
+  double confidence = 0.95;
+  Duration window = Minutes(5);
+  double minChange = 0.1;
+
+  foreach (const Parameter& parameter, parameters.parameter()) {
+    if (parameter.key() == "confidence") {
+      Try<double> _confidence = numify<double>(parameter.value());
+      if (_confidence.isError() ||
+          _confidence.get() <= 0.0 ||
+          _confidence.get() > 1.0) {
+        LOG(ERROR) << "Invalid confidence '" << parameter.value() << "'"
+                   << ": expected a number in (0, 1]";
+        return nullptr;
+      }
+
+      confidence = _confidence.get();
+    } else if (parameter.key() == "window") {
+      Try<Duration> _window = Duration::parse(parameter.value());
+      if (_window.isError() || _window.get() <= Duration::zero()) {
+        LOG(ERROR) << "Invalid window '" << parameter.value() << "'"
+                   << ": expected a positive duration";
+        return nullptr;
+      }
+
+      window = _window.get();
+    } else if (parameter.key() == "min_change") {
+      Try<double> _minChange = numify<double>(parameter.value());
+      if (_minChange.isError() || _minChange.get() < 0.0) {
+        LOG(ERROR) << "Invalid minimum change '" << parameter.value() << "'"
+                   << ": expected a non-negative number";
+        return nullptr;
+      }
+
+      minChange = _minChange.get();
+    }
+  }
+
+  return new mesos::internal::slave::UsageResourceEstimator(
+      confidence, window, minChange);
+}
+
+
+Module<ResourceEstimator> org_apache_mesos_UsageResourceEstimator(
+    MESOS_MODULE_API_VERSION,
+    MESOS_VERSION,
+    "Apache Mesos",
+    "modules@mesos.apache.org",
+    "Usage Resource Estimator Module.",
+    nullptr,
+    create);
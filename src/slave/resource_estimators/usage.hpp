@@ -0,0 +1,79 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __SLAVE_RESOURCE_ESTIMATORS_USAGE_HPP__
+#define __SLAVE_RESOURCE_ESTIMATORS_USAGE_HPP__
+
+#include <mesos/resources.hpp>
+
+#include <mesos/slave/resource_estimator.hpp>
+
+#include <process/future.hpp>
+#include <process/owned.hpp>
+
+#include <stout/duration.hpp>
+#include <stout/lambda.hpp>
+#include <stout/nothing.hpp>
+#include <stout/try.hpp>
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+// Forward declaration.
+class UsageResourceEstimatorProcess;
+
+
+// The `UsageResourceEstimator` oversubscribes the agent with the
+// resources that non-revocable executors have been allocated but do
+// not use. For every container it keeps the cpu and memory usage
+// samples observed within a sliding time window and takes the
+// `confidence` quantile of them as the container's usage, so that the
+// estimate is exceeded by at most `1 - confidence` of the observed
+// samples. The estimate is only updated once it differs from the
+// previous one by more than the `minChange` fraction, which avoids
+// forwarding every small fluctuation in usage to the master.
+class UsageResourceEstimator : public mesos::slave::ResourceEstimator
+{
+public:
+  UsageResourceEstimator(
+      double _confidence,
+      const Duration& _window,
+      double _minChange)
+    : confidence(_confidence),
+      window(_window),
+      minChange(_minChange) {}
+
+  ~UsageResourceEstimator() override;
+
+  Try<Nothing> initialize(
+      const lambda::function<process::Future<ResourceUsage>()>& usage)
+    override;
+
+  process::Future<Resources> oversubscribable() override;
+
+private:
+  const double confidence;
+  const Duration window;
+  const double minChange;
+  process::Owned<UsageResourceEstimatorProcess> process;
+};
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __SLAVE_RESOURCE_ESTIMATORS_USAGE_HPP__
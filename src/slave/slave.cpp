@@ -109,6 +109,7 @@
 #include "slave/paths.hpp"
 #include "slave/slave.hpp"
 #include "slave/state.pb.h"
+#include "slave/status_update_journal.hpp"
 #include "slave/task_status_update_manager.hpp"
 
 #ifdef __WINDOWS__
@@ -664,10 +665,12 @@ void Slave::initialize()
 
   // Start image store disk monitoring. Please note that image layers
   // garbage collection is only enabled if the agent flag `--image_gc_config`
-  // is set.
+  // is set. The incremental image garbage collection is run by the
+  // provisioner of the Mesos Containerizer itself.
   // TODO(gilbert): Consider move the image auto GC logic to containerizers
   // respectively. For now, it is only enabled for the Mesos Containerizer.
   if (flags.image_gc_config.isSome() &&
+      !flags.image_gc_config->incremental() &&
       flags.image_providers.isSome() &&
       strings::contains(flags.containerizers, "mesos")) {
     delay(
@@ -992,7 +995,11 @@ void Slave::initialize()
 #endif  // __WINDOWS__
 
   // Do recovery.
-  async(&state::recover, metaDir, flags.strict)
+  async(&state::recover,
+        metaDir,
+        flags.strict,
+        flags.recovery_threads,
+        flags.recovery_index)
     .then(defer(self(), &Slave::recover, lambda::_1))
     .then(defer(self(), &Slave::_recover))
     .onAny(defer(self(), &Slave::__recover, lambda::_1));
@@ -7221,6 +7228,40 @@ void Slave::executorTerminated(
 }
 
 
+void Slave::checkpointTasksIndex(
+    const FrameworkID& frameworkId,
+    const ExecutorID& executorId,
+    const ContainerID& containerId)
+{
+  const string rootDir = metaDir;
+  const SlaveID slaveId = info.id();
+
+  // The status updates of the tasks might still be in the status
+  // update journal, in which case they are written to the status
+  // update files of the tasks before the index is read from them.
+  taskStatusUpdateManager->flush(paths::getExecutorRunPath(
+      rootDir, slaveId, frameworkId, executorId, containerId))
+    .then([=]() {
+      return async(
+          [=]() {
+            return state::checkpointTasksIndex(
+                rootDir, slaveId, frameworkId, executorId, containerId);
+          });
+    })
+    .onAny([=](const Future<Try<Nothing>>& future) {
+      // The run is indexed when the agent recovers it instead.
+      if (!future.isReady() || future->isError()) {
+        LOG(WARNING)
+          << "Failed to checkpoint the tasks index of run " << containerId
+          << " of executor '" << executorId << "' of framework "
+          << frameworkId << ": "
+          << (future.isReady() ? future->error()
+              : future.isFailed() ? future.failure() : "discarded");
+      }
+    });
+}
+
+
 void Slave::removeExecutor(Framework* framework, Executor* executor)
 {
   CHECK_NOTNULL(framework);
@@ -7252,6 +7293,11 @@ void Slave::removeExecutor(Framework* framework, Executor* executor)
         executor->id,
         executor->containerId);
     CHECK_SOME(os::touch(path));
+
+    if (flags.recovery_index) {
+      checkpointTasksIndex(
+          framework->id(), executor->id, executor->containerId);
+    }
   }
 
   // TODO(vinod): Move the responsibility of gc'ing to the
@@ -8012,6 +8058,22 @@ Future<Nothing> Slave::_recoverVolumeGidManager(bool rebooted)
 Future<Option<SlaveState>> Slave::_recoverTaskStatusUpdates(
     const Option<SlaveState>& state)
 {
+  // The status update journal left behind by the previous run of the
+  // agent has been replayed when reading the state, but is only
+  // truncated here, before the task status update manager reopens it.
+  // `state::recover()` can also be called while the agent is running,
+  // hence it must never drop the records of the journal.
+  Try<Nothing> compact = StatusUpdateJournal::compact(
+      paths::getStatusUpdateJournalPath(metaDir));
+
+  if (compact.isError()) {
+    if (flags.strict) {
+      return Failure(compact.error());
+    }
+
+    LOG(WARNING) << compact.error();
+  }
+
   return taskStatusUpdateManager->recover(metaDir, state)
     .then([state]() -> Future<Option<SlaveState>> {
       return state;
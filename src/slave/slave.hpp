@@ -625,6 +625,14 @@ public:
   // Removes and garbage collects the executor.
   void removeExecutor(Framework* framework, Executor* executor);
 
+  // Writes the index of the tasks of the completed executor run, which
+  // is read instead of the checkpoints of the tasks when recovering
+  // the run (see `--recovery_index`).
+  void checkpointTasksIndex(
+      const FrameworkID& frameworkId,
+      const ExecutorID& executorId,
+      const ContainerID& containerId);
+
   // Removes and garbage collects the framework.
   // Made 'virtual' for Slave mocking.
   virtual void removeFramework(Framework* framework);
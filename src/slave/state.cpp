@@ -16,18 +16,24 @@
 
 #include <glog/logging.h>
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <thread>
+#include <vector>
 
 #include <process/pid.hpp>
 
 #include <stout/check.hpp>
 #include <stout/error.hpp>
 #include <stout/foreach.hpp>
+#include <stout/lambda.hpp>
 #include <stout/none.hpp>
 #include <stout/nothing.hpp>
 #include <stout/numify.hpp>
 #include <stout/path.hpp>
 #include <stout/protobuf.hpp>
+#include <stout/stringify.hpp>
 #include <stout/strings.hpp>
 #include <stout/try.hpp>
 
@@ -52,6 +58,7 @@
 #include "slave/paths.hpp"
 #include "slave/state.hpp"
 #include "slave/state.pb.h"
+#include "slave/status_update_journal.hpp"
 
 namespace mesos {
 namespace internal {
@@ -60,10 +67,159 @@ namespace state {
 
 using std::list;
 using std::max;
+using std::min;
 using std::string;
+using std::vector;
 
 
-Try<State> recover(const string& rootDir, bool strict)
+// Invokes 'f' for every index in [0, size) using up to 'concurrency'
+// threads, including the calling one.
+static void parallel(
+    size_t size,
+    size_t concurrency,
+    const lambda::function<void(size_t)>& f)
+{
+  std::atomic<size_t> next(0);
+
+  auto run = [&]() {
+    for (size_t i = next++; i < size; i = next++) {
+      f(i);
+    }
+  };
+
+  vector<std::thread> threads;
+  for (size_t i = 1; i < min(size, concurrency); i++) {
+    threads.emplace_back(run);
+  }
+
+  run();
+
+  foreach (std::thread& thread, threads) {
+    thread.join();
+  }
+}
+
+
+// Recovers the tasks of a completed executor run from its index.
+static Result<hashmap<TaskID, TaskState>> recoverTasksIndex(const string& path)
+{
+  Result<TasksIndex> index = state::read<TasksIndex>(path);
+  if (index.isError()) {
+    return Error(index.error());
+  }
+
+  if (index.isNone()) {
+    // This could happen if the slave is hard rebooted after the file is created
+    // but before the data is synced on disk.
+    return None();
+  }
+
+  hashmap<TaskID, TaskState> tasks;
+
+  foreach (const TasksIndex::Task& task, index->tasks()) {
+    TaskState state;
+    state.id = task.id();
+
+    if (task.has_info()) {
+      state.info = task.info();
+    }
+
+    foreach (const StatusUpdate& update, task.updates()) {
+      state.updates.push_back(update);
+    }
+
+    foreach (const string& ack, task.acks()) {
+      Try<id::UUID> uuid = id::UUID::fromBytes(ack);
+      if (uuid.isError()) {
+        return Error("Invalid acknowledgement of task " +
+                     stringify(task.id()) + ": " + uuid.error());
+      }
+
+      state.acks.insert(uuid.get());
+    }
+
+    tasks[task.id()] = state;
+  }
+
+  return tasks;
+}
+
+
+// Writes the index of the tasks of a completed executor run.
+static Try<Nothing> checkpointTasksIndex(
+    const string& path,
+    const hashmap<TaskID, TaskState>& tasks)
+{
+  TasksIndex index;
+
+  foreachvalue (const TaskState& state, tasks) {
+    TasksIndex::Task* task = index.add_tasks();
+    task->mutable_id()->CopyFrom(state.id);
+
+    if (state.info.isSome()) {
+      task->mutable_info()->CopyFrom(state.info.get());
+    }
+
+    foreach (const StatusUpdate& update, state.updates) {
+      task->add_updates()->CopyFrom(update);
+    }
+
+    foreach (const id::UUID& uuid, state.acks) {
+      task->add_acks(uuid.toBytes());
+    }
+  }
+
+  return checkpoint(path, index);
+}
+
+
+Try<Nothing> checkpointTasksIndex(
+    const string& rootDir,
+    const SlaveID& slaveId,
+    const FrameworkID& frameworkId,
+    const ExecutorID& executorId,
+    const ContainerID& containerId)
+{
+  Try<list<string>> taskPaths = paths::getTaskPaths(
+      rootDir, slaveId, frameworkId, executorId, containerId);
+
+  if (taskPaths.isError()) {
+    return Error(
+        "Failed to find tasks for executor run " + containerId.value() +
+        ": " + taskPaths.error());
+  }
+
+  hashmap<TaskID, TaskState> tasks;
+
+  foreach (const string& path, taskPaths.get()) {
+    TaskID taskId;
+    taskId.set_value(Path(path).basename());
+
+    // Any error is fatal, so that the index is not written unless all
+    // the tasks can be recovered.
+    Try<TaskState> task = TaskState::recover(
+        rootDir, slaveId, frameworkId, executorId, containerId, taskId, true);
+
+    if (task.isError()) {
+      return Error(
+          "Failed to recover task " + taskId.value() + ": " + task.error());
+    }
+
+    tasks[taskId] = task.get();
+  }
+
+  return checkpointTasksIndex(
+      paths::getTasksIndexPath(
+          rootDir, slaveId, frameworkId, executorId, containerId),
+      tasks);
+}
+
+
+Try<State> recover(
+    const string& rootDir,
+    bool strict,
+    size_t concurrency,
+    bool index)
 {
   LOG(INFO) << "Recovering state from '" << rootDir << "'";
 
@@ -76,6 +232,20 @@ Try<State> recover(const string& rootDir, bool strict)
     return state;
   }
 
+  // Apply the task status update journal, if any, before recovering
+  // the status updates of the tasks from their status update files.
+  Try<Nothing> journal =
+    StatusUpdateJournal::replay(paths::getStatusUpdateJournalPath(rootDir));
+
+  if (journal.isError()) {
+    if (strict) {
+      return Error(journal.error());
+    }
+
+    LOG(WARNING) << journal.error();
+    state.errors++;
+  }
+
   // Recover resources regardless whether the host has rebooted.
   Try<ResourcesState> resources = ResourcesState::recover(rootDir, strict);
   if (resources.isError()) {
@@ -125,8 +295,8 @@ Try<State> recover(const string& rootDir, bool strict)
   SlaveID slaveId;
   slaveId.set_value(Path(directory.get()).basename());
 
-  Try<SlaveState> slave =
-    SlaveState::recover(rootDir, slaveId, strict, state.rebooted);
+  Try<SlaveState> slave = SlaveState::recover(
+      rootDir, slaveId, strict, state.rebooted, concurrency, index);
 
   if (slave.isError()) {
     return Error(slave.error());
@@ -142,7 +312,9 @@ Try<SlaveState> SlaveState::recover(
     const string& rootDir,
     const SlaveID& slaveId,
     bool strict,
-    bool rebooted)
+    bool rebooted,
+    size_t concurrency,
+    bool index)
 {
   SlaveState state;
   state.id = slaveId;
@@ -187,13 +359,37 @@ Try<SlaveState> SlaveState::recover(
                  ": " + frameworks.error());
   }
 
-  // Recover each of the frameworks.
-  foreach (const string& path, frameworks.get()) {
+  // Recover the frameworks in parallel. The threads are split between
+  // the frameworks, which in turn recover their executors in parallel.
+  const vector<string> frameworkPaths(frameworks->begin(), frameworks->end());
+  vector<Option<Try<FrameworkState>>> results(frameworkPaths.size());
+
+  const size_t threads =
+    max<size_t>(min(frameworkPaths.size(), concurrency), 1);
+
+  parallel(frameworkPaths.size(), threads, [&](size_t i) {
+    FrameworkID frameworkId;
+    frameworkId.set_value(Path(frameworkPaths[i]).basename());
+
+    results[i] = FrameworkState::recover(
+        rootDir,
+        slaveId,
+        frameworkId,
+        strict,
+        rebooted,
+        max<size_t>(concurrency / threads, 1),
+        index);
+  });
+
+  // NOTE: We look at the results in the same order as we used to
+  // recover the frameworks sequentially, so that the same error is
+  // returned in strict mode.
+  for (size_t i = 0; i < frameworkPaths.size(); i++) {
     FrameworkID frameworkId;
-    frameworkId.set_value(Path(path).basename());
+    frameworkId.set_value(Path(frameworkPaths[i]).basename());
 
-    Try<FrameworkState> framework =
-      FrameworkState::recover(rootDir, slaveId, frameworkId, strict, rebooted);
+    CHECK_SOME(results[i]);
+    const Try<FrameworkState>& framework = results[i].get();
 
     if (framework.isError()) {
       return Error("Failed to recover framework " + frameworkId.value() +
@@ -285,7 +481,9 @@ Try<FrameworkState> FrameworkState::recover(
     const SlaveID& slaveId,
     const FrameworkID& frameworkId,
     bool strict,
-    bool rebooted)
+    bool rebooted,
+    size_t concurrency,
+    bool index)
 {
   FrameworkState state;
   state.id = frameworkId;
@@ -368,13 +566,24 @@ Try<FrameworkState> FrameworkState::recover(
         ": " + executors.error());
   }
 
-  // Recover the executors.
-  foreach (const string& path, executors.get()) {
+  // Recover the executors in parallel.
+  const vector<string> executorPaths(executors->begin(), executors->end());
+  vector<Option<Try<ExecutorState>>> results(executorPaths.size());
+
+  parallel(executorPaths.size(), concurrency, [&](size_t i) {
     ExecutorID executorId;
-    executorId.set_value(Path(path).basename());
+    executorId.set_value(Path(executorPaths[i]).basename());
+
+    results[i] = ExecutorState::recover(
+        rootDir, slaveId, frameworkId, executorId, strict, rebooted, index);
+  });
 
-    Try<ExecutorState> executor = ExecutorState::recover(
-        rootDir, slaveId, frameworkId, executorId, strict, rebooted);
+  for (size_t i = 0; i < executorPaths.size(); i++) {
+    ExecutorID executorId;
+    executorId.set_value(Path(executorPaths[i]).basename());
+
+    CHECK_SOME(results[i]);
+    const Try<ExecutorState>& executor = results[i].get();
 
     if (executor.isError()) {
       return Error("Failed to recover executor '" + executorId.value() +
@@ -395,7 +604,8 @@ Try<ExecutorState> ExecutorState::recover(
     const FrameworkID& frameworkId,
     const ExecutorID& executorId,
     bool strict,
-    bool rebooted)
+    bool rebooted,
+    bool index)
 {
   ExecutorState state;
   state.id = executorId;
@@ -445,7 +655,8 @@ Try<ExecutorState> ExecutorState::recover(
           executorId,
           containerId,
           strict,
-          rebooted);
+          rebooted,
+          index);
 
       if (run.isError()) {
         return Error(
@@ -551,7 +762,8 @@ Try<RunState> RunState::recover(
     const ExecutorID& executorId,
     const ContainerID& containerId,
     bool strict,
-    bool rebooted)
+    bool rebooted,
+    bool index)
 {
   RunState state;
   state.id = containerId;
@@ -566,35 +778,72 @@ Try<RunState> RunState::recover(
 
   state.completed = os::exists(path);
 
-  // Find the tasks.
-  Try<list<string>> tasks = paths::getTaskPaths(
-      rootDir,
-      slaveId,
-      frameworkId,
-      executorId,
-      containerId);
+  // The tasks of a completed run do not change anymore, hence we can
+  // recover them from the index of the run, if it has been written.
+  const string indexPath = paths::getTasksIndexPath(
+      rootDir, slaveId, frameworkId, executorId, containerId);
 
-  if (tasks.isError()) {
-    return Error(
-        "Failed to find tasks for executor run " + containerId.value() +
-        ": " + tasks.error());
+  Result<hashmap<TaskID, TaskState>> indexed = None();
+  if (index && state.completed && os::exists(indexPath)) {
+    indexed = recoverTasksIndex(indexPath);
+    if (indexed.isError()) {
+      LOG(WARNING) << "Failed to recover tasks index '" << indexPath
+                   << "': " << indexed.error();
+    }
   }
 
-  // Recover tasks.
-  foreach (const string& path, tasks.get()) {
-    TaskID taskId;
-    taskId.set_value(Path(path).basename());
+  if (indexed.isSome()) {
+    state.tasks = indexed.get();
+  } else {
+    // Find the tasks.
+    Try<list<string>> tasks = paths::getTaskPaths(
+        rootDir,
+        slaveId,
+        frameworkId,
+        executorId,
+        containerId);
+
+    if (tasks.isError()) {
+      return Error(
+          "Failed to find tasks for executor run " + containerId.value() +
+          ": " + tasks.error());
+    }
 
-    Try<TaskState> task = TaskState::recover(
-        rootDir, slaveId, frameworkId, executorId, containerId, taskId, strict);
+    // Recover tasks.
+    foreach (const string& path, tasks.get()) {
+      TaskID taskId;
+      taskId.set_value(Path(path).basename());
 
-    if (task.isError()) {
-      return Error(
-          "Failed to recover task " + taskId.value() + ": " + task.error());
+      Try<TaskState> task = TaskState::recover(
+          rootDir,
+          slaveId,
+          frameworkId,
+          executorId,
+          containerId,
+          taskId,
+          strict);
+
+      if (task.isError()) {
+        return Error(
+            "Failed to recover task " + taskId.value() + ": " + task.error());
+      }
+
+      state.tasks[taskId] = task.get();
+      state.errors += task->errors;
     }
 
-    state.tasks[taskId] = task.get();
-    state.errors += task->errors;
+    // The agent indexes a run when it completes, see
+    // `Slave::removeExecutor()`. Runs which completed before the agent
+    // was upgraded, or whose index the agent failed to write, are
+    // indexed here. Only index tasks that were recovered without
+    // errors, so that the errors are encountered again the next time.
+    if (index && state.completed && state.errors == 0) {
+      Try<Nothing> checkpoint = checkpointTasksIndex(indexPath, state.tasks);
+      if (checkpoint.isError()) {
+        LOG(WARNING) << "Failed to checkpoint tasks index '" << indexPath
+                     << "': " << checkpoint.error();
+      }
+    }
   }
 
   path = paths::getForkedPidPath(
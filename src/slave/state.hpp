@@ -71,7 +71,26 @@ struct TaskState;
 // while increasing the 'errors' count. Note that 'errors' on a struct
 // includes the 'errors' encountered recursively. In other words,
 // 'State.errors' is the sum total of all recovery errors.
-Try<State> recover(const std::string& rootDir, bool strict);
+//
+// The frameworks and executors are recovered in parallel using up to
+// 'concurrency' threads. If the 'index' flag is set, the tasks of the
+// completed executor runs are recovered from (and indexed to) a single
+// file per run, see `RunState::recover()`.
+Try<State> recover(
+    const std::string& rootDir,
+    bool strict,
+    size_t concurrency = 1,
+    bool index = false);
+
+
+// Writes the index of the tasks of the completed executor run from
+// the checkpoints of its tasks, see `RunState::recover()`.
+Try<Nothing> checkpointTasksIndex(
+    const std::string& rootDir,
+    const SlaveID& slaveId,
+    const FrameworkID& frameworkId,
+    const ExecutorID& executorId,
+    const ContainerID& containerId);
 
 
 // Reads the protobuf message(s) from the given path.
@@ -298,7 +317,8 @@ struct RunState
       const ExecutorID& executorId,
       const ContainerID& containerId,
       bool strict,
-      bool rebooted);
+      bool rebooted,
+      bool index);
 
   Option<ContainerID> id;
   hashmap<TaskID, TaskState> tasks;
@@ -326,7 +346,8 @@ struct ExecutorState
       const FrameworkID& frameworkId,
       const ExecutorID& executorId,
       bool strict,
-      bool rebooted);
+      bool rebooted,
+      bool index);
 
   ExecutorID id;
   Option<ExecutorInfo> info;
@@ -346,7 +367,9 @@ struct FrameworkState
       const SlaveID& slaveId,
       const FrameworkID& frameworkId,
       bool strict,
-      bool rebooted);
+      bool rebooted,
+      size_t concurrency,
+      bool index);
 
   FrameworkID id;
   Option<FrameworkInfo> info;
@@ -382,7 +405,9 @@ struct SlaveState
       const std::string& rootDir,
       const SlaveID& slaveId,
       bool strict,
-      bool rebooted);
+      bool rebooted,
+      size_t concurrency,
+      bool index);
 
   SlaveID id;
   Option<SlaveInfo> info;
@@ -0,0 +1,395 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <stout/bytes.hpp>
+#include <stout/error.hpp>
+#include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/linkedhashmap.hpp>
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+#include <stout/protobuf.hpp>
+#include <stout/strings.hpp>
+
+#include <stout/os/close.hpp>
+#include <stout/os/exists.hpp>
+#include <stout/os/ftruncate.hpp>
+#include <stout/os/lseek.hpp>
+#include <stout/os/mkdir.hpp>
+#include <stout/os/open.hpp>
+#include <stout/os/rm.hpp>
+#include <stout/os/stat.hpp>
+#include <stout/os/write.hpp>
+
+#include "slave/status_update_journal.hpp"
+
+using std::string;
+using std::vector;
+
+using process::Owned;
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+// Frames the message the same way as `::protobuf::write()`, i.e.,
+// with a fixed size length header followed by the serialized message.
+static void frame(const google::protobuf::Message& message, string* out)
+{
+  const uint32_t size = message.ByteSize();
+  out->append((const char*) &size, sizeof(size));
+  message.AppendToString(out);
+}
+
+
+// Writes the journal records of the status update file at 'path' to
+// it. A record is only written if the file does not contain it
+// already, which makes this idempotent.
+static Try<Nothing> write(
+    const string& path,
+    const vector<StatusUpdateJournalRecord>& records)
+{
+  // The run of the executor might have been garbage collected.
+  if (!os::exists(Path(path).dirname())) {
+    VLOG(1) << "Skipping journal records for '" << path
+            << "' as its directory no longer exists";
+    return Nothing();
+  }
+
+  Try<int_fd> file = os::open(
+      path,
+      O_CREAT | O_WRONLY | O_CLOEXEC,
+      S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+  if (file.isError()) {
+    return Error("Failed to open '" + path + "': " + file.error());
+  }
+
+  Try<Bytes> size = os::stat::size(path);
+  if (size.isError()) {
+    os::close(file.get());
+    return Error("Failed to get the size of '" + path + "': " + size.error());
+  }
+
+  uint64_t end = size->bytes();
+
+  foreach (const StatusUpdateJournalRecord& record, records) {
+    if (record.offset() + record.data().size() <= end) {
+      continue; // Already applied.
+    }
+
+    if (record.offset() > end) {
+      // This can only happen if the status update file was modified
+      // behind our back; do not leave a hole in it.
+      LOG(WARNING) << "Ignoring journal records for '" << path
+                   << "' at offset " << record.offset()
+                   << " beyond its size " << end;
+      break;
+    }
+
+    Try<off_t> seek = os::lseek(file.get(), record.offset(), SEEK_SET);
+    if (seek.isError()) {
+      os::close(file.get());
+      return Error("Failed to seek in '" + path + "': " + seek.error());
+    }
+
+    Try<Nothing> write = os::write(file.get(), record.data());
+    if (write.isError()) {
+      os::close(file.get());
+      return Error("Failed to write '" + path + "': " + write.error());
+    }
+
+    end = record.offset() + record.data().size();
+  }
+
+  os::close(file.get());
+
+  return Nothing();
+}
+
+
+// Applies the records of the journal read from 'fd' to the status
+// update files, see `write()`.
+static Try<Nothing> apply(int_fd fd)
+{
+  Try<off_t> seek = os::lseek(fd, 0, SEEK_SET);
+  if (seek.isError()) {
+    return Error(
+        "Failed to seek to the beginning of the journal: " + seek.error());
+  }
+
+  // Group the records by status update file, preserving their order.
+  LinkedHashMap<string, vector<StatusUpdateJournalRecord>> records;
+
+  while (true) {
+    // Ignore a partially written trailing record, e.g., if the agent
+    // crashed in the middle of a commit; it has not been acknowledged.
+    Result<StatusUpdateJournalRecord> record =
+      ::protobuf::read<StatusUpdateJournalRecord>(fd, true, true);
+
+    if (record.isError()) {
+      return Error("Failed to read journal record: " + record.error());
+    }
+
+    if (record.isNone()) {
+      break;
+    }
+
+    records[record->path()].push_back(record.get());
+  }
+
+  foreachpair (const string& path,
+               const vector<StatusUpdateJournalRecord>& _records,
+               records) {
+    Try<Nothing> result = write(path, _records);
+    if (result.isError()) {
+      return result;
+    }
+  }
+
+  return Nothing();
+}
+
+
+Try<Owned<StatusUpdateJournal>> StatusUpdateJournal::create(
+    const string& path)
+{
+  Try<Nothing> mkdir = os::mkdir(Path(path).dirname());
+  if (mkdir.isError()) {
+    return Error(
+        "Failed to create the directory of the status update journal '" +
+        path + "': " + mkdir.error());
+  }
+
+  Try<int_fd> fd = os::open(
+      path,
+      O_CREAT | O_RDWR | O_APPEND | O_CLOEXEC,
+      S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+  if (fd.isError()) {
+    return Error(
+        "Failed to open the status update journal '" + path + "': " +
+        fd.error());
+  }
+
+  return Owned<StatusUpdateJournal>(new StatusUpdateJournal(path, fd.get()));
+}
+
+
+Try<Nothing> StatusUpdateJournal::replay(const string& path)
+{
+  if (!os::exists(path)) {
+    return Nothing();
+  }
+
+  Try<int_fd> fd = os::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd.isError()) {
+    return Error(
+        "Failed to open the status update journal '" + path + "': " +
+        fd.error());
+  }
+
+  Try<Nothing> result = apply(fd.get());
+  os::close(fd.get());
+
+  if (result.isError()) {
+    return Error(
+        "Failed to replay the status update journal '" + path + "': " +
+        result.error());
+  }
+
+  return Nothing();
+}
+
+
+Try<Nothing> StatusUpdateJournal::compact(const string& path)
+{
+  if (!os::exists(path)) {
+    return Nothing();
+  }
+
+  Try<int_fd> fd = os::open(path, O_RDWR | O_CLOEXEC);
+  if (fd.isError()) {
+    return Error(
+        "Failed to open the status update journal '" + path + "': " +
+        fd.error());
+  }
+
+  Try<Nothing> result = apply(fd.get());
+
+  // The journal is only truncated once all its records are applied.
+  if (result.isSome()) {
+    result = os::ftruncate(fd.get(), 0);
+  }
+
+  os::close(fd.get());
+
+  if (result.isError()) {
+    return Error(
+        "Failed to compact the status update journal '" + path + "': " +
+        result.error());
+  }
+
+  return Nothing();
+}
+
+
+StatusUpdateJournal::StatusUpdateJournal(const string& _path, int_fd _fd)
+  : path(_path), fd(_fd) {}
+
+
+StatusUpdateJournal::~StatusUpdateJournal()
+{
+  Try<Nothing> close = os::close(fd);
+  if (close.isError()) {
+    LOG(ERROR) << "Failed to close the status update journal '" << path
+               << "': " << close.error();
+  }
+}
+
+
+Try<Nothing> StatusUpdateJournal::append(
+    const string& _path,
+    const StatusUpdateRecord& record)
+{
+  if (!sizes.contains(_path)) {
+    uint64_t size = 0;
+
+    if (os::exists(_path)) {
+      Try<Bytes> bytes = os::stat::size(_path);
+      if (bytes.isError()) {
+        return Error(
+            "Failed to get the size of '" + _path + "': " + bytes.error());
+      }
+
+      size = bytes->bytes();
+    }
+
+    sizes[_path] = size;
+  }
+
+  if (!record.IsInitialized()) {
+    return Error(record.InitializationErrorString() +
+                 " is required but not initialized");
+  }
+
+  StatusUpdateJournalRecord journalRecord;
+  journalRecord.set_path(_path);
+  journalRecord.set_offset(sizes[_path]);
+  frame(record, journalRecord.mutable_data());
+
+  frame(journalRecord, &buffer);
+
+  sizes[_path] += journalRecord.data().size();
+
+  appended.push_back(std::move(journalRecord));
+
+  return Nothing();
+}
+
+
+Try<Nothing> StatusUpdateJournal::commit()
+{
+  if (buffer.empty()) {
+    return Nothing();
+  }
+
+  Try<off_t> end = os::lseek(fd, 0, SEEK_END);
+  if (end.isError()) {
+    return Error("Failed to seek to the end of the journal: " + end.error());
+  }
+
+  Try<Nothing> write = os::write(fd, buffer);
+  if (write.isError()) {
+    // Drop the partially written records so that later commits are
+    // not appended after garbage.
+    Try<Nothing> truncate = os::ftruncate(fd, end.get());
+    if (truncate.isError()) {
+      LOG(ERROR) << "Failed to truncate the status update journal '"
+                 << path << "': " << truncate.error();
+    }
+
+    return Error("Failed to write the journal: " + write.error());
+  }
+
+  buffer.clear();
+
+  foreach (StatusUpdateJournalRecord& record, appended) {
+    const string path = record.path();
+    committed[path].push_back(std::move(record));
+  }
+
+  appended.clear();
+
+  return Nothing();
+}
+
+
+Try<Nothing> StatusUpdateJournal::flush(const string& directory)
+{
+  const string prefix = path::join(directory, "");
+
+  vector<string> paths;
+  foreachkey (const string& path, committed) {
+    if (strings::startsWith(path, prefix)) {
+      paths.push_back(path);
+    }
+  }
+
+  foreach (const string& path, paths) {
+    Try<Nothing> result = write(path, committed.at(path));
+    if (result.isError()) {
+      return result;
+    }
+
+    committed.erase(path);
+  }
+
+  return Nothing();
+}
+
+
+Try<Nothing> StatusUpdateJournal::compact()
+{
+  Try<Nothing> result = commit();
+  if (result.isError()) {
+    return result;
+  }
+
+  result = apply(fd);
+  if (result.isError()) {
+    return result;
+  }
+
+  result = os::ftruncate(fd, 0);
+  if (result.isError()) {
+    return Error("Failed to truncate the journal: " + result.error());
+  }
+
+  sizes.clear();
+  committed.clear();
+
+  return Nothing();
+}
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
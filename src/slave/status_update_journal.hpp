@@ -0,0 +1,124 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __SLAVE_STATUS_UPDATE_JOURNAL_HPP__
+#define __SLAVE_STATUS_UPDATE_JOURNAL_HPP__
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <process/owned.hpp>
+
+#include <stout/hashmap.hpp>
+#include <stout/nothing.hpp>
+#include <stout/try.hpp>
+
+#include <stout/os/int_fd.hpp>
+
+#include "messages/messages.hpp"
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+// An agent-wide, append-only journal for the records of the task
+// status update streams (see `TaskStatusUpdateStream`).
+//
+// Instead of appending each record to the status update file of its
+// task, which costs a file per task and a write per record, records
+// are buffered and written to the journal in groups: all records
+// appended while the agent is busy are written with a single write
+// once `commit()` is called ("group commit").
+//
+// The journal is periodically compacted by applying its records to
+// the status update files of the tasks. The journal is also replayed
+// whenever the agent state is read (see `state::recover()`), so that
+// the agent only ever reads the per-task status update files. Each
+// journal record carries the offset at which it belongs in its status
+// update file, which makes applying the journal idempotent. Only the
+// agent truncates the journal left behind by its previous run, once
+// it is compacted during recovery.
+class StatusUpdateJournal
+{
+public:
+  // Opens the journal at 'path' for appending, creating it if needed.
+  static Try<process::Owned<StatusUpdateJournal>> create(
+      const std::string& path);
+
+  // Applies the records of the journal at 'path', if any, to the
+  // status update files. The journal is left untouched since it might
+  // be in use by a running agent.
+  static Try<Nothing> replay(const std::string& path);
+
+  // Applies the records of the journal at 'path', if any, to the
+  // status update files and truncates the journal. This must only be
+  // called while no `StatusUpdateJournal` is open for 'path'.
+  static Try<Nothing> compact(const std::string& path);
+
+  ~StatusUpdateJournal();
+
+  // Buffers the record to be appended to the status update file at
+  // 'path'. The record is written to the journal by `commit()`.
+  Try<Nothing> append(
+      const std::string& path,
+      const StatusUpdateRecord& record);
+
+  // Writes all the buffered records to the journal at once.
+  Try<Nothing> commit();
+
+  // Applies the committed records of the status update files under
+  // 'directory' to these files, e.g., so that the files of a completed
+  // executor run can be read before the journal is compacted. The
+  // records are kept in the journal until it is compacted.
+  Try<Nothing> flush(const std::string& directory);
+
+  // Commits the buffered records, applies the journal to the status
+  // update files and truncates it.
+  Try<Nothing> compact();
+
+private:
+  StatusUpdateJournal(const std::string& path, int_fd fd);
+
+  StatusUpdateJournal(const StatusUpdateJournal&) = delete;
+  StatusUpdateJournal& operator=(const StatusUpdateJournal&) = delete;
+
+  const std::string path;
+  const int_fd fd;
+
+  // Journal records appended since the last commit, in the format
+  // they are written to the journal.
+  std::string buffer;
+
+  // Journal records appended since the last commit, kept until they
+  // are committed.
+  std::vector<StatusUpdateJournalRecord> appended;
+
+  // Committed journal records by status update file, which have not
+  // been flushed to the file since the last compaction.
+  hashmap<std::string, std::vector<StatusUpdateJournalRecord>> committed;
+
+  // The size of the status update files with journaled records,
+  // including the records that have not been applied to them yet.
+  hashmap<std::string, uint64_t> sizes;
+};
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __SLAVE_STATUS_UPDATE_JOURNAL_HPP__
@@ -17,7 +17,9 @@
 #include "slave/task_status_update_manager.hpp"
 
 #include <process/delay.hpp>
+#include <process/dispatch.hpp>
 #include <process/id.hpp>
+#include <process/owned.hpp>
 #include <process/process.hpp>
 #include <process/timer.hpp>
 
@@ -42,6 +44,7 @@
 #include "slave/flags.hpp"
 #include "slave/slave.hpp"
 #include "slave/state.hpp"
+#include "slave/status_update_journal.hpp"
 
 using lambda::function;
 
@@ -50,7 +53,9 @@ using std::string;
 using process::wait; // Necessary on some OS's to disambiguate.
 using process::Failure;
 using process::Future;
+using process::Owned;
 using process::PID;
+using process::Promise;
 using process::Timeout;
 using process::UPID;
 
@@ -102,6 +107,8 @@ public:
 
   void cleanup(const FrameworkID& frameworkId);
 
+  Future<Nothing> flush(const string& directory);
+
 private:
   // Helper function to handle update.
   Future<Nothing> _update(
@@ -114,6 +121,15 @@ private:
   // Status update timeout.
   void timeout(const Duration& duration);
 
+  // Writes the records appended to the journal, if any, once all the
+  // events that are currently queued for this process have been
+  // handled, so that records of concurrent updates are written at once.
+  Future<Nothing> commit();
+  void _commit();
+
+  // Periodically applies the journal to the status update files.
+  void compact();
+
   // Forwards the status update to the master and starts a timer based
   // on the 'duration' to check for ACK from the scheduler.
   // NOTE: This should only be used for those messages that expect an
@@ -146,6 +162,13 @@ private:
   function<void(StatusUpdate)> forward_;
 
   hashmap<FrameworkID, hashmap<TaskID, TaskStatusUpdateStream*>> streams;
+
+  // Agent-wide journal of the checkpointed status update streams, if
+  // enabled via the `--status_update_journal` flag.
+  Option<Owned<StatusUpdateJournal>> journal;
+
+  // Promise for the pending commit of the journal, if any.
+  Option<Owned<Promise<Nothing>>> committing;
 };
 
 
@@ -206,6 +229,23 @@ Future<Nothing> TaskStatusUpdateManagerProcess::recover(
 {
   LOG(INFO) << "Recovering task status update manager";
 
+  if (flags.status_update_journal && journal.isNone()) {
+    // NOTE: The journal left behind by a previous run of the agent
+    // was already compacted before recovering the manager.
+    const string path = paths::getStatusUpdateJournalPath(rootDir);
+
+    Try<Owned<StatusUpdateJournal>> create = StatusUpdateJournal::create(path);
+    if (create.isError()) {
+      return Failure(create.error());
+    }
+
+    journal = create.get();
+
+    delay(flags.status_update_journal_compaction_interval,
+          self(),
+          &TaskStatusUpdateManagerProcess::compact);
+  }
+
   if (state.isNone()) {
     return Nothing();
   }
@@ -353,8 +393,10 @@ Future<Nothing> TaskStatusUpdateManagerProcess::_update(
 
   // We don't return a failed future here so that the slave can re-ack
   // the duplicate update.
+  // NOTE: The duplicate might still be in the process of being
+  // committed to the journal, hence we wait for the commit.
   if (!result.get()) {
-    return Nothing();
+    return checkpoint ? commit() : Nothing();
   }
 
   // Forward the status update to the master if this is the first in the stream.
@@ -370,7 +412,7 @@ Future<Nothing> TaskStatusUpdateManagerProcess::_update(
     stream->timeout = forward(next.get(), STATUS_UPDATE_RETRY_INTERVAL_MIN);
   }
 
-  return Nothing();
+  return checkpoint ? commit() : Nothing();
 }
 
 
@@ -449,6 +491,7 @@ Future<bool> TaskStatusUpdateManagerProcess::acknowledgement(
   }
 
   bool terminated = stream->terminated;
+  bool checkpoint = stream->checkpoint;
 
   if (terminated) {
     if (next.isSome()) {
@@ -462,10 +505,91 @@ Future<bool> TaskStatusUpdateManagerProcess::acknowledgement(
     stream->timeout = forward(next.get(), STATUS_UPDATE_RETRY_INTERVAL_MIN);
   }
 
+  if (checkpoint) {
+    return commit()
+      .then([terminated]() { return !terminated; });
+  }
+
   return !terminated;
 }
 
 
+Future<Nothing> TaskStatusUpdateManagerProcess::commit()
+{
+  if (journal.isNone()) {
+    return Nothing();
+  }
+
+  if (committing.isNone()) {
+    committing = Owned<Promise<Nothing>>(new Promise<Nothing>());
+
+    // NOTE: Dispatching to ourselves queues the commit after all the
+    // updates and acknowledgements that are already queued.
+    dispatch(self(), &TaskStatusUpdateManagerProcess::_commit);
+  }
+
+  return committing.get()->future();
+}
+
+
+void TaskStatusUpdateManagerProcess::_commit()
+{
+  CHECK_SOME(journal);
+  CHECK_SOME(committing);
+
+  Owned<Promise<Nothing>> promise = committing.get();
+  committing = None();
+
+  Try<Nothing> commit = journal.get()->commit();
+  if (commit.isError()) {
+    promise->fail(
+        "Failed to commit the task status update journal: " + commit.error());
+    return;
+  }
+
+  promise->set(Nothing());
+}
+
+
+Future<Nothing> TaskStatusUpdateManagerProcess::flush(const string& directory)
+{
+  if (journal.isNone()) {
+    return Nothing();
+  }
+
+  // Wait for the records which are still buffered to be committed.
+  return commit()
+    .then(defer(self(), [this, directory]() -> Future<Nothing> {
+      Try<Nothing> flush = journal.get()->flush(directory);
+      if (flush.isError()) {
+        return Failure(
+            "Failed to flush the task status update journal: " +
+            flush.error());
+      }
+
+      return Nothing();
+    }));
+}
+
+
+void TaskStatusUpdateManagerProcess::compact()
+{
+  CHECK_SOME(journal);
+
+  // NOTE: This also writes the records of a pending commit, if any,
+  // in which case `_commit()` will find nothing left to write.
+  Try<Nothing> compact = journal.get()->compact();
+  if (compact.isError()) {
+    LOG(ERROR) << "Failed to compact the task status update journal: "
+               << compact.error();
+  }
+
+  delay(flags.status_update_journal_compaction_interval,
+        self(),
+        &TaskStatusUpdateManagerProcess::compact);
+}
+
+
 // TODO(vinod): There should be a limit on the retries.
 void TaskStatusUpdateManagerProcess::timeout(const Duration& duration)
 {
@@ -508,7 +632,14 @@ TaskStatusUpdateManagerProcess::createStatusUpdateStream(
           << " of framework " << frameworkId;
 
   TaskStatusUpdateStream* stream = new TaskStatusUpdateStream(
-      taskId, frameworkId, slaveId, flags, checkpoint, executorId, containerId);
+      taskId,
+      frameworkId,
+      slaveId,
+      flags,
+      checkpoint,
+      executorId,
+      containerId,
+      journal.isSome() ? journal->get() : nullptr);
 
   streams[frameworkId][taskId] = stream;
   return stream;
@@ -648,6 +779,13 @@ void TaskStatusUpdateManager::cleanup(const FrameworkID& frameworkId)
 }
 
 
+Future<Nothing> TaskStatusUpdateManager::flush(const string& directory)
+{
+  return dispatch(
+      process, &TaskStatusUpdateManagerProcess::flush, directory);
+}
+
+
 TaskStatusUpdateStream::TaskStatusUpdateStream(
     const TaskID& _taskId,
     const FrameworkID& _frameworkId,
@@ -655,13 +793,15 @@ TaskStatusUpdateStream::TaskStatusUpdateStream(
     const Flags& _flags,
     bool _checkpoint,
     const Option<ExecutorID>& executorId,
-    const Option<ContainerID>& containerId)
+    const Option<ContainerID>& containerId,
+    StatusUpdateJournal* _journal)
     : checkpoint(_checkpoint),
       terminated(false),
       taskId(_taskId),
       frameworkId(_frameworkId),
       slaveId(_slaveId),
       flags(_flags),
+      journal(_journal),
       error(None())
 {
   if (checkpoint) {
@@ -684,6 +824,11 @@ TaskStatusUpdateStream::TaskStatusUpdateStream(
       return;
     }
 
+    // Records are appended to the updates file through the journal.
+    if (journal != nullptr) {
+      return;
+    }
+
     // Open the updates file.
     // NOTE: We don't use `O_SYNC` here because we only read this file
     // if the host did not crash. `os::write` success implies the kernel
@@ -842,8 +987,6 @@ Try<Nothing> TaskStatusUpdateStream::handle(
     LOG(INFO) << "Checkpointing " << type << " for task status update "
               << update;
 
-    CHECK_SOME(fd);
-
     StatusUpdateRecord record;
     record.set_type(type);
 
@@ -853,7 +996,15 @@ Try<Nothing> TaskStatusUpdateStream::handle(
       record.set_uuid(update.uuid());
     }
 
-    Try<Nothing> write = ::protobuf::write(fd.get(), record);
+    Try<Nothing> write = Nothing();
+
+    if (journal != nullptr) {
+      write = journal->append(path.get(), record);
+    } else {
+      CHECK_SOME(fd);
+      write = ::protobuf::write(fd.get(), record);
+    }
+
     if (write.isError()) {
       error = "Failed to write task status update " + stringify(update) +
               " to '" + path.get() + "': " + write.error();
@@ -35,6 +35,7 @@
 #include "messages/messages.hpp"
 
 #include "slave/flags.hpp"
+#include "slave/status_update_journal.hpp"
 
 namespace mesos {
 namespace internal {
@@ -118,6 +119,12 @@ public:
   // NOTE: This stops retrying any pending status updates for this framework.
   void cleanup(const FrameworkID& frameworkId);
 
+  // Writes the checkpointed status updates and acknowledgements of the
+  // tasks under the given meta directory (e.g., of an executor run) to
+  // their status update files, if they are still in the status update
+  // journal, so that the files can be read.
+  process::Future<Nothing> flush(const std::string& directory);
+
 private:
   TaskStatusUpdateManagerProcess* process;
 };
@@ -137,7 +144,8 @@ struct TaskStatusUpdateStream
                      const Flags& _flags,
                      bool _checkpoint,
                      const Option<ExecutorID>& executorId,
-                     const Option<ContainerID>& containerId);
+                     const Option<ContainerID>& containerId,
+                     StatusUpdateJournal* _journal = nullptr);
 
   ~TaskStatusUpdateStream();
 
@@ -199,6 +207,10 @@ private:
   Option<std::string> path; // File path of the update stream.
   Option<int_fd> fd; // File descriptor to the update stream.
 
+  // If set, records are appended to the update stream through this
+  // agent-wide journal instead of through `fd`. Owned by the manager.
+  StatusUpdateJournal* journal;
+
   Option<std::string> error; // Potential non-retryable error.
 };
 
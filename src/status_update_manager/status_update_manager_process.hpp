@@ -25,7 +25,9 @@
 #include <mesos/mesos.hpp>
 #include <mesos/type_utils.hpp>
 
+#include <process/defer.hpp>
 #include <process/delay.hpp>
+#include <process/dispatch.hpp>
 #include <process/future.hpp>
 #include <process/owned.hpp>
 #include <process/protobuf.hpp>
@@ -70,6 +72,13 @@ namespace internal {
 // possible; for example, during recovery or as soon as the first status update
 // is processed.
 //
+// NOTE: The records of the checkpointed streams are written as the updates
+// and acknowledgements are processed, but they are only synced to disk once
+// all the updates and acknowledgements queued at that time have been
+// processed, with a single `fdatasync` of each stream file written to (group
+// commit). The futures of the updates and acknowledgements are only satisfied,
+// and the updates only forwarded, once their records have been synced.
+//
 // This process does NOT garbage collect any checkpointed state. The users of it
 // are responsible for the garbage collection of the status updates files.
 //
@@ -214,26 +223,30 @@ public:
     }
 
     // This only happens if the status update is a duplicate.
+    //
+    // NOTE: The duplicate might still be waiting to be synced, hence we wait
+    // for the commit.
     if (!result.get()) {
-      return Nothing();
+      return checkpoint ? commit() : Nothing();
     }
 
-    // Forward the status update if this is at the front of the queue.
-    // Subsequent status updates will be sent in `acknowledgement()`.
-    if (!paused && stream->pending.size() == 1) {
-      CHECK_NONE(stream->timeout);
-
-      const Result<UpdateType>& next = stream->next();
-      if (next.isError()) {
-        return process::Failure(next.error());
-      }
-
-      CHECK_SOME(next);
-      stream->timeout =
-        forward(stream, next.get(), slave::STATUS_UPDATE_RETRY_INTERVAL_MIN);
+    // The status update is only forwarded once it has been synced, so that
+    // it is not acknowledged if its record might be lost on a failover.
+    if (checkpoint) {
+      unsynced.insert(streamId);
+
+      return commit()
+        .then(process::defer(
+            ProtobufProcess<
+                StatusUpdateManagerProcess<
+                IDType,
+                CheckpointType,
+                UpdateType>>::self(),
+            &StatusUpdateManagerProcess::forwardNext,
+            streamId));
     }
 
-    return Nothing();
+    return forwardNext(streamId);
   }
 
   // Process the acknowledgment of a status update.
@@ -289,14 +302,43 @@ public:
         LOG(WARNING) << "Acknowledged a terminal " << statusUpdateType
                      << " but updates are still pending";
       }
+
+      // The stream file is closed when the stream is cleaned up, hence the
+      // terminal acknowledgement is synced right away.
+      if (stream->checkpointed()) {
+        Try<Nothing> sync = stream->sync();
+        unsynced.erase(streamId);
+
+        if (sync.isError()) {
+          return process::Failure(sync.error());
+        }
+      }
+
       cleanupStatusUpdateStream(streamId);
-    } else if (!paused && next.isSome()) {
-      // Forward the next queued status update.
-      stream->timeout =
-        forward(stream, next.get(), slave::STATUS_UPDATE_RETRY_INTERVAL_MIN);
+
+      return false;
     }
 
-    return !terminated;
+    // The next queued status update is forwarded once the acknowledgement
+    // has been synced, see `update()`.
+    if (stream->checkpointed()) {
+      unsynced.insert(streamId);
+
+      return commit()
+        .then(process::defer(
+            ProtobufProcess<
+                StatusUpdateManagerProcess<
+                IDType,
+                CheckpointType,
+                UpdateType>>::self(),
+            [this, streamId]() -> process::Future<bool> {
+              return forwardNext(streamId)
+                .then([]() { return true; });
+            }));
+    }
+
+    return forwardNext(streamId)
+      .then([]() { return true; });
   }
 
   // Recovers the status update manager's state using the supplied stream IDs.
@@ -405,6 +447,89 @@ private:
 
   // Helper methods.
 
+  // Forwards the next status update of the stream unless one is already
+  // in flight, in which case it is forwarded once that one is acknowledged.
+  process::Future<Nothing> forwardNext(const IDType& streamId)
+  {
+    // The stream might have been cleaned up while its records were synced.
+    if (paused || !streams.contains(streamId)) {
+      return Nothing();
+    }
+
+    StatusUpdateStream* stream = streams[streamId].get();
+
+    if (stream->timeout.isSome()) {
+      return Nothing();
+    }
+
+    const Result<UpdateType>& next = stream->next();
+    if (next.isError()) {
+      return process::Failure(next.error());
+    }
+
+    if (next.isSome()) {
+      stream->timeout =
+        forward(stream, next.get(), slave::STATUS_UPDATE_RETRY_INTERVAL_MIN);
+    }
+
+    return Nothing();
+  }
+
+  // Returns a future which is satisfied once the records written so far
+  // have been synced to disk.
+  process::Future<Nothing> commit()
+  {
+    if (committing.isNone()) {
+      committing =
+        process::Owned<process::Promise<Nothing>>(
+            new process::Promise<Nothing>());
+
+      // NOTE: Dispatching to ourselves queues the commit after all the
+      // updates and acknowledgements that are already queued.
+      process::dispatch(
+          ProtobufProcess<
+              StatusUpdateManagerProcess<
+              IDType,
+              CheckpointType,
+              UpdateType>>::self(),
+          &StatusUpdateManagerProcess::_commit);
+    }
+
+    return committing.get()->future();
+  }
+
+  void _commit()
+  {
+    CHECK_SOME(committing);
+
+    process::Owned<process::Promise<Nothing>> promise = committing.get();
+    committing = None();
+
+    Option<std::string> error;
+
+    foreach (const IDType& streamId, unsynced) {
+      // The streams of a framework that has been cleaned up are not synced
+      // since their checkpointed state is garbage collected.
+      if (!streams.contains(streamId)) {
+        continue;
+      }
+
+      Try<Nothing> sync = streams[streamId]->sync();
+      if (sync.isError() && error.isNone()) {
+        error = sync.error();
+      }
+    }
+
+    unsynced.clear();
+
+    if (error.isSome()) {
+      promise->fail(error.get());
+      return;
+    }
+
+    promise->set(Nothing());
+  }
+
   // Creates a new status update stream, adding it to `streams`.
   Try<Nothing> createStatusUpdateStream(
       const IDType& streamId,
@@ -580,6 +705,11 @@ private:
   hashmap<FrameworkID, hashset<IDType>> frameworkStreams;
   bool paused;
 
+  // The checkpointed streams written to since the last commit, and the
+  // promise for the pending commit, if any.
+  hashset<IDType> unsynced;
+  Option<process::Owned<process::Promise<Nothing>>> committing;
+
   // Handles the status updates and acknowledgements, checkpointing them if
   // necessary. It also holds the information about received, acknowledged and
   // pending status updates.
@@ -634,7 +764,7 @@ private:
         // Open the updates file.
         Try<int_fd> result = os::open(
             path.get(),
-            O_CREAT | O_SYNC | O_WRONLY | O_CLOEXEC,
+            O_CREAT | O_WRONLY | O_CLOEXEC,
             S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
 
         if (result.isError()) {
@@ -672,7 +802,7 @@ private:
 #ifdef __WINDOWS__
           O_BINARY |
 #endif // __WINDOWS__
-          O_SYNC | O_RDWR | O_CLOEXEC);
+          O_RDWR | O_CLOEXEC);
 
       if (fd.isError()) {
         return Error("Failed to open '" + path + "': " + fd.error());
@@ -888,6 +1018,34 @@ private:
       return None();
     }
 
+    // Syncs the records written to the stream file to disk.
+    Try<Nothing> sync()
+    {
+      CHECK_SOME(fd);
+
+      if (error.isSome()) {
+        return Error(error.get());
+      }
+
+      // Unlike `fsync`, `fdatasync` does not flush the metadata that is not
+      // needed to read the records back, e.g., the modification time.
+#ifdef __linux__
+      Try<Nothing> sync = Nothing();
+      if (::fdatasync(fd.get()) < 0) {
+        sync = ErrnoError();
+      }
+#else
+      Try<Nothing> sync = os::fsync(fd.get());
+#endif // __linux__
+
+      if (sync.isError()) {
+        error = "Failed to sync file '" + path.get() + "': " + sync.error();
+        return Error(error.get());
+      }
+
+      return Nothing();
+    }
+
     // Returns `true` if the stream is checkpointed, `false` otherwise.
     bool checkpointed() { return path.isSome(); }
 
@@ -447,7 +447,11 @@ Try<process::Owned<Slave>> Slave::create(
 
   // If the garbage collector is not provided, create a default one.
   if (gc.isNone()) {
-    slave->gc.reset(new slave::GarbageCollector(flags.work_dir));
+    slave->gc.reset(new slave::GarbageCollector(
+        flags.work_dir,
+        flags.gc_threads,
+        flags.gc_inode_rate_limit,
+        flags.gc_io_rate_limit));
   }
 
   // If the flag `--volume_gid_range` is specified, create a volume gid manager.
@@ -25,6 +25,8 @@
 #include <stout/os.hpp>
 #include <stout/path.hpp>
 
+#include <stout/os/open.hpp>
+
 #include "common/command_utils.hpp"
 
 #include "tests/mesos.hpp"
@@ -223,6 +225,38 @@ TEST_F_TEMP_DISABLED_ON_WINDOWS(TarTest, GZIPChangeDirectory)
 }
 
 
+// Tests that a GZIP compressed archive can be untarred from a file
+// descriptor, for which the compression has to be given.
+TEST_F_TEMP_DISABLED_ON_WINDOWS(TarTest, GZIPFileDescriptor)
+{
+  const Path testFile("testfile");
+  ASSERT_SOME(createTestFile(testFile));
+
+  const Path outputTarFile("test.tar.gz");
+  AWAIT_ASSERT_READY(command::tar(
+      testFile,
+      outputTarFile,
+      None(),
+      command::Compression::GZIP));
+
+  ASSERT_SOME(os::rm(testFile));
+
+  Try<int_fd> fd = os::open(outputTarFile, O_RDONLY | O_CLOEXEC);
+  ASSERT_SOME(fd);
+
+  Future<Nothing> untar = command::untar(
+      fd.get(),
+      Path(os::getcwd()),
+      command::Compression::GZIP);
+
+  ASSERT_SOME(os::close(fd.get()));
+
+  AWAIT_ASSERT_READY(untar);
+
+  EXPECT_SOME_EQ("test", os::read(testFile));
+}
+
+
 class ShasumTest : public TemporaryDirectoryTest {};
 
 
@@ -242,6 +276,28 @@ TEST_F_TEMP_DISABLED_ON_WINDOWS(ShasumTest, SHA512SimpleFile)
 }
 
 
+TEST_F_TEMP_DISABLED_ON_WINDOWS(ShasumTest, SHA256FileDescriptor)
+{
+  const Path testFile(path::join(os::getcwd(), "test"));
+
+  Try<Nothing> write = os::write(testFile, "hello world");
+  ASSERT_SOME(write);
+
+  Try<int_fd> fd = os::open(testFile, O_RDONLY | O_CLOEXEC);
+  ASSERT_SOME(fd);
+
+  Future<string> sha256 = command::sha256(fd.get());
+
+  ASSERT_SOME(os::close(fd.get()));
+
+  AWAIT_ASSERT_READY(sha256);
+
+  ASSERT_EQ(
+      sha256.get(),
+      "b94d27b9934d3e08a52e52d7da7dabfac484efe37a5380ee9088f7ace2efcde9");
+}
+
+
 class CompressionTest : public TemporaryDirectoryTest {};
 
 
@@ -14,6 +14,10 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
 #include <memory>
 #include <set>
 #include <string>
@@ -44,6 +48,7 @@
 
 using process::Clock;
 using process::Future;
+using process::Owned;
 
 using std::pair;
 using std::set;
@@ -266,6 +271,71 @@ TEST_F(Cgroups2Test, ROOT_CGROUPS2_CpuStats)
 }
 
 
+TEST_F(Cgroups2Test, ROOT_CGROUPS2_PressureStats)
+{
+  if (!cgroups2::pressure::supported()) {
+    LOG(WARNING) << "Skipping test: pressure stall information is disabled";
+    return;
+  }
+
+  ASSERT_SOME(cgroups2::create(TEST_CGROUP));
+
+  using cgroups2::pressure::Resource;
+
+  vector<Resource> resources = {Resource::CPU, Resource::MEMORY, Resource::IO};
+  foreach (Resource resource, resources) {
+    Try<cgroups2::pressure::Stats> stats =
+      cgroups2::pressure::stats(TEST_CGROUP, resource);
+    ASSERT_SOME(stats);
+
+    // Nothing has run in the cgroup yet.
+    EXPECT_EQ(Duration::zero(), stats->some.total);
+    EXPECT_EQ(Duration::zero(), stats->full.total);
+  }
+
+  cgroups2::pressure::Threshold threshold;
+  threshold.stall = Milliseconds(100);
+  threshold.window = Seconds(2);
+
+  Try<Owned<cgroups2::pressure::Trigger>> trigger =
+    cgroups2::pressure::Trigger::create(TEST_CGROUP, Resource::CPU, threshold);
+  ASSERT_SOME(trigger);
+
+  Future<Nothing> fired = (*trigger)->fired();
+  EXPECT_TRUE(fired.isPending());
+
+  // Spin up more processes than CPUs in the cgroup, so that they
+  // are stalled waiting for the CPUs.
+  vector<pid_t> pids;
+  for (long i = 0; i <= 2 * os::cpus().get(); i++) {
+    pid_t pid = ::fork();
+    ASSERT_NE(-1, pid);
+
+    if (pid == 0) {
+      if (cgroups2::assign(TEST_CGROUP, ::getpid()).isError()) {
+        SAFE_EXIT(EXIT_FAILURE, "Failed to assign child process to cgroup");
+      }
+
+      while (true) {}
+    }
+
+    pids.push_back(pid);
+  }
+
+  AWAIT_READY_FOR(fired, Seconds(30));
+
+  foreach (pid_t pid, pids) {
+    ::kill(pid, SIGKILL);
+    AWAIT_READY(process::reap(pid));
+  }
+
+  Try<cgroups2::pressure::Stats> stats =
+    cgroups2::pressure::stats(TEST_CGROUP, Resource::CPU);
+  ASSERT_SOME(stats);
+  EXPECT_LT(Milliseconds(100), stats->some.total);
+}
+
+
 TEST_F(Cgroups2Test, ROOT_CGROUPS2_EnableAndDisable)
 {
   ASSERT_SOME(enable_controllers({"cpu"}));
@@ -925,6 +995,80 @@ TEST_F(Cgroups2Test, ROOT_CGROUPS2_GetBpfFdById)
 }
 
 
+TEST_F(Cgroups2Test, ROOT_CGROUPS2_NetworkCounters)
+{
+  const string& cgroup = TEST_CGROUP;
+
+  ASSERT_SOME(cgroups2::create(cgroup));
+
+  Try<int> map_fd = ebpf::cgroups2::attach_network_counters(cgroup);
+  ASSERT_SOME(map_fd);
+
+  Try<ebpf::cgroups2::NetworkCounters> counters =
+    ebpf::cgroups2::network_counters(*map_fd);
+  ASSERT_SOME(counters);
+  EXPECT_EQ(0u, counters->tx_packets);
+  EXPECT_EQ(0u, counters->rx_packets);
+
+  pid_t pid = ::fork();
+  ASSERT_NE(-1, pid);
+
+  if (pid == 0) {
+    // Move the child process into the cgroup and send a datagram
+    // to ourselves over the loopback interface.
+    Try<Nothing> assign = cgroups2::assign(cgroup, ::getpid());
+    if (assign.isError()) {
+      SAFE_EXIT(EXIT_FAILURE, "Failed to assign child process to cgroup");
+    }
+
+    int s = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (s == -1) {
+      SAFE_EXIT(EXIT_FAILURE, "Failed to create socket");
+    }
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    socklen_t length = sizeof(address);
+    if (::bind(s, (sockaddr*) &address, length) == -1 ||
+        ::getsockname(s, (sockaddr*) &address, &length) == -1) {
+      SAFE_EXIT(EXIT_FAILURE, "Failed to bind socket");
+    }
+
+    char buffer[100] = {};
+    if (::sendto(s, buffer, sizeof(buffer), 0, (sockaddr*) &address, length)
+          != sizeof(buffer) ||
+        ::recv(s, buffer, sizeof(buffer), 0) != sizeof(buffer)) {
+      SAFE_EXIT(EXIT_FAILURE, "Failed to send datagram");
+    }
+
+    ::_exit(EXIT_SUCCESS);
+  }
+
+  AWAIT_EXPECT_WEXITSTATUS_EQ(EXIT_SUCCESS, process::reap(pid));
+
+  counters = ebpf::cgroups2::network_counters(*map_fd);
+  ASSERT_SOME(counters);
+  EXPECT_EQ(1u, counters->tx_packets);
+  EXPECT_EQ(1u, counters->rx_packets);
+  EXPECT_LT(100u, counters->tx_bytes);
+  EXPECT_EQ(counters->tx_bytes, counters->rx_bytes);
+
+  // The map can be found again through the attached programs.
+  Result<int> recovered = ebpf::cgroups2::network_counters_map(cgroup);
+  ASSERT_SOME(recovered);
+
+  counters = ebpf::cgroups2::network_counters(*recovered);
+  ASSERT_SOME(counters);
+  EXPECT_EQ(1u, counters->tx_packets);
+
+  os::close(*recovered);
+  os::close(*map_fd);
+}
+
+
 TEST(Cgroups2DevicesTest, NormalizedTest)
 {
   // Not normalized if there is an entry with no accesses specified.
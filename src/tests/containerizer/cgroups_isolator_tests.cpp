@@ -1469,6 +1469,117 @@ TEST_F(CgroupsIsolatorTest, ROOT_CGROUPS_PidsAndTids)
 }
 
 
+// This test verifies that the resource usage of a container is served
+// from the latest sample when usage sampling is enabled.
+TEST_F(CgroupsIsolatorTest, ROOT_CGROUPS_SampledUsage)
+{
+  Try<Owned<cluster::Master>> master = StartMaster();
+  ASSERT_SOME(master);
+
+  slave::Flags flags = CreateSlaveFlags();
+  flags.isolation = "cgroups/cpu,cgroups/mem";
+  flags.cgroups_usage_sampling_interval = Milliseconds(100);
+  flags.cgroups_usage_max_staleness = Minutes(1);
+
+  Fetcher fetcher(flags);
+
+  Try<MesosContainerizer*> _containerizer =
+    MesosContainerizer::create(flags, true, &fetcher);
+
+  ASSERT_SOME(_containerizer);
+
+  Owned<MesosContainerizer> containerizer(_containerizer.get());
+
+  Owned<MasterDetector> detector = master.get()->createDetector();
+
+  Try<Owned<cluster::Slave>> slave = StartSlave(
+      detector.get(),
+      containerizer.get());
+
+  ASSERT_SOME(slave);
+
+  MockScheduler sched;
+
+  MesosSchedulerDriver driver(
+      &sched,
+      DEFAULT_FRAMEWORK_INFO,
+      master.get()->pid,
+      DEFAULT_CREDENTIAL);
+
+  EXPECT_CALL(sched, registered(&driver, _, _));
+
+  Future<vector<Offer>> offers;
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(FutureArg<1>(&offers))
+    .WillRepeatedly(Return()); // Ignore subsequent offers.
+
+  driver.start();
+
+  AWAIT_READY(offers);
+  ASSERT_FALSE(offers->empty());
+
+  CommandInfo command;
+  command.set_shell(false);
+  command.set_value("/bin/cat");
+  command.add_arguments("/bin/cat");
+
+  TaskInfo task = createTask(
+      offers.get()[0].slave_id(),
+      offers.get()[0].resources(),
+      command);
+
+  Future<TaskStatus> statusStarting;
+  Future<TaskStatus> statusRunning;
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(FutureArg<1>(&statusStarting))
+    .WillOnce(FutureArg<1>(&statusRunning));
+
+  driver.launchTasks(offers.get()[0].id(), {task});
+
+  AWAIT_READY(statusStarting);
+  EXPECT_EQ(TASK_STARTING, statusStarting->state());
+
+  AWAIT_READY(statusRunning);
+  EXPECT_EQ(TASK_RUNNING, statusRunning->state());
+
+  Future<hashset<ContainerID>> containers = containerizer->containers();
+  AWAIT_READY(containers);
+  ASSERT_EQ(1u, containers->size());
+
+  ContainerID containerId = *(containers->begin());
+
+  // Pause the clock and trigger a sample, so that the subsequent
+  // requests are served from the same sample.
+  Clock::pause();
+  Clock::advance(flags.cgroups_usage_sampling_interval.get());
+  Clock::settle();
+
+  Future<ResourceStatistics> usage1 = containerizer->usage(containerId);
+  AWAIT_READY(usage1);
+
+  EXPECT_TRUE(usage1->has_cpus_user_time_secs());
+  EXPECT_TRUE(usage1->has_mem_total_bytes());
+
+  // Less than the sampling interval passes, the sample keeps its time.
+  Clock::advance(Milliseconds(50));
+
+  Future<ResourceStatistics> usage2 = containerizer->usage(containerId);
+  AWAIT_READY(usage2);
+
+  EXPECT_EQ(usage1->cpus_user_time_secs(), usage2->cpus_user_time_secs());
+  EXPECT_EQ(usage1->cpus_system_time_secs(), usage2->cpus_system_time_secs());
+  EXPECT_EQ(usage1->mem_total_bytes(), usage2->mem_total_bytes());
+
+  EXPECT_EQ(usage1->timestamp(), usage2->timestamp());
+  EXPECT_LT(usage2->timestamp(), Clock::now().secs());
+
+  Clock::resume();
+
+  driver.stop();
+  driver.join();
+}
+
+
 // This tests the creation of cgroup when cgoups_root dir is gone.
 // All tasks will fail if this happens after slave starting/recovering.
 // We should create cgroup recursively to solve this. SEE MESOS-9305.
@@ -964,50 +964,58 @@ class CgroupsAnyHierarchyWithPerfEventTest
 public:
   CgroupsAnyHierarchyWithPerfEventTest()
     : CgroupsAnyHierarchyTest("perf_event") {}
-};
-
 
-TEST_F(CgroupsAnyHierarchyWithPerfEventTest, ROOT_CGROUPS_PERF_PerfTest)
-{
-  int pipes[2];
-  int dummy;
-  ASSERT_NE(-1, ::pipe(pipes));
+protected:
+  // Launches a child process which spins in the test cgroup.
+  void spin(const string& hierarchy, pid_t* pid)
+  {
+    int pipes[2];
+    int dummy;
+    ASSERT_NE(-1, ::pipe(pipes));
+
+    *pid = ::fork();
+    ASSERT_NE(-1, *pid);
+
+    if (*pid == 0) {
+      // In child process.
+      ::close(pipes[1]);
+
+      // Wait until parent has assigned us to the cgroup.
+      ssize_t len;
+      while ((len = ::read(pipes[0], &dummy, sizeof(dummy))) == -1 &&
+             errno == EINTR);
+      ASSERT_EQ((ssize_t) sizeof(dummy), len);
+      ::close(pipes[0]);
+
+      while (true) {
+        // Don't sleep so 'perf' can actually sample something.
+      }
 
-  string hierarchy = path::join(baseHierarchy, "perf_event");
-  ASSERT_SOME(cgroups::create(hierarchy, TEST_CGROUPS_ROOT));
+      ABORT("Child should not reach here");
+    }
 
-  pid_t pid = ::fork();
-  ASSERT_NE(-1, pid);
+    // In parent.
+    ::close(pipes[0]);
 
-  if (pid == 0) {
-    // In child process.
-    ::close(pipes[1]);
+    // Put child into the test cgroup.
+    ASSERT_SOME(cgroups::assign(hierarchy, TEST_CGROUPS_ROOT, *pid));
 
-    // Wait until parent has assigned us to the cgroup.
     ssize_t len;
-    while ((len = ::read(pipes[0], &dummy, sizeof(dummy))) == -1 &&
+    while ((len = ::write(pipes[1], &dummy, sizeof(dummy))) == -1 &&
            errno == EINTR);
     ASSERT_EQ((ssize_t) sizeof(dummy), len);
-    ::close(pipes[0]);
-
-    while (true) {
-      // Don't sleep so 'perf' can actually sample something.
-    }
-
-    ABORT("Child should not reach here");
+    ::close(pipes[1]);
   }
+};
 
-  // In parent.
-  ::close(pipes[0]);
 
-  // Put child into the test cgroup.
-  ASSERT_SOME(cgroups::assign(hierarchy, TEST_CGROUPS_ROOT, pid));
+TEST_F(CgroupsAnyHierarchyWithPerfEventTest, ROOT_CGROUPS_PERF_PerfTest)
+{
+  string hierarchy = path::join(baseHierarchy, "perf_event");
+  ASSERT_SOME(cgroups::create(hierarchy, TEST_CGROUPS_ROOT));
 
-  ssize_t len;
-  while ((len = ::write(pipes[1], &dummy, sizeof(dummy))) == -1 &&
-         errno == EINTR);
-  ASSERT_EQ((ssize_t) sizeof(dummy), len);
-  ::close(pipes[1]);
+  pid_t pid;
+  spin(hierarchy, &pid);
 
   set<string> events;
   // Hardware event.
@@ -1046,6 +1054,53 @@ TEST_F(CgroupsAnyHierarchyWithPerfEventTest, ROOT_CGROUPS_PERF_PerfTest)
 }
 
 
+// This test verifies that the native sampler counts the events of the
+// processes in a cgroup, reading the counters of a group at once.
+TEST_F(CgroupsAnyHierarchyWithPerfEventTest, ROOT_CGROUPS_NativePerfTest)
+{
+  string hierarchy = path::join(baseHierarchy, "perf_event");
+  ASSERT_SOME(cgroups::create(hierarchy, TEST_CGROUPS_ROOT));
+
+  pid_t pid;
+  spin(hierarchy, &pid);
+
+  // Software events, which are counted even without a PMU, e.g., in a
+  // virtual machine, along with a hardware event in the same group.
+  set<string> events = {"task-clock", "cpu-clock", "context-switches"};
+  events.insert("cycles");
+
+  Future<hashmap<string, mesos::PerfStatistics>> statistics =
+    perf::native::sample(events, hierarchy, {TEST_CGROUPS_ROOT}, Seconds(1));
+
+  AWAIT_READY(statistics);
+
+  ASSERT_TRUE(statistics->contains(TEST_CGROUPS_ROOT));
+
+  const mesos::PerfStatistics& sample = statistics->at(TEST_CGROUPS_ROOT);
+
+  EXPECT_DOUBLE_EQ(1.0, sample.duration());
+
+  // The child spins for the whole sample on a CPU, hence it is counted
+  // for most of the duration of the sample (in milliseconds).
+  ASSERT_TRUE(sample.has_task_clock());
+  EXPECT_LT(500.0, sample.task_clock());
+  EXPECT_GT(2000.0, sample.task_clock());
+
+  ASSERT_TRUE(sample.has_cpu_clock());
+  EXPECT_LT(0.0, sample.cpu_clock());
+
+  // Kill the child process.
+  ASSERT_NE(-1, ::kill(pid, SIGKILL));
+
+  // Wait for the child process.
+  AWAIT_EXPECT_WTERMSIG_EQ(SIGKILL, reap(pid));
+
+  // Destroy the cgroup.
+  Future<Nothing> destroy = cgroups::destroy(hierarchy, TEST_CGROUPS_ROOT);
+  AWAIT_READY(destroy);
+}
+
+
 class CgroupsAnyHierarchyMemoryPressureTest
   : public CgroupsAnyHierarchyTest
 {
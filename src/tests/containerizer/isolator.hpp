@@ -81,8 +81,13 @@ public:
 
     EXPECT_CALL(*this, cleanup(_))
       .WillRepeatedly(Return(Nothing()));
+
+    EXPECT_CALL(*this, supportsConcurrentCleanup())
+      .WillRepeatedly(Return(false));
   }
 
+  MOCK_METHOD0(supportsConcurrentCleanup, bool());
+
   MOCK_METHOD2(
       recover,
       process::Future<Nothing>(
@@ -1314,6 +1314,84 @@ TEST_F(MesosContainerizerDestroyTest, LauncherDestroyFailure)
 }
 
 
+// This test verifies that isolators which support concurrent cleanup
+// are cleaned up without waiting for the cleanup of other isolators.
+TEST_F(MesosContainerizerDestroyTest, ConcurrentIsolatorCleanup)
+{
+  slave::Flags flags = CreateSlaveFlags();
+  flags.launcher = "posix";
+
+  Try<Launcher*> launcher_ = SubprocessLauncher::create(flags);
+  ASSERT_SOME(launcher_);
+
+  Owned<Launcher> launcher(launcher_.get());
+
+  Fetcher fetcher(flags);
+
+  Try<Owned<Provisioner>> provisioner = Provisioner::create(flags);
+  ASSERT_SOME(provisioner);
+
+  // The isolators are cleaned up in the reverse order, so the cleanup
+  // of the concurrent isolator would otherwise wait for the serial one.
+  MockIsolator* concurrentIsolator = new MockIsolator();
+  MockIsolator* serialIsolator = new MockIsolator();
+
+  EXPECT_CALL(*concurrentIsolator, supportsConcurrentCleanup())
+    .WillRepeatedly(Return(true));
+
+  Future<Nothing> concurrentCleanup;
+  EXPECT_CALL(*concurrentIsolator, cleanup(_))
+    .WillOnce(DoAll(FutureSatisfy(&concurrentCleanup),
+                    Return(Nothing())));
+
+  Promise<Nothing> serialPromise;
+  EXPECT_CALL(*serialIsolator, cleanup(_))
+    .WillOnce(Return(serialPromise.future()));
+
+  Try<MesosContainerizer*> _containerizer = MesosContainerizer::create(
+      flags,
+      true,
+      &fetcher,
+      nullptr,
+      launcher,
+      provisioner->share(),
+      {Owned<Isolator>(concurrentIsolator), Owned<Isolator>(serialIsolator)});
+
+  ASSERT_SOME(_containerizer);
+
+  Owned<MesosContainerizer> containerizer(_containerizer.get());
+
+  ContainerID containerId;
+  containerId.set_value(id::UUID::random().toString());
+
+  SlaveID slaveId = SlaveID();
+  slaveId.set_value("slave_id");
+  TaskInfo taskInfo = createTask(slaveId, Resources(), CommandInfo());
+
+  Future<Containerizer::LaunchResult> launch = containerizer->launch(
+      containerId,
+      createContainerConfig(
+          taskInfo,
+          createExecutorInfo("executor", "sleep 1000"),
+          sandbox.get()),
+      map<string, string>(),
+      None());
+
+  AWAIT_ASSERT_EQ(Containerizer::LaunchResult::SUCCESS, launch);
+
+  Future<Option<ContainerTermination>> termination =
+    containerizer->destroy(containerId);
+
+  AWAIT_READY(concurrentCleanup);
+  EXPECT_TRUE(termination.isPending());
+
+  serialPromise.set(Nothing());
+
+  AWAIT_READY(termination);
+  ASSERT_SOME(termination.get());
+}
+
+
 class MesosContainerizerRecoverTest : public MesosTest {};
 
 
@@ -67,6 +67,43 @@ TEST_F(PerfTest, ROOT_PERF_Sample)
 }
 
 
+TEST_F(PerfTest, ROOT_NativeEvents)
+{
+  // Valid events, including aliases and hardware cache events.
+  EXPECT_TRUE(perf::native::valid({"cycles", "task-clock", "cs"}));
+  EXPECT_TRUE(perf::native::valid({"L1-dcache-load-misses", "dTLB-loads"}));
+
+  // Invalid event among valid events.
+  EXPECT_FALSE(
+      perf::native::valid({"cycles", "task-clock", "invalid-event"}));
+}
+
+
+TEST_F(PerfTest, ROOT_NativeSample)
+{
+  // Sampling an empty set of cgroups should be a no-op.
+  Future<hashmap<string, PerfStatistics>> sample =
+    perf::native::sample(
+        {"cycles", "task-clock"}, "/sys/fs/cgroup", {}, Seconds(1));
+
+  AWAIT_READY(sample);
+
+  EXPECT_TRUE(sample->empty());
+
+  // A cgroup that does not exist (e.g., it has been destroyed since
+  // the sample was requested) is left out of the sample.
+  sample = perf::native::sample(
+      {"cycles", "task-clock"},
+      "/sys/fs/cgroup",
+      {"mesos_test_missing"},
+      Milliseconds(10));
+
+  AWAIT_READY(sample);
+
+  EXPECT_TRUE(sample->empty());
+}
+
+
 TEST_F(PerfTest, Parse)
 {
   // Parse multiple cgroups with uint64 and floats.
@@ -24,6 +24,8 @@
 
 #include <stout/duration.hpp>
 #include <stout/gtest.hpp>
+#include <stout/os.hpp>
+#include <stout/path.hpp>
 
 #include "internal/devolve.hpp"
 
@@ -52,6 +54,7 @@ using std::string;
 using std::vector;
 
 using testing::DoAll;
+using testing::WithParamInterface;
 
 using namespace routing::diagnosis;
 
@@ -738,9 +741,23 @@ TEST_F(NetworkPortsIsolatorTest, ROOT_NC_DefaultPortsResource)
 }
 
 
+class NetworkPortsIsolatorWatchTest
+  : public NetworkPortsIsolatorTest,
+    public WithParamInterface<bool> {};
+
+
+// The watch tests are parameterized by whether the checks are
+// incremental, i.e., `--container_ports_watch_incremental`.
+INSTANTIATE_TEST_CASE_P(
+    Incremental,
+    NetworkPortsIsolatorWatchTest,
+    ::testing::Bool());
+
+
 // This test verifies that a task that listens on a port for which it has
-// no resources is detected and killed by a container limitation.
-TEST_F(NetworkPortsIsolatorTest, ROOT_NC_UnallocatedPorts)
+// no resources is detected and killed by a container limitation, whether
+// or not the owners of the listening sockets are cached across checks.
+TEST_P(NetworkPortsIsolatorWatchTest, ROOT_NC_UnallocatedPorts)
 {
   Try<Owned<cluster::Master>> master = StartMaster();
   ASSERT_SOME(master);
@@ -753,6 +770,7 @@ TEST_F(NetworkPortsIsolatorTest, ROOT_NC_UnallocatedPorts)
   // test to trigger on the nc command, not on the command executor.
   flags.check_agent_port_range_only = true;
   flags.enforce_container_ports = true;
+  flags.container_ports_watch_incremental = GetParam();
 
   Owned<MasterDetector> detector = master.get()->createDetector();
 
@@ -851,6 +869,165 @@ TEST_F(NetworkPortsIsolatorTest, ROOT_NC_UnallocatedPorts)
 }
 
 
+// This test verifies that a listening socket opened by a task after the
+// owners of the previous listening sockets have been cached is detected
+// by a later incremental check, and the task is killed by a container
+// limitation.
+TEST_F(NetworkPortsIsolatorTest, ROOT_NC_UnallocatedPortsIncremental)
+{
+  Try<Owned<cluster::Master>> master = StartMaster();
+  ASSERT_SOME(master);
+
+  slave::Flags flags = CreateSlaveFlags();
+  flags.isolation = "network/ports";
+  flags.launcher = "linux";
+
+  // Watch only the agent ports resources range because we want this
+  // test to trigger on the nc command, not on the command executor.
+  flags.check_agent_port_range_only = true;
+  flags.enforce_container_ports = true;
+  flags.container_ports_watch_incremental = true;
+
+  Owned<MasterDetector> detector = master.get()->createDetector();
+
+  Try<Owned<cluster::Slave>> slave = StartSlave(detector.get(), flags);
+  ASSERT_SOME(slave);
+
+  MockScheduler sched;
+
+  MesosSchedulerDriver driver(
+      &sched,
+      DEFAULT_FRAMEWORK_INFO,
+      master.get()->pid,
+      DEFAULT_CREDENTIAL);
+
+  EXPECT_CALL(sched, registered(&driver, _, _));
+
+  Future<vector<Offer>> offers;
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(FutureArg<1>(&offers))
+    .WillRepeatedly(Return()); // Ignore subsequent offers.
+
+  driver.start();
+
+  AWAIT_READY(offers);
+  ASSERT_EQ(1u, offers->size());
+
+  const Offer& offer = offers.get()[0];
+
+  // Make sure we have a `ports` resource.
+  Resources resources(offer.resources());
+  ASSERT_SOME(resources.ports());
+  ASSERT_LE(1, resources.ports()->range().size());
+
+  uint16_t taskPort = selectRandomPort(resources);
+  uint16_t usedPort = selectOtherPort(resources, taskPort);
+
+  resources = Resources::parse(
+      "cpus:1;mem:32;"
+      "ports:[" + stringify(taskPort) + "," + stringify(taskPort) + "]").get();
+
+  // The task only listens on the port it hasn't been allocated once
+  // the test creates the trigger file.
+  const string trigger = path::join(os::getcwd(), "trigger");
+
+  TaskInfo task = createTask(
+      offer.slave_id(),
+      resources,
+      "nc -k -l " + stringify(taskPort) + " & "
+      "while [ ! -f " + trigger + " ]; do sleep 0.1; done; "
+      "nc -k -l " + stringify(usedPort));
+
+  addTcpHealthCheck(task, taskPort);
+
+  Future<TaskStatus> startingStatus;
+  Future<TaskStatus> runningStatus;
+  Future<TaskStatus> healthStatus;
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(FutureArg<1>(&startingStatus))
+    .WillOnce(FutureArg<1>(&runningStatus))
+    .WillOnce(FutureArg<1>(&healthStatus));
+
+  driver.launchTasks(offer.id(), {task});
+
+  awaitStatusUpdateAcked(startingStatus);
+  EXPECT_EQ(task.task_id(), startingStatus->task_id());
+  EXPECT_EQ(TASK_STARTING, startingStatus->state());
+
+  awaitStatusUpdateAcked(runningStatus);
+  EXPECT_EQ(task.task_id(), runningStatus->task_id());
+  EXPECT_EQ(TASK_RUNNING, runningStatus->state());
+
+  awaitStatusUpdateAcked(healthStatus);
+  ASSERT_EQ(task.task_id(), healthStatus->task_id());
+  expectHealthyStatus(healthStatus.get());
+
+  Future<TaskStatus> failedStatus;
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(FutureArg<1>(&failedStatus));
+
+  // The first check caches the owner of the allocated listening socket.
+  Future<Nothing> check =
+    FUTURE_DISPATCH(_, &NetworkPortsIsolatorProcess::check);
+
+  Clock::pause();
+  Clock::advance(flags.container_ports_watch_interval);
+
+  AWAIT_READY(check);
+
+  Clock::settle();
+  Clock::resume();
+
+  EXPECT_TRUE(failedStatus.isPending());
+
+  ASSERT_SOME(os::touch(trigger));
+
+  // Wait for the task to listen on the port it hasn't been allocated.
+  Duration waited = Duration::zero();
+  bool listening = false;
+
+  do {
+    Try<hashmap<uint32_t, socket::Info>> listeners =
+      NetworkPortsIsolatorProcess::getListeningSockets();
+
+    ASSERT_SOME(listeners);
+
+    foreachvalue (const socket::Info& info, listeners.get()) {
+      if (ntohs(info.sourcePort.get()) == usedPort) {
+        listening = true;
+      }
+    }
+
+    if (!listening) {
+      os::sleep(Milliseconds(100));
+      waited += Milliseconds(100);
+    }
+  } while (!listening && waited < Seconds(15));
+
+  ASSERT_TRUE(listening);
+
+  check = FUTURE_DISPATCH(_, &NetworkPortsIsolatorProcess::check);
+
+  Clock::pause();
+  Clock::advance(flags.container_ports_watch_interval);
+
+  AWAIT_READY(check);
+
+  Clock::settle();
+  Clock::resume();
+
+  // We expect that the task will get killed by the isolator.
+  AWAIT_READY(failedStatus);
+  EXPECT_EQ(task.task_id(), failedStatus->task_id());
+  EXPECT_EQ(TASK_FAILED, failedStatus->state());
+  EXPECT_EQ(TaskStatus::SOURCE_SLAVE, failedStatus->source());
+  expectPortsLimitation(failedStatus.get(), usedPort);
+
+  driver.stop();
+  driver.join();
+}
+
+
 // This test verifies that a task that listens on a port for which
 // it has no resources is detected and will not be killed by
 // a container limitation if enforce_container_ports is false.
@@ -488,6 +488,81 @@ TEST_F(ProvisionerAppcTest, Recover)
 }
 
 
+// This test verifies that a container launched with an image which
+// is already used by another container claims a pre-provisioned rootfs
+// from the pool, and that the pool is removed once the image is not
+// used anymore.
+TEST_F(ProvisionerAppcTest, ProvisionFromPool)
+{
+  slave::Flags flags;
+  flags.image_providers = "APPC";
+  flags.appc_store_dir = path::join(os::getcwd(), "store");
+  flags.image_provisioner_backend = COPY_BACKEND;
+  flags.image_provisioner_pool_size = 1;
+  flags.work_dir = path::join(sandbox.get(), "work_dir");
+
+  Try<Owned<Provisioner>> provisioner = Provisioner::create(flags);
+  ASSERT_SOME(provisioner);
+
+  Try<string> createImage = createTestImage(
+      flags.appc_store_dir,
+      getManifest());
+
+  ASSERT_SOME(createImage);
+
+  AWAIT_READY(provisioner.get()->recover({}));
+
+  Image image;
+  image.mutable_appc()->CopyFrom(getTestImage());
+
+  ContainerID containerId1;
+  containerId1.set_value(id::UUID::random().toString());
+
+  AWAIT_READY(provisioner.get()->provision(containerId1, image));
+
+  // Pruning the images waits for the pool to be refilled, and keeps
+  // the pool since the image is still used by the first container.
+  AWAIT_READY(provisioner.get()->pruneImages({image}));
+
+  const string poolDir = slave::provisioner::paths::getPoolDir(
+      slave::paths::getProvisionerDir(flags.work_dir));
+
+  Try<list<string>> pool = os::ls(poolDir);
+  ASSERT_SOME(pool);
+  EXPECT_EQ(1u, pool->size());
+
+  ContainerID containerId2;
+  containerId2.set_value(id::UUID::random().toString());
+
+  Future<slave::ProvisionInfo> provisionInfo =
+    provisioner.get()->provision(containerId2, image);
+
+  AWAIT_READY(provisionInfo);
+
+  EXPECT_SOME_EQ(
+      "test",
+      os::read(path::join(provisionInfo->rootfs, "tmp", "test")));
+
+  JSON::Object metrics = Metrics();
+  EXPECT_EQ(
+      1u,
+      metrics.values["containerizer/mesos/provisioner/pool_hits"]);
+  EXPECT_EQ(
+      1u,
+      metrics.values["containerizer/mesos/provisioner/pool_misses"]);
+
+  AWAIT_EXPECT_TRUE(provisioner.get()->destroy(containerId1));
+  AWAIT_EXPECT_TRUE(provisioner.get()->destroy(containerId2));
+
+  // The pool is removed once the image is not used anymore.
+  AWAIT_READY(provisioner.get()->pruneImages({image}));
+
+  pool = os::ls(poolDir);
+  ASSERT_SOME(pool);
+  EXPECT_TRUE(pool->empty());
+}
+
+
 // This test verifies that the provisioner can recover the rootfses
 // for both parent and child containers.
 TEST_F(ProvisionerAppcTest, RecoverNestedContainer)
@@ -890,6 +965,70 @@ TEST_F(AppcImageFetcherTest, SimpleFileFetch)
 }
 
 
+// Tests that an image whose ID is known is retrieved from the blob
+// store rather than fetched again once it has been fetched before.
+TEST_F(AppcImageFetcherTest, BlobStoreFetch)
+{
+  const string imageName = "image";
+
+  const string imageBundleName = imageName + "-latest-linux-amd64.aci";
+
+  const string imageDirMountPath(path::join(os::getcwd(), "mnt"));
+
+  const string imageBundlePath = path::join(imageDirMountPath, imageBundleName);
+
+  prepareImage(imageDirMountPath, imageBundlePath, getManifest());
+
+  Image::Appc appc = getAppcImage("image");
+
+  Try<Owned<uri::Fetcher>> uriFetcher = uri::fetcher::create();
+  ASSERT_SOME(uriFetcher);
+
+  const string blobDir = path::join(os::getcwd(), "blobs");
+
+  slave::Flags flags;
+  flags.appc_simple_discovery_uri_prefix = imageDirMountPath + "/";
+  flags.blob_store_dir = blobDir;
+  flags.blob_store_capacity = Megabytes(1);
+
+  Try<Owned<slave::appc::Fetcher>> fetcher =
+    slave::appc::Fetcher::create(flags, uriFetcher->share());
+
+  ASSERT_SOME(fetcher);
+
+  const Path imageFetchDir(path::join(os::getcwd(), "fetched-images"));
+  ASSERT_SOME(os::mkdir(imageFetchDir));
+
+  AWAIT_READY(fetcher.get()->fetch(appc, imageFetchDir));
+
+  // The bundle is kept in the blob store under the image ID.
+  Try<list<string>> blobs = os::ls(path::join(blobDir, "sha512"));
+  ASSERT_SOME(blobs);
+  ASSERT_EQ(1u, blobs->size());
+
+  Try<list<string>> imageDirs = os::ls(imageFetchDir);
+  ASSERT_SOME(imageDirs);
+  ASSERT_EQ(1u, imageDirs->size());
+  EXPECT_EQ("sha512-" + blobs->front(), imageDirs->front());
+
+  // Once the ID of the image is known, it is not fetched again.
+  ASSERT_SOME(os::rm(imageBundlePath));
+
+  appc.set_id(imageDirs->front());
+
+  const Path imageRefetchDir(path::join(os::getcwd(), "refetched-images"));
+  ASSERT_SOME(os::mkdir(imageRefetchDir));
+
+  AWAIT_READY(fetcher.get()->fetch(appc, imageRefetchDir));
+
+  const Path imageRootfs(path::join(
+      imageRefetchDir,
+      imageDirs->front(),
+      "rootfs"));
+
+  ASSERT_SOME_EQ("test", os::read(path::join(imageRootfs, "tmp", "test")));
+}
+
 #ifdef __linux__
 // Test fixture for Appc image provisioner integration tests. It also provides a
 // helper for creating a base linux image bundle.
@@ -14,13 +14,19 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <iostream>
+
+#include <mesos/docker/spec.hpp>
+
 #include <process/gtest.hpp>
 
 #include <stout/foreach.hpp>
+#include <stout/fs.hpp>
 #include <stout/gtest.hpp>
 #include <stout/os.hpp>
 #include <stout/os/permissions.hpp>
 #include <stout/path.hpp>
+#include <stout/stopwatch.hpp>
 #include <stout/strings.hpp>
 
 #include <stout/tests/utils.hpp>
@@ -35,6 +41,8 @@
 
 #include "slave/containerizer/mesos/provisioner/constants.hpp"
 
+#include "slave/constants.hpp"
+
 #include "tests/flags.hpp"
 
 using namespace process;
@@ -46,9 +54,13 @@ using mesos::internal::slave::BIND_BACKEND;
 using mesos::internal::slave::COPY_BACKEND;
 using mesos::internal::slave::OVERLAY_BACKEND;
 
+using std::cout;
+using std::endl;
 using std::string;
 using std::vector;
 
+using testing::WithParamInterface;
+
 namespace mesos {
 namespace internal {
 namespace tests {
@@ -344,6 +356,158 @@ TEST_F(CopyBackendTest, ROOT_CopyBackend)
   EXPECT_FALSE(os::exists(rootfs));
 }
 
+
+// Verifies that the copy backend applies the whiteouts of a layer and
+// preserves the hard links within a layer, and that the entries of an
+// upper layer replace the entries of a lower layer of another type.
+TEST_F(CopyBackendTest, CopyBackendWhiteouts)
+{
+  string layer1 = path::join(sandbox.get(), "source1");
+  ASSERT_SOME(os::mkdir(path::join(layer1, "dir1", "sub")));
+  ASSERT_SOME(os::write(path::join(layer1, "dir1", "sub", "1"), "1"));
+  ASSERT_SOME(os::mkdir(path::join(layer1, "dir2")));
+  ASSERT_SOME(os::write(path::join(layer1, "dir2", "2"), "2"));
+  ASSERT_SOME(os::write(path::join(layer1, "removed"), "removed"));
+  ASSERT_SOME(os::write(path::join(layer1, "file"), "file"));
+  ASSERT_SOME(::fs::symlink("file", path::join(layer1, "link")));
+  ASSERT_SOME(os::mkdir(path::join(layer1, "dir3")));
+
+  string layer2 = path::join(sandbox.get(), "source2");
+  ASSERT_SOME(os::mkdir(path::join(layer2, "dir1")));
+  ASSERT_SOME(os::write(
+      path::join(layer2, "dir1", ::docker::spec::WHITEOUT_OPAQUE_PREFIX),
+      ""));
+  ASSERT_SOME(os::write(path::join(layer2, "dir1", "3"), "3"));
+  ASSERT_SOME(os::write(
+      path::join(layer2, string(::docker::spec::WHITEOUT_PREFIX) + "removed"),
+      ""));
+  ASSERT_SOME(os::write(path::join(layer2, "link"), "link"));
+  ASSERT_SOME(os::write(path::join(layer2, "dir3"), "dir3"));
+  ASSERT_EQ(0, ::link(
+      path::join(layer2, "link").c_str(),
+      path::join(layer2, "dir1", "4").c_str()));
+
+  string rootfs = path::join(sandbox.get(), "rootfs");
+
+  hashmap<string, Owned<Backend>> backends = Backend::create(slave::Flags());
+  ASSERT_TRUE(backends.contains(COPY_BACKEND));
+
+  AWAIT_READY(backends[COPY_BACKEND]->provision(
+      {layer1, layer2},
+      rootfs,
+      sandbox.get()));
+
+  // The opaque whiteout hides the content of the lower layer only.
+  EXPECT_FALSE(os::exists(path::join(rootfs, "dir1", "sub")));
+  EXPECT_SOME_EQ("3", os::read(path::join(rootfs, "dir1", "3")));
+  EXPECT_SOME_EQ("2", os::read(path::join(rootfs, "dir2", "2")));
+
+  EXPECT_FALSE(os::exists(path::join(rootfs, "removed")));
+  EXPECT_SOME_EQ("file", os::read(path::join(rootfs, "file")));
+
+  EXPECT_FALSE(os::stat::islink(path::join(rootfs, "link")));
+  EXPECT_SOME_EQ("link", os::read(path::join(rootfs, "link")));
+  EXPECT_SOME_EQ("dir3", os::read(path::join(rootfs, "dir3")));
+
+  Try<ino_t> inode1 = os::stat::inode(path::join(rootfs, "link"));
+  Try<ino_t> inode2 = os::stat::inode(path::join(rootfs, "dir1", "4"));
+  ASSERT_SOME(inode1);
+  ASSERT_SOME(inode2);
+  EXPECT_EQ(inode1.get(), inode2.get());
+
+  // None of the whiteouts are copied.
+  EXPECT_FALSE(os::exists(
+      path::join(rootfs, "dir1", ::docker::spec::WHITEOUT_OPAQUE_PREFIX)));
+  EXPECT_FALSE(os::exists(
+      path::join(rootfs, string(::docker::spec::WHITEOUT_PREFIX) + "removed")));
+
+  AWAIT_READY(backends[COPY_BACKEND]->destroy(rootfs, sandbox.get()));
+
+  EXPECT_FALSE(os::exists(rootfs));
+}
+
+
+class CopyBackend_BENCHMARK_Test
+  : public TemporaryDirectoryTest,
+    public WithParamInterface<std::tuple<size_t, size_t>> {};
+
+
+// The copy backend benchmark is parameterized by the number of layers
+// of a synthetic image and the number of files in each layer, which
+// are spread over directories of 100 files each.
+INSTANTIATE_TEST_CASE_P(
+    LayersAndFiles,
+    CopyBackend_BENCHMARK_Test,
+    ::testing::Values(
+        std::make_tuple(1U, 10000U),
+        std::make_tuple(5U, 10000U),
+        std::make_tuple(20U, 1000U)));
+
+
+// Measures the time to provision a rootfs from a synthetic image with
+// the copy backend, using a single thread and the default number of
+// threads. Each layer overwrites a part of the files of the layer below
+// it and whites out another part.
+// NOTE: The layers are in the page cache after they are created, hence
+// this does not account for the latency of the disk.
+TEST_P(CopyBackend_BENCHMARK_Test, Provision)
+{
+  size_t layers;
+  size_t files;
+  std::tie(layers, files) = GetParam();
+
+  vector<string> paths;
+
+  for (size_t i = 0; i < layers; i++) {
+    const string layer = path::join(sandbox.get(), "layer" + stringify(i));
+
+    for (size_t j = 0; j < files; j++) {
+      const string dir = path::join(layer, "dir" + stringify(j / 100));
+
+      if (j % 100 == 0) {
+        ASSERT_SOME(os::mkdir(dir));
+      }
+
+      if (i > 0 && j % 10 == 0) {
+        ASSERT_SOME(os::write(
+            path::join(dir, ::docker::spec::WHITEOUT_PREFIX + stringify(j)),
+            ""));
+      } else {
+        ASSERT_SOME(
+            os::write(path::join(dir, stringify(j)), string(4096, 'x')));
+      }
+    }
+
+    paths.push_back(layer);
+  }
+
+  const vector<size_t> threadCounts =
+    {1U, slave::DEFAULT_IMAGE_PROVISIONER_COPY_THREADS};
+
+  foreach (size_t threads, threadCounts) {
+    slave::Flags flags;
+    flags.image_provisioner_copy_threads = threads;
+
+    Try<Owned<Backend>> backend = CopyBackend::create(flags);
+    ASSERT_SOME(backend);
+
+    const string rootfs = path::join(sandbox.get(), "rootfs");
+
+    Stopwatch watch;
+    watch.start();
+
+    AWAIT_READY_FOR(
+        backend.get()->provision(paths, rootfs, sandbox.get()),
+        Minutes(5));
+
+    cout << "Provisioned " << layers << " layers of " << files
+         << " files with " << threads << " threads in " << watch.elapsed()
+         << endl;
+
+    AWAIT_READY_FOR(backend.get()->destroy(rootfs, sandbox.get()), Minutes(5));
+  }
+}
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {
@@ -14,10 +14,14 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <utime.h>
+
 #include <gmock/gmock.h>
 
+#include <stout/bytes.hpp>
 #include <stout/duration.hpp>
 #include <stout/gtest.hpp>
+#include <stout/hashset.hpp>
 #include <stout/json.hpp>
 #include <stout/os.hpp>
 #include <stout/path.hpp>
@@ -26,7 +30,9 @@
 #include <process/clock.hpp>
 #include <process/future.hpp>
 #include <process/gmock.hpp>
+#include <process/http.hpp>
 #include <process/owned.hpp>
+#include <process/process.hpp>
 
 #include <mesos/docker/spec.hpp>
 
@@ -34,6 +40,9 @@
 #include "linux/fs.hpp"
 #endif // __linux__
 
+#include "common/command_utils.hpp"
+
+#include "slave/containerizer/mesos/provisioner/blob_store.hpp"
 #include "slave/containerizer/mesos/provisioner/constants.hpp"
 #include "slave/containerizer/mesos/provisioner/paths.hpp"
 
@@ -44,6 +53,10 @@
 #include "slave/containerizer/mesos/provisioner/docker/registry_puller.hpp"
 #include "slave/containerizer/mesos/provisioner/docker/store.hpp"
 
+#include "uri/fetcher.hpp"
+
+#include "uri/fetchers/docker.hpp"
+
 #include "tests/environment.hpp"
 #include "tests/mesos.hpp"
 #include "tests/utils.hpp"
@@ -52,6 +65,8 @@
 #include "tests/containerizer/docker_archive.hpp"
 #endif // __linux__
 
+namespace command = mesos::internal::command;
+namespace http = process::http;
 namespace master = mesos::internal::master;
 namespace paths = mesos::internal::slave::docker::paths;
 namespace slave = mesos::internal::slave;
@@ -87,6 +102,9 @@ using slave::docker::Puller;
 using slave::docker::RegistryPuller;
 using slave::docker::Store;
 
+using testing::_;
+using testing::Invoke;
+using testing::Return;
 using testing::WithParamInterface;
 
 namespace mesos {
@@ -134,56 +152,60 @@ protected:
   {
     TemporaryDirectoryTest::SetUp();
 
+    ASSERT_SOME(os::mkdir(path::join(os::getcwd(), "images")));
+
+    addImage("abc", {{"123", "foo 123"}, {"456", "bar 456"}});
+  }
+
+  // Creates the archive of an image in the local registry, where each
+  // layer is given by its id and the content of its 'temp' file, and
+  // is the parent of the next one.
+  void addImage(
+      const string& name,
+      const vector<std::pair<string, string>>& layers)
+  {
     const string archivesDir = path::join(os::getcwd(), "images");
-    const string image = path::join(archivesDir, "abc");
-    ASSERT_SOME(os::mkdir(archivesDir));
+    const string image = path::join(archivesDir, name);
     ASSERT_SOME(os::mkdir(image));
 
-    JSON::Value repositories = JSON::parse(
-        "{"
-        "  \"abc\": {"
-        "    \"latest\": \"456\""
-        "  }"
-        "}").get();
+    JSON::Object tags;
+    tags.values["latest"] = layers.back().first;
+
+    JSON::Object repositories;
+    repositories.values[name] = tags;
+
     ASSERT_SOME(
         os::write(path::join(image, "repositories"), stringify(repositories)));
 
-    ASSERT_SOME(os::mkdir(path::join(image, "123")));
-    JSON::Value manifest123 = JSON::parse(
-        "{"
-        "  \"parent\": \"\""
-        "}").get();
-    ASSERT_SOME(os::write(
-        path::join(image, "123", "json"), stringify(manifest123)));
-    ASSERT_SOME(os::mkdir(path::join(image, "123", "layer")));
-    ASSERT_SOME(
-        os::write(path::join(image, "123", "layer", "temp"), "foo 123"));
+    string parent;
+    foreach (const auto& layer, layers) {
+      const string& layerId = layer.first;
 
-    // Must change directory to avoid carrying over /path/to/archive during tar.
-    const string cwd = os::getcwd();
-    ASSERT_SOME(os::chdir(path::join(image, "123", "layer")));
-    ASSERT_SOME(os::tar(".", "../layer.tar"));
-    ASSERT_SOME(os::chdir(cwd));
-    ASSERT_SOME(os::rmdir(path::join(image, "123", "layer")));
+      ASSERT_SOME(os::mkdir(path::join(image, layerId)));
 
-    ASSERT_SOME(os::mkdir(path::join(image, "456")));
-    JSON::Value manifest456 = JSON::parse(
-        "{"
-        "  \"parent\": \"123\""
-        "}").get();
-    ASSERT_SOME(
-        os::write(path::join(image, "456", "json"), stringify(manifest456)));
-    ASSERT_SOME(os::mkdir(path::join(image, "456", "layer")));
-    ASSERT_SOME(
-        os::write(path::join(image, "456", "layer", "temp"), "bar 456"));
+      JSON::Object manifest;
+      manifest.values["parent"] = parent;
+      ASSERT_SOME(os::write(
+          path::join(image, layerId, "json"), stringify(manifest)));
 
-    ASSERT_SOME(os::chdir(path::join(image, "456", "layer")));
-    ASSERT_SOME(os::tar(".", "../layer.tar"));
-    ASSERT_SOME(os::chdir(cwd));
-    ASSERT_SOME(os::rmdir(path::join(image, "456", "layer")));
+      ASSERT_SOME(os::mkdir(path::join(image, layerId, "layer")));
+      ASSERT_SOME(os::write(
+          path::join(image, layerId, "layer", "temp"), layer.second));
+
+      // Must change directory to avoid carrying over /path/to/archive
+      // during tar.
+      const string cwd = os::getcwd();
+      ASSERT_SOME(os::chdir(path::join(image, layerId, "layer")));
+      ASSERT_SOME(os::tar(".", "../layer.tar"));
+      ASSERT_SOME(os::chdir(cwd));
+      ASSERT_SOME(os::rmdir(path::join(image, layerId, "layer")));
 
+      parent = layerId;
+    }
+
+    const string cwd = os::getcwd();
     ASSERT_SOME(os::chdir(image));
-    ASSERT_SOME(os::tar(".", "../abc.tar"));
+    ASSERT_SOME(os::tar(".", "../" + name + ".tar"));
     ASSERT_SOME(os::chdir(cwd));
     ASSERT_SOME(os::rmdir(image));
   }
@@ -303,6 +325,147 @@ TEST_F(ProvisionerDockerLocalStoreTest, MissingLayer)
 }
 
 
+// This test verifies that the store evicts an image along with its
+// layers only if it is neither excluded nor used by any container,
+// and that the evicted image is pulled again on demand.
+TEST_F(ProvisionerDockerLocalStoreTest, EvictImage)
+{
+  slave::Flags flags;
+  flags.docker_registry = path::join(os::getcwd(), "images");
+  flags.docker_store_dir = path::join(os::getcwd(), "store");
+  flags.image_provisioner_backend = COPY_BACKEND;
+
+  Try<Owned<slave::Store>> store = Store::create(flags);
+  ASSERT_SOME(store);
+
+  Image image;
+  image.set_type(Image::DOCKER);
+  image.mutable_docker()->set_name("abc");
+
+  Future<slave::ImageInfo> imageInfo = store.get()->get(
+      image, flags.image_provisioner_backend.get());
+
+  AWAIT_READY(imageInfo);
+  verifyLocalDockerImage(flags, imageInfo->layers);
+
+  hashset<string> activeLayerPaths;
+  foreach (const string& layer, imageInfo->layers) {
+    activeLayerPaths.insert(layer);
+  }
+
+  // The image is in use by a container.
+  Future<Option<Bytes>> evicted =
+    store.get()->evict(vector<Image>(), activeLayerPaths);
+
+  AWAIT_READY(evicted);
+  EXPECT_NONE(evicted.get());
+
+  // The image is excluded.
+  evicted = store.get()->evict({image}, hashset<string>());
+
+  AWAIT_READY(evicted);
+  EXPECT_NONE(evicted.get());
+
+  evicted = store.get()->evict(vector<Image>(), hashset<string>());
+
+  AWAIT_READY(evicted);
+  ASSERT_SOME(evicted.get());
+  EXPECT_LT(Bytes(0), evicted->get());
+
+  EXPECT_FALSE(os::exists(
+      paths::getImageLayerPath(flags.docker_store_dir, "123")));
+  EXPECT_FALSE(os::exists(
+      paths::getImageLayerPath(flags.docker_store_dir, "456")));
+
+  JSON::Object metrics = Metrics();
+  EXPECT_EQ(
+      JSON::Number(evicted->get().bytes()),
+      metrics.values["containerizer/mesos/provisioner/docker_store/"
+                     "gc_reclaimed_bytes"]);
+
+  // Nothing is left to evict.
+  evicted = store.get()->evict(vector<Image>(), hashset<string>());
+
+  AWAIT_READY(evicted);
+  EXPECT_NONE(evicted.get());
+
+  // The evicted image is pulled again.
+  imageInfo = store.get()->get(image, flags.image_provisioner_backend.get());
+  AWAIT_READY(imageInfo);
+  verifyLocalDockerImage(flags, imageInfo->layers);
+}
+
+
+// This test verifies that the store evicts the images one at a time
+// in the order they were least recently used, keeping the layers
+// which are shared with the remaining images.
+TEST_F(ProvisionerDockerLocalStoreTest, EvictImagesInLruOrder)
+{
+  addImage("def", {{"123", "foo 123"}, {"789", "baz 789"}});
+  addImage("ghi", {{"999", "qux 999"}});
+
+  slave::Flags flags;
+  flags.docker_registry = path::join(os::getcwd(), "images");
+  flags.docker_store_dir = path::join(os::getcwd(), "store");
+  flags.image_provisioner_backend = COPY_BACKEND;
+
+  Try<Owned<slave::Store>> store = Store::create(flags);
+  ASSERT_SOME(store);
+
+  // The image 'abc' is used again last.
+  const vector<string> names = {"abc", "def", "ghi", "abc"};
+
+  foreach (const string& name, names) {
+    Image image;
+    image.set_type(Image::DOCKER);
+    image.mutable_docker()->set_name(name);
+
+    AWAIT_READY(store.get()->get(image, flags.image_provisioner_backend.get()));
+  }
+
+  auto exists = [&](const string& layerId) {
+    return os::exists(
+        paths::getImageLayerPath(flags.docker_store_dir, layerId));
+  };
+
+  // The image 'def' is the least recently used one, and its layer
+  // '123' is shared with 'abc'.
+  Future<Option<Bytes>> evicted =
+    store.get()->evict(vector<Image>(), hashset<string>());
+
+  AWAIT_READY(evicted);
+  ASSERT_SOME(evicted.get());
+
+  EXPECT_TRUE(exists("123"));
+  EXPECT_TRUE(exists("456"));
+  EXPECT_FALSE(exists("789"));
+  EXPECT_TRUE(exists("999"));
+
+  evicted = store.get()->evict(vector<Image>(), hashset<string>());
+
+  AWAIT_READY(evicted);
+  ASSERT_SOME(evicted.get());
+
+  EXPECT_TRUE(exists("123"));
+  EXPECT_TRUE(exists("456"));
+  EXPECT_FALSE(exists("999"));
+
+  evicted = store.get()->evict(vector<Image>(), hashset<string>());
+
+  AWAIT_READY(evicted);
+  ASSERT_SOME(evicted.get());
+
+  EXPECT_FALSE(exists("123"));
+  EXPECT_FALSE(exists("456"));
+
+  // Nothing is left to evict.
+  evicted = store.get()->evict(vector<Image>(), hashset<string>());
+
+  AWAIT_READY(evicted);
+  EXPECT_NONE(evicted.get());
+}
+
+
 class MockPuller : public Puller
 {
 public:
@@ -460,6 +623,312 @@ TEST_F(ProvisionerDockerLocalStoreTest, PullDiscarded)
 }
 
 
+class BlobStoreTest : public TemporaryDirectoryTest {};
+
+
+// This tests that the blobs which are linked into a consumer are not
+// evicted, and that the least recently used of the others are evicted
+// once they exceed the capacity of the blob store.
+TEST_F(BlobStoreTest, LinkAndEvict)
+{
+  const string rootDir = path::join(os::getcwd(), "blobs");
+
+  Try<Owned<slave::BlobStore>> store =
+    slave::BlobStore::create(rootDir, Bytes(12));
+
+  ASSERT_SOME(store);
+
+  auto put = [&](const string& digest, const string& content) {
+    Try<string> staged = store.get()->stage();
+    ASSERT_SOME(staged);
+    ASSERT_SOME(os::write(staged.get(), content));
+    ASSERT_SOME(store.get()->put(digest, staged.get()));
+    ASSERT_SOME(os::rm(staged.get()));
+  };
+
+  // Marks the blob as last used at the given time.
+  auto use = [&](const string& hex, time_t time) {
+    const struct utimbuf times = {time, time};
+    ASSERT_EQ(0, ::utime(path::join(rootDir, "sha256", hex).c_str(), &times));
+  };
+
+  EXPECT_ERROR(store.get()->put("sha256:..", path::join(rootDir, "a")));
+  EXPECT_NONE(store.get()->open("sha256:aaa"));
+
+  put("sha256:aaa", "aaaaaa");
+  use("aaa", 1000);
+
+  const string linked = path::join(os::getcwd(), "linked");
+  ASSERT_SOME(store.get()->link("sha256:aaa", linked));
+  EXPECT_SOME_EQ("aaaaaa", os::read(linked));
+
+  put("sha256:bbb", "bbbbbb");
+  use("bbb", 2000);
+
+  const string copied = path::join(os::getcwd(), "copied");
+  ASSERT_SOME(store.get()->copy("sha256:bbb", copied));
+  EXPECT_SOME_EQ("bbbbbb", os::read(copied));
+
+  // The linked blob is not evicted since it does not take any space
+  // beyond the one of its consumer.
+  put("sha256:ccc", "cccccc");
+
+  Result<int_fd> blob = store.get()->open("sha256:aaa");
+  ASSERT_SOME(blob);
+  os::close(blob.get());
+
+  // Once the consumer is gone, the least recently used blob is evicted.
+  ASSERT_SOME(os::rm(linked));
+  use("aaa", 1000);
+
+  ASSERT_SOME(store.get()->prune());
+
+  EXPECT_NONE(store.get()->open("sha256:aaa"));
+  EXPECT_NONE(store.get()->link("sha256:aaa", linked));
+
+  blob = store.get()->open("sha256:bbb");
+  ASSERT_SOME(blob);
+  os::close(blob.get());
+
+  blob = store.get()->open("sha256:ccc");
+  ASSERT_SOME(blob);
+  os::close(blob.get());
+}
+
+
+#ifndef __WINDOWS__
+// A stand-in for a Docker registry serving the manifests and blobs of
+// 'library/test'. Its ID is 'v2' so that it serves the registry API
+// under '/v2'.
+class TestRegistry : public process::Process<TestRegistry>
+{
+public:
+  TestRegistry() : ProcessBase("v2")
+  {
+    route("/library/test/manifests", None(), &TestRegistry::manifests);
+    route("/library/test/blobs", None(), &TestRegistry::blobs);
+  }
+
+  MOCK_METHOD1(manifests, Future<http::Response>(const http::Request&));
+  MOCK_METHOD1(blobs, Future<http::Response>(const http::Request&));
+};
+
+
+class RegistryPullerTest : public TemporaryDirectoryTest
+{
+protected:
+  void SetUp() override
+  {
+    TemporaryDirectoryTest::SetUp();
+
+    spawn(registry);
+  }
+
+  void TearDown() override
+  {
+    terminate(registry);
+    wait(registry);
+
+    TemporaryDirectoryTest::TearDown();
+  }
+
+  // Returns the digest of the file, like the registry does.
+  Future<string> digest(const string& path)
+  {
+    Try<int_fd> fd = os::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd.isError()) {
+      return process::Failure(fd.error());
+    }
+
+    Future<string> sha256 = command::sha256(fd.get());
+    os::close(fd.get());
+
+    return sha256.then([](const string& sha256) {
+      return "sha256:" + sha256;
+    });
+  }
+
+  // Serves an image of the given layers from the test registry.
+  void serve(
+      const string& config,
+      const hashmap<string, string>& layers,
+      const vector<string>& digests)
+  {
+    const string configPath = path::join(os::getcwd(), "config");
+    ASSERT_SOME(os::write(configPath, config));
+
+    Future<string> configDigest = digest(configPath);
+    AWAIT_READY(configDigest);
+
+    JSON::Array layersJson;
+    foreach (const string& digest, digests) {
+      JSON::Object layer;
+      layer.values["mediaType"] =
+        "application/vnd.docker.image.rootfs.diff.tar.gzip";
+      layer.values["size"] = layers.at(digest).size();
+      layer.values["digest"] = digest;
+      layersJson.values.push_back(layer);
+    }
+
+    JSON::Object configJson;
+    configJson.values["mediaType"] =
+      "application/vnd.docker.container.image.v1+json";
+    configJson.values["size"] = config.size();
+    configJson.values["digest"] = configDigest.get();
+
+    JSON::Object manifest;
+    manifest.values["schemaVersion"] = 2;
+    manifest.values["mediaType"] =
+      "application/vnd.docker.distribution.manifest.v2+json";
+    manifest.values["config"] = configJson;
+    manifest.values["layers"] = layersJson;
+
+    http::OK response(stringify(manifest));
+    response.headers["Content-Type"] =
+      "application/vnd.docker.distribution.manifest.v2+json";
+
+    EXPECT_CALL(registry, manifests(_))
+      .WillRepeatedly(Return(response));
+
+    hashmap<string, string> blobs = layers;
+    blobs[configDigest.get()] = config;
+
+    EXPECT_CALL(registry, blobs(_))
+      .WillRepeatedly(Invoke([=](const http::Request& request)
+          -> http::Response {
+        const string digest = Path(request.url.path).basename();
+        if (!blobs.contains(digest)) {
+          return http::NotFound();
+        }
+
+        return http::OK(blobs.at(digest));
+      }));
+  }
+
+  Try<Owned<Puller>> createPuller()
+  {
+    slave::Flags flags;
+    flags.docker_store_dir = path::join(os::getcwd(), "store");
+    flags.docker_registry = "http://" + stringify(registry.self().address);
+
+    Try<Owned<uri::Fetcher>> fetcher = uri::fetcher::create();
+    if (fetcher.isError()) {
+      return Error(fetcher.error());
+    }
+
+    return RegistryPuller::create(flags, fetcher->share(), nullptr);
+  }
+
+  TestRegistry registry;
+};
+
+
+// This test verifies that the registry puller extracts a layer while
+// it is downloaded from a registry, without writing the layer tarball
+// to the staging directory, and fetches the config along with it.
+TEST_F(RegistryPullerTest, CURL_PullFromLocalRegistry)
+{
+  const string layerDir = path::join(os::getcwd(), "layer");
+  ASSERT_SOME(os::mkdir(layerDir));
+  ASSERT_SOME(os::write(path::join(layerDir, "hello"), "world"));
+
+  const string tarball = path::join(os::getcwd(), "layer.tar.gz");
+  AWAIT_READY(command::tar(
+      Path("."),
+      Path(tarball),
+      Path(layerDir),
+      command::Compression::GZIP));
+
+  Future<string> layerDigest = digest(tarball);
+  AWAIT_READY(layerDigest);
+
+  Try<string> layer = os::read(tarball);
+  ASSERT_SOME(layer);
+
+  serve(
+      "{\"architecture\": \"amd64\", \"os\": \"linux\"}",
+      {{layerDigest.get(), layer.get()}},
+      {layerDigest.get()});
+
+  Try<Owned<Puller>> puller = createPuller();
+  ASSERT_SOME(puller);
+
+  Try<spec::ImageReference> reference =
+    spec::parseImageReference("library/test");
+
+  ASSERT_SOME(reference);
+
+  const string directory = path::join(os::getcwd(), "staging");
+  ASSERT_SOME(os::mkdir(directory));
+
+  Future<slave::docker::Image> image =
+    puller.get()->pull(reference.get(), directory, COPY_BACKEND, None());
+
+  AWAIT_READY(image);
+  ASSERT_EQ(1, image->layer_ids_size());
+  EXPECT_EQ(layerDigest.get(), image->layer_ids(0));
+
+  const string rootfs = paths::getImageLayerRootfsPath(
+      path::join(directory, layerDigest.get()),
+      COPY_BACKEND);
+
+  EXPECT_SOME_EQ("world", os::read(path::join(rootfs, "hello")));
+
+  // The layer tarball was streamed into the rootfs, hence there is no
+  // blob left in the staging directory.
+  EXPECT_FALSE(os::exists(path::join(directory, "blobs")));
+  EXPECT_FALSE(os::exists(
+      uri::DockerFetcherPlugin::getBlobPath(directory, layerDigest.get())));
+
+  EXPECT_TRUE(os::exists(
+      uri::DockerFetcherPlugin::getBlobPath(
+          directory,
+          image->config_digest())));
+}
+
+
+// This test verifies that the registry puller fails to pull a layer
+// whose checksum does not match its digest.
+TEST_F(RegistryPullerTest, CURL_PullLayerDigestMismatch)
+{
+  const string layerDir = path::join(os::getcwd(), "layer");
+  ASSERT_SOME(os::mkdir(layerDir));
+  ASSERT_SOME(os::write(path::join(layerDir, "hello"), "world"));
+
+  const string tarball = path::join(os::getcwd(), "layer.tar.gz");
+  AWAIT_READY(command::tar(
+      Path("."),
+      Path(tarball),
+      Path(layerDir),
+      command::Compression::GZIP));
+
+  Try<string> layer = os::read(tarball);
+  ASSERT_SOME(layer);
+
+  const string layerDigest = "sha256:" + string(64, '0');
+
+  serve(
+      "{\"architecture\": \"amd64\", \"os\": \"linux\"}",
+      {{layerDigest, layer.get()}},
+      {layerDigest});
+
+  Try<Owned<Puller>> puller = createPuller();
+  ASSERT_SOME(puller);
+
+  Try<spec::ImageReference> reference =
+    spec::parseImageReference("library/test");
+
+  ASSERT_SOME(reference);
+
+  const string directory = path::join(os::getcwd(), "staging");
+  ASSERT_SOME(os::mkdir(directory));
+
+  AWAIT_FAILED(
+      puller.get()->pull(reference.get(), directory, COPY_BACKEND, None()));
+}
+#endif // __WINDOWS__
+
+
 #ifdef __linux__
 class ProvisionerDockerTest
   : public MesosTest,
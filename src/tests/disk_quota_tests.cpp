@@ -14,6 +14,10 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <unistd.h>
+
+#include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -30,6 +34,7 @@
 #include <stout/gtest.hpp>
 #include <stout/os.hpp>
 #include <stout/path.hpp>
+#include <stout/stopwatch.hpp>
 #include <stout/try.hpp>
 
 #include "master/master.hpp"
@@ -53,15 +58,20 @@
 
 using namespace process;
 
+using std::cout;
+using std::endl;
 using std::string;
 using std::vector;
 
 using testing::_;
 using testing::Return;
+using testing::WithParamInterface;
 
 using mesos::internal::master::Master;
 
 using mesos::internal::slave::DiskUsageCollector;
+using mesos::internal::slave::DiskUsageWalker;
+using mesos::internal::slave::DiskUsageWatcher;
 using mesos::internal::slave::Fetcher;
 using mesos::internal::slave::MesosContainerizer;
 using mesos::internal::slave::Slave;
@@ -176,6 +186,219 @@ TEST_F(DiskUsageCollectorTest, ExcludeRelativePath)
 #endif
 
 
+// This test verifies that the in-process walker collects the usage
+// of a directory, including the changes since the previous walk.
+TEST_F(DiskUsageCollectorTest, NativeUsage)
+{
+  string dir = path::join(os::getcwd(), "dir");
+  string file1 = path::join(os::getcwd(), "file1");
+  string file2 = path::join(dir, "file2");
+  string file3 = path::join(dir, "file3");
+
+  ASSERT_SOME(os::mkdir(dir));
+
+  ASSERT_SOME(os::write(file1, string(Kilobytes(64).bytes(), 'x')));
+  ASSERT_SOME(os::write(file2, string(Kilobytes(64).bytes(), 'y')));
+
+  DiskUsageWalker::Options options;
+  options.threads = 2;
+
+  DiskUsageCollector collector(Milliseconds(1), options);
+
+  Future<Bytes> usage = collector.usage(os::getcwd(), {});
+  AWAIT_READY(usage);
+  EXPECT_GE(usage.get(), Kilobytes(128));
+  EXPECT_LT(usage.get(), Kilobytes(192));
+
+  // Add a file to the subdirectory.
+  ASSERT_SOME(os::write(file3, string(Kilobytes(64).bytes(), 'z')));
+
+  usage = collector.usage(os::getcwd(), {});
+  AWAIT_READY(usage);
+  EXPECT_GE(usage.get(), Kilobytes(192));
+
+  // Remove the subdirectory.
+  ASSERT_SOME(os::rmdir(dir));
+
+  usage = collector.usage(os::getcwd(), {});
+  AWAIT_READY(usage);
+  EXPECT_GE(usage.get(), Kilobytes(64));
+  EXPECT_LT(usage.get(), Kilobytes(128));
+
+  // Exclude 'file1' and make sure the usage is way below 64k.
+  usage = collector.usage(os::getcwd(), {"file1"});
+  AWAIT_READY(usage);
+  EXPECT_LT(usage.get(), Kilobytes(64));
+}
+
+
+// This test verifies that the in-process walker counts a hard linked
+// file once, even if it is linked from several directories.
+TEST_F(DiskUsageCollectorTest, NativeUsageHardLinks)
+{
+  string dir = path::join(os::getcwd(), "dir");
+  string file = path::join(os::getcwd(), "file");
+
+  ASSERT_SOME(os::mkdir(dir));
+  ASSERT_SOME(os::write(file, string(Kilobytes(64).bytes(), 'x')));
+
+  ASSERT_EQ(0, ::link(file.c_str(), path::join(dir, "link1").c_str()));
+  ASSERT_EQ(0, ::link(file.c_str(), path::join(dir, "link2").c_str()));
+
+  DiskUsageWalker::Options options;
+  options.threads = 2;
+
+  DiskUsageWalker walker(os::getcwd(), options);
+
+  Try<Bytes> usage = walker.walk({});
+  ASSERT_SOME(usage);
+  EXPECT_GE(usage.get(), Kilobytes(64));
+  EXPECT_LT(usage.get(), Kilobytes(128));
+
+  // The file is still counted once after the original is removed.
+  ASSERT_SOME(os::rm(file));
+
+  usage = walker.walk({});
+  ASSERT_SOME(usage);
+  EXPECT_GE(usage.get(), Kilobytes(64));
+  EXPECT_LT(usage.get(), Kilobytes(128));
+}
+
+
+// This test verifies that the in-process walkers sharing an inotify
+// instance each notice the changes to their own path.
+TEST_F(DiskUsageCollectorTest, NativeUsageSharedWatcher)
+{
+  string dir1 = path::join(os::getcwd(), "dir1");
+  string dir2 = path::join(os::getcwd(), "dir2");
+
+  ASSERT_SOME(os::mkdir(path::join(dir1, "subdir")));
+  ASSERT_SOME(os::mkdir(path::join(dir2, "subdir")));
+
+  DiskUsageWalker::Options options;
+  options.threads = 2;
+
+  std::shared_ptr<DiskUsageWatcher> watcher =
+    DiskUsageWalker::createWatcher();
+
+  DiskUsageWalker walker1(dir1, options, watcher);
+  DiskUsageWalker walker2(dir2, options, watcher);
+
+  ASSERT_SOME(walker1.walk({}));
+
+  Try<Bytes> usage2 = walker2.walk({});
+  ASSERT_SOME(usage2);
+  EXPECT_LT(usage2.get(), Kilobytes(64));
+
+  // Add a file under the second path, whose change is read by the
+  // walk of the first path.
+  ASSERT_SOME(os::write(
+      path::join(dir2, "subdir", "file"),
+      string(Kilobytes(64).bytes(), 'x')));
+
+  Try<Bytes> usage1 = walker1.walk({});
+  ASSERT_SOME(usage1);
+  EXPECT_LT(usage1.get(), Kilobytes(64));
+
+  usage2 = walker2.walk({});
+  ASSERT_SOME(usage2);
+  EXPECT_GE(usage2.get(), Kilobytes(64));
+}
+
+
+// This test verifies that the in-process walker does not stat more
+// entries per second than its budget.
+TEST_F(DiskUsageCollectorTest, NativeUsageBudget)
+{
+  for (int i = 0; i < 25; i++) {
+    ASSERT_SOME(os::write(path::join(os::getcwd(), stringify(i)), "x"));
+  }
+
+  DiskUsageWalker::Options options;
+  options.threads = 2;
+  options.budget = 10;
+  options.incremental = false;
+
+  DiskUsageWalker walker(os::getcwd(), options);
+
+  Stopwatch watch;
+  watch.start();
+
+  Try<Bytes> usage = walker.walk({});
+  ASSERT_SOME(usage);
+  EXPECT_GT(usage.get(), Bytes(0));
+
+  // The 25 entries take at least 2 seconds at 10 entries per second.
+  EXPECT_GE(watch.elapsed(), Seconds(2));
+}
+
+
+class DiskUsageCollector_BENCHMARK_Test
+  : public TemporaryDirectoryTest,
+    public WithParamInterface<size_t> {};
+
+
+// The disk usage benchmark is parameterized by the number of files,
+// which are spread over directories of 100 files each.
+INSTANTIATE_TEST_CASE_P(
+    Files,
+    DiskUsageCollector_BENCHMARK_Test,
+    ::testing::Values(1000U, 10000U, 100000U));
+
+
+// Measures the time to collect the disk usage of a directory with 'du'
+// and with the in-process walker. The second collection follows the
+// change of a single file, which the walker only rescans the directory
+// of when it watches the directories.
+// NOTE: The directory is in the page cache after it is created, hence
+// this does not account for the latency of the disk.
+TEST_P(DiskUsageCollector_BENCHMARK_Test, Usage)
+{
+  const size_t files = GetParam();
+
+  for (size_t i = 0; i < files; i++) {
+    const string dir = path::join(os::getcwd(), "dir" + stringify(i / 100));
+
+    if (i % 100 == 0) {
+      ASSERT_SOME(os::mkdir(dir));
+    }
+
+    ASSERT_SOME(os::write(path::join(dir, stringify(i)), "x"));
+  }
+
+  DiskUsageWalker::Options options;
+  options.threads = slave::DEFAULT_CONTAINER_DISK_USAGE_THREADS;
+
+  DiskUsageWalker::Options full = options;
+  full.incremental = false;
+
+  DiskUsageCollector du(Milliseconds(1));
+  DiskUsageCollector native(Milliseconds(1), full);
+  DiskUsageCollector incremental(Milliseconds(1), options);
+
+  const vector<std::pair<string, DiskUsageCollector*>> collectors = {
+    {"'du'", &du},
+    {"the walker", &native},
+    {"the incremental walker", &incremental}
+  };
+
+  for (int i = 0; i < 2; i++) {
+    foreach (const auto& collector, collectors) {
+      Stopwatch watch;
+      watch.start();
+
+      Future<Bytes> usage = collector.second->usage(os::getcwd(), {});
+      AWAIT_READY_FOR(usage, Minutes(5));
+
+      cout << "Collected the usage of " << files << " files with "
+           << collector.first << " in " << watch.elapsed() << endl;
+    }
+
+    ASSERT_SOME(os::write(path::join(os::getcwd(), "dir0", "0"), "xx"));
+  }
+}
+
+
 class DiskQuotaTest : public MesosTest {};
 
 
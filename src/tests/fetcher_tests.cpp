@@ -18,11 +18,14 @@
 #include <unistd.h>
 #endif // __WINDOWS__
 
+#include <list>
 #include <map>
 #include <string>
+#include <vector>
 
 #include <hdfs/hdfs.hpp>
 
+#include <process/collect.hpp>
 #include <process/future.hpp>
 #include <process/gmock.hpp>
 #include <process/gtest.hpp>
@@ -63,8 +66,12 @@ using mesos::internal::slave::Fetcher;
 using process::Subprocess;
 using process::Future;
 
+using std::list;
 using std::map;
 using std::string;
+using std::vector;
+
+using testing::DoAll;
 
 
 namespace mesos {
@@ -268,6 +275,141 @@ TEST_F(FetcherTest, LogFailureToStderr)
 }
 
 
+// Tests that the agent fetches the URIs of several containers itself
+// when `--fetcher_threads` is set, including duplicate cached URIs and
+// archives, and logs the results to the sandboxes.
+TEST_F_TEMP_DISABLED_ON_WINDOWS(FetcherTest, InProcessFetch)
+{
+  string fromDir = path::join(os::getcwd(), "from");
+  ASSERT_SOME(os::mkdir(fromDir));
+
+  string testFile = path::join(fromDir, "test");
+  ASSERT_SOME(os::write(testFile, "data"));
+
+  string archiveFile = path::join(fromDir, "archive");
+  ASSERT_SOME(os::write(archiveFile, "hello tar"));
+  ASSERT_SOME(os::shell(
+      "tar cf '" + archiveFile + ".tar' -C '" + fromDir + "' archive 2>&1"));
+
+  CommandInfo commandInfo;
+  commandInfo.add_uris()->set_value(uri::from_path(testFile));
+  commandInfo.add_uris()->set_value(uri::from_path(testFile));
+  commandInfo.add_uris()->set_value(uri::from_path(archiveFile + ".tar"));
+
+  commandInfo.mutable_uris(0)->set_cache(true);
+  commandInfo.mutable_uris(1)->set_cache(true);
+  commandInfo.mutable_uris(0)->set_output_file("one");
+  commandInfo.mutable_uris(1)->set_output_file("two");
+  commandInfo.mutable_uris(2)->set_extract(true);
+
+  slave::Flags flags = CreateSlaveFlags();
+  flags.fetcher_threads = 2;
+
+  Fetcher fetcher(flags);
+
+  vector<string> sandboxes;
+  vector<Future<Nothing>> fetches;
+
+  for (int i = 0; i < 2; i++) {
+    const string sandbox = path::join(os::getcwd(), "sandbox" + stringify(i));
+    ASSERT_SOME(os::mkdir(sandbox));
+
+    ContainerID containerId;
+    containerId.set_value(id::UUID::random().toString());
+
+    sandboxes.push_back(sandbox);
+    fetches.push_back(fetcher.fetch(containerId, commandInfo, sandbox, None()));
+  }
+
+  AWAIT_READY(collect(fetches));
+
+  foreach (const string& sandbox, sandboxes) {
+    EXPECT_SOME_EQ("data", os::read(path::join(sandbox, "one")));
+    EXPECT_SOME_EQ("data", os::read(path::join(sandbox, "two")));
+    EXPECT_SOME_EQ("hello tar", os::read(path::join(sandbox, "archive")));
+
+    // The agent logged the results to the sandbox.
+    Try<string> stderrContent = os::read(path::join(sandbox, "stderr"));
+    ASSERT_SOME(stderrContent);
+    EXPECT_TRUE(strings::contains(
+        stderrContent.get(), "Successfully fetched all URIs into"));
+  }
+
+  verifyMetrics(2, 0);
+
+  // Both containers share the single cache file of the duplicate URIs.
+  JSON::Object metrics = Metrics();
+  EXPECT_SOME_EQ(
+    os::stat::size(testFile)->bytes(),
+    metrics.at<JSON::Number>("containerizer/fetcher/cache_size_used_bytes"));
+}
+
+
+// Tests that a cache file which has been evicted from the fetcher cache
+// is restored from the blob store rather than downloaded again.
+TEST_F_TEMP_DISABLED_ON_WINDOWS(FetcherTest, RestoreEvictedCacheFile)
+{
+  string fromDir = path::join(os::getcwd(), "from");
+  ASSERT_SOME(os::mkdir(fromDir));
+
+  string testFile1 = path::join(fromDir, "test1");
+  ASSERT_SOME(os::write(testFile1, "data1"));
+
+  string testFile2 = path::join(fromDir, "test2");
+  ASSERT_SOME(os::write(testFile2, "data2"));
+
+  const string blobDir = path::join(os::getcwd(), "blobs");
+
+  slave::Flags flags = CreateSlaveFlags();
+  flags.fetcher_cache_size = Bytes(8);
+  flags.blob_store_dir = blobDir;
+  flags.blob_store_capacity = Megabytes(1);
+
+  Fetcher fetcher(flags);
+
+  auto fetch = [&](const string& file, const string& sandbox) {
+    ASSERT_SOME(os::mkdir(sandbox));
+
+    ContainerID containerId;
+    containerId.set_value(id::UUID::random().toString());
+
+    CommandInfo commandInfo;
+    commandInfo.add_uris()->set_value(uri::from_path(file));
+    commandInfo.mutable_uris(0)->set_cache(true);
+    commandInfo.mutable_uris(0)->set_output_file("test");
+
+    AWAIT_READY(fetcher.fetch(containerId, commandInfo, sandbox, None()));
+  };
+
+  fetch(testFile1, path::join(os::getcwd(), "sandbox1"));
+
+  // Wait for the cache file to be added to the blob store.
+  Duration waited = Duration::zero();
+  do {
+    Try<list<string>> blobs = os::ls(path::join(blobDir, "sha256"));
+    if (blobs.isSome() && !blobs->empty()) {
+      break;
+    }
+
+    os::sleep(Milliseconds(10));
+    waited += Milliseconds(10);
+  } while (waited < Seconds(15));
+
+  ASSERT_LT(waited, Seconds(15));
+
+  // The second cache file evicts the first one, whose source is gone
+  // by the time it is fetched again.
+  fetch(testFile2, path::join(os::getcwd(), "sandbox2"));
+  ASSERT_SOME(os::rm(testFile1));
+
+  const string sandbox = path::join(os::getcwd(), "sandbox3");
+  fetch(testFile1, sandbox);
+
+  EXPECT_SOME_EQ("data1", os::read(path::join(sandbox, "test")));
+
+  verifyMetrics(3, 0);
+}
+
 // TODO(coffler): Test uses os::getuid(), which does not exist on Windows.
 //     Disable test until privilege model is worked out on Windows.
 #ifndef __WINDOWS__
@@ -630,6 +772,74 @@ TEST_F(FetcherTest, OSNetUriTest)
 }
 
 
+// Tests that killing a container cancels the URI which is being fetched
+// for it within the agent, and that the thread of the fetch is freed
+// for the URIs of other containers.
+TEST_F_TEMP_DISABLED_ON_WINDOWS(FetcherTest, InProcessFetchKill)
+{
+  Http http;
+
+  const network::inet::Address& address = http.process->self().address;
+
+  process::http::URL url(
+      "http",
+      address.ip,
+      address.port,
+      strings::join("/", http.process->self().id, "test"));
+
+  // The server never responds to the download of the first container.
+  Promise<http::Response> response;
+  Future<Nothing> request;
+
+  EXPECT_CALL(*http.process, test(_))
+    .WillOnce(DoAll(FutureSatisfy(&request), Return(response.future())));
+
+  string testFile = path::join(os::getcwd(), "test");
+  ASSERT_SOME(os::write(testFile, "data"));
+
+  slave::Flags flags = CreateSlaveFlags();
+  flags.fetcher_threads = 1;
+
+  Fetcher fetcher(flags);
+
+  ContainerID containerId1;
+  containerId1.set_value(id::UUID::random().toString());
+
+  CommandInfo commandInfo1;
+  commandInfo1.add_uris()->set_value(stringify(url));
+
+  const string sandbox1 = path::join(os::getcwd(), "sandbox1");
+  ASSERT_SOME(os::mkdir(sandbox1));
+
+  Future<Nothing> fetch1 =
+    fetcher.fetch(containerId1, commandInfo1, sandbox1, None());
+
+  AWAIT_READY(request);
+
+  // The second container waits for the only thread of the fetcher.
+  ContainerID containerId2;
+  containerId2.set_value(id::UUID::random().toString());
+
+  CommandInfo commandInfo2;
+  commandInfo2.add_uris()->set_value(uri::from_path(testFile));
+
+  const string sandbox2 = path::join(os::getcwd(), "sandbox2");
+  ASSERT_SOME(os::mkdir(sandbox2));
+
+  Future<Nothing> fetch2 =
+    fetcher.fetch(containerId2, commandInfo2, sandbox2, None());
+
+  fetcher.kill(containerId1);
+
+  AWAIT_FAILED(fetch1);
+
+  // The thread is freed once the download has been aborted.
+  AWAIT_READY(fetch2);
+  EXPECT_SOME_EQ("data", os::read(path::join(sandbox2, "test")));
+
+  response.set(http::OK());
+}
+
 // Tests whether fetcher can process URIs that contain leading whitespace
 // characters. This was added as a verification for MESOS-2862.
 //
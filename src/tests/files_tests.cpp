@@ -14,6 +14,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <limits>
 #include <string>
 
 #include <gmock/gmock.h>
@@ -535,6 +536,135 @@ TEST_F(FilesTest, DownloadTest)
 }
 
 
+// Tests that a range of a file can be downloaded, or read as raw bytes,
+// with the `Range` header or the `offset` and `length` parameters.
+TEST_F(FilesTest, RangeTest)
+{
+  Files files;
+  process::UPID upid("files", process::address());
+
+  ASSERT_SOME(os::write("file", "0123456789"));
+  AWAIT_EXPECT_READY(files.attach("file", "file"));
+
+  process::http::Headers headers;
+  headers["Range"] = "bytes=2-5";
+
+  Future<Response> response =
+    process::http::get(upid, "download", "path=file", headers);
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      process::http::Status::string(
+          process::http::Status::PARTIAL_CONTENT),
+      response);
+  AWAIT_EXPECT_RESPONSE_HEADER_EQ("bytes 2-5/10", "Content-Range", response);
+  AWAIT_EXPECT_RESPONSE_BODY_EQ("2345", response);
+
+  // The last bytes of the file.
+  headers["Range"] = "bytes=-3";
+
+  response = process::http::get(upid, "download", "path=file", headers);
+
+  AWAIT_EXPECT_RESPONSE_HEADER_EQ("bytes 7-9/10", "Content-Range", response);
+  AWAIT_EXPECT_RESPONSE_BODY_EQ("789", response);
+
+  headers["Range"] = "bytes=10-";
+
+  response = process::http::get(upid, "download", "path=file", headers);
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      process::http::Status::string(
+          process::http::Status::REQUESTED_RANGE_NOT_SATISFIABLE),
+      response);
+  AWAIT_EXPECT_RESPONSE_HEADER_EQ("bytes */10", "Content-Range", response);
+
+  // Multiple ranges are not supported, hence the whole file is sent.
+  headers["Range"] = "bytes=0-1,4-5";
+
+  response = process::http::get(upid, "download", "path=file", headers);
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response);
+  AWAIT_EXPECT_RESPONSE_BODY_EQ("0123456789", response);
+
+  response = process::http::get(
+      upid, "read", "path=file&raw=true&offset=4&length=3");
+
+  AWAIT_EXPECT_RESPONSE_HEADER_EQ("bytes 4-6/10", "Content-Range", response);
+  AWAIT_EXPECT_RESPONSE_BODY_EQ("456", response);
+
+  response = process::http::get(upid, "read", "path=file&raw=true&offset=8");
+
+  AWAIT_EXPECT_RESPONSE_HEADER_EQ("bytes 8-9/10", "Content-Range", response);
+  AWAIT_EXPECT_RESPONSE_BODY_EQ("89", response);
+
+  // The range of a length past the end of the file is capped.
+  response = process::http::get(
+      upid,
+      "read",
+      "path=file&raw=true&offset=4&length=" +
+        stringify(std::numeric_limits<ssize_t>::max()));
+
+  AWAIT_EXPECT_RESPONSE_HEADER_EQ("bytes 4-9/10", "Content-Range", response);
+  AWAIT_EXPECT_RESPONSE_BODY_EQ("456789", response);
+
+  response = process::http::get(upid, "read", "path=file&raw=true&offset=-1");
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(BadRequest().status, response);
+}
+
+
+#ifdef __linux__
+// Tests that a read at the end of a file waits for data to be appended.
+TEST_F(FilesTest, ReadWaitTest)
+{
+  Files files;
+  process::UPID upid("files", process::address());
+
+  ASSERT_SOME(os::write("file", "body"));
+  AWAIT_EXPECT_READY(files.attach("file", "file"));
+
+  // Nothing is appended within the wait.
+  Future<Response> response = process::http::get(
+      upid, "read", "path=file&raw=true&offset=4&wait=10ms");
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      process::http::Status::string(
+          process::http::Status::REQUESTED_RANGE_NOT_SATISFIABLE),
+      response);
+
+  response = process::http::get(
+      upid, "read", "path=file&raw=true&offset=4&wait=1mins");
+
+  // The read is pending until data is appended.
+  os::sleep(Milliseconds(100));
+  EXPECT_TRUE(response.isPending());
+
+  Try<int_fd> fd = os::open("file", O_WRONLY | O_APPEND | O_CLOEXEC);
+  ASSERT_SOME(fd);
+
+  ASSERT_SOME(os::write(fd.get(), " appended"));
+
+  AWAIT_EXPECT_RESPONSE_HEADER_EQ("bytes 4-12/13", "Content-Range", response);
+  AWAIT_EXPECT_RESPONSE_BODY_EQ(" appended", response);
+
+  // The JSON reads wait as well.
+  response = process::http::get(
+      upid, "read", "path=file&offset=13&wait=1mins");
+
+  os::sleep(Milliseconds(100));
+  EXPECT_TRUE(response.isPending());
+
+  ASSERT_SOME(os::write(fd.get(), " again"));
+  ASSERT_SOME(os::close(fd.get()));
+
+  JSON::Object expected;
+  expected.values["offset"] = 13;
+  expected.values["data"] = " again";
+
+  AWAIT_EXPECT_RESPONSE_BODY_EQ(stringify(expected), response);
+}
+#endif // __linux__
+
+
 // Tests that the '/files/debug' endpoint works as expected.
 TEST_F(FilesTest, DebugTest)
 {
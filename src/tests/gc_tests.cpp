@@ -41,10 +41,13 @@
 #include <process/timeout.hpp>
 
 #include <stout/duration.hpp>
+#include <stout/fs.hpp>
 #include <stout/gtest.hpp>
 #include <stout/nothing.hpp>
 #include <stout/os.hpp>
 #include <stout/path.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
 
 #include <stout/os/realpath.hpp>
 
@@ -302,6 +305,97 @@ TEST_F(GarbageCollectorTest, Prune)
 }
 
 
+#ifndef __WINDOWS__
+// This test verifies that the garbage collector removes a directory
+// tree with a number of threads, without following the symbolic links
+// or removing the other links of the files, and reports the progress.
+TEST_F(GarbageCollectorTest, ParallelRemoval)
+{
+  GarbageCollector gc("work_dir", 4);
+
+  const string outside = path::join(os::getcwd(), "outside");
+  ASSERT_SOME(os::mkdir(outside));
+  ASSERT_SOME(os::write(path::join(outside, "file"), "outside"));
+
+  const string sandbox = path::join(os::getcwd(), "sandbox");
+  ASSERT_SOME(os::mkdir(path::join(sandbox, "a", "b")));
+  ASSERT_SOME(os::mkdir(path::join(sandbox, "c")));
+
+  ASSERT_SOME(os::write(path::join(sandbox, "a", "1"), "1"));
+  ASSERT_SOME(os::write(path::join(sandbox, "a", "2"), "2"));
+  ASSERT_SOME(os::write(path::join(sandbox, "a", "b", "3"), "3"));
+  ASSERT_SOME(os::write(path::join(sandbox, "c", "4"), "4"));
+  ASSERT_SOME(::fs::symlink(outside, path::join(sandbox, "link")));
+  ASSERT_EQ(0, ::link(
+      path::join(sandbox, "a", "1").c_str(),
+      path::join(outside, "1").c_str()));
+
+  AWAIT_READY(gc.schedule(Seconds(0), sandbox));
+
+  EXPECT_FALSE(os::exists(sandbox));
+
+  EXPECT_SOME_EQ("outside", os::read(path::join(outside, "file")));
+  EXPECT_SOME_EQ("1", os::read(path::join(outside, "1")));
+
+  JSON::Object metrics = Metrics();
+
+  // The 4 directories, 4 files and the symbolic link.
+  EXPECT_SOME_EQ(
+      9u,
+      metrics.at<JSON::Number>("gc/inodes_removed"));
+  EXPECT_SOME_EQ(
+      1u,
+      metrics.at<JSON::Number>("gc/path_removals_succeeded"));
+}
+
+
+// This test verifies that the garbage collector removes the inodes
+// within its budget, and keeps serving requests while the removal
+// waits for the budget.
+TEST_F(GarbageCollectorTest, RemovalBudget)
+{
+  // Up to 10 inodes are removed per second, after a burst of 10.
+  GarbageCollector gc("work_dir", 1, 10u, None());
+
+  const string sandbox = path::join(os::getcwd(), "sandbox");
+  ASSERT_SOME(os::mkdir(sandbox));
+
+  // The directory and the 29 files take at least 2 seconds to remove.
+  for (int i = 0; i < 29; i++) {
+    ASSERT_SOME(os::touch(path::join(sandbox, stringify(i))));
+  }
+
+  const string file = "file";
+  ASSERT_SOME(os::touch(file));
+
+  Future<Nothing> scheduleFile = gc.schedule(Hours(1), file);
+
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  Future<Nothing> scheduleSandbox = gc.schedule(Seconds(0), sandbox);
+
+  AWAIT_TRUE(gc.unschedule(file));
+  AWAIT_DISCARDED(scheduleFile);
+
+  EXPECT_TRUE(scheduleSandbox.isPending());
+
+  AWAIT_READY_FOR(scheduleSandbox, Seconds(15));
+
+  EXPECT_LE(Seconds(1), stopwatch.elapsed());
+
+  EXPECT_FALSE(os::exists(sandbox));
+  EXPECT_TRUE(os::exists(file));
+
+  JSON::Object metrics = Metrics();
+
+  EXPECT_SOME_EQ(
+      30u,
+      metrics.at<JSON::Number>("gc/inodes_removed"));
+}
+#endif // __WINDOWS__
+
+
 class GarbageCollectorIntegrationTest : public MesosTest {};
 
 
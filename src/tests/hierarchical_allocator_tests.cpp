@@ -442,6 +442,60 @@ TEST_F(HierarchicalAllocatorTest, UnreservedDRF)
 }
 
 
+// This test ensures that agents added in a batch via `addSlaves()` are
+// allocated together, and that an agent added via `addSlave()` (which
+// the allocator wrapper may defer to coalesce it with other additions)
+// is always added before subsequent calls are processed.
+TEST_F(HierarchicalAllocatorTest, AddSlaves)
+{
+  Clock::pause();
+
+  initialize();
+
+  FrameworkInfo framework = createFrameworkInfo({"role1"});
+  allocator->addFramework(framework.id(), framework, {}, true, {});
+
+  // The removal must be processed after the (possibly deferred)
+  // addition, otherwise the allocator would crash.
+  SlaveInfo slave1 = createSlaveInfo("cpus:1;mem:512;disk:0");
+  allocator->addSlave(
+      slave1.id(),
+      slave1,
+      AGENT_CAPABILITIES(),
+      None(),
+      slave1.resources(),
+      {});
+
+  allocator->removeSlave(slave1.id());
+
+  SlaveInfo slave2 = createSlaveInfo("cpus:2;mem:1024;disk:0");
+  SlaveInfo slave3 = createSlaveInfo("cpus:3;mem:2048;disk:0");
+
+  vector<mesos::allocator::SlaveAddition> additions;
+
+  const vector<SlaveInfo> slaves = {slave2, slave3};
+
+  foreach (const SlaveInfo& slave, slaves) {
+    mesos::allocator::SlaveAddition addition;
+    addition.slaveId = slave.id();
+    addition.slaveInfo = slave;
+    addition.capabilities = AGENT_CAPABILITIES();
+    addition.total = slave.resources();
+
+    additions.push_back(addition);
+  }
+
+  allocator->addSlaves(additions);
+
+  Allocation expected = Allocation(
+      framework.id(),
+      {{"role1", {{slave2.id(), slave2.resources()},
+                  {slave3.id(), slave3.resources()}}}});
+
+  AWAIT_EXPECT_EQ(expected, allocations.get());
+}
+
+
 // This test ensures that reserved resources do affect the sharing across roles.
 TEST_F(HierarchicalAllocatorTest, ReservedDRF)
 {
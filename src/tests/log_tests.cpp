@@ -48,10 +48,12 @@
 #include "log/coordinator.hpp"
 #include "log/leveldb.hpp"
 #include "log/network.hpp"
+#include "log/segment.hpp"
 #include "log/storage.hpp"
 #include "log/recover.hpp"
 #include "log/replica.hpp"
 #include "log/tool/initialize.hpp"
+#include "log/tool/migrate.hpp"
 
 #include "tests/environment.hpp"
 #include "tests/mesos.hpp"
@@ -65,6 +67,8 @@ using namespace mesos::internal::log;
 
 using namespace process;
 
+using std::cout;
+using std::endl;
 using std::list;
 using std::set;
 using std::string;
@@ -133,7 +137,7 @@ template <typename T>
 class LogStorageTest : public TemporaryDirectoryTest {};
 
 
-typedef ::testing::Types<LevelDBStorage> LogStorageTypes;
+typedef ::testing::Types<LevelDBStorage, SegmentStorage> LogStorageTypes;
 
 
 TYPED_TEST_CASE(LogStorageTest, LogStorageTypes);
@@ -469,6 +473,391 @@ TYPED_TEST(LogStorageTest, OverflowTruncate)
   }
 }
 
+TYPED_TEST(LogStorageTest, Restore)
+{
+  const string path = os::getcwd() + "/.log";
+
+  {
+    TypeParam storage;
+
+    Try<Storage::State> state = storage.restore(path);
+    ASSERT_SOME(state);
+
+    Metadata metadata;
+    metadata.set_status(Metadata::VOTING);
+    metadata.set_promised(2);
+
+    ASSERT_SOME(storage.persist(metadata));
+
+    // Learn positions 0 to 4, leave position 5 unlearned and write
+    // position 7 (i.e., position 6 is a hole).
+    for (uint64_t i = 0; i < 8; i++) {
+      if (i == 6) {
+        continue;
+      }
+
+      Action action;
+      action.set_position(i);
+      action.set_promised(1);
+      action.set_performed(1);
+      action.set_learned(i < 5);
+      action.set_type(Action::APPEND);
+      action.mutable_append()->set_bytes(stringify(i));
+
+      ASSERT_SOME(storage.persist(action));
+    }
+
+    // Learn position 7 (i.e., overwrite it).
+    Action action;
+    action.set_position(7);
+    action.set_promised(1);
+    action.set_performed(1);
+    action.set_learned(true);
+    action.set_type(Action::APPEND);
+    action.mutable_append()->set_bytes("7");
+
+    ASSERT_SOME(storage.persist(action));
+
+    // Truncate to position 2 (at position 8).
+    Action truncate;
+    truncate.set_position(8);
+    truncate.set_promised(1);
+    truncate.set_performed(1);
+    truncate.set_learned(true);
+    truncate.set_type(Action::TRUNCATE);
+    truncate.mutable_truncate()->set_to(2);
+
+    ASSERT_SOME(storage.persist(truncate));
+  }
+
+  TypeParam storage;
+
+  Try<Storage::State> state = storage.restore(path);
+  ASSERT_SOME(state);
+
+  EXPECT_EQ(Metadata::VOTING, state->metadata.status());
+  EXPECT_EQ(2u, state->metadata.promised());
+  EXPECT_EQ(2u, state->begin);
+  EXPECT_EQ(8u, state->end);
+
+  EXPECT_TRUE(state->learned.contains(
+      (Bound<uint64_t>::closed(2), Bound<uint64_t>::closed(4))));
+  EXPECT_TRUE(state->learned.contains(7));
+  EXPECT_TRUE(state->learned.contains(8));
+  EXPECT_FALSE(state->learned.contains(5));
+  EXPECT_FALSE(state->learned.contains(6));
+
+  EXPECT_TRUE(state->unlearned.contains(5));
+  EXPECT_FALSE(state->unlearned.contains(7));
+
+  EXPECT_ERROR(storage.read(1));
+  EXPECT_ERROR(storage.read(6));
+
+  for (uint64_t i = 2; i < 8; i++) {
+    if (i == 6) {
+      continue;
+    }
+
+    Try<Action> action = storage.read(i);
+    ASSERT_SOME(action);
+
+    EXPECT_EQ(i, action->position());
+    EXPECT_EQ(i != 5, action->learned());
+    EXPECT_EQ(stringify(i), action->append().bytes());
+  }
+}
+
+
+// Measures persisting and then reading back the positions of a log
+// with each storage.
+TYPED_TEST(LogStorageTest, BENCHMARK_PersistRead)
+{
+  const size_t positions = 5000;
+  const string bytes(1024, 'x');
+
+  TypeParam storage;
+
+  Try<Storage::State> state = storage.restore(os::getcwd() + "/.log");
+  ASSERT_SOME(state);
+
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  for (uint64_t i = 0; i < positions; i++) {
+    Action action;
+    action.set_position(i);
+    action.set_promised(1);
+    action.set_performed(1);
+    action.set_learned(true);
+    action.set_type(Action::APPEND);
+    action.mutable_append()->set_bytes(bytes);
+
+    ASSERT_SOME(storage.persist(action));
+  }
+
+  cout << "Persisted " << positions << " positions in "
+       << stopwatch.elapsed() << endl;
+
+  stopwatch.start();
+
+  for (uint64_t i = 0; i < positions; i++) {
+    ASSERT_SOME(storage.read(i));
+  }
+
+  cout << "Read " << positions << " positions in "
+       << stopwatch.elapsed() << endl;
+}
+
+
+class SegmentStorageTest : public TemporaryDirectoryTest {};
+
+
+// This test verifies that the segment storage starts new segments
+// when the active one is full, and deletes the segments that only
+// hold truncated positions.
+TEST_F(SegmentStorageTest, RollAndTruncate)
+{
+  const string path = os::getcwd() + "/.log";
+
+  auto segments = [&path]() -> size_t {
+    Try<list<string>> entries = os::ls(path);
+    CHECK_SOME(entries);
+
+    size_t count = 0;
+    foreach (const string& entry, entries.get()) {
+      if (strings::endsWith(entry, ".segment")) {
+        count++;
+      }
+    }
+
+    return count;
+  };
+
+  {
+    // Every segment only fits a few records.
+    SegmentStorage storage(Bytes(256));
+
+    ASSERT_SOME(storage.restore(path));
+
+    for (uint64_t i = 0; i < 20; i++) {
+      Action action;
+      action.set_position(i);
+      action.set_promised(1);
+      action.set_performed(1);
+      action.set_learned(true);
+      action.set_type(Action::APPEND);
+      action.mutable_append()->set_bytes(string(64, 'a' + i));
+
+      ASSERT_SOME(storage.persist(action));
+    }
+
+    const size_t before = segments();
+    EXPECT_LT(1u, before);
+
+    // Truncate to position 15 (at position 20).
+    Action truncate;
+    truncate.set_position(20);
+    truncate.set_promised(1);
+    truncate.set_performed(1);
+    truncate.set_learned(true);
+    truncate.set_type(Action::TRUNCATE);
+    truncate.mutable_truncate()->set_to(15);
+
+    ASSERT_SOME(storage.persist(truncate));
+
+    EXPECT_GT(before, segments());
+
+    for (uint64_t i = 0; i < 20; i++) {
+      Try<Action> action = storage.read(i);
+
+      if (i < 15) {
+        EXPECT_ERROR(action);
+      } else {
+        ASSERT_SOME(action);
+        EXPECT_EQ(string(64, 'a' + i), action->append().bytes());
+      }
+    }
+  }
+
+  // A segment size which is larger than the existing segments should
+  // not affect the restore.
+  SegmentStorage storage(Megabytes(1));
+
+  Try<Storage::State> state = storage.restore(path);
+  ASSERT_SOME(state);
+
+  EXPECT_EQ(15u, state->begin);
+  EXPECT_EQ(20u, state->end);
+  EXPECT_FALSE(state->learned.contains(14));
+  EXPECT_TRUE(state->learned.contains(
+      (Bound<uint64_t>::closed(15), Bound<uint64_t>::closed(20))));
+
+  EXPECT_ERROR(storage.read(14));
+  ASSERT_SOME(storage.read(15));
+}
+
+
+// This test verifies that a record which was only partially written
+// when the replica crashed is discarded on restore.
+TEST_F(SegmentStorageTest, PartialRecord)
+{
+  const string path = os::getcwd() + "/.log";
+
+  {
+    SegmentStorage storage;
+
+    ASSERT_SOME(storage.restore(path));
+
+    Action action;
+    action.set_position(0);
+    action.set_promised(1);
+    action.set_performed(1);
+    action.set_learned(true);
+    action.set_type(Action::APPEND);
+    action.mutable_append()->set_bytes("hello");
+
+    ASSERT_SOME(storage.persist(action));
+  }
+
+  // Simulate a crash while appending a record by writing the header
+  // of a record which never made it to disk after the first record.
+  const string segment = path::join(path, "00000000000000000000.segment");
+
+  Try<string> data = os::read(segment);
+  ASSERT_SOME(data);
+
+  uint32_t length;
+  memcpy(&length, data->data(), sizeof(length));
+
+  const size_t tail = 2 * sizeof(uint32_t) + length;
+
+  Try<int_fd> fd = os::open(segment, O_WRONLY | O_CLOEXEC);
+  ASSERT_SOME(fd);
+
+  // The partially written record is longer than the one appended
+  // after the restore.
+  uint32_t header[2] = {100, 42};
+  ASSERT_EQ(
+      static_cast<ssize_t>(sizeof(header)),
+      ::pwrite(fd.get(), header, sizeof(header), tail));
+
+  const string garbage(100, '\xff');
+  ASSERT_EQ(
+      static_cast<ssize_t>(garbage.size()),
+      ::pwrite(
+          fd.get(), garbage.data(), garbage.size(), tail + sizeof(header)));
+
+  ASSERT_SOME(os::close(fd.get()));
+
+  SegmentStorage storage;
+
+  Try<Storage::State> state = storage.restore(path);
+  ASSERT_SOME(state);
+
+  EXPECT_TRUE(state->learned.contains(0));
+  EXPECT_EQ(0u, state->end);
+
+  Action action;
+  action.set_position(1);
+  action.set_promised(1);
+  action.set_performed(1);
+  action.set_learned(true);
+  action.set_type(Action::APPEND);
+  action.mutable_append()->set_bytes("world");
+
+  ASSERT_SOME(storage.persist(action));
+
+  Try<Action> read = storage.read(0);
+  ASSERT_SOME(read);
+  EXPECT_EQ("hello", read->append().bytes());
+
+  read = storage.read(1);
+  ASSERT_SOME(read);
+  EXPECT_EQ("world", read->append().bytes());
+
+  // Nothing of the partially written record is left behind the
+  // appended one, which would otherwise be taken for a corruption.
+  data = os::read(segment);
+  ASSERT_SOME(data);
+
+  memcpy(&length, data->data() + tail, sizeof(length));
+
+  const size_t end = tail + 2 * sizeof(uint32_t) + length;
+  ASSERT_LT(end, tail + sizeof(header) + garbage.size());
+
+  EXPECT_EQ(
+      string(tail + sizeof(header) + garbage.size() - end, '\0'),
+      data->substr(end, tail + sizeof(header) + garbage.size() - end));
+
+#ifdef __linux__
+  // The segment is preallocated again rather than left sparse.
+  struct stat s;
+  ASSERT_EQ(0, ::stat(segment.c_str(), &s));
+  EXPECT_LE(s.st_size, s.st_blocks * 512);
+#endif // __linux__
+}
+
+
+// This test verifies that 'mesos-log migrate' copies a leveldb log
+// into a segment log which a replica then keeps using.
+TEST_F(SegmentStorageTest, Migrate)
+{
+  const string source = os::getcwd() + "/.log";
+  const string destination = os::getcwd() + "/.segments";
+
+  {
+    LevelDBStorage storage;
+
+    ASSERT_SOME(storage.restore(source));
+
+    Metadata metadata;
+    metadata.set_status(Metadata::VOTING);
+    metadata.set_promised(1);
+
+    ASSERT_SOME(storage.persist(metadata));
+
+    for (uint64_t i = 0; i < 10; i++) {
+      Action action;
+      action.set_position(i);
+      action.set_promised(1);
+      action.set_performed(1);
+      action.set_learned(true);
+      action.set_type(Action::APPEND);
+      action.mutable_append()->set_bytes(stringify(i));
+
+      ASSERT_SOME(storage.persist(action));
+    }
+  }
+
+  tool::Migrate migrate;
+  migrate.flags.path = source;
+  migrate.flags.destination = destination;
+
+  ASSERT_SOME(migrate.execute());
+
+  EXPECT_TRUE(SegmentStorage::exists(destination));
+
+  // Migrating into a non-empty log is refused.
+  EXPECT_ERROR(migrate.execute());
+
+  Replica replica(destination);
+
+  AWAIT_EXPECT_EQ(Metadata::VOTING, replica.status());
+  AWAIT_EXPECT_EQ(9u, replica.ending());
+
+  Future<list<Action>> actions = replica.read(0, 9);
+  AWAIT_READY(actions);
+  ASSERT_EQ(10u, actions->size());
+
+  uint64_t position = 0;
+  foreach (const Action& action, actions.get()) {
+    EXPECT_EQ(position, action.position());
+    EXPECT_EQ(stringify(position), action.append().bytes());
+    position++;
+  }
+}
+
+
 class ReplicaTest : public TemporaryDirectoryTest
 {
 protected:
@@ -1958,6 +2347,10 @@ TEST_F(RecoverTest, CatchupRetry)
 
   Shared<Network> network2(new Network(pids));
 
+  // Drop the bulk catch-up requests so that the positions have to be
+  // filled using Paxos.
+  DROP_PROTOBUFS(CatchUpRequest(), _, _);
+
   // Drop a promise request to replica1 so that the catch-up process
   // won't be able to get a quorum of explicit promises. Also, since
   // learned messages are blocked from being sent replica2, the
@@ -1971,6 +2364,10 @@ TEST_F(RecoverTest, CatchupRetry)
 
   Clock::pause();
 
+  // Wait for the bulk catch-up to time out.
+  Clock::settle();
+  Clock::advance(Seconds(10));
+
   // Wait for the retry timer in 'catchup' to be setup.
   Clock::settle();
 
@@ -1992,6 +2389,151 @@ TEST_F(RecoverTest, CatchupRetry)
 }
 
 
+// This test verifies that positions learned by other replicas are
+// caught-up in bulk, i.e., without running Paxos for them.
+TEST_F(RecoverTest, BulkCatchup)
+{
+  const string path1 = os::getcwd() + "/.log1";
+  initializer.flags.path = path1;
+  ASSERT_SOME(initializer.execute());
+
+  const string path2 = os::getcwd() + "/.log2";
+  initializer.flags.path = path2;
+  ASSERT_SOME(initializer.execute());
+
+  const string path3 = os::getcwd() + "/.log3";
+
+  Shared<Replica> replica1(new Replica(path1));
+  Shared<Replica> replica2(new Replica(path2));
+
+  set<UPID> pids;
+  pids.insert(replica1->pid());
+  pids.insert(replica2->pid());
+
+  Shared<Network> network1(new Network(pids));
+
+  Coordinator coord(2, replica1, network1);
+
+  {
+    Future<Option<uint64_t>> electing = coord.elect();
+    AWAIT_READY(electing);
+    EXPECT_SOME_EQ(0u, electing.get());
+  }
+
+  IntervalSet<uint64_t> positions;
+
+  for (uint64_t position = 1; position <= 100; position++) {
+    Future<Option<uint64_t>> appending = coord.append(stringify(position));
+    AWAIT_READY(appending);
+    EXPECT_SOME_EQ(position, appending.get());
+    positions += position;
+  }
+
+  Shared<Replica> replica3(new Replica(path3));
+
+  pids.insert(replica3->pid());
+
+  Shared<Network> network2(new Network(pids));
+
+  // No position can be filled since the quorum is larger than the
+  // number of VOTING replicas.
+  EXPECT_NO_FUTURE_PROTOBUFS(PromiseRequest(), _, _);
+
+  Future<Nothing> catching =
+    catchup(3, replica3, network2, None(), positions, Seconds(10));
+
+  AWAIT_READY(catching);
+
+  Future<IntervalSet<uint64_t>> missing = replica3->missing(1, 100);
+  AWAIT_READY(missing);
+  EXPECT_TRUE(missing->empty());
+
+  Future<list<Action>> actions = replica3->read(1, 100);
+  AWAIT_READY(actions);
+  ASSERT_EQ(100u, actions->size());
+
+  uint64_t position = 1;
+  foreach (const Action& action, actions.get()) {
+    EXPECT_EQ(position, action.position());
+    EXPECT_TRUE(action.learned());
+    EXPECT_EQ(stringify(position), action.append().bytes());
+    position++;
+  }
+}
+
+
+// This test verifies that the bulk catch-up moves on with the
+// responses of a VOTING replica when another replica does not answer,
+// rather than waiting for it to time out or filling all the positions
+// using Paxos.
+TEST_F(RecoverTest, BulkCatchupSlowReplica)
+{
+  const string path1 = os::getcwd() + "/.log1";
+  initializer.flags.path = path1;
+  ASSERT_SOME(initializer.execute());
+
+  const string path2 = os::getcwd() + "/.log2";
+  initializer.flags.path = path2;
+  ASSERT_SOME(initializer.execute());
+
+  const string path3 = os::getcwd() + "/.log3";
+
+  Shared<Replica> replica1(new Replica(path1));
+  Shared<Replica> replica2(new Replica(path2));
+
+  set<UPID> pids;
+  pids.insert(replica1->pid());
+  pids.insert(replica2->pid());
+
+  Shared<Network> network1(new Network(pids));
+
+  Coordinator coord(2, replica1, network1);
+
+  {
+    Future<Option<uint64_t>> electing = coord.elect();
+    AWAIT_READY(electing);
+    EXPECT_SOME_EQ(0u, electing.get());
+  }
+
+  IntervalSet<uint64_t> positions;
+
+  for (uint64_t position = 1; position <= 100; position++) {
+    Future<Option<uint64_t>> appending = coord.append(stringify(position));
+    AWAIT_READY(appending);
+    EXPECT_SOME_EQ(position, appending.get());
+    positions += position;
+  }
+
+  Shared<Replica> replica3(new Replica(path3));
+
+  pids.insert(replica3->pid());
+
+  Shared<Network> network2(new Network(pids));
+
+  // Replica2 never answers the bulk catch-up requests.
+  DROP_PROTOBUFS(CatchUpRequest(), _, Eq(replica2->pid()));
+
+  // No position can be filled since the quorum is larger than the
+  // number of VOTING replicas.
+  EXPECT_NO_FUTURE_PROTOBUFS(PromiseRequest(), _, _);
+
+  Clock::pause();
+
+  Future<Nothing> catching =
+    catchup(3, replica3, network2, None(), positions, Seconds(10));
+
+  // The responses of replica1 cover the positions, so the bulk
+  // catch-up does not wait for replica2 to time out.
+  AWAIT_READY(catching);
+
+  Clock::resume();
+
+  Future<IntervalSet<uint64_t>> missing = replica3->missing(1, 100);
+  AWAIT_READY(missing);
+  EXPECT_TRUE(missing->empty());
+}
+
+
 TEST_F(RecoverTest, RecoverProtocolRetry)
 {
   const string path1 = path::join(os::getcwd(), ".log1");
@@ -28,17 +28,24 @@
 #include <process/clock.hpp>
 #include <process/collect.hpp>
 #include <process/future.hpp>
+#include <process/gmock.hpp>
 #include <process/loop.hpp>
 #include <process/pid.hpp>
 #include <process/process.hpp>
 #include <process/protobuf.hpp>
 #include <process/statistics.hpp>
 
+#include <stout/bytes.hpp>
 #include <stout/duration.hpp>
+#include <stout/json.hpp>
 #include <stout/stopwatch.hpp>
 
 #include "common/protobuf_utils.hpp"
 
+#include "master/master.hpp"
+
+#include "master/allocator/mesos/allocator.hpp"
+
 #include "tests/mesos.hpp"
 
 namespace http = process::http;
@@ -63,6 +70,10 @@ using process::terminate;
 using process::UPID;
 using process::wait;
 
+using mesos::internal::master::CompletedTask;
+
+using mesos::internal::master::allocator::MesosAllocatorProcess;
+
 using std::atomic_bool;
 using std::cout;
 using std::endl;
@@ -198,10 +209,13 @@ public:
     }
   }
 
+  // NOTE: This can be called again (e.g., after a master failover)
+  // once the previous re-registration has completed.
   Future<Nothing> reregister()
   {
+    promise.reset(new Promise<Nothing>());
     send(masterPid, message);
-    return promise.future();
+    return promise->future();
   }
 
   TestSlaveProcess(const TestSlaveProcess& other) = delete;
@@ -210,7 +224,9 @@ public:
 private:
   void reregistered(const SlaveReregisteredMessage&)
   {
-    promise.set(Nothing());
+    if (promise.get() != nullptr) {
+      promise->set(Nothing());
+    }
   }
 
   // We need to answer pings to keep the agent registered.
@@ -227,7 +243,7 @@ private:
   const size_t tasksPerCompletedFramework;
 
   ReregisterSlaveMessage message;
-  Promise<Nothing> promise;
+  Owned<Promise<Nothing>> promise;
 };
 
 
@@ -356,6 +372,95 @@ TEST_P(MasterFailover_BENCHMARK_Test, AgentReregistrationDelay)
 }
 
 
+// This test measures the agent re-registration throughput after a
+// master failover, i.e., when all agents have been recovered from the
+// registry and reregister at about the same time.
+TEST_P(MasterFailover_BENCHMARK_Test, AgentReregistrationAfterFailover)
+{
+  size_t agentCount;
+  size_t frameworksPerAgent;
+  size_t tasksPerFramework;
+  size_t completedFrameworksPerAgent;
+  size_t tasksPerCompletedFramework;
+
+  tie(agentCount,
+      frameworksPerAgent,
+      tasksPerFramework,
+      completedFrameworksPerAgent,
+      tasksPerCompletedFramework) = GetParam();
+
+  master::Flags masterFlags = CreateMasterFlags();
+  masterFlags.authenticate_agents = false;
+
+  // The registry must survive the master failover.
+  masterFlags.registry = "replicated_log";
+
+  Try<Owned<cluster::Master>> master = StartMaster(masterFlags);
+  ASSERT_SOME(master);
+
+  vector<TestSlave> slaves;
+
+  for (size_t i = 0; i < agentCount; i++) {
+    SlaveID slaveId;
+    slaveId.set_value("agent" + stringify(i));
+
+    slaves.emplace_back(
+        master.get()->pid,
+        slaveId,
+        frameworksPerAgent,
+        tasksPerFramework,
+        completedFrameworksPerAgent,
+        tasksPerCompletedFramework);
+  }
+
+  // Admit all the agents into the registry.
+  vector<Future<Nothing>> reregistered;
+
+  foreach (TestSlave& slave, slaves) {
+    reregistered.push_back(slave.reregister());
+  }
+
+  await(reregistered).await();
+
+  // Fail over the master. We wait for the registry to be recovered
+  // (which is when the master starts accepting agents again) before
+  // starting the stopwatch.
+  Future<Nothing> recover =
+    FUTURE_DISPATCH(_, &MesosAllocatorProcess::recover);
+
+  master->reset();
+  master = StartMaster(masterFlags);
+  ASSERT_SOME(master);
+
+  AWAIT_READY(recover);
+
+  reregistered.clear();
+
+  Stopwatch watch;
+  watch.start();
+
+  foreach (TestSlave& slave, slaves) {
+    reregistered.push_back(slave.reregister());
+  }
+
+  await(reregistered).await();
+
+  watch.stop();
+
+  JSON::Object metrics = Metrics();
+
+  cout << "Reregistered " << agentCount << " recovered agents with a total of "
+       << frameworksPerAgent * tasksPerFramework * agentCount
+       << " running tasks in " << watch.elapsed() << " ("
+       << agentCount / watch.elapsed().secs() << " agents/s)" << endl;
+
+  cout << "master/recovery_slave_reregistrations: "
+       << metrics.values["master/recovery_slave_reregistrations"] << endl
+       << "master/recovery_slave_reregistration_secs: "
+       << metrics.values["master/recovery_slave_reregistration_secs"] << endl;
+}
+
+
 class MasterStateQuery_BENCHMARK_Test
   : public MesosTest,
     public WithParamInterface<tuple<
@@ -851,6 +956,54 @@ TEST_P(MasterMetricsQuery_BENCHMARK_Test, GetMetrics)
   }
 }
 
+
+// This benchmark reports the memory used by the master to retain a
+// task in a framework's history of completed tasks, comparing the
+// parsed `Task` protobuf with the serialized `CompletedTask`.
+TEST(MasterCompletedTasks_BENCHMARK_Test, MemoryPerTask)
+{
+  SlaveID slaveId;
+  slaveId.set_value("agent");
+
+  FrameworkID frameworkId;
+  frameworkId.set_value("framework");
+
+  TaskInfo taskInfo = createTask(
+      slaveId,
+      Resources::parse("cpus:1;mem:128;disk:1024;ports:[31000-31010]").get(),
+      "sleep 1000");
+
+  Task task = protobuf::createTask(taskInfo, TASK_FINISHED, frameworkId);
+
+  foreach (
+      TaskState state,
+      vector<TaskState>({TASK_STARTING, TASK_RUNNING, TASK_FINISHED})) {
+    task.add_statuses()->CopyFrom(protobuf::createStatusUpdate(
+        frameworkId,
+        slaveId,
+        taskInfo.task_id(),
+        state,
+        TaskStatus::SOURCE_EXECUTOR,
+        id::UUID::random()).status());
+  }
+
+  // Before: the task was held as an `Owned<Task>`.
+  const size_t parsed = sizeof(Owned<Task>) + task.SpaceUsedLong();
+
+  // After: the serialized task, plus the fields kept parsed alongside.
+  const CompletedTask completedTask(task);
+
+  const size_t compact =
+    sizeof(CompletedTask) +
+    task.ByteSizeLong() +
+    completedTask.taskId().SpaceUsedLong() - sizeof(TaskID) +
+    completedTask.slaveId().SpaceUsedLong() - sizeof(SlaveID);
+
+  cout << "Retaining a completed task takes " << Bytes(parsed)
+       << " as a parsed protobuf and " << Bytes(compact)
+       << " in serialized form" << endl;
+}
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {
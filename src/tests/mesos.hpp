@@ -2741,6 +2741,7 @@ public:
       rescindInverseOffers,
       void(Mesos*, const typename Event::RescindInverseOffer&));
   MOCK_METHOD2_T(update, void(Mesos*, const typename Event::Update&));
+  MOCK_METHOD2_T(updates, void(Mesos*, const typename Event::Updates&));
   MOCK_METHOD2_T(
       updateOperationStatus,
       void(Mesos*, const typename Event::UpdateOperationStatus&));
@@ -2773,6 +2774,9 @@ public:
         case Event::UPDATE:
           update(mesos, event.update());
           break;
+        case Event::UPDATES:
+          updates(mesos, event.updates());
+          break;
         case Event::UPDATE_OPERATION_STATUS:
           updateOperationStatus(mesos, event.update_operation_status());
           break;
@@ -14,6 +14,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <list>
 #include <string>
 
 #include <gtest/gtest.h>
@@ -49,6 +50,7 @@ using process::Future;
 using process::Owned;
 using process::Promise;
 
+using std::list;
 using std::string;
 
 namespace mesos {
@@ -357,6 +359,68 @@ TEST_F(OperationStatusUpdateManagerTest, RecoverCheckpointedStream)
 }
 
 
+// This test verifies that the status updates which are committed together
+// are all checkpointed, and that only the first one is forwarded.
+TEST_F(OperationStatusUpdateManagerTest, RecoverCommittedUpdates)
+{
+  Future<UpdateOperationStatusMessage> forwardedStatusUpdate1;
+  Future<UpdateOperationStatusMessage> forwardedStatusUpdate2;
+  EXPECT_CALL(statusUpdateProcessor, update(_))
+    .WillOnce(FutureArg<0>(&forwardedStatusUpdate1))
+    .WillOnce(FutureArg<0>(&forwardedStatusUpdate2));
+
+  const id::UUID operationUuid = id::UUID::random();
+
+  UpdateOperationStatusMessage statusUpdate1 =
+    createUpdateOperationStatusMessage(
+        id::UUID::random(), operationUuid, OperationState::OPERATION_PENDING);
+
+  UpdateOperationStatusMessage statusUpdate2 =
+    createUpdateOperationStatusMessage(
+        id::UUID::random(), operationUuid, OperationState::OPERATION_FINISHED);
+
+  // Send both checkpointed operation status updates before waiting for
+  // either of them, so that they are synced by the same commit.
+  Future<Nothing> update1 = statusUpdateManager->update(statusUpdate1, true);
+  Future<Nothing> update2 = statusUpdateManager->update(statusUpdate2, true);
+
+  AWAIT_ASSERT_READY(update1);
+  AWAIT_ASSERT_READY(update2);
+
+  UpdateOperationStatusMessage expectedStatusUpdate(statusUpdate1);
+  expectedStatusUpdate.mutable_latest_status()->CopyFrom(
+      statusUpdate2.status());
+
+  // Verify that only the first status update is forwarded.
+  AWAIT_EXPECT_EQ(expectedStatusUpdate, forwardedStatusUpdate1);
+
+  Clock::settle();
+  EXPECT_FALSE(forwardedStatusUpdate2.isReady());
+
+  resetStatusUpdateManager();
+
+  // Recover the checkpointed stream, which holds both status updates.
+  Future<OperationStatusUpdateManagerState> state =
+    statusUpdateManager->recover({operationUuid}, true);
+
+  AWAIT_READY(state);
+
+  EXPECT_EQ(0u, state->errors);
+  ASSERT_TRUE(state->streams.contains(operationUuid));
+  ASSERT_SOME(state->streams.at(operationUuid));
+
+  const list<UpdateOperationStatusMessage>& updates =
+    state->streams.at(operationUuid)->updates;
+
+  ASSERT_EQ(2u, updates.size());
+  EXPECT_EQ(statusUpdate1, updates.front());
+  EXPECT_EQ(statusUpdate2, updates.back());
+
+  // Check that the first status update is resent.
+  AWAIT_EXPECT_EQ(expectedStatusUpdate, forwardedStatusUpdate2);
+}
+
+
 // This test verifies that the status update manager returns a `Failure` when
 // trying to recover a stream that isn't checkpointed.
 TEST_F(OperationStatusUpdateManagerTest, RecoverNotCheckpointedStream)
@@ -27,7 +27,9 @@
 #include <process/clock.hpp>
 #include <process/future.hpp>
 #include <process/gtest.hpp>
+#include <process/reap.hpp>
 
+#include <stout/exit.hpp>
 #include <stout/gtest.hpp>
 #include <stout/os.hpp>
 #include <stout/path.hpp>
@@ -45,6 +47,13 @@
 #include "slave/flags.hpp"
 #include "slave/slave.hpp"
 #include "slave/qos_controllers/load.hpp"
+#include "slave/resource_estimators/usage.hpp"
+
+#ifdef __linux__
+#include "linux/cgroups2.hpp"
+
+#include "slave/qos_controllers/pressure.hpp"
+#endif // __linux__
 
 #include "tests/flags.hpp"
 #include "tests/containerizer.hpp"
@@ -60,7 +69,11 @@ using mesos::internal::master::Master;
 using mesos::internal::protobuf::createLabel;
 
 using mesos::internal::slave::LoadQoSController;
+#ifdef __linux__
+using mesos::internal::slave::PressureQoSController;
+#endif // __linux__
 using mesos::internal::slave::Slave;
+using mesos::internal::slave::UsageResourceEstimator;
 
 using mesos::master::detector::MasterDetector;
 using mesos::master::detector::StandaloneMasterDetector;
@@ -68,6 +81,7 @@ using mesos::master::detector::StandaloneMasterDetector;
 using mesos::slave::QoSCorrection;
 
 using std::list;
+using std::pair;
 using std::string;
 using std::vector;
 
@@ -1529,6 +1543,171 @@ TEST_F(OversubscriptionTest, LoadQoSController)
 }
 
 
+// This test verifies that the Usage Resource Estimator oversubscribes
+// the resources which non-revocable executors are allocated but do not
+// use, and that it only updates its estimate on material changes.
+TEST_F(OversubscriptionTest, UsageResourceEstimator)
+{
+  UsageResourceEstimator estimator(0.95, Minutes(5), 0.1);
+
+  // The non-revocable executor is sampled once per second and uses
+  // `cpusUsed` cpus and 256MB of memory.
+  double timestamp = 0;
+  double cpusTime = 0;
+  double cpusUsed = 1;
+
+  ContainerID containerId;
+  containerId.set_value("container");
+
+  estimator.initialize([&]() -> Future<ResourceUsage> {
+    timestamp += 1;
+    cpusTime += cpusUsed;
+
+    ResourceUsage usage;
+
+    ResourceStatistics statistics = createResourceStatistics();
+    statistics.set_timestamp(timestamp);
+    statistics.set_cpus_user_time_secs(cpusTime);
+    statistics.set_cpus_system_time_secs(0);
+    statistics.set_mem_rss_bytes(Megabytes(256).bytes());
+
+    ResourceUsage::Executor* executor = usage.add_executors();
+    executor->mutable_executor_info()->CopyFrom(
+        createExecutorInfo("framework", "executor1"));
+    executor->mutable_allocated()->CopyFrom(
+        Resources::parse("cpus:4;mem:1024").get());
+    executor->mutable_container_id()->CopyFrom(containerId);
+    executor->mutable_statistics()->CopyFrom(statistics);
+
+    // The revocable executor already uses 1 of the oversubscribed cpus.
+    executor = usage.add_executors();
+    executor->mutable_executor_info()->CopyFrom(
+        createExecutorInfo("framework", "executor2"));
+    executor->mutable_allocated()->CopyFrom(
+        createRevocableResources("cpus", "1"));
+
+    return usage;
+  });
+
+  // The cpu usage is not known after the first sample, so only the
+  // unused memory is oversubscribed.
+  AWAIT_EXPECT_EQ(
+      createRevocableResources("mem", "768"),
+      estimator.oversubscribable());
+
+  AWAIT_EXPECT_EQ(
+      createRevocableResources("cpus", "2") +
+        createRevocableResources("mem", "768"),
+      estimator.oversubscribable());
+
+  // A small increase in cpu usage does not change the estimate.
+  cpusUsed = 1.1;
+
+  AWAIT_EXPECT_EQ(
+      createRevocableResources("cpus", "2") +
+        createRevocableResources("mem", "768"),
+      estimator.oversubscribable());
+
+  // The estimate follows a material increase in cpu usage, which
+  // leaves no room for the revocable executor.
+  cpusUsed = 3;
+
+  AWAIT_EXPECT_EQ(
+      createRevocableResources("mem", "768"),
+      estimator.oversubscribable());
+}
+
+
+#ifdef __linux__
+// This test verifies the functionality of the Pressure QoS Controller.
+// When the tasks of the watched cgroup are stalled on the CPU for longer
+// than the threshold, it should evict the revocable executor under the
+// most CPU pressure.
+// 1. Ask for corrections while the cgroup is idle. No correction should
+//    appear.
+// 2. Saturate the CPUs from within the cgroup. A single QoSCorrection
+//    for the executor under the most pressure should appear.
+TEST_F(OversubscriptionTest, ROOT_CGROUPS2_PressureQoSController)
+{
+  const string cgroup = "mesos_test_pressure_qos_controller";
+  ASSERT_SOME(cgroups2::create(cgroup));
+
+  cgroups2::pressure::Threshold threshold;
+  threshold.stall = Milliseconds(100);
+  threshold.window = Seconds(2);
+
+  PressureQoSController controller(
+      cgroup, {{cgroups2::pressure::Resource::CPU, threshold}});
+
+  // Prepare lambda creating ResourceUsage stub with two revocable
+  // executors, where the second one is under more CPU pressure.
+  ASSERT_SOME(controller.initialize([this]() -> Future<ResourceUsage> {
+    ResourceUsage usage;
+
+    Resources resources = Resources::parse("mem:128").get();
+    resources += createRevocableResources("cpus", "1");
+
+    vector<pair<string, double>> executors = {
+      {"executor1", 10},
+      {"executor2", 50}
+    };
+
+    foreach (const auto& pressure, executors) {
+      ResourceStatistics statistics = createResourceStatistics();
+      statistics.mutable_cpu_pressure()->mutable_some()->set_avg10(
+          pressure.second);
+
+      ResourceUsage::Executor* executor = usage.add_executors();
+      executor->mutable_executor_info()->CopyFrom(
+          createExecutorInfo("framework", pressure.first));
+      executor->mutable_allocated()->CopyFrom(resources);
+      executor->mutable_statistics()->CopyFrom(statistics);
+      executor->mutable_container_id()->set_value(pressure.first);
+    }
+
+    return usage;
+  }));
+
+  // First correction iteration. The cgroup is idle.
+  Future<list<QoSCorrection>> qosCorrections = controller.corrections();
+
+  os::sleep(Seconds(3));
+  EXPECT_TRUE(qosCorrections.isPending());
+
+  // Second correction iteration. Spin up more processes than CPUs
+  // in the cgroup, so that they are stalled waiting for the CPUs.
+  vector<pid_t> pids;
+  for (long i = 0; i <= 2 * os::cpus().get(); i++) {
+    pid_t pid = ::fork();
+    ASSERT_NE(-1, pid);
+
+    if (pid == 0) {
+      if (cgroups2::assign(cgroup, ::getpid()).isError()) {
+        SAFE_EXIT(EXIT_FAILURE, "Failed to assign child process to cgroup");
+      }
+
+      while (true) {}
+    }
+
+    pids.push_back(pid);
+  }
+
+  AWAIT_READY_FOR(qosCorrections, Seconds(30));
+
+  foreach (pid_t pid, pids) {
+    ::kill(pid, SIGKILL);
+    AWAIT_READY(process::reap(pid));
+  }
+
+  AWAIT_READY(cgroups2::destroy(cgroup));
+
+  // Expect a single correction for the executor under the most pressure.
+  ASSERT_EQ(1u, qosCorrections->size());
+  EXPECT_EQ("executor2", qosCorrections->front().kill().executor_id().value());
+}
+#endif // __linux__
+
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {
@@ -930,6 +930,234 @@ TEST_P(SchedulerTest, ReconcileTask)
 }
 
 
+// This test verifies that a scheduler which asks for a batched
+// implicit reconciliation receives the task statuses in an 'UPDATES'
+// event rather than in individual 'UPDATE' events.
+TEST_P(SchedulerTest, ReconcileTasksBatched)
+{
+  Try<Owned<cluster::Master>> master = StartMaster();
+  ASSERT_SOME(master);
+
+  auto scheduler = std::make_shared<v1::MockHTTPScheduler>();
+  auto executor = std::make_shared<v1::MockHTTPExecutor>();
+
+  ExecutorID executorId = DEFAULT_EXECUTOR_ID;
+  TestContainerizer containerizer(executorId, executor);
+
+  Owned<MasterDetector> detector = master.get()->createDetector();
+  Try<Owned<cluster::Slave>> slave = StartSlave(detector.get(), &containerizer);
+  ASSERT_SOME(slave);
+
+  Future<Nothing> connected;
+  EXPECT_CALL(*scheduler, connected(_))
+    .WillOnce(FutureSatisfy(&connected));
+
+  ContentType contentType = GetParam();
+
+  v1::scheduler::TestMesos mesos(
+      master.get()->pid,
+      contentType,
+      scheduler);
+
+  AWAIT_READY(connected);
+
+  Future<Event::Subscribed> subscribed;
+  EXPECT_CALL(*scheduler, subscribed(_, _))
+    .WillOnce(FutureArg<1>(&subscribed));
+
+  EXPECT_CALL(*scheduler, heartbeat(_))
+    .WillRepeatedly(Return()); // Ignore heartbeats.
+
+  Future<Event::Offers> offers;
+  EXPECT_CALL(*scheduler, offers(_, _))
+    .WillOnce(FutureArg<1>(&offers));
+
+  {
+    Call call;
+    call.set_type(Call::SUBSCRIBE);
+
+    Call::Subscribe* subscribe = call.mutable_subscribe();
+    subscribe->mutable_framework_info()->CopyFrom(v1::DEFAULT_FRAMEWORK_INFO);
+
+    mesos.send(call);
+  }
+
+  AWAIT_READY(subscribed);
+
+  v1::FrameworkID frameworkId(subscribed->framework_id());
+
+  AWAIT_READY(offers);
+  ASSERT_FALSE(offers->offers().empty());
+
+  EXPECT_CALL(*executor, connected(_))
+    .WillOnce(v1::executor::SendSubscribe(frameworkId, evolve(executorId)));
+
+  EXPECT_CALL(*executor, subscribed(_, _));
+
+  EXPECT_CALL(*executor, launch(_, _))
+    .WillOnce(v1::executor::SendUpdateFromTask(
+        frameworkId, evolve(executorId), v1::TASK_RUNNING));
+
+  Future<Nothing> acknowledged;
+  EXPECT_CALL(*executor, acknowledged(_, _))
+    .WillOnce(FutureSatisfy(&acknowledged));
+
+  Future<Event::Update> update1;
+  EXPECT_CALL(*scheduler, update(_, _))
+    .WillOnce(FutureArg<1>(&update1));
+
+  const v1::Offer& offer = offers->offers(0);
+
+  v1::TaskInfo taskInfo =
+    evolve(createTask(devolve(offer), "", DEFAULT_EXECUTOR_ID));
+
+  {
+    Call call;
+    call.mutable_framework_id()->CopyFrom(frameworkId);
+    call.set_type(Call::ACCEPT);
+
+    Call::Accept* accept = call.mutable_accept();
+    accept->add_offer_ids()->CopyFrom(offer.id());
+
+    v1::Offer::Operation* operation = accept->add_operations();
+    operation->set_type(v1::Offer::Operation::LAUNCH);
+    operation->mutable_launch()->add_task_infos()->CopyFrom(taskInfo);
+
+    mesos.send(call);
+  }
+
+  AWAIT_READY(acknowledged);
+  AWAIT_READY(update1);
+
+  EXPECT_EQ(v1::TASK_RUNNING, update1->status().state());
+
+  EXPECT_CALL(*scheduler, update(_, _))
+    .Times(0);
+
+  Future<Event::Updates> updates;
+  EXPECT_CALL(*scheduler, updates(_, _))
+    .WillOnce(FutureArg<1>(&updates));
+
+  {
+    Call call;
+    call.mutable_framework_id()->CopyFrom(frameworkId);
+    call.set_type(Call::RECONCILE);
+    call.mutable_reconcile()->set_batch(true);
+
+    mesos.send(call);
+  }
+
+  AWAIT_READY(updates);
+  ASSERT_EQ(1, updates->statuses_size());
+
+  const v1::TaskStatus& status = updates->statuses(0);
+
+  EXPECT_EQ(taskInfo.task_id(), status.task_id());
+  EXPECT_FALSE(status.has_uuid());
+  EXPECT_EQ(v1::TASK_RUNNING, status.state());
+  EXPECT_EQ(v1::TaskStatus::REASON_RECONCILIATION, status.reason());
+
+  EXPECT_CALL(*executor, shutdown(_))
+    .Times(AtMost(1));
+
+  EXPECT_CALL(*executor, disconnected(_))
+    .Times(AtMost(1));
+}
+
+
+// This test verifies that a reconciliation of more tasks than fit in a
+// batch is answered in several batches.
+TEST_P(SchedulerTest, ReconcileTasksMultipleBatches)
+{
+  const size_t batchSize =
+    mesos::internal::master::MAX_RECONCILIATION_BATCH_SIZE;
+
+  Try<Owned<cluster::Master>> master = StartMaster();
+  ASSERT_SOME(master);
+
+  auto scheduler = std::make_shared<v1::MockHTTPScheduler>();
+
+  Future<Nothing> connected;
+  EXPECT_CALL(*scheduler, connected(_))
+    .WillOnce(FutureSatisfy(&connected));
+
+  ContentType contentType = GetParam();
+
+  v1::scheduler::TestMesos mesos(
+      master.get()->pid,
+      contentType,
+      scheduler);
+
+  AWAIT_READY(connected);
+
+  Future<Event::Subscribed> subscribed;
+  EXPECT_CALL(*scheduler, subscribed(_, _))
+    .WillOnce(FutureArg<1>(&subscribed));
+
+  EXPECT_CALL(*scheduler, heartbeat(_))
+    .WillRepeatedly(Return()); // Ignore heartbeats.
+
+  {
+    Call call;
+    call.set_type(Call::SUBSCRIBE);
+
+    Call::Subscribe* subscribe = call.mutable_subscribe();
+    subscribe->mutable_framework_info()->CopyFrom(v1::DEFAULT_FRAMEWORK_INFO);
+
+    mesos.send(call);
+  }
+
+  AWAIT_READY(subscribed);
+
+  v1::FrameworkID frameworkId(subscribed->framework_id());
+
+  EXPECT_CALL(*scheduler, update(_, _))
+    .Times(0);
+
+  Future<Event::Updates> updates1;
+  Future<Event::Updates> updates2;
+  EXPECT_CALL(*scheduler, updates(_, _))
+    .WillOnce(FutureArg<1>(&updates1))
+    .WillOnce(FutureArg<1>(&updates2));
+
+  // The tasks are unknown to the master, which answers them with
+  // TASK_LOST since the framework is not partition aware.
+  const size_t tasks = batchSize + batchSize / 2;
+
+  {
+    Call call;
+    call.mutable_framework_id()->CopyFrom(frameworkId);
+    call.set_type(Call::RECONCILE);
+    call.mutable_reconcile()->set_batch(true);
+
+    for (size_t i = 0; i < tasks; i++) {
+      call.mutable_reconcile()->add_tasks()->mutable_task_id()->set_value(
+          "task-" + stringify(i));
+    }
+
+    mesos.send(call);
+  }
+
+  AWAIT_READY(updates1);
+  ASSERT_EQ(batchSize, static_cast<size_t>(updates1->statuses_size()));
+
+  AWAIT_READY(updates2);
+  ASSERT_EQ(tasks - batchSize, static_cast<size_t>(updates2->statuses_size()));
+
+  // The batches answer the tasks in the order they were asked for.
+  EXPECT_EQ("task-0", updates1->statuses(0).task_id().value());
+  EXPECT_EQ(v1::TASK_LOST, updates1->statuses(0).state());
+
+  EXPECT_EQ(
+      "task-" + stringify(batchSize),
+      updates2->statuses(0).task_id().value());
+
+  EXPECT_EQ(
+      "task-" + stringify(tasks - 1),
+      updates2->statuses(updates2->statuses_size() - 1).task_id().value());
+}
+
+
 TEST_P(SchedulerTest, KillTask)
 {
   Try<Owned<cluster::Master>> master = StartMaster();
@@ -18,7 +18,9 @@
 #include <unistd.h>
 #endif // __WINDOWS__
 
+#include <iostream>
 #include <string>
+#include <tuple>
 
 #include <gtest/gtest.h>
 
@@ -47,6 +49,7 @@
 #include <stout/option.hpp>
 #include <stout/os.hpp>
 #include <stout/path.hpp>
+#include <stout/stopwatch.hpp>
 #include <stout/uuid.hpp>
 
 #include <stout/os/killtree.hpp>
@@ -95,8 +98,11 @@ using mesos::slave::ContainerTermination;
 
 using mesos::v1::executor::Call;
 
+using std::cout;
+using std::endl;
 using std::map;
 using std::string;
+using std::tuple;
 using std::vector;
 
 using testing::_;
@@ -105,6 +111,7 @@ using testing::DoAll;
 using testing::Eq;
 using testing::Return;
 using testing::SaveArg;
+using testing::WithParamInterface;
 
 namespace mesos {
 namespace internal {
@@ -157,6 +164,262 @@ TEST_F(SlaveStateTest, CheckpointRepeatedProtobufMessages)
 }
 
 
+// Populates the agent meta directory at 'rootDir' with a framework
+// that has the given number of completed executors (with a single run
+// each), each of which ran 'tasks' tasks whose terminal status update
+// was acknowledged.
+static void createMetaDir(
+    const string& rootDir,
+    const SlaveID& slaveId,
+    const FrameworkID& frameworkId,
+    size_t executors,
+    size_t tasks)
+{
+  paths::createSlaveDirectory(rootDir, slaveId);
+
+  SlaveInfo slaveInfo;
+  slaveInfo.set_hostname("localhost");
+  slaveInfo.mutable_id()->CopyFrom(slaveId);
+
+  ASSERT_SOME(slave::state::checkpoint(
+      paths::getSlaveInfoPath(rootDir, slaveId), slaveInfo));
+
+  FrameworkInfo frameworkInfo = DEFAULT_FRAMEWORK_INFO;
+  frameworkInfo.mutable_id()->CopyFrom(frameworkId);
+
+  ASSERT_SOME(slave::state::checkpoint(
+      paths::getFrameworkInfoPath(rootDir, slaveId, frameworkId),
+      frameworkInfo));
+
+  ASSERT_SOME(slave::state::checkpoint(
+      paths::getFrameworkPidPath(rootDir, slaveId, frameworkId),
+      string("scheduler@127.0.0.1:5050")));
+
+  for (size_t i = 0; i < executors; i++) {
+    ExecutorInfo executorInfo = DEFAULT_EXECUTOR_INFO;
+    executorInfo.mutable_executor_id()->set_value("executor-" + stringify(i));
+    executorInfo.mutable_framework_id()->CopyFrom(frameworkId);
+
+    const ExecutorID& executorId = executorInfo.executor_id();
+
+    ASSERT_SOME(slave::state::checkpoint(
+        paths::getExecutorInfoPath(rootDir, slaveId, frameworkId, executorId),
+        executorInfo));
+
+    ContainerID containerId;
+    containerId.set_value(id::UUID::random().toString());
+
+    ASSERT_SOME(paths::createExecutorDirectory(
+        rootDir, slaveId, frameworkId, executorId, containerId));
+
+    ASSERT_SOME(os::touch(paths::getExecutorSentinelPath(
+        rootDir, slaveId, frameworkId, executorId, containerId)));
+
+    ASSERT_SOME(slave::state::checkpoint(
+        paths::getForkedPidPath(
+            rootDir, slaveId, frameworkId, executorId, containerId),
+        string("1")));
+
+    ASSERT_SOME(slave::state::checkpoint(
+        paths::getLibprocessPidPath(
+            rootDir, slaveId, frameworkId, executorId, containerId),
+        string("executor(1)@127.0.0.1:5051")));
+
+    for (size_t j = 0; j < tasks; j++) {
+      Task task;
+      task.set_name("task");
+      task.mutable_task_id()->set_value(
+          "task-" + stringify(i) + "-" + stringify(j));
+      task.mutable_framework_id()->CopyFrom(frameworkId);
+      task.mutable_executor_id()->CopyFrom(executorId);
+      task.mutable_slave_id()->CopyFrom(slaveId);
+      task.set_state(TASK_STAGING);
+
+      ASSERT_SOME(slave::state::checkpoint(
+          paths::getTaskInfoPath(
+              rootDir,
+              slaveId,
+              frameworkId,
+              executorId,
+              containerId,
+              task.task_id()),
+          task));
+
+      const id::UUID uuid = id::UUID::random();
+
+      RepeatedPtrField<StatusUpdateRecord> records;
+
+      StatusUpdateRecord* record = records.Add();
+      record->set_type(StatusUpdateRecord::UPDATE);
+      record->mutable_update()->CopyFrom(
+          mesos::internal::protobuf::createStatusUpdate(
+              frameworkId,
+              slaveId,
+              task.task_id(),
+              TASK_FINISHED,
+              TaskStatus::SOURCE_EXECUTOR,
+              uuid));
+
+      record = records.Add();
+      record->set_type(StatusUpdateRecord::ACK);
+      record->set_uuid(uuid.toBytes());
+
+      ASSERT_SOME(::protobuf::write(
+          paths::getTaskUpdatesPath(
+              rootDir,
+              slaveId,
+              frameworkId,
+              executorId,
+              containerId,
+              task.task_id()),
+          records));
+    }
+  }
+}
+
+
+// This test verifies that the tasks of the completed executor runs
+// are recovered from their index once it has been written.
+TEST_F(SlaveStateTest, RecoverTasksIndex)
+{
+  const string rootDir = path::join(os::getcwd(), "meta");
+
+  SlaveID slaveId;
+  slaveId.set_value("agent");
+
+  FrameworkID frameworkId;
+  frameworkId.set_value("framework");
+
+  createMetaDir(rootDir, slaveId, frameworkId, 4, 2);
+
+  // The first recovery indexes the tasks.
+  Try<slave::state::State> state =
+    slave::state::recover(rootDir, true, 2, true);
+
+  ASSERT_SOME(state);
+  ASSERT_SOME(state->slave);
+  ASSERT_TRUE(state->slave->frameworks.contains(frameworkId));
+
+  const slave::state::FrameworkState& framework =
+    state->slave->frameworks.at(frameworkId);
+
+  ASSERT_EQ(4u, framework.executors.size());
+
+  foreachvalue (const slave::state::ExecutorState& executor,
+                framework.executors) {
+    ASSERT_SOME(executor.latest);
+
+    const ContainerID& containerId = executor.latest.get();
+
+    ASSERT_TRUE(executor.runs.contains(containerId));
+    EXPECT_TRUE(executor.runs.at(containerId).completed);
+    EXPECT_EQ(2u, executor.runs.at(containerId).tasks.size());
+
+    EXPECT_TRUE(os::exists(paths::getTasksIndexPath(
+        rootDir, slaveId, frameworkId, executor.id, containerId)));
+
+    // Remove the checkpoints of the tasks to ensure that the next
+    // recovery reads the index.
+    foreachkey (const TaskID& taskId, executor.runs.at(containerId).tasks) {
+      ASSERT_SOME(os::rmdir(paths::getTaskPath(
+          rootDir, slaveId, frameworkId, executor.id, containerId, taskId)));
+    }
+  }
+
+  state = slave::state::recover(rootDir, true, 2, true);
+
+  ASSERT_SOME(state);
+  ASSERT_SOME(state->slave);
+  ASSERT_TRUE(state->slave->frameworks.contains(frameworkId));
+  ASSERT_EQ(4u, state->slave->frameworks.at(frameworkId).executors.size());
+
+  foreachvalue (const slave::state::ExecutorState& executor,
+                state->slave->frameworks.at(frameworkId).executors) {
+    ASSERT_SOME(executor.latest);
+
+    const slave::state::RunState& run =
+      executor.runs.at(executor.latest.get());
+
+    ASSERT_EQ(2u, run.tasks.size());
+
+    foreachvalue (const slave::state::TaskState& task, run.tasks) {
+      ASSERT_SOME(task.info);
+      ASSERT_EQ(1u, task.updates.size());
+      EXPECT_EQ(TASK_FINISHED, task.updates.front().status().state());
+      EXPECT_EQ(1u, task.acks.size());
+    }
+  }
+}
+
+
+class SlaveState_BENCHMARK_Test
+  : public TemporaryDirectoryTest,
+    public WithParamInterface<tuple<size_t, size_t>> {};
+
+
+// The agent state recovery benchmark is parameterized by the number of
+// executors and the number of tasks per executor.
+INSTANTIATE_TEST_CASE_P(
+    ExecutorsAndTasks,
+    SlaveState_BENCHMARK_Test,
+    ::testing::Values(
+        std::make_tuple(1000U, 1U),
+        std::make_tuple(1000U, 10U),
+        std::make_tuple(10000U, 1U),
+        std::make_tuple(10000U, 5U)));
+
+
+// Measures the time to recover the state of an agent from a synthetic
+// meta directory, sequentially, in parallel, and using the index of
+// the tasks of the completed executor runs.
+// NOTE: The meta directory is in the page cache after it is created,
+// hence this does not account for the latency of the disk.
+TEST_P(SlaveState_BENCHMARK_Test, Recover)
+{
+  size_t executors;
+  size_t tasks;
+  std::tie(executors, tasks) = GetParam();
+
+  const string rootDir = path::join(os::getcwd(), "meta");
+
+  SlaveID slaveId;
+  slaveId.set_value("agent");
+
+  FrameworkID frameworkId;
+  frameworkId.set_value("framework");
+
+  createMetaDir(rootDir, slaveId, frameworkId, executors, tasks);
+
+  cout << "Created a meta directory with " << executors << " executors"
+       << " and " << tasks << " tasks per executor" << endl;
+
+  auto recover = [&](const string& name, size_t concurrency, bool index) {
+    Stopwatch watch;
+    watch.start();
+
+    Try<slave::state::State> state =
+      slave::state::recover(rootDir, true, concurrency, index);
+
+    watch.stop();
+
+    ASSERT_SOME(state);
+    ASSERT_SOME(state->slave);
+    ASSERT_EQ(
+        executors,
+        state->slave->frameworks.at(frameworkId).executors.size());
+
+    cout << "Recovered " << name << " in " << watch.elapsed() << endl;
+  };
+
+  recover("sequentially", 1, false);
+  recover("using 8 threads", 8, false);
+
+  // The first recovery using the index writes it.
+  recover("using 8 threads while writing the index", 8, true);
+  recover("using 8 threads and the index", 8, true);
+}
+
+
 template <typename T>
 class SlaveRecoveryTest : public ContainerizerTest<T>
 {
@@ -28,10 +28,15 @@
 #include <process/owned.hpp>
 #include <process/pid.hpp>
 
+#include <stout/bytes.hpp>
 #include <stout/none.hpp>
 #include <stout/result.hpp>
 #include <stout/try.hpp>
 
+#include <stout/os/exists.hpp>
+#include <stout/os/rmdir.hpp>
+#include <stout/os/stat.hpp>
+
 #include "master/master.hpp"
 
 #include "slave/constants.hpp"
@@ -184,6 +189,256 @@ TEST_F_TEMP_DISABLED_ON_WINDOWS(
 }
 
 
+// This test verifies that the status updates and acknowledgements
+// of a task are checkpointed when the agent journals them.
+TEST_F_TEMP_DISABLED_ON_WINDOWS(
+    TaskStatusUpdateManagerTest, JournalStatusUpdate)
+{
+  Try<Owned<cluster::Master>> master = StartMaster();
+  ASSERT_SOME(master);
+
+  MockExecutor exec(DEFAULT_EXECUTOR_ID);
+  TestContainerizer containerizer(&exec);
+
+  // Require flags to retrieve work_dir when recovering
+  // the checkpointed data.
+  slave::Flags flags = CreateSlaveFlags();
+  flags.status_update_journal = true;
+
+  Owned<MasterDetector> detector = master.get()->createDetector();
+
+  Try<Owned<cluster::Slave>> slave =
+    StartSlave(detector.get(), &containerizer, flags);
+  ASSERT_SOME(slave);
+  FrameworkInfo frameworkInfo = DEFAULT_FRAMEWORK_INFO;
+  frameworkInfo.set_checkpoint(true); // Enable checkpointing.
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(
+      &sched, frameworkInfo, master.get()->pid, DEFAULT_CREDENTIAL);
+
+  Future<FrameworkID> frameworkId;
+  EXPECT_CALL(sched, registered(_, _, _))
+    .WillOnce(FutureArg<1>(&frameworkId));
+
+  Future<vector<Offer>> offers;
+  EXPECT_CALL(sched, resourceOffers(_, _))
+    .WillOnce(FutureArg<1>(&offers))
+    .WillRepeatedly(Return()); // Ignore subsequent offers.
+
+  driver.start();
+
+  AWAIT_READY(frameworkId);
+  AWAIT_READY(offers);
+  ASSERT_FALSE(offers->empty());
+
+  EXPECT_CALL(exec, registered(_, _, _, _));
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdateFromTask(TASK_RUNNING));
+
+  Future<TaskStatus> status;
+  EXPECT_CALL(sched, statusUpdate(_, _))
+    .WillOnce(FutureArg<1>(&status));
+
+  Future<Nothing> _statusUpdateAcknowledgement =
+    FUTURE_DISPATCH(slave.get()->pid, &Slave::_statusUpdateAcknowledgement);
+
+  driver.launchTasks(offers.get()[0].id(), createTasks(offers.get()[0]));
+
+  AWAIT_READY(status);
+  EXPECT_EQ(TASK_RUNNING, status->state());
+
+  AWAIT_READY(_statusUpdateAcknowledgement);
+
+  // The records are in the journal until it is compacted.
+  const string metaDir = slave::paths::getMetaRootDir(flags.work_dir);
+  const string journal = slave::paths::getStatusUpdateJournalPath(metaDir);
+
+  Try<Bytes> size = os::stat::size(journal);
+  ASSERT_SOME(size);
+  EXPECT_GT(size.get(), Bytes(0));
+
+  // Ensure that both the status update and its acknowledgement are
+  // correctly checkpointed.
+  Result<slave::state::State> state =
+    slave::state::recover(metaDir, true);
+
+  ASSERT_SOME(state);
+
+  // Reading the state of the running agent must not drop the records
+  // of its journal.
+  EXPECT_SOME_EQ(size.get(), os::stat::size(journal));
+  ASSERT_SOME(state->slave);
+  ASSERT_TRUE(state->slave->frameworks.contains(frameworkId.get()));
+
+  slave::state::FrameworkState frameworkState =
+    state->slave->frameworks.at(frameworkId.get());
+
+  ASSERT_EQ(1u, frameworkState.executors.size());
+
+  slave::state::ExecutorState executorState =
+    frameworkState.executors.begin()->second;
+
+  ASSERT_EQ(1u, executorState.runs.size());
+
+  slave::state::RunState runState = executorState.runs.begin()->second;
+
+  ASSERT_EQ(1u, runState.tasks.size());
+
+  slave::state::TaskState taskState = runState.tasks.begin()->second;
+
+  EXPECT_EQ(1u, taskState.updates.size());
+  EXPECT_EQ(1u, taskState.acks.size());
+
+  EXPECT_CALL(exec, shutdown(_))
+    .Times(AtMost(1));
+
+  driver.stop();
+  driver.join();
+}
+
+
+// This test verifies that the agent indexes the tasks of an executor
+// run when the run completes, including the status updates which are
+// still in the status update journal.
+TEST_F_TEMP_DISABLED_ON_WINDOWS(
+    TaskStatusUpdateManagerTest, JournalTasksIndex)
+{
+  Try<Owned<cluster::Master>> master = StartMaster();
+  ASSERT_SOME(master);
+
+  MockExecutor exec(DEFAULT_EXECUTOR_ID);
+  TestContainerizer containerizer(&exec);
+
+  slave::Flags flags = CreateSlaveFlags();
+  flags.status_update_journal = true;
+  flags.recovery_index = true;
+
+  Owned<MasterDetector> detector = master.get()->createDetector();
+
+  Try<Owned<cluster::Slave>> slave =
+    StartSlave(detector.get(), &containerizer, flags);
+  ASSERT_SOME(slave);
+
+  FrameworkInfo frameworkInfo = DEFAULT_FRAMEWORK_INFO;
+  frameworkInfo.set_checkpoint(true); // Enable checkpointing.
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(
+      &sched, frameworkInfo, master.get()->pid, DEFAULT_CREDENTIAL);
+
+  Future<FrameworkID> frameworkId;
+  EXPECT_CALL(sched, registered(_, _, _))
+    .WillOnce(FutureArg<1>(&frameworkId));
+
+  Future<vector<Offer>> offers;
+  EXPECT_CALL(sched, resourceOffers(_, _))
+    .WillOnce(FutureArg<1>(&offers))
+    .WillRepeatedly(Return()); // Ignore subsequent offers.
+
+  driver.start();
+
+  AWAIT_READY(frameworkId);
+  AWAIT_READY(offers);
+  ASSERT_FALSE(offers->empty());
+
+  EXPECT_CALL(exec, registered(_, _, _, _));
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdateFromTask(TASK_FINISHED));
+
+  Future<TaskStatus> status;
+  EXPECT_CALL(sched, statusUpdate(_, _))
+    .WillOnce(FutureArg<1>(&status));
+
+  Future<Nothing> _statusUpdateAcknowledgement =
+    FUTURE_DISPATCH(slave.get()->pid, &Slave::_statusUpdateAcknowledgement);
+
+  driver.launchTasks(offers.get()[0].id(), createTasks(offers.get()[0]));
+
+  AWAIT_READY(status);
+  EXPECT_EQ(TASK_FINISHED, status->state());
+
+  AWAIT_READY(_statusUpdateAcknowledgement);
+
+  Future<Nothing> executorTerminated =
+    FUTURE_DISPATCH(_, &Slave::executorTerminated);
+
+  // Terminate the executor, which completes its run.
+  EXPECT_CALL(exec, shutdown(_))
+    .Times(AtMost(1));
+
+  driver.stop();
+  driver.join();
+
+  AWAIT_READY(executorTerminated);
+
+  // Wait for the index to be written.
+  Clock::pause();
+  Clock::settle();
+  Clock::resume();
+
+  const string metaDir = slave::paths::getMetaRootDir(flags.work_dir);
+
+  Result<slave::state::State> state = slave::state::recover(metaDir, true);
+
+  ASSERT_SOME(state);
+  ASSERT_SOME(state->slave);
+  ASSERT_TRUE(state->slave->frameworks.contains(frameworkId.get()));
+
+  const slave::state::FrameworkState& framework =
+    state->slave->frameworks.at(frameworkId.get());
+
+  ASSERT_EQ(1u, framework.executors.size());
+
+  const slave::state::ExecutorState& executor =
+    framework.executors.begin()->second;
+
+  ASSERT_SOME(executor.latest);
+
+  const ContainerID& containerId = executor.latest.get();
+
+  ASSERT_TRUE(executor.runs.contains(containerId));
+  ASSERT_TRUE(executor.runs.at(containerId).completed);
+
+  EXPECT_TRUE(os::exists(slave::paths::getTasksIndexPath(
+      metaDir,
+      state->slave->id,
+      frameworkId.get(),
+      executor.id,
+      containerId)));
+
+  // Remove the checkpoints of the tasks to ensure that the recovery
+  // reads the index.
+  foreachkey (const TaskID& taskId, executor.runs.at(containerId).tasks) {
+    ASSERT_SOME(os::rmdir(slave::paths::getTaskPath(
+        metaDir,
+        state->slave->id,
+        frameworkId.get(),
+        executor.id,
+        containerId,
+        taskId)));
+  }
+
+  state = slave::state::recover(metaDir, true, 1, true);
+
+  ASSERT_SOME(state);
+  ASSERT_SOME(state->slave);
+
+  const slave::state::RunState& run = state->slave->frameworks
+    .at(frameworkId.get()).executors.begin()->second.runs.at(containerId);
+
+  ASSERT_EQ(1u, run.tasks.size());
+
+  const slave::state::TaskState& task = run.tasks.begin()->second;
+
+  ASSERT_EQ(1u, task.updates.size());
+  EXPECT_EQ(TASK_FINISHED, task.updates.front().status().state());
+  EXPECT_EQ(1u, task.acks.size());
+}
+
+
 TEST_F(TaskStatusUpdateManagerTest, RetryStatusUpdate)
 {
   Try<Owned<cluster::Master>> master = StartMaster();
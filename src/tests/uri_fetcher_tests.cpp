@@ -60,6 +60,7 @@ using process::Owned;
 using process::Process;
 
 using testing::_;
+using testing::Invoke;
 using testing::Return;
 
 namespace mesos {
@@ -485,6 +486,146 @@ TEST_F(DockerFetcherPluginTest, DISABLED_INTERNET_CURL_InvokeFetchByName)
             manifest->layers(i).digest())));
   }
 }
+
+
+// A stand-in for a Docker registry serving the blobs of 'library/test'.
+// Its ID is 'v2' so that it serves the registry API under '/v2'.
+class TestRegistry : public Process<TestRegistry>
+{
+public:
+  TestRegistry() : ProcessBase("v2")
+  {
+    route("/library/test/blobs", None(), &TestRegistry::blobs);
+    route("/token", None(), &TestRegistry::token);
+  }
+
+  MOCK_METHOD1(blobs, Future<http::Response>(const http::Request&));
+  MOCK_METHOD1(token, Future<http::Response>(const http::Request&));
+};
+
+
+class DockerFetcherPluginNativeClientTest : public TemporaryDirectoryTest
+{
+protected:
+  void SetUp() override
+  {
+    TemporaryDirectoryTest::SetUp();
+
+    spawn(registry);
+  }
+
+  void TearDown() override
+  {
+    terminate(registry);
+    wait(registry);
+
+    TemporaryDirectoryTest::TearDown();
+  }
+
+  Try<Owned<uri::Fetcher::Plugin>> createPlugin()
+  {
+    DockerFetcherPlugin::Flags flags;
+    flags.docker_registry_native_client = true;
+
+    return DockerFetcherPlugin::create(flags);
+  }
+
+  URI blob(const string& digest)
+  {
+    return uri::docker::blob(
+        "library/test",
+        digest,
+        stringify(registry.self().address.ip),
+        "http",
+        registry.self().address.port);
+  }
+
+  TestRegistry registry;
+};
+
+
+// This test verifies that the native client authenticates with the
+// auth service of the registry only once for the blobs of a repository.
+TEST_F(DockerFetcherPluginNativeClientTest, CachedAuthToken)
+{
+  const string challenge =
+    "Bearer realm=\"http://" + stringify(registry.self().address) +
+    "/v2/token\",service=\"registry\",scope=\"repository:library/test:pull\"";
+
+  EXPECT_CALL(registry, blobs(_))
+    .WillRepeatedly(Invoke([=](const http::Request& request) -> http::Response {
+      Option<string> authorization = request.headers.get("Authorization");
+      if (authorization != string("Bearer token")) {
+        return http::Unauthorized({challenge});
+      }
+
+      return http::OK("blob");
+    }));
+
+  EXPECT_CALL(registry, token(_))
+    .WillOnce(Return(http::OK("{\"token\": \"token\", \"expires_in\": 300}")));
+
+  Try<Owned<uri::Fetcher::Plugin>> plugin = createPlugin();
+  ASSERT_SOME(plugin);
+
+  const string dir = path::join(os::getcwd(), "dir");
+
+  AWAIT_READY(plugin.get()->fetch(blob("sha256:1"), dir));
+  AWAIT_READY(plugin.get()->fetch(blob("sha256:2"), dir));
+
+  EXPECT_SOME_EQ(
+      "blob",
+      os::read(DockerFetcherPlugin::getBlobPath(dir, "sha256:1")));
+
+  EXPECT_SOME_EQ(
+      "blob",
+      os::read(DockerFetcherPlugin::getBlobPath(dir, "sha256:2")));
+}
+
+
+// This test verifies that the native client resumes the download of
+// a blob from where it stopped when the connection breaks.
+TEST_F(DockerFetcherPluginNativeClientTest, ResumeBlobDownload)
+{
+  const string data = string(1024, 'a') + string(1024, 'b');
+
+  EXPECT_CALL(registry, blobs(_))
+    .WillOnce(Invoke([=](const http::Request& request) -> http::Response {
+      // Break the connection after the first half of the blob.
+      http::Pipe pipe;
+      http::Pipe::Writer writer = pipe.writer();
+      writer.write(data.substr(0, 1024));
+      writer.fail("Connection broken");
+
+      http::OK response;
+      response.type = http::Response::PIPE;
+      response.reader = pipe.reader();
+
+      return response;
+    }))
+    .WillOnce(Invoke([=](const http::Request& request) -> http::Response {
+      Option<string> range = request.headers.get("Range");
+      if (range != string("bytes=1024-")) {
+        return http::BadRequest("Unexpected range");
+      }
+
+      http::Response response(data.substr(1024), http::Status::PARTIAL_CONTENT);
+      response.headers["Content-Range"] = "bytes 1024-2047/2048";
+
+      return response;
+    }));
+
+  Try<Owned<uri::Fetcher::Plugin>> plugin = createPlugin();
+  ASSERT_SOME(plugin);
+
+  const string dir = path::join(os::getcwd(), "dir");
+
+  AWAIT_READY(plugin.get()->fetch(blob("sha256:1"), dir));
+
+  EXPECT_SOME_EQ(
+      data,
+      os::read(DockerFetcherPlugin::getBlobPath(dir, "sha256:1")));
+}
 #endif // __WINDOWS__
 
 
@@ -0,0 +1,316 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <process/defer.hpp>
+#include <process/dispatch.hpp>
+#include <process/id.hpp>
+#include <process/loop.hpp>
+#include <process/process.hpp>
+
+#include <stout/check.hpp>
+#include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/lambda.hpp>
+#include <stout/option.hpp>
+#include <stout/stringify.hpp>
+#include <stout/strings.hpp>
+
+#include "uri/connection_pool.hpp"
+
+namespace http = process::http;
+
+using std::deque;
+using std::string;
+using std::vector;
+
+using process::Break;
+using process::Continue;
+using process::ControlFlow;
+using process::Failure;
+using process::Future;
+using process::Owned;
+using process::Process;
+using process::Promise;
+
+using process::defer;
+using process::dispatch;
+using process::loop;
+using process::spawn;
+using process::terminate;
+using process::wait;
+
+namespace mesos {
+namespace uri {
+
+// Returns the key of the server that the request is sent to.
+static string getServerKey(const http::URL& url)
+{
+  return url.scheme.getOrElse("http") + "://" +
+    (url.domain.isSome() ? url.domain.get() : stringify(url.ip.get())) +
+    ":" + (url.port.isSome() ? stringify(url.port.get()) : "");
+}
+
+
+// Returns whether the server closes the connection after the response.
+static bool closes(const http::Response& response)
+{
+  Option<string> connection = response.headers.get("Connection");
+
+  return connection.isSome() && strings::lower(connection.get()) == "close";
+}
+
+
+class ConnectionPoolProcess : public Process<ConnectionPoolProcess>
+{
+public:
+  explicit ConnectionPoolProcess(size_t _maxConnections)
+    : ProcessBase(process::ID::generate("connection-pool")),
+      maxConnections(_maxConnections) {}
+
+  Future<http::Response> send(const http::Request& request, bool streamed);
+
+protected:
+  void finalize() override
+  {
+    foreachvalue (const Server& server, servers) {
+      foreach (http::Connection connection, server.idle) {
+        connection.disconnect();
+      }
+    }
+  }
+
+private:
+  // The connections to a single server.
+  struct Server
+  {
+    // The number of open connections, both idle and busy ones.
+    size_t connections = 0;
+
+    vector<http::Connection> idle;
+
+    // The requests waiting for a connection to become idle.
+    deque<Owned<Promise<Nothing>>> waiters;
+  };
+
+  Future<http::Connection> connect(const string& key, const http::URL& url);
+
+  Future<http::Response> _send(
+      const string& key,
+      const http::Request& request,
+      bool streamed,
+      http::Connection connection);
+
+  // Returns a connection to the pool once a response has been
+  // received over it, or frees its slot if it cannot be reused.
+  void release(const string& key, const Option<http::Connection>& connection);
+
+  const size_t maxConnections;
+
+  hashmap<string, Server> servers;
+};
+
+
+Future<http::Response> ConnectionPoolProcess::send(
+    const http::Request& request,
+    bool streamed)
+{
+  const string key = getServerKey(request.url);
+
+  Server& server = servers[key];
+
+  if (!server.idle.empty()) {
+    http::Connection connection = server.idle.back();
+    server.idle.pop_back();
+
+    // NOTE: The server might have closed the idle connection in the
+    // meantime, in which case the request is sent again.
+    return _send(key, request, streamed, connection)
+      .repair(defer(self(), [=](const Future<http::Response>& response) {
+        VLOG(1) << "Retrying request to '" << key << "' on another "
+                << "connection: " << response.failure();
+
+        return send(request, streamed);
+      }));
+  }
+
+  if (server.connections < maxConnections) {
+    return connect(key, request.url)
+      .then(defer(self(), &Self::_send, key, request, streamed, lambda::_1));
+  }
+
+  Owned<Promise<Nothing>> promise(new Promise<Nothing>());
+  server.waiters.push_back(promise);
+
+  return promise->future()
+    .then(defer(self(), &Self::send, request, streamed));
+}
+
+
+Future<http::Connection> ConnectionPoolProcess::connect(
+    const string& key,
+    const http::URL& url)
+{
+  servers[key].connections++;
+
+  return http::connect(url)
+    .onAny(defer(self(), [=](const Future<http::Connection>& connection) {
+      if (!connection.isReady()) {
+        release(key, None());
+      }
+    }));
+}
+
+
+Future<http::Response> ConnectionPoolProcess::_send(
+    const string& key,
+    const http::Request& request,
+    bool streamed,
+    http::Connection connection)
+{
+  http::Request _request = request;
+  _request.keepAlive = true;
+
+  return connection.send(_request, streamed)
+    .repair(defer(self(), [=](const Future<http::Response>& response)
+        -> Future<http::Response> {
+      http::Connection _connection = connection;
+      _connection.disconnect();
+
+      release(key, None());
+
+      return response;
+    }))
+    .then(defer(self(), [=](const http::Response& response)
+        -> http::Response {
+      const bool reusable = !closes(response);
+
+      if (response.type != http::Response::PIPE) {
+        if (reusable) {
+          release(key, connection);
+        } else {
+          http::Connection _connection = connection;
+          _connection.disconnect();
+
+          release(key, None());
+        }
+
+        return response;
+      }
+
+      // The connection can only be reused once the body has been read,
+      // so the body is passed on through another pipe to find out when.
+      CHECK_SOME(response.reader);
+
+      http::Pipe pipe;
+      http::Pipe::Reader reader = response.reader.get();
+      http::Pipe::Writer writer = pipe.writer();
+
+      loop(
+          self(),
+          [=]() mutable {
+            return reader.read();
+          },
+          [=](const string& data) mutable -> Future<ControlFlow<Nothing>> {
+            if (data.empty()) {
+              writer.close();
+              return Break();
+            }
+
+            if (!writer.write(data)) {
+              return Failure("The response body is no longer read");
+            }
+
+            return Continue();
+          })
+        .onAny(defer(self(), [=](const Future<Nothing>& body) mutable {
+          if (body.isReady() && reusable) {
+            release(key, connection);
+            return;
+          }
+
+          if (!body.isReady()) {
+            writer.fail(body.isFailed() ? body.failure() : "discarded");
+            reader.close();
+          }
+
+          http::Connection _connection = connection;
+          _connection.disconnect();
+
+          release(key, None());
+        }));
+
+      http::Response result = response;
+      result.reader = pipe.reader();
+
+      return result;
+    }));
+}
+
+
+void ConnectionPoolProcess::release(
+    const string& key,
+    const Option<http::Connection>& connection)
+{
+  Server& server = servers[key];
+
+  if (connection.isSome()) {
+    server.idle.push_back(connection.get());
+  } else {
+    CHECK_GT(server.connections, 0u);
+    server.connections--;
+  }
+
+  // Let the next waiting request use the connection or its slot.
+  if (!server.waiters.empty()) {
+    Owned<Promise<Nothing>> waiter = server.waiters.front();
+    server.waiters.pop_front();
+
+    waiter->set(Nothing());
+  }
+}
+
+
+ConnectionPool::ConnectionPool(size_t maxConnections)
+  : process(new ConnectionPoolProcess(maxConnections))
+{
+  spawn(process.get());
+}
+
+
+ConnectionPool::~ConnectionPool()
+{
+  terminate(process.get());
+  wait(process.get());
+}
+
+
+Future<http::Response> ConnectionPool::send(
+    const http::Request& request,
+    bool streamedResponse) const
+{
+  return dispatch(
+      process.get(),
+      &ConnectionPoolProcess::send,
+      request,
+      streamedResponse);
+}
+
+} // namespace uri {
+} // namespace mesos {
@@ -0,0 +1,59 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __URI_CONNECTION_POOL_HPP__
+#define __URI_CONNECTION_POOL_HPP__
+
+#include <process/future.hpp>
+#include <process/http.hpp>
+#include <process/owned.hpp>
+
+namespace mesos {
+namespace uri {
+
+// Forward declarations.
+class ConnectionPoolProcess;
+
+
+// Sends HTTP requests over persistent connections, which are kept
+// open and reused for the following requests to the same server.
+// At most `maxConnections` connections are opened to each server;
+// further requests wait for one of them to become idle.
+class ConnectionPool
+{
+public:
+  explicit ConnectionPool(size_t maxConnections);
+
+  ~ConnectionPool();
+
+  // Sends the request to the server of its URL. If `streamedResponse`
+  // is set, the response body is of type 'PIPE' and the connection is
+  // only reused once the body has been read until its end.
+  process::Future<process::http::Response> send(
+      const process::http::Request& request,
+      bool streamedResponse = false) const;
+
+private:
+  ConnectionPool(const ConnectionPool&) = delete;
+  ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+  process::Owned<ConnectionPoolProcess> process;
+};
+
+} // namespace uri {
+} // namespace mesos {
+
+#endif // __URI_CONNECTION_POOL_HPP__
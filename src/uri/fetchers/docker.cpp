@@ -14,32 +14,40 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <memory>
 #include <string>
 #include <tuple>
 #include <vector>
 
+#include <process/clock.hpp>
 #include <process/collect.hpp>
 #include <process/dispatch.hpp>
 #include <process/http.hpp>
 #include <process/id.hpp>
 #include <process/io.hpp>
+#include <process/loop.hpp>
 #include <process/once.hpp>
 #include <process/process.hpp>
+#include <process/shared.hpp>
 #include <process/subprocess.hpp>
 
 #include <stout/none.hpp>
 #include <stout/option.hpp>
 #include <stout/strings.hpp>
 
+#include <stout/os/close.hpp>
 #include <stout/os/constants.hpp>
 #include <stout/os/exec.hpp>
 #include <stout/os/getenv.hpp>
 #include <stout/os/kill.hpp>
 #include <stout/os/mkdir.hpp>
+#include <stout/os/open.hpp>
 #include <stout/os/write.hpp>
 
 #include <mesos/docker/spec.hpp>
 
+#include "uri/connection_pool.hpp"
 #include "uri/utils.hpp"
 
 #include "uri/fetchers/docker.hpp"
@@ -61,10 +69,14 @@ using process::spawn;
 using process::terminate;
 using process::wait;
 
+using process::Break;
+using process::Continue;
+using process::ControlFlow;
 using process::Failure;
 using process::Future;
 using process::Owned;
 using process::Process;
+using process::Shared;
 using process::Subprocess;
 
 namespace mesos {
@@ -251,7 +263,12 @@ static Future<http::Response> curl(
 }
 
 
-// TODO(jieyu): Add a comment here.
+// Uses the curl command to download the given URL to 'blobPath' and
+// returns the HTTP response code. Redirects are followed without the
+// given headers, which are only meant for the registry.
+//
+// NOTE: Only the body of a successful response is written to
+// 'blobPath', which might be a FIFO that the blob is streamed from.
 static Future<int> download(
     const string& uri,
     const string& blobPath,
@@ -262,6 +279,9 @@ static Future<int> download(
     "curl",
     "-s",                 // Don't show progress meter or error messages.
     "-S",                 // Make curl show an error message if it fails.
+    "-f",                 // Don't write the body of HTTP errors.
+    "-L",                 // Don't write the body of redirects, which
+    "--max-redirs", "0",  // are followed below instead.
     "-w", "%{http_code}\n%{redirect_url}", // Display HTTP response code and the redirected URL. // NOLINT(whitespace/line_length)
     "-o", blobPath        // Write output to the file.
   };
@@ -313,7 +333,12 @@ static Future<int> download(
         return Failure("Failed to reap the curl subprocess for '" + uri + "'");
       }
 
-      if (status->get() != 0) {
+      // An HTTP error (22) or a redirect (47) still yields the response
+      // code below. See: https://curl.se/libcurl/c/libcurl-errors.html
+      if (status->get() != 0 &&
+          !(WIFEXITED(status->get()) &&
+            (WEXITSTATUS(status->get()) == 22 ||
+             WEXITSTATUS(status->get()) == 47))) {
         const Future<string>& error = std::get<2>(t);
         if (!error.isReady()) {
           return Failure(
@@ -365,6 +390,18 @@ static Future<int> download(
 }
 
 
+// Returns the blob sum (i.e., the last component) of a blob URI.
+static string getBlobSum(const URI& uri)
+{
+  auto lastSlash = uri.path().find_last_of('/');
+  if (lastSlash == string::npos) {
+    return uri.path();
+  }
+
+  return uri.path().substr(lastSlash + 1);
+}
+
+
 static Future<int> download(
     const URI& uri,
     const string& url,
@@ -372,23 +409,333 @@ static Future<int> download(
     const http::Headers& headers,
     const Option<Duration>& stallTimeout)
 {
-  string blobSum;
-
-  auto lastSlash = uri.path().find_last_of('/');
-  if (lastSlash == string::npos) {
-    blobSum = uri.path();
-  } else {
-    blobSum = uri.path().substr(lastSlash + 1);
-  }
-
   return download(
       url,
-      DockerFetcherPlugin::getBlobPath(directory, blobSum),
+      DockerFetcherPlugin::getBlobPath(directory, getBlobSum(uri)),
       headers,
       stallTimeout);
 }
 
 
+//-------------------------------------------------------------------
+// Native HTTP client based utility functions.
+//-------------------------------------------------------------------
+
+// Redirects are followed up to this many times, like curl does.
+constexpr size_t MAX_REDIRECTS = 50;
+
+// Interrupted downloads are resumed up to this many times.
+constexpr size_t MAX_DOWNLOAD_RESUMES = 3;
+
+
+// Returns the URL a '3xx' response redirects to, if any. Relative
+// locations are resolved against the server of the request.
+static Option<string> getRedirectUrl(
+    const http::URL& url,
+    const http::Response& response)
+{
+  if (response.code / 100 != 3) {
+    return None();
+  }
+
+  Option<string> location = response.headers.get("Location");
+  if (location.isNone() || !strings::startsWith(location.get(), "/")) {
+    return location;
+  }
+
+  return url.scheme.getOrElse("http") + "://" +
+    (url.domain.isSome() ? url.domain.get() : stringify(url.ip.get())) +
+    (url.port.isSome() ? ":" + stringify(url.port.get()) : "") +
+    location.get();
+}
+
+
+// Returns whether both URLs are served by the same server.
+static bool isSameServer(const http::URL& url, const string& other)
+{
+  Try<http::URL> _other = http::URL::parse(other);
+
+  return _other.isSome() &&
+    _other->scheme == url.scheme &&
+    _other->domain == url.domain &&
+    _other->ip == url.ip &&
+    _other->port == url.port;
+}
+
+
+// Uses the native HTTP client to send a GET request to the given URL
+// and returns the last response, like the curl based 'curl' above.
+// Redirects are followed, but the given headers are only sent to the
+// server of the given URL.
+static Future<http::Response> get(
+    const Shared<ConnectionPool>& pool,
+    const string& url,
+    const http::Headers& headers,
+    const Option<Duration>& stallTimeout,
+    size_t redirects = 0)
+{
+  Try<http::URL> _url = http::URL::parse(strings::trim(url));
+  if (_url.isError()) {
+    return Failure("Failed to parse URL '" + url + "': " + _url.error());
+  }
+
+  http::Request request;
+  request.method = "GET";
+  request.url = _url.get();
+  request.headers = headers;
+
+  Future<http::Response> response = pool->send(request);
+
+  if (stallTimeout.isSome()) {
+    response = response.after(
+        stallTimeout.get(),
+        [url](Future<http::Response> response) -> Future<http::Response> {
+          response.discard();
+          return Failure("Timed out waiting for a response from '" + url + "'");
+        });
+  }
+
+  return response
+    .then([=](const http::Response& response) -> Future<http::Response> {
+      Option<string> redirect = getRedirectUrl(_url.get(), response);
+      if (redirect.isNone()) {
+        return response;
+      }
+
+      if (redirects >= MAX_REDIRECTS) {
+        return Failure("Too many redirects when requesting '" + url + "'");
+      }
+
+      return get(
+          pool,
+          redirect.get(),
+          isSameServer(_url.get(), redirect.get()) ? headers : http::Headers(),
+          stallTimeout,
+          redirects + 1);
+    });
+}
+
+
+// The state of a blob download with the native HTTP client.
+struct Download
+{
+  Download(
+      const Shared<ConnectionPool>& _pool,
+      const http::URL& _url,
+      const string& _blobPath,
+      const http::Headers& _headers,
+      const Option<Duration>& _stallTimeout,
+      size_t _redirects)
+    : pool(_pool),
+      url(_url),
+      blobPath(_blobPath),
+      headers(_headers),
+      stallTimeout(_stallTimeout),
+      redirects(_redirects) {}
+
+  ~Download()
+  {
+    if (fd.isSome()) {
+      os::close(fd.get());
+    }
+  }
+
+  const Shared<ConnectionPool> pool;
+  const http::URL url;
+  const string blobPath;
+  const http::Headers headers;
+  const Option<Duration> stallTimeout;
+  const size_t redirects;
+
+  // The blob file, which is only opened once the blob is received.
+  Option<int_fd> fd;
+
+  // The number of bytes written to the blob file so far.
+  size_t offset = 0;
+
+  size_t resumes = 0;
+};
+
+
+static Future<int> _download(const std::shared_ptr<Download>& download);
+
+
+// Uses the native HTTP client to download the given URL to 'blobPath'
+// and returns the HTTP response code, like the curl based 'download'
+// above. If the connection breaks or stalls while the blob is being
+// received, the download is resumed with a range request.
+static Future<int> download(
+    const Shared<ConnectionPool>& pool,
+    const string& url,
+    const string& blobPath,
+    const http::Headers& headers,
+    const Option<Duration>& stallTimeout,
+    size_t redirects = 0)
+{
+  Try<http::URL> _url = http::URL::parse(strings::trim(url));
+  if (_url.isError()) {
+    return Failure("Failed to parse URL '" + url + "': " + _url.error());
+  }
+
+  return _download(std::make_shared<Download>(
+      pool,
+      _url.get(),
+      blobPath,
+      headers,
+      stallTimeout,
+      redirects));
+}
+
+
+static Future<int> _download(const std::shared_ptr<Download>& download)
+{
+  http::Request request;
+  request.method = "GET";
+  request.url = download->url;
+  request.headers = download->headers;
+
+  if (download->offset > 0) {
+    request.headers["Range"] = "bytes=" + stringify(download->offset) + "-";
+  }
+
+  Future<http::Response> response = download->pool->send(request, true);
+
+  if (download->stallTimeout.isSome()) {
+    response = response.after(
+        download->stallTimeout.get(),
+        [](Future<http::Response> response) -> Future<http::Response> {
+          response.discard();
+          return Failure("Timed out waiting for a response");
+        });
+  }
+
+  return response
+    .then([download](const http::Response& response) -> Future<int> {
+      CHECK_SOME(response.reader);
+      http::Pipe::Reader reader = response.reader.get();
+
+      if (response.code != http::Status::OK &&
+          response.code != http::Status::PARTIAL_CONTENT) {
+        reader.close();
+
+        Option<string> redirect = getRedirectUrl(download->url, response);
+        if (redirect.isNone() || download->offset > 0) {
+          return response.code;
+        }
+
+        if (download->redirects >= MAX_REDIRECTS) {
+          return Failure(
+              "Too many redirects when downloading '" +
+              stringify(download->url) + "'");
+        }
+
+        // Headers are not attached because the request is already
+        // authenticated, like in the curl based 'download' above.
+        return uri::download(
+            download->pool,
+            redirect.get(),
+            download->blobPath,
+            http::Headers(),
+            download->stallTimeout,
+            download->redirects + 1);
+      }
+
+      if (response.code == http::Status::PARTIAL_CONTENT &&
+          !strings::startsWith(
+              response.headers.get("Content-Range").getOrElse(""),
+              "bytes " + stringify(download->offset) + "-")) {
+        reader.close();
+
+        return Failure(
+            "Unexpected range '" +
+            response.headers.get("Content-Range").getOrElse("") +
+            "' when resuming the download of '" +
+            stringify(download->url) + "'");
+      }
+
+      if (download->fd.isNone()) {
+        Try<int_fd> fd = os::open(
+            download->blobPath,
+            O_WRONLY | O_CREAT | O_TRUNC | O_NONBLOCK | O_CLOEXEC,
+            S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+        if (fd.isError()) {
+          reader.close();
+
+          return Failure(
+              "Failed to open '" + download->blobPath + "': " + fd.error());
+        }
+
+        download->fd = fd.get();
+      }
+
+      // If the server ignored the range, skip the part of the blob
+      // that has been written already.
+      std::shared_ptr<size_t> skip = std::make_shared<size_t>(
+          response.code == http::Status::OK ? download->offset : 0);
+
+      // Whether receiving the blob failed, as opposed to writing it.
+      std::shared_ptr<bool> interrupted = std::make_shared<bool>(false);
+
+      return process::loop(
+          [=]() mutable {
+            Future<string> data = reader.read();
+
+            if (download->stallTimeout.isSome()) {
+              data = data.after(
+                  download->stallTimeout.get(),
+                  [](Future<string> data) -> Future<string> {
+                    data.discard();
+                    return Failure("The download stalled");
+                  });
+            }
+
+            return data
+              .repair([interrupted](const Future<string>& data) {
+                *interrupted = true;
+                return data;
+              });
+          },
+          [=](const string& data) -> Future<ControlFlow<Nothing>> {
+            if (data.empty()) {
+              return Break();
+            }
+
+            const size_t skipped = std::min(*skip, data.size());
+            *skip -= skipped;
+
+            if (skipped == data.size()) {
+              return Continue();
+            }
+
+            const string remaining = data.substr(skipped);
+
+            return io::write(download->fd.get(), remaining)
+              .then([download, remaining]() -> ControlFlow<Nothing> {
+                download->offset += remaining.size();
+                return Continue();
+              });
+          })
+        .then([]() -> int { return http::Status::OK; })
+        .repair([=](const Future<int>& result) mutable -> Future<int> {
+          reader.close();
+
+          if (!*interrupted || download->resumes >= MAX_DOWNLOAD_RESUMES) {
+            return result;
+          }
+
+          download->resumes++;
+
+          LOG(WARNING) << "Resuming the download of '" << download->url
+                       << "' at byte " << download->offset << ": "
+                       << result.failure();
+
+          return _download(download);
+        });
+    });
+}
+
+
 // Returns the 'Basic' credential as a header for pulling an image
 // from a registry, if the host of the image's repository exists in
 // the docker config file, or empty if there is none.
@@ -445,6 +792,22 @@ static http::Headers getAuthHeaderBearer(
 }
 
 
+// Returns the key of the token obtained for the repository in the
+// registry of the URI with the given 'Basic' credential, if any.
+static string getAuthTokenKey(
+    const string& repository,
+    const URI& uri,
+    const http::Headers& basicAuthHeaders)
+{
+  const string registry = uri.has_port()
+    ? uri.host() + ":" + stringify(uri.port())
+    : uri.host();
+
+  return registry + "/" + repository + " " +
+    basicAuthHeaders.get("Authorization").getOrElse("");
+}
+
+
 static URI constructRegistryUri(const URI& imageUri, string&& path)
 {
   const string scheme = imageUri.has_fragment() ? imageUri.fragment() : "https";
@@ -526,10 +889,12 @@ public:
   DockerFetcherPluginProcess(
       const hashmap<string, spec::Config::Auth>& _auths,
       const Option<Duration>& _stallTimeout,
+      const Option<Shared<ConnectionPool>>& _pool,
       bool _enableAuthServiceUriFallback)
     : ProcessBase(process::ID::generate("docker-fetcher-plugin")),
       auths(_auths),
       stallTimeout(_stallTimeout),
+      pool(_pool),
       enableAuthServiceUriFallback(_enableAuthServiceUriFallback) {}
 
   Future<Nothing> fetch(
@@ -583,6 +948,24 @@ private:
       vector<string> urls);
 #endif
 
+  // Sends a GET request with the native HTTP client if it is enabled,
+  // or with the curl command otherwise.
+  Future<http::Response> get(
+      const string& url,
+      const http::Headers& headers) const;
+
+  Future<http::Response> get(
+      const URI& uri,
+      const http::Headers& headers) const;
+
+  // Downloads the blob with the native HTTP client if it is enabled,
+  // or with the curl command otherwise.
+  Future<int> download(
+      const URI& uri,
+      const string& url,
+      const string& directory,
+      const http::Headers& headers) const;
+
   Future<string> getAuthServiceUri(
       const string& repository,
       const URI& initialUri,
@@ -597,6 +980,13 @@ private:
       const http::Headers& basicAuthHeaders,
       const http::Response& response);
 
+  // Returns the token-based authorization header obtained for the
+  // repository with the given credential before, if it is still valid.
+  Option<http::Headers> getCachedAuthHeader(
+      const string& repository,
+      const URI& uri,
+      const http::Headers& basicAuthHeaders);
+
   // This is a lookup table for credentials in docker config file,
   // keyed by registry URL.
   // For example, "https://index.docker.io/v1/" -> spec::Config::Auth
@@ -605,6 +995,20 @@ private:
   // Timeout for curl to wait when a net download stalls.
   const Option<Duration> stallTimeout;
 
+  // The connections of the native HTTP client, if it is enabled.
+  const Option<Shared<ConnectionPool>> pool;
+
+  // The tokens obtained from auth services, keyed by the registry,
+  // the repository and the credential used to obtain them, so that
+  // the following requests do not have to authenticate again.
+  struct AuthToken
+  {
+    http::Headers headers;
+    process::Time expiry;
+  };
+
+  hashmap<string, AuthToken> tokens;
+
   // Disables auth server URI generation (see MESOS-10092).
   // Used for tests only.
   const bool enableAuthServiceUriFallback;
@@ -622,6 +1026,30 @@ DockerFetcherPlugin::Flags::Flags()
       "Amount of time for the fetcher to wait before considering a download\n"
       "being too slow and abort it when the download stalls (i.e., the speed\n"
       "keeps below one byte per second).");
+
+  add(&Flags::docker_registry_native_client,
+      "docker_registry_native_client",
+      "Whether to send the requests to Docker registries with the HTTP\n"
+      "client built into libprocess instead of running a 'curl' command for\n"
+      "each of them. The native client keeps the connections to a registry\n"
+      "open across requests and resumes interrupted blob downloads.\n"
+      "NOTE: HTTPS registries require libprocess to be built with SSL.",
+      false);
+
+  add(&Flags::docker_registry_max_connections,
+      "docker_registry_max_connections",
+      "Maximum number of connections the native client opens to a single\n"
+      "Docker registry (or other server, e.g., the auth service). Requests\n"
+      "wait for an idle connection once the limit is reached.",
+      3,
+      [](const size_t& value) -> Option<Error> {
+        if (value == 0) {
+          return Error(
+              "Expected --docker_registry_max_connections to be positive");
+        }
+
+        return None();
+      });
 }
 
 
@@ -646,9 +1074,21 @@ Try<Owned<Fetcher::Plugin>> DockerFetcherPlugin::create(
     auths = cachedAuths.get();
   }
 
+  Option<Shared<ConnectionPool>> pool;
+  if (flags.docker_registry_native_client) {
+#ifndef USE_SSL_SOCKET
+    LOG(WARNING) << "The native Docker registry client only supports HTTP "
+                 << "registries because SSL is not enabled";
+#endif // USE_SSL_SOCKET
+
+    pool = Owned<ConnectionPool>(
+        new ConnectionPool(flags.docker_registry_max_connections)).share();
+  }
+
   Owned<DockerFetcherPluginProcess> process(new DockerFetcherPluginProcess(
       hashmap<string, spec::Config::Auth>(auths),
       flags.docker_stall_timeout,
+      pool,
       enableAuthServiceUriFallback));
 
   return Owned<Fetcher::Plugin>(new DockerFetcherPlugin(process));
@@ -792,7 +1232,14 @@ Future<Nothing> DockerFetcherPluginProcess::fetch(
     }
   };
 
-  return curl(manifestUri, manifestHeaders + basicAuthHeaders, stallTimeout)
+  // Use the token obtained for the repository before, if any, instead
+  // of authenticating again.
+  Option<http::Headers> authHeaders =
+    getCachedAuthHeader(uri.path(), manifestUri, basicAuthHeaders);
+
+  return get(
+      manifestUri,
+      manifestHeaders + authHeaders.getOrElse(basicAuthHeaders))
     .then(defer(self(),
                 &Self::_fetch,
                 uri,
@@ -817,7 +1264,7 @@ Future<Nothing> DockerFetcherPluginProcess::_fetch(
     return getAuthHeader(uri.path(), manifestUri, basicAuthHeaders, response)
       .then(defer(self(), [=](
           const http::Headers& authHeaders) -> Future<Nothing> {
-        return curl(manifestUri, manifestHeaders + authHeaders, stallTimeout)
+        return get(manifestUri, manifestHeaders + authHeaders)
           .then(defer(self(),
                       &Self::__fetch,
                       uri,
@@ -983,12 +1430,16 @@ Future<Nothing> DockerFetcherPluginProcess::fetchBlob(
 {
   URI blobUri = getBlobUri(uri);
 
+  // Use the token obtained for the repository before, if any, instead
+  // of authenticating again.
+  Option<http::Headers> cachedAuthHeaders =
+    getCachedAuthHeader(uri.path(), blobUri, authHeaders);
+
   return download(
       blobUri,
       strings::trim(stringify(blobUri)),
       directory,
-      authHeaders,
-      stallTimeout)
+      cachedAuthHeaders.getOrElse(authHeaders))
     .then(defer(self(), [=](int code) -> Future<Nothing> {
       if (code == http::Status::UNAUTHORIZED) {
         // If we get a '401 Unauthorized', we assume that 'authHeaders'
@@ -1023,7 +1474,7 @@ Future<Nothing> DockerFetcherPluginProcess::_fetchBlob(
   // HTTP headers from 'download'. Currently, 'download' only returns
   // the HTTP response code because we don't support parsing HTTP
   // headers alone. Revisit this once that's supported.
-  return curl(blobUri, basicAuthHeaders, stallTimeout)
+  return get(blobUri, basicAuthHeaders)
     .then(defer(self(), [=](const http::Response& response) -> Future<Nothing> {
       // We expect a '401 Unauthorized' response here since the
       // 'download' with the same URI returns a '401 Unauthorized'.
@@ -1040,8 +1491,7 @@ Future<Nothing> DockerFetcherPluginProcess::_fetchBlob(
               blobUri,
               strings::trim(stringify(blobUri)),
               directory,
-              authHeaders,
-              stallTimeout)
+              authHeaders)
             .then(defer(self(), [=](int code) -> Future<Nothing> {
               if (code == http::Status::OK) {
                 return Nothing();
@@ -1115,7 +1565,7 @@ Future<Nothing> DockerFetcherPluginProcess::_urlFetchBlob(
 
   string url = urls.back();
   urls.pop_back();
-  return download(blobUri, url, directory, authHeaders, stallTimeout)
+  return download(blobUri, url, directory, authHeaders)
       .then(defer(self(), [=](int code) -> Future<Nothing> {
         if (code == http::Status::OK) {
           return Nothing();
@@ -1181,7 +1631,7 @@ Future<string> DockerFetcherPluginProcess::getAuthServiceUri(
   LOG(WARNING) << msg;
 
   const URI registryRootUri = getRegistryRootUri(initialUri);
-  return curl(registryRootUri, basicAuthHeaders, stallTimeout)
+  return get(registryRootUri, basicAuthHeaders)
     .then([repository, registryRootUri](const http::Response& rootResponse)
       -> Future<string> {
       const Try<hashmap<string, string>> authParam =
@@ -1219,13 +1669,13 @@ Future<http::Headers> DockerFetcherPluginProcess::getAuthHeader(
     const http::Headers& basicAuthHeaders,
     const http::Response& response)
 {
-  const auto stallTimeout = this->stallTimeout;
+  const string key = getAuthTokenKey(repository, uri, basicAuthHeaders);
 
   return getAuthServiceUri(repository, uri, response, basicAuthHeaders)
-    .then([basicAuthHeaders, stallTimeout](const string& authServiceUri) {
-      return curl(authServiceUri, basicAuthHeaders, stallTimeout)
-        .then([authServiceUri](const http::Response& response)
-        -> Future<http::Headers> {
+    .then(defer(self(), [=](const string& authServiceUri) {
+      return get(authServiceUri, basicAuthHeaders)
+        .then(defer(self(), [=](const http::Response& response)
+            -> Future<http::Headers> {
           if (response.code != http::Status::OK) {
             return Failure(
                 "Unexpected HTTP response '" + response.status + "' "
@@ -1247,9 +1697,91 @@ Future<http::Headers> DockerFetcherPluginProcess::getAuthHeader(
             return Failure("Failed to find token in JSON object");
           }
 
-          return getAuthHeaderBearer(token->value);
-        });
-    });
+          // Tokens are valid for 60 seconds unless stated otherwise, see the
+          // token response fields in:
+          // https://docs.docker.com/registry/spec/auth/token/
+          Duration expiresIn = Seconds(60);
+
+          Result<JSON::Number> _expiresIn =
+            object->find<JSON::Number>("expires_in");
+
+          if (_expiresIn.isSome()) {
+            expiresIn = Seconds(_expiresIn->as<int64_t>());
+          }
+
+          // Drop the expired tokens so that the cache does not grow.
+          const process::Time now = process::Clock::now();
+          foreach (const string& cached, tokens.keys()) {
+            if (tokens.at(cached).expiry <= now) {
+              tokens.erase(cached);
+            }
+          }
+
+          const http::Headers headers = getAuthHeaderBearer(token->value);
+          tokens[key] = AuthToken{headers, now + expiresIn};
+
+          return headers;
+        }));
+    }));
+}
+
+
+Option<http::Headers> DockerFetcherPluginProcess::getCachedAuthHeader(
+    const string& repository,
+    const URI& uri,
+    const http::Headers& basicAuthHeaders)
+{
+  const string key = getAuthTokenKey(repository, uri, basicAuthHeaders);
+
+  if (!tokens.contains(key)) {
+    return None();
+  }
+
+  if (tokens.at(key).expiry <= process::Clock::now()) {
+    tokens.erase(key);
+    return None();
+  }
+
+  return tokens.at(key).headers;
+}
+
+
+Future<http::Response> DockerFetcherPluginProcess::get(
+    const string& url,
+    const http::Headers& headers) const
+{
+  if (pool.isSome()) {
+    return uri::get(pool.get(), url, headers, stallTimeout);
+  }
+
+  return curl(url, headers, stallTimeout);
+}
+
+
+Future<http::Response> DockerFetcherPluginProcess::get(
+    const URI& uri,
+    const http::Headers& headers) const
+{
+  return get(stringify(uri), headers);
+}
+
+
+Future<int> DockerFetcherPluginProcess::download(
+    const URI& uri,
+    const string& url,
+    const string& directory,
+    const http::Headers& headers) const
+{
+  if (pool.isSome()) {
+    return uri::download(
+        pool.get(),
+        url,
+        DockerFetcherPlugin::getBlobPath(directory, getBlobSum(uri)),
+        headers,
+        stallTimeout);
+  }
+
+  return uri::download(uri, url, directory, headers, stallTimeout);
 }
 
 
@@ -41,6 +41,8 @@ public:
 
     Option<JSON::Object> docker_config;
     Option<Duration> docker_stall_timeout;
+    bool docker_registry_native_client;
+    size_t docker_registry_max_connections;
   };
 
   static const char NAME[];